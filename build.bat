@@ -31,9 +31,40 @@ cl /EHsc /std:c++17 /I include ^
    src\SystemTrayManager.cpp ^
    src\SettingsWindow.cpp ^
    src\ConfigManager.cpp ^
+   src\CommandBus.cpp ^
+   src\IpcServer.cpp ^
+   src\IpcClient.cpp ^
+   src\StartupProfiler.cpp ^
+   src\Tracer.cpp ^
+   src\Metrics.cpp ^
+   src\SharedStatePage.cpp ^
+   src\AllocationTracker.cpp ^
+   src\TimerService.cpp ^
+   src\MemoryFootprint.cpp ^
+   src\SharedAssets.cpp ^
+   src\ToggleStrategy.cpp ^
+   src\ShellWatcher.cpp ^
+   src\PatternRules.cpp ^
+   src\RemoteListView.cpp ^
+   src\SelectiveHider.cpp ^
+   src\IconLayout.cpp ^
+   src\DisplayTopology.cpp ^
+   src\LayoutStore.cpp ^
+   src\LayoutHistory.cpp ^
+   src\IconSpatialIndex.cpp ^
+   src\MonitorHider.cpp ^
+   src\VirtualDesktopWatcher.cpp ^
+   src\ContextRules.cpp ^
+   src\ContextWatcher.cpp ^
+   src\IdleDetector.cpp ^
+   src\TimerWheel.cpp ^
+   src\IconSchedule.cpp ^
+   src\IconHitGrid.cpp ^
+   src\DesktopClickWatcher.cpp ^
+   src\StrategySelector.cpp ^
    resources\app.res ^
    /Fe:bin\DesktopIconToggler.exe ^
-   /link user32.lib shell32.lib advapi32.lib comctl32.lib gdi32.lib kernel32.lib ole32.lib /SUBSYSTEM:WINDOWS
+   /link user32.lib shell32.lib advapi32.lib comctl32.lib gdi32.lib kernel32.lib ole32.lib psapi.lib shcore.lib /SUBSYSTEM:WINDOWS
 
 if %ERRORLEVEL% neq 0 (
     echo Compilation failed!
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Common.h"
+#include <cstddef>
+#include <cstdint>
+
+// Per-subsystem heap allocation accounting.
+//
+// Counting is compiled in only when DIT_ALLOCATION_ACCOUNTING is defined
+// (CMake option ALLOCATION_ACCOUNTING). Those builds replace the global
+// operator new and attribute each allocation to the subsystem named by the
+// innermost ALLOCATION_SCOPE on the allocating thread. In normal builds the
+// scopes and checks below compile to nothing.
+enum class AllocationSubsystem : uint32_t {
+    Other,
+    App,
+    Desktop,
+    Tray,
+    Config,
+    Ipc,
+    Diagnostics,
+    Count
+};
+
+// Toggles allowed to allocate before NoAllocationCheck starts enforcing
+constexpr uint32_t ALLOCATION_WARMUP_RUNS = 1;
+
+class AllocationTracker {
+public:
+    // Called from the replaced operator new
+    static void RecordAllocation(size_t size);
+    
+    // Totals per subsystem, all threads
+    static uint64_t GetAllocationCount(AllocationSubsystem subsystem);
+    static uint64_t GetAllocatedBytes(AllocationSubsystem subsystem);
+    
+    // Allocations made by the calling thread, all subsystems
+    static uint64_t GetThreadAllocationCount();
+    
+    // Paths that allocated after warmup
+    static uint64_t GetViolationCount();
+    static void ReportViolation(const char* path, uint64_t allocations);
+    
+    static const char* GetSubsystemName(AllocationSubsystem subsystem);
+    static void DumpToDebugOutput();
+    
+    // Returns the previous subsystem so scopes can nest
+    static AllocationSubsystem SetCurrentSubsystem(AllocationSubsystem subsystem);
+};
+
+#ifdef DIT_ALLOCATION_ACCOUNTING
+
+// Attributes allocations in the enclosing scope to one subsystem
+class AllocationScope {
+public:
+    explicit AllocationScope(AllocationSubsystem subsystem)
+        : m_previous(AllocationTracker::SetCurrentSubsystem(subsystem)) {
+    }
+    
+    ~AllocationScope() {
+        AllocationTracker::SetCurrentSubsystem(m_previous);
+    }
+    
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    AllocationSubsystem m_previous;
+};
+
+// Reports a violation if the enclosing scope allocated on this thread.
+// Disarm() on paths that are allowed to allocate (errors, first use).
+class NoAllocationCheck {
+public:
+    NoAllocationCheck(const char* path, bool armed)
+        : m_path(path)
+        , m_armed(armed)
+        , m_before(AllocationTracker::GetThreadAllocationCount()) {
+    }
+    
+    ~NoAllocationCheck() {
+        if (!m_armed) {
+            return;
+        }
+        
+        uint64_t allocations = AllocationTracker::GetThreadAllocationCount() - m_before;
+        if (allocations != 0) {
+            AllocationTracker::ReportViolation(m_path, allocations);
+        }
+    }
+    
+    void Disarm() { m_armed = false; }
+    
+    NoAllocationCheck(const NoAllocationCheck&) = delete;
+    NoAllocationCheck& operator=(const NoAllocationCheck&) = delete;
+
+private:
+    const char* m_path;
+    bool m_armed;
+    uint64_t m_before;
+};
+
+#define ALLOCATION_SCOPE_CONCAT_INNER(a, b) a##b
+#define ALLOCATION_SCOPE_CONCAT(a, b) ALLOCATION_SCOPE_CONCAT_INNER(a, b)
+#define ALLOCATION_SCOPE(subsystem) \
+    AllocationScope ALLOCATION_SCOPE_CONCAT(allocationScope_, __LINE__)(AllocationSubsystem::subsystem)
+
+#else
+
+class NoAllocationCheck {
+public:
+    NoAllocationCheck(const char*, bool) {}
+    void Disarm() {}
+};
+
+#define ALLOCATION_SCOPE(subsystem) ((void)0)
+
+#endif
@@ -6,6 +6,23 @@
 #include "SystemTrayManager.h"
 #include "SettingsWindow.h"
 #include "ConfigManager.h"
+#include "CommandBus.h"
+#include "IpcServer.h"
+#include "SharedStatePage.h"
+#include "SharedAssets.h"
+#include "StartupProfiler.h"
+#include "TimerService.h"
+#include "ShellWatcher.h"
+#include "VirtualDesktopWatcher.h"
+#include "ContextWatcher.h"
+#include "DesktopClickWatcher.h"
+#include "ContextRules.h"
+#include "IdleDetector.h"
+#include "IconSchedule.h"
+#include "MemoryFootprint.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
 
 class Application {
 public:
@@ -19,6 +36,26 @@ public:
     
     // Singleton access
     static Application* GetInstance();
+    
+    // Queue a command as if it came from the tray or hotkey
+    bool PostCommand(CommandType type);
+    
+    // Startup measurement (see --measure-startup)
+    bool WriteStartupReport(const std::wstring& path);
+    bool IsStartupWithinBudget() const;
+    
+    // Idle measurement (see --measure-idle): runs the message loop for the
+    // given time and returns how often the UI thread woke up
+    uint64_t MeasureIdleWakeups(DWORD durationMs);
+    
+    // Memory footprint (see --measure-footprint and [Memory] FootprintMode)
+    void TrimFootprint();
+    bool WriteFootprintReport(const std::wstring& path, bool& withinBudget);
+    
+    // Virtual desktop switch measurement (see --measure-desktop-switch):
+    // simulated switches between desktops with different remembered states.
+    // allApplied is false if a switch was not applied within two seconds.
+    bool MeasureDesktopSwitches(const std::wstring& path, uint32_t count, bool& allApplied);
 
     // Message handling
     static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -37,19 +74,153 @@ private:
     void OnExit();
     void OnHotkeyPressed();
     void OnSettingsChanged();
+    void OnSettingsClosed();
+    void OnSettingsIdleTimeout();
+    void OnTimerService();
+    
+    // Puts the desktop back the way it is without this process, for exit
+    // and for a session that ends before exit
+    void ReleaseDesktop();
+    void OnEndSession();
+    
+    // Explorer's desktop or taskbar appeared (at logon or after a restart)
+    void OnShellReady();
+    void OnTaskbarCreated();
+    void OnDesktopAvailable();
+    void ApplyRememberedState();
+    
+    // Layouts are captured after icons move, for the per-display store and
+    // the history; per-display ones are restored after the setup changes
+    void UpdateLayoutRecording();
+    void OnDisplayChange();
+    void OnIconsMoved();
+    void OnDisplayLayoutRestore();
+    
+    // Layout history; pending captures are recorded first
+    void FlushLayoutCapture();
+    void OnUndoLayout();
+    void OnRestoreLayoutAt(uint32_t minutesAgo);
+    
+    // Icons of the monitor under the cursor, or under a point such as a
+    // double click; with a single monitor the whole desktop is toggled
+    // instead
+    void OnToggleMonitorIcons();
+    void OnToggleMonitorIconsAt(POINT screenPoint);
+    void ApplyRememberedMonitors();
+    
+    // Icon state per virtual desktop. A switch schedules the apply; a later
+    // switch before it runs replaces it.
+    void UpdateDesktopWatching();
+    void OnVirtualDesktopChanged();
+    void OnVirtualDesktopApply();
+    void RememberDesktopState();
+    
+    // Context rules. An event only schedules the change; the context must
+    // still want it when the timer fires (hysteresis). A manual toggle
+    // overrides the rules until they stop wanting the icons hidden, and
+    // ends an idle or timed hide.
+    void UpdateContextRules();
+    void OnContextChanged();
+    void OnContextRulesTimer();
+    bool EvaluateContext();
+    bool NoteManualToggle(); // True if it changed the settings
+    
+    // Idle hiding: one deadline while active, raw input while idle
+    void UpdateIdleHiding();
+    void ArmIdleDeadline();
+    void OnIdleDeadline();
+    void OnIdleInput();
+    
+    // Daily windows and timed hides, each on its own cookie timer. Their
+    // deadlines come from the wall clock, so they are set again after a
+    // resume or a clock change.
+    void UpdateSchedules();
+    void ArmScheduleTimers();
+    void ApplySchedules();
+    void OnHideIconsFor(uint32_t minutes);
+    void OnScheduleTimer(uint64_t cookie);
+    void OnClockChanged();
+    
+    // Double-clicks reach the UI thread as commands; only those on empty
+    // desktop space toggle the icons
+    void UpdateDoubleClickToggle();
+    void OnDesktopDoubleClick(POINT screenPoint);
+    
+    // Restarts the idle countdown before a footprint trim
+    void NoteActivity();
+    void CollectFootprint(MemoryFootprint& footprint);
+    void OnDumpTrace();
+    void OnSaveLayout();
+    void OnRestoreLayout();
+    
+    // Command dispatch
+    void DrainCommands();
+    void DispatchCommand(const Command& command);
+    
+    // Dispatches everything queued; returns false once WM_QUIT is seen
+    bool PumpMessages(int& exitCode);
     
     // Utility methods
-    void ShowNotification(const std::wstring& message);
+    void ShowNotification(const wchar_t* message);
+    
+    // Logs settings entries that were ignored; the user is notified once
+    // per distinct set, which is kept in reported
+    void ReportRejectedEntries(const wchar_t* section, const std::vector<std::wstring>& rejected,
+                               std::wstring& reported);
+    // After every change of the icons' visibility: releases them from the
+    // rules, then publishes the new state
+    void OnIconsChanged();
+    // Context rules, idle hiding and schedules own only icons that are hidden
+    void ReleaseShownIcons();
     void UpdateTrayIconState();
     bool RegisterWindowClass();
     
+    // Stores a newly selected toggle strategy in the config; true if it changed
+    bool SaveToggleStrategy();
+    
+    // Settings window is created on demand and released when idle
+    SettingsWindow* EnsureSettingsWindow();
+    void ReleaseSettingsWindow();
+    
     // Application state
     HINSTANCE m_hInstance;
     HWND m_mainWindow;
     bool m_initialized;
     bool m_running;
+    StartupProfiler m_startupProfiler;
+    uint32_t m_toggleCount; // For the zero-allocation check warmup
+    DWORD m_monitorToggleTick; // When icons were last moved by a monitor toggle
+    GUID m_currentDesktop;     // Virtual desktop last switched to
+    bool m_hasCurrentDesktop;
+    LONGLONG m_desktopSwitchTime; // Signal time of the pending switch
+    uint32_t m_desktopSwitchesApplied;
+    uint64_t m_lastDesktopSwitchUs;
+    ContextRules m_contextRules;
+    std::wstring m_rejectedKeepPatterns; // Last reported by ReportRejectedEntries()
+    bool m_contextHiding;   // Icons are hidden because of the rules
+    bool m_contextOverride; // The user toggled while the rules wanted them hidden
+    bool m_contextWantsHide; // Result of the last evaluation
+    IdleDetector m_idleDetector;
+    bool m_idleHiding; // Icons are hidden because the user is idle
+    IconSchedule m_schedule;
+    std::vector<TimerWheel::Handle> m_scheduleTimers; // One per window
+    std::wstring m_rejectedScheduleWindows; // Last reported by ReportRejectedEntries()
+    TimerWheel::Handle m_timedHideTimer;
+    bool m_scheduleHiding;    // Icons are hidden by a window or timed hide
+    bool m_scheduleOverride;  // The user toggled while one wanted them hidden
+    bool m_scheduleWantsHide; // Result of the last ApplySchedules()
     
     // Component managers
+    std::unique_ptr<CommandBus> m_commandBus;
+    std::unique_ptr<TimerService> m_timerService;
+    std::unique_ptr<ShellWatcher> m_shellWatcher;
+    std::unique_ptr<VirtualDesktopWatcher> m_desktopWatcher;
+    std::unique_ptr<ContextWatcher> m_contextWatcher;
+    std::unique_ptr<DesktopClickWatcher> m_clickWatcher;
+    std::unique_ptr<IpcServer> m_ipcServer;
+    std::unique_ptr<SharedStatePublisher> m_sharedState;
+    std::unique_ptr<SharedAssetStore> m_sharedAssets;
+    std::unique_ptr<MetricsExporter> m_metricsExporter;
     std::unique_ptr<DesktopIconManager> m_desktopIconManager;
     std::unique_ptr<HotkeyManager> m_hotkeyManager;
     std::unique_ptr<SystemTrayManager> m_systemTrayManager;
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Common.h"
+#include "MpscQueue.h"
+
+// Commands understood by the application. Every input (hotkey, tray,
+// menu, other threads) is turned into one of these and handled on the UI
+// thread when the main loop drains the bus.
+enum class CommandType : uint32_t {
+    None,
+    ToggleIcons,
+    ShowIcons,
+    HideIcons,
+    ShowSettings,
+    ReloadSettings,
+    DumpTrace,
+    SaveLayout,
+    RestoreLayout,
+    UndoLayout,
+    RestoreLayoutAt, // argument: minutes back from now
+    ToggleMonitorIcons, // Monitor under the mouse cursor
+    HideIconsFor, // argument: minutes until they are shown again
+    DesktopDoubleClick, // argument: screen point, MAKELONG(x, y)
+    Exit
+};
+
+enum class CommandSource : uint32_t {
+    Internal,
+    Hotkey,
+    Tray,
+    Menu,
+    Ipc,
+    Mouse
+};
+
+// Fixed-size and trivially copyable so it can live in the lock-free queue.
+// A non-zero cookie asks the dispatcher to report completion back to the
+// producer (see IpcServer::CompleteRequest).
+struct Command {
+    CommandType type = CommandType::None;
+    CommandSource source = CommandSource::Internal;
+    uint32_t argument = 0;
+    uint32_t reserved = 0;
+    uint64_t cookie = 0;
+};
+
+class CommandBus {
+public:
+    CommandBus();
+    ~CommandBus();
+
+    // Initialization
+    bool Initialize(HWND targetWindow);
+    void Cleanup();
+    
+    // Producer side, safe from any thread
+    bool Post(const Command& command);
+    bool Post(CommandType type, CommandSource source, uint32_t argument = 0);
+    
+    // Posts every command, back to back, or none if they do not all fit
+    bool PostAll(const Command* commands, size_t count);
+    
+    // Consumer side, UI thread only. Call when WM_COMMAND_BUS arrives and
+    // keep calling until it returns false.
+    void BeginDrain();
+    bool TryTake(Command& command);
+    
+    // Statistics
+    uint64_t GetDroppedCount() const;
+
+    static constexpr size_t QUEUE_CAPACITY = 256;
+    
+private:
+    void Wake();
+    
+    
+    MpscQueue<Command, QUEUE_CAPACITY> m_queue;
+    std::atomic<HWND> m_targetWindow;
+    
+    // Set while a wake-up message is in flight so producers post at most one
+    std::atomic<bool> m_wakePending;
+    std::atomic<uint64_t> m_droppedCount;
+};
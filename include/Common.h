@@ -26,14 +26,101 @@
 constexpr int WM_TRAYICON = WM_USER + 1;
 constexpr int WM_HOTKEY_PRESSED = WM_USER + 2;
 constexpr int WM_SETTINGS_CHANGED = WM_USER + 3;
+constexpr int WM_SETTINGS_CLOSED = WM_USER + 4;
+constexpr int WM_COMMAND_BUS = WM_USER + 5;
+constexpr int WM_SHELL_READY = WM_USER + 6;
+constexpr int WM_ICONS_MOVED = WM_USER + 7;
+constexpr int WM_VIRTUAL_DESKTOP_CHANGED = WM_USER + 8;
+constexpr int WM_CONTEXT_CHANGED = WM_USER + 9;
+constexpr int WM_APPBAR_NOTIFY = WM_USER + 10;
 
 constexpr int ID_TRAY_ICON = 1001;
 constexpr int ID_MENU_TOGGLE = 1002;
 constexpr int ID_MENU_SETTINGS = 1003;
 constexpr int ID_MENU_EXIT = 1004;
+constexpr int ID_MENU_SAVE_LAYOUT = 1005;
+constexpr int ID_MENU_RESTORE_LAYOUT = 1006;
+constexpr int ID_MENU_UNDO_LAYOUT = 1007;
+constexpr int ID_MENU_LAYOUT_HOUR_AGO = 1008;
+constexpr int ID_MENU_LAYOUT_DAY_AGO = 1009;
+constexpr int ID_MENU_LAYOUT_WEEK_AGO = 1010;
+constexpr int ID_MENU_TOGGLE_MONITOR = 1011;
+constexpr int ID_MENU_HIDE_FOR = 1012;
 
 constexpr int ID_HOTKEY_TOGGLE = 2001;
 
+// Timers. All timed work goes through TimerService, which owns this one
+// Win32 timer and keeps it disarmed while nothing is scheduled.
+constexpr UINT_PTR ID_TIMER_SERVICE = 4001;
+constexpr DWORD TIMER_DEFAULT_TOLERANCE_MS = 1000;
+
+// An idle instance should wake its UI thread at most this often;
+// checked by --measure-idle.
+constexpr double IDLE_WAKEUP_BUDGET_PER_MINUTE = 1.0;
+constexpr DWORD IDLE_MEASURE_DEFAULT_SECONDS = 60;
+
+// The settings window is created on first use and released again once it
+// has been closed for this long.
+constexpr UINT SETTINGS_IDLE_RELEASE_MS = 60 * 1000;
+
+// Opening the settings window (including re-creating it after release)
+// should stay below this budget.
+constexpr double SETTINGS_OPEN_BUDGET_MS = 50.0;
+
+// A second launch forwards its command line to the running instance and
+// exits; the whole round trip should fit in this budget.
+constexpr double SECOND_LAUNCH_BUDGET_MS = 50.0;
+constexpr DWORD FORWARD_CONNECT_TIMEOUT_MS = 2000;
+constexpr DWORD FORWARD_RESPONSE_TIMEOUT_MS = 5000; // The batch runs before the answer
+
+// Visibility changes timed per toggle strategy before the fastest one is
+// kept (see DesktopIconManager)
+constexpr UINT TOGGLE_CALIBRATION_SAMPLES = 2;
+
+// Keep patterns read from the [Selective] section (Keep1..KeepN)
+constexpr int MAX_SELECTIVE_RULES = 64;
+
+// Hidden monitors remembered in the [Monitors] section (Hidden1..HiddenN).
+// Moves reported this soon after a monitor toggle are the toggle's own and
+// do not invalidate the icon index.
+constexpr int MAX_HIDDEN_MONITORS = 16;
+constexpr DWORD MONITOR_TOGGLE_MOVE_GRACE_MS = 500;
+
+// Icon state per virtual desktop, kept in [VirtualDesktopStates]. Switches
+// in quick succession (Ctrl+Win+Arrow held down) only apply the last one.
+constexpr int MAX_DESKTOP_STATES = 64;
+constexpr DWORD VIRTUAL_DESKTOP_APPLY_DELAY_MS = 100;
+constexpr uint32_t DESKTOP_SWITCH_MEASURE_COUNT = 40;
+
+// Context rules from the [Rules] section (Hide1..HideN, Ignore1..IgnoreN).
+// A context must hold this long before the icons follow it, so alt-tabbing
+// through a fullscreen app does not flash the desktop; showing waits longer
+// than hiding.
+constexpr int MAX_CONTEXT_RULES = 4096;
+constexpr DWORD CONTEXT_HIDE_DELAY_MS = 500;
+constexpr DWORD CONTEXT_SHOW_DELAY_MS = 2000;
+
+// Daily hide windows from the [Schedule] section (Hide1..HideN), and the
+// length of "Hide Icons for 25 Minutes" in the tray menu
+constexpr int MAX_SCHEDULE_WINDOWS = 32;
+constexpr uint32_t TIMED_HIDE_MINUTES = 25;
+
+// Idle hiding ([Idle] HideAfterMinutes). The deadline only decides when to
+// look at the last input again, so it can fire a little late.
+constexpr int MAX_IDLE_HIDE_MINUTES = 24 * 60;
+constexpr DWORD IDLE_DEADLINE_TOLERANCE_MS = 1000;
+
+// Per-display layouts. Explorer rearranges the icons itself right after a
+// display change, so the stored layout is applied once that has settled;
+// icon moves are captured once the user has stopped dragging.
+constexpr DWORD DISPLAY_LAYOUT_RESTORE_DELAY_MS = 2000;
+constexpr DWORD LAYOUT_CAPTURE_DELAY_MS = 5000;
+
+// How far back the layout history entries of the tray menu go
+constexpr uint32_t LAYOUT_HOUR_AGO_MINUTES = 60;
+constexpr uint32_t LAYOUT_DAY_AGO_MINUTES = 24 * 60;
+constexpr uint32_t LAYOUT_WEEK_AGO_MINUTES = 7 * 24 * 60;
+
 // Settings window controls
 constexpr int ID_HOTKEY_CTRL = 3001;
 constexpr int ID_HOTKEY_ALT = 3002;
@@ -51,6 +138,17 @@ constexpr const wchar_t* APP_VERSION = L"1.0.0";
 constexpr const wchar_t* CONFIG_FILE = L"settings.ini";
 constexpr const wchar_t* WINDOW_CLASS_NAME = L"DesktopIconTogglerClass";
 constexpr const wchar_t* SETTINGS_CLASS_NAME = L"DesktopIconTogglerSettingsClass";
+constexpr const wchar_t* TRACE_FILE = L"trace.json";
+constexpr const wchar_t* CRASH_TRACE_FILE = L"crash-trace.json";
+constexpr const wchar_t* METRICS_FILE = L"metrics.prom";
+constexpr const wchar_t* LAYOUT_FILE = L"layout.bin";
+constexpr const wchar_t* LAYOUT_STORE_FILE = L"layouts.dat";
+constexpr const wchar_t* LAYOUT_HISTORY_FILE = L"layout-history.dat";
+constexpr const wchar_t* HIDDEN_ICONS_FILE = L"hidden-icons.bin";
+
+// Layout-independent key name from the shared asset section, or nullptr
+// (see SharedAssetStore)
+const wchar_t* LookupSharedKeyName(UINT vkCode);
 
 // Hotkey structure
 struct HotkeyConfig {
@@ -76,6 +174,13 @@ struct HotkeyConfig {
         if (shift) result += L"Shift+";
         if (win) result += L"Win+";
         
+        // Fixed names first; GetKeyNameText mislabels navigation keys
+        const wchar_t* sharedName = LookupSharedKeyName(vkCode);
+        if (sharedName) {
+            result += sharedName;
+            return result;
+        }
+        
         // Convert virtual key code to string
         wchar_t keyName[256];
         UINT scanCode = MapVirtualKey(vkCode, MAPVK_VK_TO_VSC);
@@ -112,6 +217,20 @@ inline std::wstring GetLastErrorString() {
     return message;
 }
 
+// Directory containing the executable, without a trailing backslash
+inline std::wstring GetModuleDirectory() {
+    wchar_t path[MAX_PATH];
+    GetModuleFileName(nullptr, path, MAX_PATH);
+    
+    std::wstring fullPath(path);
+    size_t lastSlash = fullPath.find_last_of(L'\\');
+    if (lastSlash != std::wstring::npos) {
+        return fullPath.substr(0, lastSlash);
+    }
+    
+    return L".";
+}
+
 inline void ShowErrorMessage(const std::wstring& message, const std::wstring& title = L"Error") {
     MessageBox(nullptr, message.c_str(), title.c_str(), MB_OK | MB_ICONERROR);
 }
@@ -1,7 +1,79 @@
 #pragma once
 
 #include "Common.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
 
+// Remembered icon state of one virtual desktop
+struct DesktopIconState {
+    GUID desktop;
+    IconState state;
+};
+
+// Immutable copy of the persisted settings, apart from the last icon state
+// and the per-desktop states, which ConfigManager keeps on their own. A published snapshot is never
+// modified; writers copy it, change the copy and publish that instead.
+struct ConfigSnapshot {
+    HotkeyConfig hotkeyConfig;
+    bool startWithWindows = false;
+    bool showNotifications = true;
+    bool rememberState = true;
+    bool tracingEnabled = true;
+    bool metricsEnabled = false;
+    std::wstring metricsFilePath; // Empty = metrics.prom next to the executable
+    int metricsIntervalSeconds = 15;
+    bool footprintMode = false;
+    int trimIdleSeconds = 300;
+    std::wstring toggleStrategy; // Empty = calibrate on the next toggles
+    bool doubleClickToggle = false;
+    bool selectiveMode = false;
+    std::vector<std::wstring> keepPatterns; // Edited in the file only
+    bool layoutPerDisplay = true;
+    bool layoutHistory = true;
+    int historyRetentionDays = 30; // 0 = keep forever
+    int historyMaxSizeKB = 4096;   // 0 = unlimited
+    bool perMonitor = false;
+    std::vector<std::wstring> hiddenMonitors; // Device names
+    bool perDesktop = false;
+    bool contextRules = false;
+    bool hideWhenFullscreen = true;
+    bool hideWhenPresenting = true;
+    std::vector<std::wstring> hideProcesses;   // Edited in the file only
+    std::vector<std::wstring> ignoreProcesses; // Edited in the file only
+    int idleHideMinutes = 0; // 0 = never
+    std::vector<std::wstring> scheduleWindows; // "HH:MM-HH:MM", edited in the file only
+    ULONGLONG hiddenUntil = 0; // UTC FILETIME ticks, 0 = no timed hide
+};
+
+class ConfigManager;
+
+// Keeps a snapshot alive while it is in use. Cheap to acquire from any
+// thread; hold it only for as long as the settings are being read.
+class ConfigSnapshotRef {
+public:
+    ConfigSnapshotRef(ConfigSnapshotRef&& other) noexcept;
+    ~ConfigSnapshotRef();
+    
+    const ConfigSnapshot* operator->() const { return m_snapshot; }
+    const ConfigSnapshot& operator*() const { return *m_snapshot; }
+
+private:
+    friend class ConfigManager;
+    ConfigSnapshotRef(const ConfigManager* owner, const ConfigSnapshot* snapshot,
+                      std::atomic<const ConfigSnapshot*>* slot);
+    ConfigSnapshotRef(const ConfigSnapshotRef&) = delete;
+    ConfigSnapshotRef& operator=(const ConfigSnapshotRef&) = delete;
+    
+    const ConfigManager* m_owner;
+    const ConfigSnapshot* m_snapshot;
+    std::atomic<const ConfigSnapshot*>* m_slot; // Null when counted as a shared reader
+};
+
+// Settings can be read from any thread without locks. The getters below each
+// read one field of the current snapshot; use GetSnapshot() when several
+// fields must come from the same version.
 class ConfigManager {
 public:
     ConfigManager();
@@ -12,6 +84,13 @@ public:
     bool LoadSettings();
     bool SaveSettings();
     
+    // Consistent view of all settings. Any thread.
+    ConfigSnapshotRef GetSnapshot() const;
+    
+    // Copies the current snapshot, applies the change and publishes the result
+    // as one new version. Writers are serialized; readers are never blocked.
+    void Update(const std::function<void(ConfigSnapshot&)>& change);
+    
     // Hotkey configuration
     HotkeyConfig GetHotkeyConfig() const;
     void SetHotkeyConfig(const HotkeyConfig& config);
@@ -29,27 +108,131 @@ public:
     IconState GetLastIconState() const;
     void SetLastIconState(IconState state);
     
+    // Diagnostics
+    bool GetTracingEnabled() const;
+    void SetTracingEnabled(bool enable);
+    
+    bool GetMetricsEnabled() const;
+    void SetMetricsEnabled(bool enable);
+    
+    std::wstring GetMetricsFilePath() const;
+    void SetMetricsFilePath(const std::wstring& path);
+    
+    int GetMetricsIntervalSeconds() const;
+    void SetMetricsIntervalSeconds(int seconds);
+    
+    // Startup phase budgets in milliseconds (0 = none)
+    int GetStartupBudgetMs(const std::wstring& phase);
+    
+    // Memory footprint
+    bool GetFootprintMode() const;
+    void SetFootprintMode(bool enable);
+    
+    int GetTrimIdleSeconds() const;
+    void SetTrimIdleSeconds(int seconds);
+    
+    // Toggle strategy picked by calibration (see DesktopIconManager)
+    std::wstring GetToggleStrategy() const;
+    void SetToggleStrategy(const std::wstring& name);
+    
+    // Selective mode; keep patterns are only ever read from the file
+    bool GetSelectiveMode() const;
+    void SetSelectiveMode(bool enable);
+    
+    // Icon layouts kept per monitor setup and restored on display changes
+    bool GetLayoutPerDisplay() const;
+    void SetLayoutPerDisplay(bool enable);
+    
+    // Layout history for undo and going back in time
+    bool GetLayoutHistory() const;
+    void SetLayoutHistory(bool enable);
+    
+    // Hotkey and tray toggle only the monitor under the cursor
+    bool GetPerMonitor() const;
+    void SetPerMonitor(bool enable);
+    
+    // Monitors whose icons were hidden, for RememberState
+    std::vector<std::wstring> GetHiddenMonitors() const;
+    void SetHiddenMonitors(const std::vector<std::wstring>& devices);
+    
+    // Icon state remembered per virtual desktop
+    bool GetPerDesktop() const;
+    void SetPerDesktop(bool enable);
+    bool GetDesktopIconState(const GUID& desktop, IconState& state) const;
+    void SetDesktopIconState(const GUID& desktop, IconState state);
+    void RemoveDesktopIconState(const GUID& desktop);
+    
+    // Drops the state of desktops that no longer exist
+    void PruneDesktopIconStates(const std::vector<GUID>& existing);
+    
+    // Context rules; the process lists are only ever read from the file
+    bool GetContextRules() const;
+    void SetContextRules(bool enable);
+    
+    // Minutes without input before the icons are hidden (0 = never)
+    int GetIdleHideMinutes() const;
+    void SetIdleHideMinutes(int minutes);
+    
+    // End of a timed hide as a UTC FILETIME (0 = none), so it survives a
+    // restart; the daily windows are only ever read from the file
+    ULONGLONG GetHiddenUntil() const;
+    void SetHiddenUntil(ULONGLONG fileTime);
+    
+    // Working set budget for --measure-footprint in KB (0 = none)
+    int GetWorkingSetBudgetKB();
+    
+    // Bytes held by the current and retired snapshots
+    size_t GetMemoryUsage();
+    
     // File operations
     std::wstring GetConfigFilePath() const;
     bool ConfigFileExists() const;
     bool CreateDefaultConfig();
 
 private:
+    friend class ConfigSnapshotRef;
+    
+    // Snapshot publication
+    void Publish(ConfigSnapshot* snapshot);
+    void ReclaimRetired() const;
+    void ReleaseReader(const ConfigSnapshot* snapshot, std::atomic<const ConfigSnapshot*>* slot) const;
+    bool IsReferenced(const ConfigSnapshot* snapshot) const;
+    
     // INI file operations
-    std::wstring ReadIniString(const std::wstring& section, const std::wstring& key, const std::wstring& defaultValue);
-    int ReadIniInt(const std::wstring& section, const std::wstring& key, int defaultValue);
-    bool WriteIniString(const std::wstring& section, const std::wstring& key, const std::wstring& value);
-    bool WriteIniInt(const std::wstring& section, const std::wstring& key, int value);
+    std::wstring ReadIniString(const wchar_t* section, const wchar_t* key, const wchar_t* defaultValue);
+    int ReadIniInt(const wchar_t* section, const wchar_t* key, int defaultValue);
+    bool WriteIniString(const wchar_t* section, const wchar_t* key, const wchar_t* value);
+    bool WriteIniInt(const wchar_t* section, const wchar_t* key, int value);
     
     // Path management
     std::wstring GetExecutableDirectory();
     
-    // Settings data
-    HotkeyConfig m_hotkeyConfig;
-    bool m_startWithWindows;
-    bool m_showNotifications;
-    bool m_rememberState;
-    IconState m_lastIconState;
+    // Settings data. Each reader announces the snapshot it holds in a slot
+    // of its own, so readers on different threads share no cache line. A
+    // replaced snapshot is retired and freed by whoever finds it in no slot
+    // any more: the writer, or the last reader to release it.
+    static constexpr size_t READER_SLOTS = 16;
+    struct alignas(64) ReaderSlot {
+        std::atomic<const ConfigSnapshot*> snapshot{ nullptr };
+    };
+    
+    std::atomic<const ConfigSnapshot*> m_current;
+    mutable ReaderSlot m_readerSlots[READER_SLOTS];
+    mutable std::atomic<uint32_t> m_sharedReaders; // Found every slot taken
+    std::mutex m_writeMutex;
+    mutable std::mutex m_retiredMutex; // Taken after m_writeMutex
+    mutable std::vector<const ConfigSnapshot*> m_retired;
+    mutable std::atomic<size_t> m_retiredCount;
+    
+    // Changes on every toggle, so it is kept outside the snapshot to avoid
+    // publishing a new version per keypress
+    std::atomic<IconState> m_lastIconState;
+    
+    // Same for the per-desktop states: a fixed table sorted by GUID bytes,
+    // so remembering a desktop never allocates
+    mutable std::mutex m_desktopStatesMutex;
+    DesktopIconState m_desktopStates[MAX_DESKTOP_STATES];
+    size_t m_desktopStateCount;
     
     // File path
     std::wstring m_configFilePath;
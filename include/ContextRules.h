@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+// Decides whether the desktop icons should be hidden for what the user is
+// doing: which process is in the foreground, and whether a fullscreen app
+// or presentation mode is active.
+//
+// Process rules are compiled into an open-addressing table keyed on the
+// FNV-1a hash of the lowercase executable name, so evaluating a context is
+// one probe sequence and two flag tests however many rules there are. A
+// hash collision between two names would give them the same rule; with 64
+// bits this is left unhandled.
+class ContextRules {
+public:
+    enum class Action : uint8_t {
+        None,
+        Hide,   // Hide while this process is in the foreground
+        Ignore  // Never hide while this process is in the foreground
+    };
+
+    struct Context {
+        uint64_t processHash; // HashProcessName() of the foreground process, 0 = unknown
+        bool fullscreen;
+        bool presenting;
+    };
+
+    ContextRules();
+    ~ContextRules();
+
+    // Executable file names such as powerpnt.exe, case-insensitive. A name
+    // listed for both actions gets Ignore.
+    void Compile(const std::vector<std::wstring>& hideProcesses, const std::vector<std::wstring>& ignoreProcesses,
+                 bool hideWhenFullscreen, bool hideWhenPresenting);
+    void Clear();
+
+    bool IsEmpty() const;
+    size_t GetRuleCount() const;
+
+    bool ShouldHide(const Context& context) const;
+    Action Lookup(uint64_t processHash) const;
+
+    // Hash of a file name without its directory; never 0
+    static uint64_t HashProcessName(const wchar_t* name, size_t length);
+
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Slot {
+        uint64_t hash; // 0 = empty
+        Action action;
+    };
+
+    void Insert(uint64_t hash, Action action);
+
+    std::vector<Slot> m_slots; // Power-of-two size, at most half full
+    size_t m_ruleCount;
+    bool m_hideWhenFullscreen;
+    bool m_hideWhenPresenting;
+};
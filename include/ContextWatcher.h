@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Common.h"
+#include "ContextRules.h"
+
+// Reports changes to what the user is doing, without polling:
+//
+// - An out-of-context WinEvent hook on EVENT_SYSTEM_FOREGROUND posts
+//   WM_CONTEXT_CHANGED when another window comes to the foreground; at
+//   most once until ResetSignal().
+// - The main window is registered as an app bar, so the shell sends
+//   WM_APPBAR_NOTIFY with ABN_FULLSCREENAPP when a fullscreen app opens or
+//   closes. Pass it to OnAppBarNotify().
+//
+// Capture() then reads the current context: the foreground process (its
+// name hashed once per process), the fullscreen flag and the shell's
+// notification state, which reports presentation mode and fullscreen
+// Direct3D apps.
+//
+// UI thread only.
+class ContextWatcher {
+public:
+    ContextWatcher();
+    ~ContextWatcher();
+
+    // Initialization
+    bool Initialize(HWND notifyWindow);
+    void Cleanup();
+
+    // True if the message changed the fullscreen state
+    bool OnAppBarNotify(WPARAM notification, LPARAM state);
+
+    void ResetSignal();
+    void Capture(ContextRules::Context& context);
+
+private:
+    static void CALLBACK ForegroundEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                             LONG idObject, LONG idChild,
+                                             DWORD eventThread, DWORD eventTime);
+    static uint64_t HashProcess(DWORD processId);
+
+    HWND m_notifyWindow;
+    HWINEVENTHOOK m_hook;
+    bool m_appBar;
+    bool m_fullscreenApp;
+    bool m_signalPending;
+
+    // Foreground changes mostly go back and forth between a few windows of
+    // the same process
+    DWORD m_cachedProcessId;
+    uint64_t m_cachedHash;
+
+    // Out-of-context callbacks carry no context pointer
+    static ContextWatcher* s_instance;
+};
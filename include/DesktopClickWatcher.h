@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.h"
+#include <thread>
+
+class CommandBus;
+
+// Reports double-clicks anywhere on screen as DesktopDoubleClick commands.
+//
+// A low-level mouse hook sees every click of the session, and Windows waits
+// for it before the click goes anywhere, so the hook runs on its own thread
+// and does almost nothing: it pairs a left button press with the previous
+// one (same place, within the double-click time) and posts the pair to the
+// command bus. Whether the click hit empty desktop is decided on the UI
+// thread. Low-level hooks never see WM_LBUTTONDBLCLK, hence the pairing.
+class DesktopClickWatcher {
+public:
+    DesktopClickWatcher();
+    ~DesktopClickWatcher();
+
+    // Starts the hook thread; false if the hook could not be installed
+    bool Initialize(CommandBus* commandBus);
+    void Cleanup();
+    bool IsRunning() const;
+
+private:
+    static LRESULT CALLBACK MouseProc(int code, WPARAM wParam, LPARAM lParam);
+    void HookLoop(HANDLE ready);
+    void OnButtonDown(const MSLLHOOKSTRUCT& event);
+
+    CommandBus* m_commandBus;
+    std::thread m_thread;
+    DWORD m_threadId;
+    bool m_hooked;
+
+    // Read once at start to keep the hook short
+    DWORD m_doubleClickTime;
+    LONG m_doubleClickWidth;
+    LONG m_doubleClickHeight;
+    LONGLONG m_frequency;
+
+    // Hook thread only
+    POINT m_lastDownPoint;
+    DWORD m_lastDownTime;
+    bool m_lastDownValid;
+
+    // Low-level hooks carry no context pointer
+    static DesktopClickWatcher* s_instance;
+};
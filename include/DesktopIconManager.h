@@ -1,7 +1,32 @@
 #pragma once
 
 #include "Common.h"
+#include "ToggleStrategy.h"
+#include "StrategySelector.h"
+#include "SelectiveHider.h"
+#include "MonitorHider.h"
+#include "IconHitGrid.h"
+#include "LayoutStore.h"
+#include "LayoutHistory.h"
+#include <cstdint>
 
+// Shows and hides the desktop icons through one of several IToggleStrategy
+// implementations. Until a strategy is known to work on this shell, each
+// hide and the show after it use the next unmeasured strategy and time it;
+// after TOGGLE_CALIBRATION_SAMPLES changes per strategy the fastest one is
+// kept. When the kept strategy stops working, the others are tried in order
+// of measured latency and the first that works replaces it (see
+// StrategySelector).
+//
+// In selective mode the listview stays visible and SelectiveHider hides
+// only the icons that no keep rule matches. MonitorHider does the same
+// for every icon on one monitor.
+//
+// With a layout store open, layouts are also kept per display topology:
+// RecordLayout() stores the icons under the current monitor setup and
+// RestoreDisplayLayout() puts back the layout last recorded for it. With a
+// layout history open, RecordLayout() also appends to it, and earlier
+// layouts can be brought back by undo or by time.
 class DesktopIconManager {
 public:
     DesktopIconManager();
@@ -19,18 +44,125 @@ public:
     // Initialization and cleanup
     bool Initialize();
     void Cleanup();
+    
+    // Strategy selection. An unknown or empty name starts calibration.
+    void SetSelectedStrategy(const wchar_t* name);
+    
+    // Name of the strategy in use, or an empty string while calibrating
+    const wchar_t* GetSelectedStrategyName() const;
+    
+    // True once after calibration finished or a failover picked another
+    // strategy, so the caller can persist the new choice
+    bool TakeSelectionChanged();
+    
+    // Selective mode; returns the number of keep patterns rejected (see
+    // SelectiveHider::SetKeepRules). Icons hidden under the old rules are put
+    // back and hidden again under the new.
+    size_t SetSelectiveMode(bool enabled, const std::vector<std::wstring>& keepPatterns,
+                            std::vector<std::wstring>* rejectedPatterns = nullptr);
+    bool IsSelectiveMode() const;
+    
+    // Icons of one monitor, by device name (\\.\DISPLAYn). Hiding is
+    // refused in selective mode and while the icons are hidden as a whole.
+    bool SetMonitorVisibility(const wchar_t* device, bool visible);
+    bool IsMonitorHidden(const wchar_t* device) const;
+    bool IsHidingMonitors() const;
+    std::vector<std::wstring> GetHiddenMonitors() const;
+    
+    // While icons are off-screen their original positions are also kept in
+    // a file, so a run that ends without Cleanup() cannot leave them there.
+    // RecoverHiddenIcons() names the file and puts back what an earlier run
+    // left in it; RestoreHiddenIcons() puts back this run's own.
+    bool RecoverHiddenIcons(const std::wstring& path);
+    void RestoreHiddenIcons();
+    
+    // Icons were moved or monitors changed since the last monitor toggle
+    void InvalidateIconIndex();
+    
+    // True if a click at the screen point lands on the desktop itself and
+    // not on an icon or a window in front of it (see IconHitGrid)
+    bool IsEmptyDesktopAt(POINT screenPoint);
+    
+    // Icon positions. Refused while selective mode or a hidden monitor has
+    // icons off-screen, since the layout would record or undo that.
+    bool CaptureLayout(IconLayout& layout);
+    bool RestoreLayout(const IconLayout& layout, size_t* moved = nullptr);
+    
+    // Layouts per display topology (see LayoutStore)
+    bool OpenLayoutStore(const std::wstring& path);
+    void CloseLayoutStore();
+    bool IsLayoutStoreOpen() const;
+    
+    // Layout history (see LayoutHistory); opening it again only updates the
+    // retention limits
+    bool OpenLayoutHistory(const std::wstring& path, const LayoutHistory::Retention& retention);
+    void CloseLayoutHistory();
+    bool IsLayoutHistoryOpen() const;
+    
+    // Captures the icons once for the store and the history. A layout that
+    // only repeats the one brought back by undo is not added to the history,
+    // so undo can go back several steps.
+    bool RecordLayout();
+    
+    // Steps back from the layout last brought back, or from the latest one
+    bool UndoLayoutChange();
+    
+    // Latest layout recorded at or before the time (FILETIME); false if the
+    // history does not reach back that far
+    bool RestoreLayoutAt(uint64_t time);
+    
+    // Does nothing if the topology is the one last saved or restored;
+    // false if no layout is stored for the current one
+    bool RestoreDisplayLayout(size_t* moved = nullptr);
+    
+    // The desktop listview, or nullptr before Initialize()
+    HWND GetListViewWindow() const;
+    
+    size_t GetMemoryUsage() const;
 
 private:
     // Windows API helpers
     HWND FindDesktopListView();
     bool SetDesktopIconVisibility(bool visible);
-    bool RefreshDesktop();
+    bool SetSelectiveVisibility(bool visible);
+    
+    // Strategy helpers
+    bool TryStrategy(size_t index, bool visible, uint64_t& latencyUs);
     
     // State tracking
     IconState m_currentState;
-    HWND m_desktopListView;
-    HWND m_progman;
-    HWND m_shelldll_defview;
+    DesktopWindows m_windows;
+    
+    // Strategies, indexed by ToggleStrategyId
+    static constexpr size_t STRATEGY_COUNT = static_cast<size_t>(ToggleStrategyId::Count);
+    std::unique_ptr<IToggleStrategy> m_strategies[STRATEGY_COUNT];
+    StrategySelector m_selector;
+    
+    // Selective mode
+    SelectiveHider m_selective;
+    bool m_selectiveMode;
+    
+    // Per-monitor hiding
+    MonitorHider m_monitors;
+    
+    // Original positions of the off-screen icons, on disk
+    std::wstring m_hiddenIconsPath;
+    IconLayout m_hiddenIcons; // Selective and monitor ones, reused between saves
+    void SaveHiddenIcons();
+    
+    // Double-click hit tests
+    IconHitGrid m_hitGrid;
+    
+    // Per-display layouts
+    LayoutStore m_layoutStore;
+    uint64_t m_layoutTopology; // Topology last saved or restored, 0 = none
+    IconLayout m_displayLayout; // Reused between captures
+    
+    // Layout history
+    LayoutHistory m_history;
+    size_t m_historyCursor;     // Snapshot brought back by undo, or NPOS
+    IconLayout m_historyLayout; // That snapshot
+    bool RestoreHistory(size_t index);
     
     // Internal methods
     bool FindDesktopWindows();
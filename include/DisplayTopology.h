@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+// Identifies the current monitor setup: the number of monitors and, for
+// each, its position and size in the virtual screen, its DPI and whether it
+// is the primary one. Docking, undocking, changing a resolution or scale, or
+// rearranging monitors all produce a different hash.
+//
+// Monitors are hashed in position order, so enumeration order does not
+// matter.
+struct DisplayTopology {
+    uint64_t hash = 0;
+    size_t monitorCount = 0;
+
+    static DisplayTopology Capture();
+};
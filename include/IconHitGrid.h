@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+class RemoteListView;
+
+// Answers "is there a desktop icon at this point" without looking at every
+// icon. The listview's client area is cut into a uniform grid of cells at
+// least as large as an icon, and each icon is linked into the cell holding
+// its top-left corner; an icon covering a point then starts in that point's
+// cell or in the one to its left, above, or above-left, so a hit test walks
+// four short lists.
+//
+// An icon covers its grid spacing from its position, which is a little
+// more than its visible bounds: clicks between close icons count as hits.
+//
+// Refresh() only relinks icons whose position changed. The grid is rebuilt
+// from scratch when the number of icons, the spacing or the listview size
+// changes. UI thread only.
+class IconHitGrid {
+public:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    IconHitGrid();
+    ~IconHitGrid();
+
+    // Reads the listview again if the grid is stale or the icon count
+    // changed; cheap otherwise
+    bool Prepare(HWND listView);
+    bool Refresh(RemoteListView& remote, HWND listView);
+    void Invalidate();
+
+    // Building the grid by hand; Reset() drops every icon
+    void Reset(const RECT& bounds, SIZE iconSize, size_t count);
+    void SetPosition(size_t index, POINT position);
+
+    // Listview item index of the icon at a client point, or NPOS
+    size_t HitTest(POINT point) const;
+
+    size_t GetCount() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Keeps huge client areas with tiny spacings within bounds
+    static constexpr size_t MAX_CELLS = 64 * 1024;
+
+    struct Icon {
+        POINT position;
+        uint32_t cell; // NONE while outside the grid (off-screen)
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    uint32_t CellOf(POINT position) const;
+    void Link(uint32_t index, uint32_t cell);
+    void Unlink(uint32_t index);
+
+    RECT m_bounds;
+    SIZE m_iconSize;
+    SIZE m_cellSize;
+    int m_columns;
+    int m_rows;
+    std::vector<uint32_t> m_heads; // First icon of each cell, row-major
+    std::vector<Icon> m_icons;     // By listview item index
+    bool m_stale;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+// Names and positions of desktop icons.
+//
+// Icons are matched by name when a layout is applied, so icons added,
+// removed or reordered since the capture do not shift the others. Names can
+// repeat (a file and a shortcut with extensions hidden); each saved
+// position is then used once, in listview order.
+//
+// File format (little-endian), version 1:
+//
+//   Header:  u32 magic 'DITL', u16 version, u16 reserved, u32 entryCount,
+//            u32 nameChars, u32 checksum (FNV-1a of everything after it)
+//   Entries: entryCount x { i32 x, i32 y, u32 nameOffset, u32 nameLength }
+//   Names:   nameChars UTF-16 code units, not terminated
+class IconLayout {
+public:
+    static constexpr uint32_t FILE_MAGIC = 0x4C544944; // "DITL"
+    static constexpr uint16_t FILE_VERSION = 1;
+
+    struct Entry {
+        std::wstring name;
+        POINT position;
+    };
+
+    IconLayout();
+    ~IconLayout();
+
+    // Reads every icon of the listview, in batches (see RemoteListView)
+    bool Capture(HWND listView);
+
+    // Moves every icon that is in the layout and not already in place, with
+    // painting suspended until the last move. Fails while the desktop
+    // auto-arranges, since the shell would undo the moves, and whenever an
+    // icon could not be read or moved; the layout stays valid to apply again.
+    bool Apply(HWND listView, size_t* moved = nullptr) const;
+
+    // Building a layout by hand; call Sort() before Apply()
+    void Add(const wchar_t* name, POINT position);
+    void Sort();
+    void Clear();
+
+    bool IsEmpty() const;
+    size_t GetCount() const;
+    const Entry& GetEntry(size_t index) const;
+    size_t GetMemoryUsage() const;
+    
+    // Same names at the same positions, in the same order
+    bool Equals(const IconLayout& other) const;
+
+    // The file format, in memory (see LayoutStore)
+    void Serialize(std::vector<uint8_t>& buffer) const;
+    bool Deserialize(const uint8_t* data, size_t size);
+
+    // Written to a temporary file and moved into place
+    bool Save(const std::wstring& path) const;
+    bool Load(const std::wstring& path);
+
+private:
+    std::vector<Entry> m_entries; // Sorted by name after Sort()
+};
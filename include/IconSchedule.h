@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+// Daily windows during which the desktop icons are hidden, such as
+// "09:00-17:00". A window whose end is before its start runs past midnight
+// ("22:00-06:00"); "00:00-24:00" covers the whole day. Times are local
+// wall-clock minutes, so each window's next start or end is worked out
+// again from the clock every time instead of counting down, which keeps
+// them right across sleep and clock changes.
+class IconSchedule {
+public:
+    struct Window {
+        uint16_t start; // Minutes after midnight
+        uint16_t end;   // 1440 for "24:00"
+    };
+
+    IconSchedule();
+    ~IconSchedule();
+
+    // Replaces the windows; returns the number of specs rejected and adds
+    // them to the list, if given
+    size_t SetWindows(const std::vector<std::wstring>& specs, std::vector<std::wstring>* rejectedSpecs = nullptr);
+    void Clear();
+
+    bool IsEmpty() const;
+    size_t GetCount() const;
+
+    // Inside any window at this time
+    bool IsHideTime(const SYSTEMTIME& local) const;
+
+    // Milliseconds from this time to the window's next start or end
+    ULONGLONG GetNextEdgeDelay(size_t index, const SYSTEMTIME& local) const;
+
+    static bool Parse(const wchar_t* text, Window& window);
+
+private:
+    std::vector<Window> m_windows;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+class RemoteListView;
+
+// Desktop icons grouped by the monitor they are on, so acting on one
+// monitor does not read the whole desktop again. An icon belongs to the
+// monitor that holds the center of its grid cell.
+//
+// The index is a snapshot: it stays valid until Invalidate() is called
+// (icons moved, monitors changed) or the number of icons changes.
+class IconSpatialIndex {
+public:
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+    static constexpr size_t DEVICE_NAME_LENGTH = 32;
+
+    struct Item {
+        int index;           // Listview item index
+        std::wstring name;
+        POINT position;
+    };
+
+    struct Monitor {
+        wchar_t device[DEVICE_NAME_LENGTH]; // e.g. \\.\DISPLAY2; stable across restarts
+        RECT bounds;                        // Listview client coordinates
+        std::vector<Item> items;
+    };
+
+    IconSpatialIndex();
+    ~IconSpatialIndex();
+
+    // Reads every icon in batches and sorts them into the monitors
+    bool Build(RemoteListView& remote, HWND listView);
+    void Invalidate();
+    bool IsValid(const RemoteListView& remote) const;
+
+    size_t GetMonitorCount() const;
+    Monitor& GetMonitor(size_t index);
+    size_t FindMonitor(const wchar_t* device) const;
+
+    size_t GetMemoryUsage() const;
+
+    // Device name of the monitor at a screen point; false if there is none
+    static bool GetDeviceAt(POINT screenPoint, wchar_t (&device)[DEVICE_NAME_LENGTH]);
+
+private:
+    std::vector<Monitor> m_monitors;
+    int m_itemCount;
+    bool m_valid;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+// Decides when the user has gone idle without watching every input.
+//
+// Only one deadline is ever armed: last input + timeout. When it fires the
+// last-input time is read once; if there was input meanwhile, the deadline
+// moves to the new last input + timeout, otherwise the user is idle. Being
+// active therefore costs at most one wakeup per timeout, however much input
+// there is. Leaving idle is an edge: raw input is registered while idle and
+// the first input reports the resume, after which it is removed again.
+//
+// Times are GetTickCount() milliseconds passed in by the caller, so the
+// same logic runs against a virtual clock.
+class IdleDetector {
+public:
+    static constexpr DWORD NO_DEADLINE = INFINITE;
+
+    IdleDetector();
+    ~IdleDetector();
+
+    // 0 turns detection off and leaves idle
+    void SetTimeout(DWORD timeoutMs);
+    DWORD GetTimeout() const;
+    bool IsEnabled() const;
+
+    // Delay until the deadline; NO_DEADLINE while off or idle
+    DWORD Arm(DWORD now, DWORD lastInput) const;
+
+    // The deadline timer fired. True when the user has gone idle;
+    // otherwise nextDelay says when to look again.
+    bool OnDeadline(DWORD now, DWORD lastInput, DWORD& nextDelay);
+
+    // Input while idle; true for the first one only
+    bool OnInput();
+
+    bool IsIdle() const;
+    uint32_t GetWakeups() const;
+
+    // Raw mouse and keyboard input to the window, also in the background
+    bool StartInputWatch(HWND window);
+    void StopInputWatch();
+
+private:
+    DWORD m_timeout;
+    bool m_idle;
+    bool m_watching;
+    uint32_t m_wakeups; // Deadlines that fired
+};
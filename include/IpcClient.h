@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Common.h"
+#include "IpcProtocol.h"
+
+// Minimal blocking client for the control pipe. Used by a second launch of
+// the executable to hand its command line to the running instance, so it
+// deliberately depends on nothing but kernel32.
+class IpcClient {
+public:
+    IpcClient();
+    ~IpcClient();
+
+    // Connection
+    bool Connect(DWORD timeoutMs);
+    void Close();
+    bool IsConnected() const;
+    
+    // Sends one batch and waits up to timeoutMs for its response. A server
+    // that does not answer in time costs the connection, not a hang.
+    bool Transact(const Ipc::Opcode* ops, size_t count, DWORD timeoutMs, Ipc::Status& status, Ipc::WireState& state);
+
+private:
+    bool WriteAll(const uint8_t* data, size_t size, ULONGLONG deadline);
+    bool ReadAll(uint8_t* data, size_t size, ULONGLONG deadline);
+    
+    // Waits for an overlapped transfer until the deadline
+    bool Finish(OVERLAPPED& overlapped, BOOL started, ULONGLONG deadline, DWORD& transferred);
+    
+    HANDLE m_pipe;
+    HANDLE m_event; // Signals the transfer in flight
+    uint32_t m_nextRequestId;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Common.h"
+#include "SessionScope.h"
+#include <cstdint>
+
+// Local control channel used by scripts and by a second launch of the
+// executable. Every message is a little-endian length-prefixed frame:
+//
+//   Request:  [u32 length][u32 requestId][u8 count][u8 opcode] x count
+//   Response: [u32 length][u32 requestId][u8 status][u8 iconState]
+//
+// A request batches up to MAX_OPS_PER_REQUEST opcodes which are applied in
+// order. The response is sent once the whole batch has been applied and
+// carries the resulting icon state. Clients may pipeline any number of
+// requests on one connection; responses come back in request order.
+//
+// The pipe is named per session (see Session::FormatPipeName).
+namespace Ipc {
+
+constexpr uint32_t HEADER_SIZE = 4;
+constexpr uint32_t MAX_OPS_PER_REQUEST = 64;
+constexpr uint32_t MIN_REQUEST_PAYLOAD = 5;
+constexpr uint32_t MAX_REQUEST_PAYLOAD = MIN_REQUEST_PAYLOAD + MAX_OPS_PER_REQUEST;
+constexpr uint32_t RESPONSE_PAYLOAD = 6;
+constexpr uint32_t RESPONSE_FRAME_SIZE = HEADER_SIZE + RESPONSE_PAYLOAD;
+
+enum class Opcode : uint8_t {
+    Toggle = 1,
+    Show = 2,
+    Hide = 3,
+    QueryState = 4,
+    ShowSettings = 5,
+    DumpTrace = 6,
+    SaveLayout = 7,
+    RestoreLayout = 8,
+    UndoLayout = 9
+};
+
+enum class Status : uint8_t {
+    Ok = 0,
+    BadRequest = 1,
+    Busy = 2 // The command queue was full; nothing in the batch was applied
+};
+
+// Same encoding as LastIconState in settings.ini, plus "unknown"
+enum class WireState : uint8_t {
+    Hidden = 0,
+    Visible = 1,
+    Unknown = 2
+};
+
+inline WireState ToWireState(IconState state) {
+    switch (state) {
+        case IconState::Visible: return WireState::Visible;
+        case IconState::Hidden: return WireState::Hidden;
+        default: return WireState::Unknown;
+    }
+}
+
+// Completion cookies (see Command::cookie) name the connection slot and its
+// generation. The tag bit keeps every cookie non-zero, since 0 means that
+// no completion is wanted.
+constexpr uint32_t COOKIE_TAG = 0x80000000;
+
+inline uint64_t MakeCookie(uint32_t slot, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) | COOKIE_TAG | slot;
+}
+
+inline uint32_t CookieSlot(uint64_t cookie) {
+    return static_cast<uint32_t>(cookie) & ~COOKIE_TAG;
+}
+
+inline uint32_t CookieGeneration(uint64_t cookie) {
+    return static_cast<uint32_t>(cookie >> 32);
+}
+
+inline void WriteU32(uint8_t* p, uint32_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+inline uint32_t ReadU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Returns the number of bytes written, or 0 if the buffer is too small
+inline size_t EncodeRequest(uint8_t* buffer, size_t capacity, uint32_t requestId,
+                            const Opcode* ops, size_t count) {
+    if (count == 0 || count > MAX_OPS_PER_REQUEST) {
+        return 0;
+    }
+    
+    size_t payload = MIN_REQUEST_PAYLOAD + count;
+    if (capacity < HEADER_SIZE + payload) {
+        return 0;
+    }
+    
+    WriteU32(buffer, static_cast<uint32_t>(payload));
+    WriteU32(buffer + 4, requestId);
+    buffer[8] = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; i++) {
+        buffer[9 + i] = static_cast<uint8_t>(ops[i]);
+    }
+    
+    return HEADER_SIZE + payload;
+}
+
+inline size_t EncodeResponse(uint8_t* buffer, size_t capacity, uint32_t requestId,
+                             Status status, WireState state) {
+    if (capacity < RESPONSE_FRAME_SIZE) {
+        return 0;
+    }
+    
+    WriteU32(buffer, RESPONSE_PAYLOAD);
+    WriteU32(buffer + 4, requestId);
+    buffer[8] = static_cast<uint8_t>(status);
+    buffer[9] = static_cast<uint8_t>(state);
+    return RESPONSE_FRAME_SIZE;
+}
+
+inline bool DecodeResponse(const uint8_t* buffer, size_t size, uint32_t& requestId,
+                           Status& status, WireState& state) {
+    if (size < RESPONSE_FRAME_SIZE || ReadU32(buffer) != RESPONSE_PAYLOAD) {
+        return false;
+    }
+    
+    requestId = ReadU32(buffer + 4);
+    status = static_cast<Status>(buffer[8]);
+    state = static_cast<WireState>(buffer[9]);
+    return true;
+}
+
+} // namespace Ipc
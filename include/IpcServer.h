@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Common.h"
+#include "IpcProtocol.h"
+#include "MpscQueue.h"
+#include <atomic>
+#include <thread>
+
+class CommandBus;
+
+// Serves the local control pipe on a background thread using overlapped
+// I/O on a single completion port. Commands are forwarded to the command
+// bus; the UI thread reports back through CompleteRequest() once the last
+// command of a batch has been handled, which releases the response.
+class IpcServer {
+public:
+    IpcServer();
+    ~IpcServer();
+
+    // Initialization
+    bool Initialize(CommandBus* commandBus);
+    void Cleanup();
+    
+    // Current icon state returned to state queries. Any thread.
+    void PublishState(IconState state);
+    
+    // Called on the UI thread after dispatching a command carrying a cookie
+    void CompleteRequest(uint64_t cookie, IconState state);
+    
+    // Bytes held by connection slots and queues
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr size_t MAX_CONNECTIONS = 64;
+    static constexpr size_t LISTEN_BACKLOG = 4;
+    static constexpr size_t BUFFER_SIZE = 1024;
+    
+    enum class IoKind { Connect, Read, Write };
+    enum class SlotState { Free, Listening, Connected, Closing };
+    
+    struct Connection;
+    
+    struct IoContext {
+        OVERLAPPED overlapped; // Must be first
+        IoKind kind;
+        bool pending;
+        Connection* connection;
+    };
+    
+    struct Connection {
+        HANDLE pipe;
+        SlotState state;
+        uint32_t slot;
+        uint32_t generation;
+        IoContext connectIo;
+        IoContext readIo;
+        IoContext writeIo;
+        
+        // Set while a batch is waiting for the UI thread
+        bool awaitingCompletion;
+        uint32_t awaitingRequestId;
+        
+        uint8_t readBuffer[BUFFER_SIZE];
+        size_t readSize;
+        uint8_t writeBuffer[BUFFER_SIZE];  // Responses not yet handed to WriteFile
+        size_t writeSize;
+        uint8_t sendBuffer[BUFFER_SIZE];   // Responses being written
+        size_t sendSize;
+    };
+    
+    struct Completion {
+        uint64_t cookie;
+        IconState state;
+    };
+    
+    // Worker thread
+    void WorkerLoop();
+    void DrainCompletions();
+    void OnIoCompleted(IoContext& io, bool success, DWORD bytes);
+    void CancelAllAndWait();
+    
+    // Connection management
+    void EnsureListening();
+    bool StartListening(Connection& connection);
+    void OnConnected(Connection& connection);
+    void CloseConnection(Connection& connection);
+    void FinishClose(Connection& connection);
+    bool HasPendingIo(const Connection& connection) const;
+    
+    // Request processing
+    void IssueRead(Connection& connection);
+    void IssueWrite(Connection& connection);
+    void ProcessRequests(Connection& connection);
+    bool HandleRequest(Connection& connection, const uint8_t* payload, uint32_t size);
+    void QueueResponse(Connection& connection, uint32_t requestId, Ipc::Status status, Ipc::WireState state);
+    
+    CommandBus* m_commandBus;
+    wchar_t m_pipeName[Session::MAX_OBJECT_NAME];
+    HANDLE m_completionPort;
+    std::thread m_worker;
+    std::unique_ptr<Connection[]> m_connections;
+    bool m_firstInstanceCreated;
+    bool m_stopping;
+    bool m_initialized;
+    
+    std::atomic<uint8_t> m_publishedState;
+    MpscQueue<Completion, 256> m_completions;
+};
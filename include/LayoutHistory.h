@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Common.h"
+#include "IconLayout.h"
+#include <cstdint>
+
+// Append-only history of icon layouts, for undo and for going back to the
+// layout of an earlier time.
+//
+// Every KEYFRAME_INTERVAL-th snapshot is a keyframe holding a whole
+// IconLayout; the ones in between are deltas against the snapshot before
+// them, listing only the icons removed, moved or added, with varint
+// coordinates relative to the old position. Rebuilding any snapshot reads
+// one keyframe and at most KEYFRAME_INTERVAL - 1 deltas.
+//
+// The record headers are indexed in memory when the file is opened, so
+// finding the snapshot for a point in time is a binary search. Retention
+// drops whole keyframe groups from the front by rewriting the file.
+//
+// File format (little-endian), version 1:
+//
+//   Header:  u32 magic 'DITH', u16 version, u16 reserved
+//   Records: u32 payloadSize, u8 kind (0 keyframe, 1 delta), u8 reserved[3],
+//            u64 time (FILETIME), u32 checksum (FNV-1a of the payload),
+//            then the payload
+//
+// UI thread only.
+class LayoutHistory {
+public:
+    static constexpr uint32_t FILE_MAGIC = 0x48544944; // "DITH"
+    static constexpr uint16_t FILE_VERSION = 1;
+    static constexpr size_t KEYFRAME_INTERVAL = 32;
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    struct Retention {
+        uint32_t maxAgeDays = 30;         // 0 = keep forever
+        uint64_t maxBytes = 4 * 1024 * 1024; // 0 = unlimited
+    };
+
+    LayoutHistory();
+    ~LayoutHistory();
+
+    // Opens or creates the file; a damaged tail is cut off
+    bool Open(const std::wstring& path, const Retention& retention);
+    void Close();
+    bool IsOpen() const;
+
+    // Applied right away and after every append
+    void SetRetention(const Retention& retention);
+
+    // Adds a snapshot unless it equals the latest one; true if added
+    bool Append(const IconLayout& layout, uint64_t time);
+
+    size_t GetCount() const;
+    uint64_t GetTime(size_t index) const;
+
+    // Index of the latest snapshot taken at or before the time, or NPOS
+    size_t Seek(uint64_t time) const;
+
+    bool Load(size_t index, IconLayout& layout);
+
+    size_t GetMemoryUsage() const;
+
+    static uint64_t Now();
+
+private:
+    struct Record {
+        uint64_t time;
+        uint64_t offset;     // Of the payload
+        uint32_t size;
+        bool keyframe;
+    };
+
+    bool ReadIndex();
+    bool CutAfterLastLoadable();
+    bool Truncate(size_t count); // Keeps the first count records
+    bool ReadPayload(const Record& record, std::vector<uint8_t>& payload);
+    bool WriteRecord(bool keyframe, uint64_t time, const std::vector<uint8_t>& payload);
+    void ApplyRetention(uint64_t now);
+    bool DropBefore(size_t first);
+
+    // False if the layouts are the same
+    static bool EncodeDelta(const IconLayout& from, const IconLayout& to, std::vector<uint8_t>& payload);
+    static bool ApplyDelta(const IconLayout& from, const uint8_t* data, size_t size, IconLayout& to);
+
+    std::wstring m_path;
+    HANDLE m_file;
+    uint64_t m_fileSize;
+    Retention m_retention;
+    std::vector<Record> m_records;
+    std::vector<size_t> m_keyframes; // Indices into m_records, ascending
+    IconLayout m_latest;             // Rebuilt latest snapshot, for deltas
+    std::vector<uint8_t> m_buffer;
+};
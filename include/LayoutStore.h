@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.h"
+#include "IconLayout.h"
+#include <cstdint>
+
+// Icon layouts for every display topology seen so far, kept in one
+// memory-mapped file. A fixed index at the start of the file maps a
+// topology hash (see DisplayTopology) to a serialized IconLayout further
+// in, so looking up a layout reads only the index and that one record.
+//
+// The index holds MAX_LAYOUTS entries; storing a new topology when it is
+// full replaces the one used least recently. Records that outgrow their
+// place are appended; the file is compacted, and grown only when that is
+// not enough. The index entry is switched to an appended record only once
+// it is written, so a failed store leaves the old layout in place.
+//
+// UI thread only.
+namespace LayoutStoreFormat {
+
+constexpr uint32_t FILE_MAGIC = 0x44544944; // "DITD"
+constexpr uint16_t FILE_VERSION = 1;
+constexpr uint16_t MAX_LAYOUTS = 16;
+
+// Records start here, after the header and the index
+constexpr uint32_t DATA_OFFSET = 512;
+constexpr uint32_t INITIAL_SIZE = 64 * 1024;
+
+struct IndexEntry {
+    uint64_t topology;   // 0 = unused
+    uint32_t offset;     // From the start of the file
+    uint32_t size;
+    uint64_t lastUsed;   // Value of Header::useCounter when last stored or read
+};
+
+// Bump FILE_VERSION when changing the layout
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entryCount;
+    uint32_t dataEnd;    // First free byte after the records
+    uint32_t reserved;
+    uint64_t useCounter;
+    IndexEntry entries[MAX_LAYOUTS];
+};
+
+static_assert(sizeof(Header) <= DATA_OFFSET, "index overlaps the records");
+
+} // namespace LayoutStoreFormat
+
+class LayoutStore {
+public:
+    LayoutStore();
+    ~LayoutStore();
+
+    // Opens or creates the file; an unreadable file is started over
+    bool Open(const std::wstring& path);
+    void Close();
+    bool IsOpen() const;
+
+    bool Store(uint64_t topology, const IconLayout& layout);
+    bool Lookup(uint64_t topology, IconLayout& layout);
+
+    size_t GetCount() const;
+    size_t GetMappedBytes() const;
+
+private:
+    bool Map(uint64_t size);
+    void Unmap();
+    bool Grow(uint64_t size);
+    void Compact();
+    void Reset();
+
+    LayoutStoreFormat::IndexEntry* Find(uint64_t topology);
+    LayoutStoreFormat::IndexEntry* FindSlot(uint64_t topology);
+
+    HANDLE m_file;
+    HANDLE m_mapping;
+    uint8_t* m_view;
+    uint64_t m_size;
+    std::vector<uint8_t> m_buffer; // Reused for serializing
+};
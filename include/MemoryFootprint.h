@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Common.h"
+#include <cstddef>
+#include <cstdint>
+
+// Resident memory of the process, broken down by subsystem.
+//
+// Subsystem figures are the memory each component owns (heap buffers, ring
+// buffers, bitmaps); the remainder of the working set is code, the C++
+// runtime and system DLLs, and is reported as "other".
+class MemoryFootprint {
+public:
+    static constexpr size_t MAX_ENTRIES = 16;
+    
+    struct Entry {
+        const char* subsystem; // String literal
+        size_t bytes;
+    };
+    
+    MemoryFootprint();
+    
+    // Subsystem breakdown
+    void Add(const char* subsystem, size_t bytes);
+    size_t GetEntryCount() const;
+    const Entry& GetEntry(size_t index) const;
+    
+    // Process-wide counters; call after adding the subsystems
+    bool CaptureProcess();
+    size_t GetWorkingSetBytes() const;
+    size_t GetPrivateBytes() const;
+    
+    // Machine-readable JSON report. budgetBytes of 0 means no budget.
+    bool WriteReport(const std::wstring& path, size_t budgetBytes) const;
+    
+    // Returns heap pages to the system and trims the working set
+    static void TrimWorkingSet();
+
+private:
+    Entry m_entries[MAX_ENTRIES];
+    size_t m_entryCount;
+    
+    size_t m_workingSetBytes;
+    size_t m_peakWorkingSetBytes;
+    size_t m_privateBytes;
+    DWORD m_gdiObjects;
+    DWORD m_userObjects;
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Process-wide metrics: counters, gauges and fixed-bucket histograms. Every
+// update is a single relaxed atomic add on the metric's own cache line.
+// MetricsExporter snapshots them to a Prometheus text-format file from a
+// background thread; the UI thread never does file I/O for metrics.
+//
+// Metrics register themselves at static-initialization time. Metrics that
+// share a family name must be defined next to each other so the exporter
+// can emit a single HELP/TYPE header for them.
+
+enum class MetricType {
+    Counter,
+    Gauge,
+    Histogram
+};
+
+class Metric {
+public:
+    Metric(MetricType type, const char* family, const char* labels, const char* help);
+    virtual ~Metric() = default;
+    
+    MetricType GetType() const { return m_type; }
+    const char* GetFamily() const { return m_family; }
+    const char* GetLabels() const { return m_labels; }
+    const char* GetHelp() const { return m_help; }
+
+protected:
+    // Lets the exporter sleep until something actually changed
+    static void MarkDirty();
+
+private:
+    MetricType m_type;
+    const char* m_family;
+    const char* m_labels; // e.g. "reason=\"not_found\"" or ""
+    const char* m_help;
+};
+
+class alignas(64) Counter : public Metric {
+public:
+    Counter(const char* family, const char* labels, const char* help)
+        : Metric(MetricType::Counter, family, labels, help), m_value(0) {}
+    
+    void Increment(uint64_t amount = 1) {
+        m_value.fetch_add(amount, std::memory_order_relaxed);
+        MarkDirty();
+    }
+    
+    uint64_t GetValue() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value;
+};
+
+class alignas(64) Gauge : public Metric {
+public:
+    Gauge(const char* family, const char* labels, const char* help)
+        : Metric(MetricType::Gauge, family, labels, help), m_value(0) {}
+    
+    void Set(int64_t value) {
+        if (m_value.exchange(value, std::memory_order_relaxed) != value) {
+            MarkDirty();
+        }
+    }
+    
+    void Add(int64_t amount) {
+        m_value.fetch_add(amount, std::memory_order_relaxed);
+        MarkDirty();
+    }
+    
+    int64_t GetValue() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value;
+};
+
+// Observations are recorded in microseconds and exported in seconds
+class alignas(64) Histogram : public Metric {
+public:
+    static constexpr size_t MAX_BUCKETS = 12;
+    
+    // upperBoundsUs must be ascending; an implicit +Inf bucket is added
+    Histogram(const char* family, const char* labels, const char* help,
+              const uint64_t* upperBoundsUs, size_t bucketCount);
+    
+    void Observe(uint64_t valueUs);
+    
+    size_t GetBucketCount() const { return m_bucketCount; }
+    uint64_t GetUpperBoundUs(size_t bucket) const { return m_upperBoundsUs[bucket]; }
+    uint64_t GetBucketValue(size_t bucket) const { return m_buckets[bucket].load(std::memory_order_relaxed); }
+    uint64_t GetCount() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t GetSumUs() const { return m_sumUs.load(std::memory_order_relaxed); }
+
+private:
+    uint64_t m_upperBoundsUs[MAX_BUCKETS];
+    size_t m_bucketCount;
+    std::atomic<uint64_t> m_buckets[MAX_BUCKETS + 1]; // Non-cumulative, last is +Inf
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sumUs;
+};
+
+// Application metrics
+namespace Metrics {
+    extern Counter TogglesTotal;
+    extern Counter ToggleFailuresNotFound;
+    extern Counter ToggleFailuresInvalidWindow;
+    extern Counter ToggleFailuresSelective;
+    extern Counter ToggleStrategyFailures;
+    extern Counter ToggleStrategyFailovers;
+    extern Histogram ToggleDuration;
+    extern Gauge IconsVisible;
+    extern Gauge SelectiveItemsHidden;
+    extern Gauge MonitorsHidden;
+    extern Histogram MonitorToggleDuration;
+    extern Counter IconIndexHits;
+    extern Counter IconIndexBuilds;
+    extern Histogram DesktopSwitchApplyDuration;
+    extern Counter DesktopSwitchesApplied;
+    extern Counter DesktopSwitchesCancelled;
+    extern Histogram ContextEvaluationDuration;
+    extern Counter ContextHides;
+    extern Counter ContextShows;
+    extern Counter IdleWakeups;
+    extern Counter IdleHides;
+    extern Counter IdleResumes;
+    extern Counter ScheduleHides;
+    extern Counter ScheduleShows;
+    extern Histogram ClickHookDuration;
+    extern Counter DoubleClickToggles;
+    extern Counter DoubleClicksIgnored;
+    extern Histogram LayoutCaptureDuration;
+    extern Histogram LayoutRestoreDuration;
+    extern Histogram LayoutLookupDuration;
+    extern Counter LayoutDisplayRestores;
+    extern Counter HotkeyRegistrations;
+    extern Counter HotkeyRegistrationFailures;
+    extern Counter CommandsDispatched;
+    extern Counter CommandsDropped;
+    extern Counter IpcRequests;
+    extern Counter ConfigLoads;
+    extern Counter ConfigWrites;
+    extern Counter ConfigWriteFailures;
+    extern Counter TrayUpdates;
+    extern Counter MainLoopWakeups;
+    extern Counter TimerWakeups;
+    extern Gauge TimersPending;
+    extern Counter ShellStarts;
+    extern Histogram ShellReadyLatency;
+}
+
+class MetricsExporter {
+public:
+    MetricsExporter();
+    ~MetricsExporter();
+
+    // Starts the writer thread. Snapshots are written at most once per
+    // interval and only after a metric has changed.
+    bool Start(const std::wstring& path, DWORD intervalMs);
+    void Stop();
+    
+    // Writes a snapshot right now (any thread)
+    static bool WriteSnapshot(const std::wstring& path);
+
+private:
+    void WriterLoop();
+    
+    std::wstring m_path;
+    DWORD m_intervalMs;
+    HANDLE m_stopEvent;
+    std::thread m_writer;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Common.h"
+#include "IconLayout.h"
+#include "IconSpatialIndex.h"
+
+// Hides the desktop icons of one monitor at a time by moving them
+// off-screen, the way SelectiveHider does for the whole desktop. Each
+// hidden monitor keeps its own IconLayout, so monitors are shown again
+// independently.
+//
+// Icons are looked up in an IconSpatialIndex that survives between toggles;
+// only the icons of the toggled monitor are touched, in one batch with
+// painting suspended.
+class MonitorHider {
+public:
+    MonitorHider();
+    ~MonitorHider();
+
+    bool Hide(HWND listView, const wchar_t* device);
+    bool Show(HWND listView, const wchar_t* device);
+    bool RestoreAll(HWND listView);
+
+    bool IsHidden(const wchar_t* device) const;
+    bool IsHidingAny() const;
+    std::vector<std::wstring> GetHiddenDevices() const;
+    
+    // Adds where the icons of every hidden monitor were; unsorted
+    void AppendHiddenLayouts(IconLayout& layout) const;
+
+    // Icons or monitors changed outside of this class
+    void InvalidateIndex();
+
+    size_t GetMemoryUsage() const;
+
+private:
+    struct HiddenMonitor {
+        std::wstring device;
+        IconLayout layout; // Where the hidden icons were
+    };
+
+    bool PrepareIndex(RemoteListView& remote, HWND listView);
+    size_t FindHidden(const wchar_t* device) const;
+
+    IconSpatialIndex m_index;
+    std::vector<HiddenMonitor> m_hidden;
+};
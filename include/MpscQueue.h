@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Bounded lock-free multi-producer single-consumer queue.
+//
+// Each slot carries a sequence number that tells producers whether it is
+// free and the consumer whether it has been published, so pushing is one
+// CAS on the enqueue position and popping needs no atomics read-modify-write
+// at all. Storage is inline and fixed; neither side ever allocates.
+template <typename T, size_t Capacity>
+class MpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpscQueue capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "MpscQueue elements must be trivially copyable");
+
+public:
+    MpscQueue() {
+        for (size_t i = 0; i < Capacity; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Safe to call from any thread. Returns false if the queue is full.
+    bool TryPush(const T& value) {
+        Cell* cell = nullptr;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        
+        for (;;) {
+            cell = &m_cells[pos & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pushes all of the values, in order and with no other producer's in
+    // between, or none of them if they do not all fit. Slots are freed in
+    // queue order, so the last one being free means the rest are too.
+    bool TryPushAll(const T* values, size_t count) {
+        if (count == 0 || count > Capacity) {
+            return count == 0;
+        }
+        
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        
+        for (;;) {
+            Cell& last = m_cells[(pos + count - 1) & (Capacity - 1)];
+            size_t sequence = last.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + count - 1);
+            
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Not enough room
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            Cell& cell = m_cells[(pos + i) & (Capacity - 1)];
+            cell.value = values[i];
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // Consumer thread only. Returns false if nothing has been published yet.
+    bool TryPop(T& value) {
+        Cell& cell = m_cells[m_dequeuePos & (Capacity - 1)];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(m_dequeuePos + 1) < 0) {
+            return false; // Empty
+        }
+        
+        value = cell.value;
+        cell.sequence.store(m_dequeuePos + Capacity, std::memory_order_release);
+        m_dequeuePos++;
+        return true;
+    }
+
+    static constexpr size_t GetCapacity() {
+        return Capacity;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    alignas(64) Cell m_cells[Capacity];
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) size_t m_dequeuePos = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.h"
+#include <regex>
+
+// Case-insensitive name patterns, compiled once when the rules are loaded.
+//
+// A pattern is a glob (* and ?) unless it starts with "re:", in which case
+// the rest is an ECMAScript regular expression matched against the whole
+// name. Globs without wildcards, and globs whose only wildcard is a leading
+// or trailing *, are matched without the general glob matcher. An
+// expression the regex engine gives up on for a name (too much
+// backtracking) does not match that name.
+class PatternRules {
+public:
+    PatternRules();
+    ~PatternRules();
+
+    // Returns false if the pattern is empty or not a valid expression
+    bool Add(const std::wstring& pattern);
+    void Clear();
+
+    bool IsEmpty() const;
+    size_t GetCount() const;
+
+    // True if any rule matches
+    bool Matches(const wchar_t* name) const;
+
+    size_t GetMemoryUsage() const;
+
+private:
+    enum class RuleKind {
+        Literal,  // name
+        Prefix,   // name*
+        Suffix,   // *name
+        Glob,     // anything else with * or ?
+        Regex
+    };
+
+    struct Rule {
+        RuleKind kind;
+        std::wstring text;  // Lowercase; without the wildcard for Prefix/Suffix
+        std::unique_ptr<std::wregex> regex;
+    };
+
+    static bool MatchGlob(const wchar_t* pattern, const wchar_t* name);
+
+    std::vector<Rule> m_rules;
+};
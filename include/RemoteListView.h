@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Common.h"
+
+// Reads the items of a listview owned by another process (the desktop
+// listview lives in Explorer) through one buffer allocated in that process.
+//
+// A batch of up to BATCH_SIZE items costs one WriteProcessMemory and one
+// ReadProcessMemory however large it is; only the per-item listview
+// messages remain, since a listview has no message that reads or moves
+// several items at once. The LVITEM layout must match Explorer's, so a 32-bit
+// build running on 64-bit Windows cannot open it.
+class RemoteListView {
+public:
+    static constexpr size_t BATCH_SIZE = 256;
+    static constexpr size_t MAX_ITEM_NAME = 260;
+
+    struct Item {
+        wchar_t name[MAX_ITEM_NAME];
+        POINT position;
+    };
+
+    RemoteListView();
+    ~RemoteListView();
+
+    bool Open(HWND listView);
+    void Close();
+
+    int GetItemCount() const;
+
+    // Size of the grid cell every icon occupies
+    SIZE GetItemSpacing() const;
+
+    // Reads `count` items starting at `first`; count must not exceed
+    // BATCH_SIZE. Returns the number of items read.
+    size_t ReadItems(int first, Item* items, size_t count);
+
+    // Positions only, packed at the start of the remote buffer, for callers
+    // that already know the names. Same limits as ReadItems().
+    size_t ReadPositions(int first, POINT* positions, size_t count);
+
+    // Positions are in listview client coordinates. Moves are queued and
+    // sent BATCH_SIZE at a time: the POINTs go to the remote buffer in one
+    // write and each LVM_SETITEMPOSITION32 points at its own, so positions
+    // keep all 32 bits. Reads, re-enabling painting and Close() send what
+    // is queued first.
+    bool MoveItem(int index, POINT position);
+    bool FlushMoves();
+
+    // Suspends painting for a batch of moves; re-enabling sends the queued
+    // moves and repaints once. False if the moves could not be sent.
+    bool SetRedraw(bool enable);
+
+private:
+    struct Slot {
+        LVITEM item;
+        POINT position;
+        wchar_t text[MAX_ITEM_NAME];
+    };
+
+    HWND m_listView;
+    HANDLE m_process;
+    BYTE* m_remote;                    // BATCH_SIZE slots in the owner process
+    std::unique_ptr<Slot[]> m_local;   // Request slots, written to m_remote
+    std::unique_ptr<Slot[]> m_results; // Slots read back from m_remote
+    
+    // Queued moves
+    std::unique_ptr<int[]> m_moveIndices;
+    std::unique_ptr<POINT[]> m_movePositions;
+    size_t m_moveCount;
+};
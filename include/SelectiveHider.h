@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Common.h"
+#include "PatternRules.h"
+#include "IconLayout.h"
+
+// Hides individual desktop icons: every item whose name matches none of the
+// keep rules is moved off-screen, and moved back to where it was on
+// Restore(). The listview itself stays visible.
+//
+// The hidden icons' original positions are kept as an IconLayout. Moves
+// need "Auto arrange icons" to be off; with it on, Hide() fails instead of
+// fighting the shell.
+class SelectiveHider {
+public:
+    SelectiveHider();
+    ~SelectiveHider();
+
+    // Replaces the keep rules; returns the number of patterns rejected and
+    // adds them to the list, if given
+    size_t SetKeepRules(const std::vector<std::wstring>& patterns, std::vector<std::wstring>* rejectedPatterns = nullptr);
+    bool HasRules() const;
+
+    bool Hide(HWND listView);
+    bool Restore(HWND listView);
+
+    bool IsHiding() const;
+    size_t GetHiddenCount() const;
+    const IconLayout& GetHiddenLayout() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    PatternRules m_keepRules;
+    IconLayout m_hidden; // Where the hidden icons were
+    bool m_hiding;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Common.h"
+
+// Names of the kernel objects that identify the running instance.
+//
+// Every terminal-server session runs its own instance. The single-instance
+// mutex and our shared memory live in the session's Local\ namespace, so
+// they are already per session. Pipe names are machine-wide, so the control
+// pipe name carries the session id to keep sessions from reaching each
+// other's instance.
+namespace Session {
+
+constexpr const wchar_t* INSTANCE_MUTEX_NAME = L"Local\\DesktopIconTogglerMutex";
+constexpr const wchar_t* PIPE_NAME_PREFIX = L"\\\\.\\pipe\\DesktopIconToggler-";
+constexpr size_t MAX_OBJECT_NAME = 128;
+
+inline DWORD GetCurrentSessionId() {
+    DWORD sessionId = 0;
+    if (!ProcessIdToSessionId(GetCurrentProcessId(), &sessionId)) {
+        return 0;
+    }
+    return sessionId;
+}
+
+// \\.\pipe\DesktopIconToggler-<session id>
+inline void FormatPipeName(wchar_t (&name)[MAX_OBJECT_NAME]) {
+    swprintf_s(name, L"%s%lu", PIPE_NAME_PREFIX, GetCurrentSessionId());
+}
+
+} // namespace Session
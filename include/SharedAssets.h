@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <cstdint>
+
+// Read-only data that is identical in every session: the pre-rendered tray
+// icon bitmaps and layout-independent key names. On terminal-server hosts
+// the first instance that is allowed to create objects in the Global
+// namespace publishes them once and every session maps the same pages.
+// Without that privilege each session keeps a private copy in its Local
+// namespace, and if neither works callers render on their own.
+namespace SharedAssets {
+
+constexpr const wchar_t* GLOBAL_SECTION_NAME = L"Global\\DesktopIconTogglerAssets-1";
+constexpr const wchar_t* LOCAL_SECTION_NAME = L"Local\\DesktopIconTogglerAssets-1";
+
+constexpr uint32_t SECTION_MAGIC = 0x41544944; // "DITA"
+constexpr uint32_t SECTION_VERSION = 1;
+
+constexpr uint32_t ICON_SIZE = 16;
+constexpr uint32_t ICON_PIXELS = ICON_SIZE * ICON_SIZE;
+constexpr uint32_t KEY_NAME_LENGTH = 16;
+constexpr uint32_t KEY_COUNT = 256;
+
+// Bump SECTION_VERSION (and the section names) when changing the layout
+struct Section {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> ready;              // Set once fully written
+    uint32_t reserved;
+    uint32_t iconPixels[2][ICON_PIXELS];      // [0] hidden, [1] visible; 32bpp BGRA, top-down
+    wchar_t keyNames[KEY_COUNT][KEY_NAME_LENGTH]; // Empty if the name depends on the layout
+};
+
+} // namespace SharedAssets
+
+class SharedAssetStore {
+public:
+    SharedAssetStore();
+    ~SharedAssetStore();
+
+    // Initialization
+    bool Initialize();
+    void Cleanup();
+    
+    // True if the section is shared machine-wide rather than per session
+    bool IsMachineWide() const;
+    size_t GetPrivateBytes() const;
+    
+    // Lookups; nullptr when unavailable
+    const uint32_t* GetIconPixels(bool visible) const;
+    const wchar_t* GetKeyName(UINT vkCode) const;
+    
+    // Used to fill the section, and by callers when it is unavailable
+    static bool RenderIcon(bool visible, uint32_t* pixels);
+    static void FillKeyNames(wchar_t (*keyNames)[SharedAssets::KEY_NAME_LENGTH]);
+    
+    // The store used by HotkeyConfig::ToString
+    static const SharedAssetStore* GetActive();
+
+private:
+    bool OpenExisting(const wchar_t* name);
+    bool CreateAndPublish(const wchar_t* name, bool machineWide);
+    bool MapReadOnly();
+    bool WaitUntilReady() const;
+    
+    HANDLE m_mapping;
+    const SharedAssets::Section* m_section;
+    bool m_machineWide;
+    
+    static const SharedAssetStore* s_active;
+};
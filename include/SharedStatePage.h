@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <cstdint>
+
+// A small named shared-memory page that publishes the current icon state so
+// status bars and desktop widgets can read it without talking to us.
+//
+// The page is guarded by a seqlock: the writer makes the sequence odd,
+// updates the payload and makes it even again. Readers copy the payload and
+// retry if the sequence moved, so they never block the writer and the writer
+// never waits for them.
+//
+// To wait for a change instead of polling, a reader that has seen change
+// counter N waits on CHANGE_EVENT_NAMES[(N + 1) & 1]. Publishing change N
+// sets event N & 1 and resets the other one. Wait with a timeout and
+// re-check the counter, since a reader that falls two changes behind
+// can miss a signal.
+namespace SharedState {
+
+constexpr const wchar_t* MAPPING_NAME = L"Local\\DesktopIconTogglerState";
+constexpr const wchar_t* CHANGE_EVENT_NAMES[2] = {
+    L"Local\\DesktopIconTogglerStateChanged0",
+    L"Local\\DesktopIconTogglerStateChanged1"
+};
+
+constexpr uint32_t PAGE_MAGIC = 0x53544944; // "DITS"
+constexpr uint32_t PAGE_VERSION = 1;
+
+// Layout is part of the contract with readers; only append fields and bump
+// PAGE_VERSION when doing so
+struct Page {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t publisherProcessId;
+    uint32_t reserved;
+    uint64_t publisherStartTime;            // FILETIME, UTC
+    
+    alignas(64) std::atomic<uint32_t> sequence; // Odd while being written
+    std::atomic<uint32_t> iconState;        // 0 hidden, 1 visible, 2 unknown
+    std::atomic<uint32_t> hotkeyModifiers;  // MOD_* flags
+    std::atomic<uint32_t> hotkeyVirtualKey;
+    std::atomic<uint64_t> changeCounter;    // Incremented on every change
+    std::atomic<uint64_t> lastChangeTime;   // FILETIME, UTC
+};
+
+// Consistent copy of the payload
+struct Snapshot {
+    uint32_t iconState;
+    uint32_t hotkeyModifiers;
+    uint32_t hotkeyVirtualKey;
+    uint64_t changeCounter;
+    uint64_t lastChangeTime;
+};
+
+// Reader side, for consumers built against this header
+inline Snapshot ReadSnapshot(const Page& page) {
+    Snapshot snapshot;
+    
+    for (;;) {
+        uint32_t before = page.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            YieldProcessor();
+            continue;
+        }
+        
+        snapshot.iconState = page.iconState.load(std::memory_order_relaxed);
+        snapshot.hotkeyModifiers = page.hotkeyModifiers.load(std::memory_order_relaxed);
+        snapshot.hotkeyVirtualKey = page.hotkeyVirtualKey.load(std::memory_order_relaxed);
+        snapshot.changeCounter = page.changeCounter.load(std::memory_order_relaxed);
+        snapshot.lastChangeTime = page.lastChangeTime.load(std::memory_order_relaxed);
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (page.sequence.load(std::memory_order_relaxed) == before) {
+            return snapshot;
+        }
+    }
+}
+
+} // namespace SharedState
+
+// Writer side, owned by Application
+class SharedStatePublisher {
+public:
+    SharedStatePublisher();
+    ~SharedStatePublisher();
+
+    // Initialization
+    bool Initialize();
+    void Cleanup();
+    
+    // Publishes only if something changed. UI thread.
+    void Publish(IconState iconState, const HotkeyConfig& hotkey);
+
+private:
+    HANDLE m_mapping;
+    SharedState::Page* m_page;
+    HANDLE m_changeEvents[2];
+};
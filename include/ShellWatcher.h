@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Common.h"
+
+// Tells the main window when Explorer's desktop and taskbar appear, without
+// polling. At logon the app can start before Explorer has created Progman;
+// Explorer can also restart at any time.
+//
+// - Explorer broadcasts the registered "TaskbarCreated" message to top-level
+//   windows whenever the taskbar is (re)created. Compare against
+//   GetTaskbarCreatedMessage() in the window procedure.
+// - While waiting, an out-of-context WinEvent hook watches window creation
+//   and posts WM_SHELL_READY once a desktop listview or DefView shows up.
+//   The hook is removed as soon as the desktop has been found.
+// - While tracking icon moves, a second hook limited to the desktop
+//   listview's thread posts WM_ICONS_MOVED when icons change position.
+//
+// UI thread only.
+class ShellWatcher {
+public:
+    ShellWatcher();
+    ~ShellWatcher();
+
+    // Initialization
+    bool Initialize(HWND notifyWindow);
+    void Cleanup();
+
+    UINT GetTaskbarCreatedMessage() const;
+
+    // Installs the creation hook; WM_SHELL_READY is posted at most once per
+    // signal until ResetSignal() is called
+    bool BeginWaiting();
+    void StopWaiting();
+    bool IsWaiting() const;
+    void ResetSignal();
+
+    // QueryPerformanceCounter value of the event that raised the last signal
+    LONGLONG GetSignalTime() const;
+
+    // Marks the shell as ready now, for signals that do not come from the
+    // hook (TaskbarCreated, or the desktop already being there)
+    void MarkSignalTime();
+
+    // WM_ICONS_MOVED is posted at most once until ResetIconMoveSignal().
+    // Call again with the new listview after Explorer restarts.
+    bool TrackIconMoves(HWND listView);
+    void StopTrackingIconMoves();
+    bool IsTrackingIconMoves() const;
+    void ResetIconMoveSignal();
+
+private:
+    static void CALLBACK WinEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                      LONG idObject, LONG idChild,
+                                      DWORD eventThread, DWORD eventTime);
+    static void CALLBACK MoveEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                       LONG idObject, LONG idChild,
+                                       DWORD eventThread, DWORD eventTime);
+    void OnWindowEvent(HWND hwnd);
+
+    HWND m_notifyWindow;
+    UINT m_taskbarCreatedMessage;
+    HWINEVENTHOOK m_hook;
+    bool m_signalPending;
+    LONGLONG m_signalTime;
+    HWINEVENTHOOK m_moveHook;
+    HWND m_trackedListView;
+    bool m_moveSignalPending;
+
+    // Out-of-context callbacks carry no context pointer
+    static ShellWatcher* s_waiting;
+    static ShellWatcher* s_tracking;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.h"
+
+// Times the phases of Application::Initialize with QueryPerformanceCounter.
+// Storage is a fixed table, so recording costs two counter reads per phase
+// and is always on. The report is written only in measure-only launches.
+class StartupProfiler {
+public:
+    static constexpr size_t MAX_PHASES = 16;
+    
+    struct Phase {
+        const char* name;
+        double elapsedMs;
+        double budgetMs; // 0 = no budget
+    };
+    
+    StartupProfiler();
+
+    // Recording
+    void BeginPhase(const char* name);
+    void EndPhase();
+    void Finish();
+    
+    // Budgets, applied before writing the report
+    void SetBudget(const char* name, double budgetMs);
+    bool IsWithinBudget() const;
+    
+    // Results
+    size_t GetPhaseCount() const;
+    const Phase& GetPhase(size_t index) const;
+    double GetTotalMs() const;
+    
+    // Machine-readable JSON report
+    bool WriteReport(const std::wstring& path) const;
+
+private:
+    double ElapsedMs(LONGLONG from, LONGLONG to) const;
+    
+    Phase m_phases[MAX_PHASES];
+    size_t m_phaseCount;
+    bool m_phaseOpen;
+    
+    LARGE_INTEGER m_frequency;
+    LONGLONG m_startTime;
+    LONGLONG m_phaseStart;
+    double m_totalMs;
+    double m_totalBudgetMs;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decides which toggle strategy (see ToggleStrategy.h) changes the icons'
+// visibility, and learns from the results. Until one is known to work,
+// each change goes to the strategy measured least so far, and once every
+// strategy has calibrationSamples results the fastest is selected. When the
+// selected strategy fails, the others are tried, fastest measured first,
+// and the first that works becomes the selection.
+//
+// Calibration goes in hide/show pairs: the show after a hide goes to the
+// strategy that hid, and calibration only ends after a show. Strategies
+// hide different things, so a show by another one could leave part of the
+// hide in place.
+//
+// Pure bookkeeping over strategy indices; the caller passes in how to
+// apply one. UI thread only.
+class StrategySelector {
+public:
+    static constexpr size_t MAX_STRATEGIES = 8;
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    StrategySelector(size_t count, uint32_t calibrationSamples);
+    ~StrategySelector();
+
+    // Starts measuring again, or uses one strategy from now on
+    void Calibrate();
+    void Select(size_t index);
+
+    bool IsCalibrating() const;
+    size_t GetSelected() const;
+
+    // True once after calibration finished or a failover selected another
+    // strategy
+    bool TakeSelectionChanged();
+
+    // Tries the strategies in turn through attempt(index, latencyUs), which
+    // returns whether the change took effect and how long it took. Returns
+    // the strategy that worked, or NPOS if none did.
+    template<typename Attempt>
+    size_t Apply(bool visible, Attempt attempt);
+
+private:
+    struct Stats {
+        uint64_t bestLatencyUs; // 0 = not measured
+        uint32_t samples;
+        bool failed;            // Failed on its last attempt
+    };
+
+    size_t First(bool visible) const;
+    size_t NextFallback(const bool* tried) const;
+    size_t NextCalibration() const;
+    void Record(size_t index, bool visible, uint64_t latencyUs);
+    void FinishCalibration();
+
+    size_t m_count;
+    uint32_t m_calibrationSamples;
+    Stats m_stats[MAX_STRATEGIES];
+    size_t m_selected;
+    size_t m_hiddenBy; // Calibration strategy whose hide awaits its show
+    bool m_calibrating;
+    bool m_selectionChanged;
+};
+
+template<typename Attempt>
+size_t StrategySelector::Apply(bool visible, Attempt attempt) {
+    bool tried[MAX_STRATEGIES] = {};
+    for (size_t index = First(visible); index != NPOS; index = NextFallback(tried)) {
+        tried[index] = true;
+
+        uint64_t latencyUs = 0;
+        if (attempt(index, latencyUs)) {
+            Record(index, visible, latencyUs);
+            return index;
+        }
+        m_stats[index].failed = true;
+    }
+
+    return NPOS;
+}
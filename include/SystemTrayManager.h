@@ -2,6 +2,9 @@
 
 #include "Common.h"
 
+class CommandBus;
+class SharedAssetStore;
+
 class SystemTrayManager {
 public:
     SystemTrayManager();
@@ -15,7 +18,7 @@ public:
     bool CreateTrayIcon();
     bool RemoveTrayIcon();
     bool UpdateTrayIcon(IconState iconState);
-    bool ShowBalloonTip(const std::wstring& title, const std::wstring& message, DWORD timeout = 3000);
+    bool ShowBalloonTip(const wchar_t* title, const wchar_t* message, DWORD timeout = 3000);
     
     // Context menu
     bool ShowContextMenu(int x, int y);
@@ -29,10 +32,16 @@ public:
     void SetIconState(IconState state);
     IconState GetIconState() const;
     
-    // Callbacks
-    void SetToggleCallback(std::function<void()> callback);
-    void SetSettingsCallback(std::function<void()> callback);
-    void SetExitCallback(std::function<void()> callback);
+    // Tray and menu actions are posted here
+    void SetCommandBus(CommandBus* commandBus);
+    
+    // Pre-rendered icons; set before Initialize
+    void SetSharedAssets(const SharedAssetStore* sharedAssets);
+    
+    // Drops the context menu and the icon not currently shown; both are
+    // rebuilt on next use
+    void ReleaseCachedResources();
+    size_t GetMemoryUsage() const;
 
 private:
     // Internal state
@@ -43,10 +52,9 @@ private:
     bool m_initialized;
     IconState m_currentIconState;
     
-    // Callbacks
-    std::function<void()> m_toggleCallback;
-    std::function<void()> m_settingsCallback;
-    std::function<void()> m_exitCallback;
+    // Command target
+    CommandBus* m_commandBus;
+    const SharedAssetStore* m_sharedAssets;
     
     // Icon resources
     HICON m_iconVisible;
@@ -59,5 +67,5 @@ private:
     void DestroyContextMenu();
     HICON CreateCustomIcon(bool visible);
     void UpdateMenuItemText();
-    std::wstring GetToggleMenuText() const;
+    const wchar_t* GetToggleMenuText() const;
 };
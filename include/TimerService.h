@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Common.h"
+#include "TimerWheel.h"
+#include <cstdint>
+
+// Timed work owned by the UI thread. Each timed feature gets a TimerId
+// instead of its own Win32 timer.
+enum class TimerId : uint32_t {
+    SettingsIdle,
+    FootprintTrim,
+    DisplayLayoutRestore,
+    LayoutCapture,
+    VirtualDesktopApply,
+    ContextRules,
+    IdleDeadline,
+    Count
+};
+
+// Every scheduled TimerId shares one coalescable Win32 timer on the main
+// window. It is armed for the earliest deadline and killed as soon as
+// nothing is scheduled, so an idle process receives no timer messages.
+//
+// Deadlines are kept in a TimerWheel, which also holds any number of
+// cookie timers for features with many of their own (schedules, timed
+// states); adding or cancelling one costs the same however many exist.
+//
+// UI thread only.
+class TimerService {
+public:
+    TimerService();
+    ~TimerService();
+
+    // Initialization
+    bool Initialize(HWND window);
+    void Cleanup();
+    
+    // Scheduling a TimerId that is already scheduled moves its deadline.
+    // The tolerance lets Windows batch this wakeup with other activity.
+    void Schedule(TimerId id, DWORD delayMs, DWORD toleranceMs = TIMER_DEFAULT_TOLERANCE_MS);
+    void Cancel(TimerId id);
+    bool IsScheduled(TimerId id) const;
+    size_t GetScheduledCount() const;
+    
+    // Cookie timers use the default tolerance; 0 = not scheduled
+    TimerWheel::Handle ScheduleCookie(ULONGLONG delayMs, uint64_t cookie);
+    void CancelCookie(TimerWheel::Handle handle);
+    
+    // Call on WM_TIMER with ID_TIMER_SERVICE, and after the clock jumped
+    // (resume from sleep). Unschedules the timers that are due, re-arms for
+    // the next one and returns the due TimerIds as a bit mask (see Bit());
+    // due cookie timers follow from TakeExpiredCookie().
+    uint32_t TakeExpired();
+    bool TakeExpiredCookie(uint64_t& cookie);
+    
+    size_t GetMemoryUsage() const;
+    
+    static uint32_t Bit(TimerId id) {
+        return 1u << static_cast<uint32_t>(id);
+    }
+
+private:
+    struct Entry {
+        TimerWheel::Handle handle; // 0 = not scheduled
+        DWORD toleranceMs;
+    };
+    
+    void Rearm();
+    
+    HWND m_window;
+    TimerWheel m_wheel;
+    Entry m_entries[static_cast<size_t>(TimerId::Count)];
+    std::vector<uint64_t> m_expiredCookies; // Since the last TakeExpired()
+    size_t m_nextExpiredCookie;
+    ULONGLONG m_armedDeadline; // 0 = Win32 timer not armed
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel: any number of timers with O(1) insert and
+// cancel, and expiry work proportional to the timers that are due.
+//
+// Time is cut into ticks of TICK_MS. Level 0 has one slot per tick for the
+// next 64 ticks, level 1 one slot per 64 ticks for the next 64^2, and so on
+// up to LEVELS; with 16 ms ticks the wheel spans about three days, and
+// later deadlines are parked in the last slot and re-sorted from there.
+// When time reaches the start of a higher-level slot, its timers are
+// cascaded to the levels below. A bitmap per level finds the next occupied
+// slot, so the wheel skips over empty time instead of stepping every tick.
+//
+// Timers live in one node pool and are linked into their slot; a handle
+// carries the node index and a generation, so cancelling a timer that has
+// already expired is harmless. Pure bookkeeping on millisecond times passed
+// in by the caller, so it runs the same against any clock.
+class TimerWheel {
+public:
+    using Handle = uint64_t; // 0 = none
+
+    static constexpr uint64_t TICK_MS = 16;
+    static constexpr uint32_t SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t LEVELS = 4;
+
+    TimerWheel();
+    ~TimerWheel();
+
+    // Deadlines already past expire on the next tick. The cookie is
+    // handed back by PopExpired().
+    Handle Insert(uint64_t nowMs, uint64_t deadlineMs, uint64_t cookie);
+    bool Cancel(Handle handle);
+    bool IsPending(Handle handle) const;
+    size_t GetCount() const;
+
+    // Earliest time at which Advance() has something to expire; false when
+    // no timer is pending. Never later than the earliest deadline.
+    bool GetNextDeadline(uint64_t& deadlineMs) const;
+
+    // Moves every timer due at nowMs to the expired list; returns how many
+    size_t Advance(uint64_t nowMs);
+    bool PopExpired(uint64_t& cookie);
+
+    void Reserve(size_t timers);
+    void Clear();
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr uint32_t NIL = 0xFFFFFFFFu;
+    static constexpr uint16_t EXPIRED_LIST = LEVELS * SLOTS;
+    static constexpr uint16_t FREE_LIST = 0xFFFF;
+
+    struct Node {
+        uint64_t deadline; // Tick
+        uint64_t cookie;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t generation;
+        uint16_t list; // Slot, EXPIRED_LIST or FREE_LIST
+    };
+
+    uint32_t Allocate();
+    void Release(uint32_t index);
+    void Link(uint32_t index, uint16_t list);
+    void Unlink(uint32_t index);
+    void Place(uint32_t index);
+    uint64_t NextEventTick() const;
+    void Cascade(uint32_t level, uint32_t slot);
+
+    std::vector<Node> m_nodes;
+    uint32_t m_free;                                // Head of the free nodes, through next
+    uint32_t m_heads[LEVELS * SLOTS + 1];           // Slots, then the expired list
+    uint32_t m_expiredTail;                         // Expired timers pop in order
+    uint64_t m_slotMin[LEVELS * SLOTS];             // Lower bound of a slot's deadlines
+    uint64_t m_occupied[LEVELS];                    // Bit per non-empty slot
+    uint64_t m_current;                             // Last tick processed
+    size_t m_count;                                 // Pending, not expired
+};
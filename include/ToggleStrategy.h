@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common.h"
+#include <cstdint>
+
+// The desktop windows a strategy acts on. defView or listView may be null if
+// the shell has not created them (yet).
+struct DesktopWindows {
+    HWND progman = nullptr;
+    HWND defView = nullptr;   // SHELLDLL_DefView
+    HWND listView = nullptr;  // SysListView32 "FolderView"
+};
+
+// Order is the fallback order before anything has been measured
+enum class ToggleStrategyId : uint32_t {
+    ListView,
+    ShellCommand,
+    HideDefView,
+    Count
+};
+
+// One way of showing or hiding the desktop icons. Strategies differ in
+// latency and in which shell versions they work on; DesktopIconManager
+// measures them and picks one (see DesktopIconManager::SetDesktopIconVisibility).
+//
+// Apply(true) must also undo whatever the other strategies may have hidden
+// (the listview, DefView and the shell's own hide-icons setting), so
+// switching strategies never leaves the icons stuck hidden.
+class IToggleStrategy {
+public:
+    virtual ~IToggleStrategy() = default;
+
+    virtual ToggleStrategyId GetId() const = 0;
+
+    // Stable name stored in settings.ini
+    virtual const wchar_t* GetName() const = 0;
+
+    // Whether the windows this strategy needs exist
+    virtual bool IsAvailable(const DesktopWindows& windows) const = 0;
+
+    // Returns false if the shell rejected the change. The caller still
+    // verifies the result, since some shells accept and ignore it.
+    virtual bool Apply(const DesktopWindows& windows, bool visible) = 0;
+};
+
+// ShowWindow on the FolderView listview followed by a full desktop refresh.
+// Works everywhere the listview exists but the refresh is expensive.
+class ListViewToggleStrategy : public IToggleStrategy {
+public:
+    ToggleStrategyId GetId() const override { return ToggleStrategyId::ListView; }
+    const wchar_t* GetName() const override { return L"listview"; }
+    bool IsAvailable(const DesktopWindows& windows) const override;
+    bool Apply(const DesktopWindows& windows, bool visible) override;
+};
+
+// Sends DefView the command behind "View > Show desktop icons". The shell
+// updates its own setting, so Explorer and the desktop menu stay in sync.
+class ShellCommandToggleStrategy : public IToggleStrategy {
+public:
+    ToggleStrategyId GetId() const override { return ToggleStrategyId::ShellCommand; }
+    const wchar_t* GetName() const override { return L"shell_command"; }
+    bool IsAvailable(const DesktopWindows& windows) const override;
+    bool Apply(const DesktopWindows& windows, bool visible) override;
+};
+
+// Hides the whole SHELLDLL_DefView. Cheapest, but the desktop context menu
+// is unavailable while the icons are hidden.
+class HideDefViewToggleStrategy : public IToggleStrategy {
+public:
+    ToggleStrategyId GetId() const override { return ToggleStrategyId::HideDefView; }
+    const wchar_t* GetName() const override { return L"hide_defview"; }
+    bool IsAvailable(const DesktopWindows& windows) const override;
+    bool Apply(const DesktopWindows& windows, bool visible) override;
+};
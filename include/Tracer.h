@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <cstdint>
+
+// Always-on span tracer. Each thread records into its own fixed-size ring
+// buffer, so emitting a span is two QueryPerformanceCounter reads and a
+// handful of stores with no locks or allocation after the thread's first
+// span. The most recent spans of every thread can be written out in Chrome
+// trace-event JSON (chrome://tracing, Perfetto) on demand or from the
+// unhandled-exception filter.
+//
+// Span names and categories must be string literals; only the pointers are
+// stored.
+class Tracer {
+public:
+    static constexpr size_t RING_CAPACITY = 2048; // Per thread, power of two
+    static constexpr size_t MAX_THREADS = 32;
+    
+    // Once at startup, before any dump. Also installs the crash filter that
+    // dumps to crashTracePath.
+    static void Initialize(const std::wstring& crashTracePath);
+    
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+    
+    static int64_t Now();
+    static void Record(const char* category, const char* name, int64_t start, int64_t end);
+    
+    // Output
+    // False if another dump is running or Initialize has not been called
+    static bool DumpChromeTrace(const wchar_t* path);
+    
+    // Bytes held by the per-thread ring buffers
+    static size_t GetMemoryUsage();
+
+private:
+    struct Event {
+        const char* category;
+        const char* name;
+        int64_t start;
+        int64_t end;
+    };
+    
+    struct ThreadBuffer {
+        std::atomic<uint64_t> head;
+        DWORD threadId;
+        Event events[RING_CAPACITY];
+    };
+    
+    static ThreadBuffer* AcquireThreadBuffer();
+    static LONG WINAPI CrashFilter(EXCEPTION_POINTERS* exceptionInfo);
+    
+    static thread_local ThreadBuffer* s_threadBuffer;
+    static thread_local bool s_threadBufferUnavailable;
+    
+    static std::atomic<bool> s_enabled;
+    static std::atomic<ThreadBuffer*> s_buffers[MAX_THREADS];
+    static std::atomic<size_t> s_bufferCount;
+    static wchar_t s_crashTracePath[MAX_PATH];
+    static LPTOP_LEVEL_EXCEPTION_FILTER s_previousFilter;
+};
+
+// Records the enclosing scope as one span
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name)
+        : m_category(category)
+        , m_name(name)
+        , m_start(Tracer::IsEnabled() ? Tracer::Now() : 0) {
+    }
+    
+    ~TraceSpan() {
+        if (m_start != 0) {
+            Tracer::Record(m_category, m_name, m_start, Tracer::Now());
+        }
+    }
+    
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_category;
+    const char* m_name;
+    int64_t m_start;
+};
+
+#define TRACE_SPAN_CONCAT_INNER(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_INNER(a, b)
+#define TRACE_SPAN(category, name) TraceSpan TRACE_SPAN_CONCAT(traceSpan_, __LINE__)(category, name)
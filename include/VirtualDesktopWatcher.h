@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <cstring>
+
+// Tells the main window when the user switches virtual desktops, without
+// polling. Explorer keeps the current desktop's GUID in the registry
+// (CurrentVirtualDesktop under Explorer\VirtualDesktops, or under the
+// session's key on older Windows 10 builds); a thread-agnostic
+// RegNotifyChangeKeyValue signals an event, and a thread pool wait on that
+// event re-arms the notification and posts WM_VIRTUAL_DESKTOP_CHANGED.
+//
+// The key also changes when desktops are created or renamed, so the
+// receiver compares GetCurrent() with the desktop it last saw.
+//
+// Simulate() stands in for Explorer (see --measure-desktop-switch): it
+// posts the same message and GetCurrent() reports the simulated desktop
+// until StopSimulating().
+class VirtualDesktopWatcher {
+public:
+    VirtualDesktopWatcher();
+    ~VirtualDesktopWatcher();
+
+    // Initialization
+    bool Initialize(HWND notifyWindow);
+    void Cleanup();
+    bool IsActive() const;
+
+    static bool IsSame(const GUID& a, const GUID& b) {
+        return memcmp(&a, &b, sizeof(GUID)) == 0;
+    }
+
+    // False if Explorer has not recorded a current desktop (no switch yet)
+    bool GetCurrent(GUID& desktop) const;
+
+    // Every desktop Explorer knows, for dropping state of removed ones
+    bool GetDesktops(std::vector<GUID>& desktops) const;
+
+    // QueryPerformanceCounter value of the last change notification
+    LONGLONG GetSignalTime() const;
+
+    void Simulate(const GUID& desktop);
+    void StopSimulating();
+
+private:
+    static void CALLBACK OnKeyChanged(PVOID context, BOOLEAN timedOut);
+    bool ArmNotification();
+    bool OpenDesktopsKey();
+
+    HWND m_notifyWindow;
+    HKEY m_key;     // Holds CurrentVirtualDesktop
+    HKEY m_listKey; // Holds VirtualDesktopIDs; not always the same key
+    HANDLE m_event;
+    HANDLE m_wait;
+    std::atomic<LONGLONG> m_signalTime;
+    bool m_simulating;
+    GUID m_simulated;
+};
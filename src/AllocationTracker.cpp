@@ -0,0 +1,137 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    constexpr size_t SUBSYSTEM_COUNT = static_cast<size_t>(AllocationSubsystem::Count);
+    
+    const char* const SUBSYSTEM_NAMES[SUBSYSTEM_COUNT] = {
+        "other", "app", "desktop", "tray", "config", "ipc", "diagnostics"
+    };
+    
+    // Plain zero-initialized globals and thread_locals only: these are touched
+    // from operator new, possibly before any constructor has run
+    std::atomic<uint64_t> g_allocationCounts[SUBSYSTEM_COUNT];
+    std::atomic<uint64_t> g_allocatedBytes[SUBSYSTEM_COUNT];
+    std::atomic<uint64_t> g_violations;
+    
+    thread_local AllocationSubsystem t_currentSubsystem = AllocationSubsystem::Other;
+    thread_local uint64_t t_threadAllocations = 0;
+}
+
+void AllocationTracker::RecordAllocation(size_t size) {
+    size_t index = static_cast<size_t>(t_currentSubsystem);
+    g_allocationCounts[index].fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes[index].fetch_add(size, std::memory_order_relaxed);
+    t_threadAllocations++;
+}
+
+uint64_t AllocationTracker::GetAllocationCount(AllocationSubsystem subsystem) {
+    return g_allocationCounts[static_cast<size_t>(subsystem)].load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::GetAllocatedBytes(AllocationSubsystem subsystem) {
+    return g_allocatedBytes[static_cast<size_t>(subsystem)].load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::GetThreadAllocationCount() {
+    return t_threadAllocations;
+}
+
+uint64_t AllocationTracker::GetViolationCount() {
+    return g_violations.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::ReportViolation(const char* path, uint64_t allocations) {
+    g_violations.fetch_add(1, std::memory_order_relaxed);
+    
+    char message[160];
+    sprintf_s(message, "Allocation check failed: %s made %llu heap allocation(s) after warmup\n",
+              path, static_cast<unsigned long long>(allocations));
+    OutputDebugStringA(message);
+    
+    assert(!"Heap allocation on a zero-allocation path");
+}
+
+const char* AllocationTracker::GetSubsystemName(AllocationSubsystem subsystem) {
+    size_t index = static_cast<size_t>(subsystem);
+    return index < SUBSYSTEM_COUNT ? SUBSYSTEM_NAMES[index] : "unknown";
+}
+
+void AllocationTracker::DumpToDebugOutput() {
+    char line[128];
+    for (size_t i = 0; i < SUBSYSTEM_COUNT; i++) {
+        AllocationSubsystem subsystem = static_cast<AllocationSubsystem>(i);
+        sprintf_s(line, "Allocations %-12s %10llu (%llu bytes)\n",
+                  GetSubsystemName(subsystem),
+                  static_cast<unsigned long long>(GetAllocationCount(subsystem)),
+                  static_cast<unsigned long long>(GetAllocatedBytes(subsystem)));
+        OutputDebugStringA(line);
+    }
+    
+    sprintf_s(line, "Allocation check violations: %llu\n",
+              static_cast<unsigned long long>(GetViolationCount()));
+    OutputDebugStringA(line);
+}
+
+AllocationSubsystem AllocationTracker::SetCurrentSubsystem(AllocationSubsystem subsystem) {
+    AllocationSubsystem previous = t_currentSubsystem;
+    t_currentSubsystem = subsystem;
+    return previous;
+}
+
+#ifdef DIT_ALLOCATION_ACCOUNTING
+
+// Global allocator replacement. Over-aligned allocations keep the default
+// implementation and are not counted.
+
+void* operator new(size_t size) {
+    AllocationTracker::RecordAllocation(size);
+    void* memory = std::malloc(size ? size : 1);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    AllocationTracker::RecordAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+#endif
@@ -1,4 +1,20 @@
 #include "Application.h"
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    // Cookie timers of the schedules: the timed hide, then one per window
+    constexpr uint64_t COOKIE_TIMED_HIDE = 0;
+    constexpr uint64_t COOKIE_SCHEDULE_WINDOW = 1;
+    
+    constexpr ULONGLONG FILETIME_TICKS_PER_MS = 10000;
+    
+    ULONGLONG FileTimeNow() {
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        return (static_cast<ULONGLONG>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+    }
+}
 
 Application* Application::s_instance = nullptr;
 
@@ -6,7 +22,22 @@ Application::Application()
     : m_hInstance(nullptr)
     , m_mainWindow(nullptr)
     , m_initialized(false)
-    , m_running(false) {
+    , m_running(false)
+    , m_toggleCount(0)
+    , m_monitorToggleTick(0)
+    , m_currentDesktop{}
+    , m_hasCurrentDesktop(false)
+    , m_desktopSwitchTime(0)
+    , m_desktopSwitchesApplied(0)
+    , m_lastDesktopSwitchUs(0)
+    , m_contextHiding(false)
+    , m_contextOverride(false)
+    , m_contextWantsHide(false)
+    , m_idleHiding(false)
+    , m_timedHideTimer(0)
+    , m_scheduleHiding(false)
+    , m_scheduleOverride(false)
+    , m_scheduleWantsHide(false) {
     
     s_instance = this;
 }
@@ -23,37 +54,49 @@ bool Application::Initialize(HINSTANCE hInstance) {
     
     m_hInstance = hInstance;
     
+    // Keep the last spans of every thread if we go down
+    Tracer::Initialize(GetModuleDirectory() + L"\\" + CRASH_TRACE_FILE);
+    
     // Initialize COM for shell operations
+    m_startupProfiler.BeginPhase("CoInitialize");
     if (FAILED(CoInitialize(nullptr))) {
         ShowErrorMessage(L"Failed to initialize COM library");
         return false;
     }
     
     // Create main window
+    m_startupProfiler.BeginPhase("CreateMainWindow");
     if (!CreateMainWindow()) {
         ShowErrorMessage(L"Failed to create main window");
         return false;
     }
     
     // Initialize components
+    m_startupProfiler.BeginPhase("InitializeComponents");
     if (!InitializeComponents()) {
         ShowErrorMessage(L"Failed to initialize application components");
         return false;
     }
     
     // Load configuration
+    m_startupProfiler.BeginPhase("LoadConfiguration");
     if (!LoadConfiguration()) {
         ShowErrorMessage(L"Failed to load configuration");
         return false;
     }
     
     // Setup callbacks
+    m_startupProfiler.BeginPhase("SetupCallbacks");
     if (!SetupCallbacks()) {
         ShowErrorMessage(L"Failed to setup callbacks");
         return false;
     }
     
+    m_startupProfiler.Finish();
     m_initialized = true;
+    
+    // Start the idle countdown for footprint mode
+    NoteActivity();
     return true;
 }
 
@@ -64,13 +107,70 @@ int Application::Run() {
     
     m_running = true;
     
+    // Everything the app does is driven by messages or kernel events; the
+    // loop blocks without a timeout so an idle instance never wakes up
+    int exitCode = 0;
+    while (PumpMessages(exitCode) && m_running) {
+        MsgWaitForMultipleObjectsEx(0, nullptr, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        Metrics::MainLoopWakeups.Increment();
+    }
+    
+    return exitCode;
+}
+
+bool Application::PumpMessages(int& exitCode) {
     MSG msg;
-    while (m_running && GetMessage(&msg, nullptr, 0, 0)) {
+    while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+        if (msg.message == WM_QUIT) {
+            exitCode = static_cast<int>(msg.wParam);
+            return false;
+        }
+        
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
     
-    return static_cast<int>(msg.wParam);
+    return true;
+}
+
+uint64_t Application::MeasureIdleWakeups(DWORD durationMs) {
+    if (!m_initialized) {
+        return 0;
+    }
+    
+    m_running = true;
+    
+    // Let startup traffic (tray registration, shell notifications) settle
+    // before counting
+    int exitCode = 0;
+    if (!PumpMessages(exitCode)) {
+        return 0;
+    }
+    
+    uint64_t wakeups = 0;
+    ULONGLONG deadline = GetTickCount64() + durationMs;
+    
+    for (;;) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline || !m_running) {
+            break;
+        }
+        
+        DWORD result = MsgWaitForMultipleObjectsEx(0, nullptr, static_cast<DWORD>(deadline - now),
+                                                   QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        if (result == WAIT_TIMEOUT) {
+            break;
+        }
+        
+        wakeups++;
+        Metrics::MainLoopWakeups.Increment();
+        
+        if (!PumpMessages(exitCode)) {
+            break;
+        }
+    }
+    
+    return wakeups;
 }
 
 void Application::Shutdown() {
@@ -80,17 +180,24 @@ void Application::Shutdown() {
     
     m_running = false;
     
-    // Save configuration before shutdown
-    if (m_configManager) {
-        m_configManager->SaveSettings();
-    }
+    ReleaseDesktop();
+    
+    // Stop accepting commands from other processes first
+    m_ipcServer.reset();
+    m_sharedState.reset();
+    m_metricsExporter.reset();
     
     // Cleanup components in reverse order
-    m_settingsWindow.reset();
+    ReleaseSettingsWindow();
+    m_desktopWatcher.reset();
+    m_shellWatcher.reset();
     m_systemTrayManager.reset();
+    m_sharedAssets.reset();
     m_hotkeyManager.reset();
     m_desktopIconManager.reset();
     m_configManager.reset();
+    m_timerService.reset();
+    m_commandBus.reset();
     
     // Destroy main window
     if (m_mainWindow) {
@@ -101,13 +208,85 @@ void Application::Shutdown() {
     // Cleanup COM
     CoUninitialize();
     
+#ifdef DIT_ALLOCATION_ACCOUNTING
+    AllocationTracker::DumpToDebugOutput();
+#endif
+    
     m_initialized = false;
 }
 
+void Application::ReleaseDesktop() {
+    // Icons moved since the last capture would otherwise be lost
+    FlushLayoutCapture();
+    
+    // Icons hidden by a context rule, idle or a schedule would stay hidden
+    // after exit; a timed hide picks up again on the next start
+    m_contextWatcher.reset();
+    m_clickWatcher.reset();
+    m_idleDetector.StopInputWatch();
+    if ((m_contextHiding || m_idleHiding || m_scheduleHiding) && m_desktopIconManager) {
+        m_desktopIconManager->ShowDesktopIcons();
+        m_contextHiding = false;
+        m_idleHiding = false;
+        m_scheduleHiding = false;
+    }
+    
+    // Save configuration before shutdown
+    if (m_configManager) {
+        m_configManager->SaveSettings();
+    }
+    
+    // Off-screen icons go back while Explorer is still there to save them
+    if (m_desktopIconManager) {
+        m_desktopIconManager->RestoreHiddenIcons();
+    }
+}
+
+void Application::OnEndSession() {
+    TRACE_SPAN("app", "OnEndSession");
+    
+    // The process may be ended without WM_DESTROY once this returns
+    if (m_initialized) {
+        ReleaseDesktop();
+    }
+}
+
 Application* Application::GetInstance() {
     return s_instance;
 }
 
+bool Application::PostCommand(CommandType type) {
+    if (!m_commandBus) {
+        return false;
+    }
+    
+    return m_commandBus->Post(type, CommandSource::Internal);
+}
+
+bool Application::WriteStartupReport(const std::wstring& path) {
+    // Budgets come from the [StartupBudgets] section of settings.ini
+    if (m_configManager) {
+        for (size_t i = 0; i < m_startupProfiler.GetPhaseCount(); i++) {
+            const char* name = m_startupProfiler.GetPhase(i).name;
+            int budgetMs = m_configManager->GetStartupBudgetMs(std::wstring(name, name + strlen(name)));
+            if (budgetMs > 0) {
+                m_startupProfiler.SetBudget(name, budgetMs);
+            }
+        }
+        
+        int totalBudgetMs = m_configManager->GetStartupBudgetMs(L"Total");
+        if (totalBudgetMs > 0) {
+            m_startupProfiler.SetBudget("Total", totalBudgetMs);
+        }
+    }
+    
+    return m_startupProfiler.WriteReport(path);
+}
+
+bool Application::IsStartupWithinBudget() const {
+    return m_startupProfiler.IsWithinBudget();
+}
+
 bool Application::CreateMainWindow() {
     if (!RegisterWindowClass()) {
         return false;
@@ -132,36 +311,92 @@ bool Application::CreateMainWindow() {
 
 bool Application::InitializeComponents() {
     // Create component managers
+    m_commandBus = std::make_unique<CommandBus>();
+    m_timerService = std::make_unique<TimerService>();
     m_configManager = std::make_unique<ConfigManager>();
     m_desktopIconManager = std::make_unique<DesktopIconManager>();
     m_hotkeyManager = std::make_unique<HotkeyManager>();
     m_systemTrayManager = std::make_unique<SystemTrayManager>();
-    m_settingsWindow = std::make_unique<SettingsWindow>();
     
     // Initialize components
+    if (!m_commandBus->Initialize(m_mainWindow)) {
+        return false;
+    }
+    
+    if (!m_timerService->Initialize(m_mainWindow)) {
+        return false;
+    }
+    
     if (!m_configManager->Initialize()) {
         return false;
     }
     
+    // At logon Explorer may not have created the desktop yet. Start without
+    // it and apply the remembered state once it appears.
+    m_shellWatcher = std::make_unique<ShellWatcher>();
+    if (!m_shellWatcher->Initialize(m_mainWindow)) {
+        m_shellWatcher.reset();
+    }
+    
     if (!m_desktopIconManager->Initialize()) {
-        return false;
+        if (!m_shellWatcher || !m_shellWatcher->BeginWaiting()) {
+            return false;
+        }
+        
+        // The desktop may have appeared before the hook was installed
+        if (m_desktopIconManager->Initialize()) {
+            m_shellWatcher->StopWaiting();
+        } else {
+            OutputDebugString(L"Desktop not available yet; waiting for the shell\n");
+        }
     }
     
     if (!m_hotkeyManager->Initialize(m_mainWindow)) {
         return false;
     }
     
+    // Icon bitmaps and key names shared between sessions; without them the
+    // tray renders its own icons
+    m_sharedAssets = std::make_unique<SharedAssetStore>();
+    if (!m_sharedAssets->Initialize()) {
+        OutputDebugString(L"Shared assets unavailable; rendering icons locally\n");
+        m_sharedAssets.reset();
+    }
+    m_systemTrayManager->SetSharedAssets(m_sharedAssets.get());
+    
     if (!m_systemTrayManager->Initialize(m_mainWindow, m_hInstance)) {
         return false;
     }
     
-    if (!m_settingsWindow->Create(m_mainWindow, m_hInstance)) {
-        return false;
+    // Metrics export is opt-in and runs entirely on its own thread
+    if (m_configManager->GetMetricsEnabled()) {
+        std::wstring metricsPath = m_configManager->GetMetricsFilePath();
+        if (metricsPath.empty()) {
+            metricsPath = GetModuleDirectory() + L"\\" + METRICS_FILE;
+        }
+        
+        m_metricsExporter = std::make_unique<MetricsExporter>();
+        if (!m_metricsExporter->Start(metricsPath, m_configManager->GetMetricsIntervalSeconds() * 1000)) {
+            m_metricsExporter.reset();
+        }
+    }
+    
+    // The control pipe is optional; the app is fully usable without it
+    m_ipcServer = std::make_unique<IpcServer>();
+    if (!m_ipcServer->Initialize(m_commandBus.get())) {
+        OutputDebugString(L"Control pipe unavailable; scripting commands are disabled\n");
+        m_ipcServer.reset();
+    }
+    
+    // Same for the shared state page read by status bars and widgets
+    m_sharedState = std::make_unique<SharedStatePublisher>();
+    if (!m_sharedState->Initialize()) {
+        OutputDebugString(L"Shared state page unavailable\n");
+        m_sharedState.reset();
     }
     
-    // Set up cross-component references
-    m_settingsWindow->SetHotkeyManager(m_hotkeyManager.get());
-    m_settingsWindow->SetConfigManager(m_configManager.get());
+    // The settings window is not created here; most sessions never open it,
+    // so it is built on first use by EnsureSettingsWindow()
     
     return true;
 }
@@ -171,6 +406,10 @@ bool Application::LoadConfiguration() {
         return false;
     }
     
+    TRACE_SPAN("app", "LoadConfiguration");
+    
+    Tracer::SetEnabled(m_configManager->GetTracingEnabled());
+    
     // Load hotkey configuration
     HotkeyConfig hotkeyConfig = m_configManager->GetHotkeyConfig();
     if (!m_hotkeyManager->RegisterHotkey(hotkeyConfig)) {
@@ -178,48 +417,177 @@ bool Application::LoadConfiguration() {
         // Continue anyway with default hotkey
     }
     
-    // Restore last icon state if configured
-    if (m_configManager->GetRememberState()) {
-        IconState lastState = m_configManager->GetLastIconState();
-        if (lastState == IconState::Hidden) {
-            m_desktopIconManager->HideDesktopIcons();
-        } else {
-            m_desktopIconManager->ShowDesktopIcons();
-        }
+    // Use the strategy calibrated on an earlier run, if any
+    m_desktopIconManager->SetSelectedStrategy(m_configManager->GetToggleStrategy().c_str());
+    
+    // Keep patterns are compiled once per load, not per toggle
+    {
+        ConfigSnapshotRef settings = m_configManager->GetSnapshot();
+        std::vector<std::wstring> rejected;
+        m_desktopIconManager->SetSelectiveMode(settings->selectiveMode, settings->keepPatterns, &rejected);
+        ReportRejectedEntries(L"Selective", rejected, m_rejectedKeepPatterns);
     }
     
-    // Update tray icon to reflect current state
-    UpdateTrayIconState();
+    UpdateLayoutRecording();
+    UpdateDesktopWatching();
+    UpdateContextRules();
+    UpdateIdleHiding();
+    UpdateSchedules();
+    UpdateDoubleClickToggle();
+    
+    // Without a desktop this happens in OnDesktopAvailable() instead
+    if (!m_shellWatcher || !m_shellWatcher->IsWaiting()) {
+        ApplyRememberedState();
+    }
+    
+    OnIconsChanged();
     
     return true;
 }
 
 bool Application::SetupCallbacks() {
-    if (!m_systemTrayManager) {
+    if (!m_systemTrayManager || !m_commandBus) {
         return false;
     }
     
-    // Set up system tray callbacks
-    m_systemTrayManager->SetToggleCallback([this]() { OnToggleDesktopIcons(); });
-    m_systemTrayManager->SetSettingsCallback([this]() { OnShowSettings(); });
-    m_systemTrayManager->SetExitCallback([this]() { OnExit(); });
+    // Tray clicks and menu commands are posted to the command bus
+    m_systemTrayManager->SetCommandBus(m_commandBus.get());
     
     return true;
 }
 
+void Application::DrainCommands() {
+    if (!m_commandBus) {
+        return;
+    }
+    
+    m_commandBus->BeginDrain();
+    
+    Command command;
+    while (m_commandBus && m_commandBus->TryTake(command)) {
+        DispatchCommand(command);
+    }
+}
+
+void Application::DispatchCommand(const Command& command) {
+    TRACE_SPAN("app", "DispatchCommand");
+    ALLOCATION_SCOPE(App);
+    NoteActivity();
+    Metrics::CommandsDispatched.Increment();
+    
+    switch (command.type) {
+        case CommandType::ToggleIcons:
+            if ((command.source == CommandSource::Hotkey || command.source == CommandSource::Tray) &&
+                m_configManager && m_configManager->GetPerMonitor()) {
+                OnToggleMonitorIcons();
+            } else if (command.source == CommandSource::Hotkey) {
+                OnHotkeyPressed();
+            } else {
+                OnToggleDesktopIcons();
+            }
+            break;
+            
+        case CommandType::ShowIcons:
+        case CommandType::HideIcons:
+            if (m_desktopIconManager) {
+                bool visible = (command.type == CommandType::ShowIcons);
+                if (m_desktopIconManager->IsDesktopIconsVisible() != visible) {
+                    OnToggleDesktopIcons();
+                }
+            }
+            break;
+            
+        case CommandType::ShowSettings:
+            OnShowSettings();
+            break;
+            
+        case CommandType::ReloadSettings:
+            OnSettingsChanged();
+            break;
+            
+        case CommandType::DumpTrace:
+            OnDumpTrace();
+            break;
+            
+        case CommandType::SaveLayout:
+            OnSaveLayout();
+            break;
+            
+        case CommandType::RestoreLayout:
+            OnRestoreLayout();
+            break;
+            
+        case CommandType::UndoLayout:
+            OnUndoLayout();
+            break;
+            
+        case CommandType::RestoreLayoutAt:
+            OnRestoreLayoutAt(command.argument);
+            break;
+            
+        case CommandType::ToggleMonitorIcons:
+            OnToggleMonitorIcons();
+            break;
+            
+        case CommandType::HideIconsFor:
+            OnHideIconsFor(command.argument);
+            break;
+            
+        case CommandType::DesktopDoubleClick:
+            OnDesktopDoubleClick({ static_cast<SHORT>(LOWORD(command.argument)),
+                                   static_cast<SHORT>(HIWORD(command.argument)) });
+            break;
+            
+        case CommandType::Exit:
+            OnExit();
+            break;
+            
+        case CommandType::None:
+            break;
+    }
+    
+    // Release the IPC response waiting on this batch
+    if (command.source == CommandSource::Ipc && command.cookie != 0 && m_ipcServer) {
+        IconState state = m_desktopIconManager ? m_desktopIconManager->GetCurrentState() : IconState::Unknown;
+        m_ipcServer->CompleteRequest(command.cookie, state);
+    }
+}
+
 void Application::OnToggleDesktopIcons() {
+    TRACE_SPAN("app", "OnToggleDesktopIcons");
+    
     if (!m_desktopIconManager) {
         return;
     }
     
+    // Everything below must stay off the heap once warmed up; accounting
+    // builds verify this on every toggle. Selective mode records the icons
+    // it hides, so it is exempt.
+    bool checkAllocations = m_toggleCount++ >= ALLOCATION_WARMUP_RUNS && !m_desktopIconManager->IsSelectiveMode();
+    NoAllocationCheck allocationCheck("OnToggleDesktopIcons", checkAllocations);
+    
     bool success = m_desktopIconManager->ToggleDesktopIcons();
     if (!success) {
-        ShowErrorMessage(L"Failed to toggle desktop icons");
+        allocationCheck.Disarm();
+        
+        // Expected until Explorer has created the desktop
+        if (!m_shellWatcher || !m_shellWatcher->IsWaiting()) {
+            ShowErrorMessage(L"Failed to toggle desktop icons");
+        }
         return;
     }
     
-    // Update tray icon state
-    UpdateTrayIconState();
+    // Calibration finished or a failover happened; remember the new choice
+    if (SaveToggleStrategy()) {
+        allocationCheck.Disarm();
+    }
+    
+    // Ending a timed hide changes the settings
+    if (NoteManualToggle()) {
+        allocationCheck.Disarm();
+    }
+    
+    OnIconsChanged();
     
     // Save current state
     if (m_configManager && m_configManager->GetRememberState()) {
@@ -227,18 +595,55 @@ void Application::OnToggleDesktopIcons() {
         m_configManager->SetLastIconState(currentState);
     }
     
+    // The per-desktop table has a fixed size, so this stays off the heap
+    RememberDesktopState();
+    
     // Show notification if enabled
     if (m_configManager && m_configManager->GetShowNotifications()) {
         IconState currentState = m_desktopIconManager->GetCurrentState();
-        std::wstring message = (currentState == IconState::Visible) ? 
-            L"Desktop icons are now visible" : L"Desktop icons are now hidden";
-        ShowNotification(message);
+        ShowNotification((currentState == IconState::Visible) ?
+            L"Desktop icons are now visible" : L"Desktop icons are now hidden");
+    }
+}
+
+bool Application::SaveToggleStrategy() {
+    if (!m_desktopIconManager || !m_desktopIconManager->TakeSelectionChanged()) {
+        return false;
+    }
+    
+    if (m_configManager) {
+        m_configManager->SetToggleStrategy(m_desktopIconManager->GetSelectedStrategyName());
     }
+    return true;
 }
 
 void Application::OnShowSettings() {
-    if (m_settingsWindow) {
-        m_settingsWindow->Show();
+    // Opening the window cancels any pending release
+    if (m_timerService) {
+        m_timerService->Cancel(TimerId::SettingsIdle);
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    TRACE_SPAN("app", "OnShowSettings");
+    
+    SettingsWindow* settingsWindow = EnsureSettingsWindow();
+    if (!settingsWindow) {
+        ShowErrorMessage(L"Failed to create settings window");
+        return;
+    }
+    
+    settingsWindow->Show();
+    
+    QueryPerformanceCounter(&end);
+    double elapsedMs = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+    if (elapsedMs > SETTINGS_OPEN_BUDGET_MS) {
+        wchar_t message[128];
+        swprintf_s(message, L"Settings window took %.1f ms to open (budget %.1f ms)\n",
+                   elapsedMs, SETTINGS_OPEN_BUDGET_MS);
+        OutputDebugString(message);
     }
 }
 
@@ -256,55 +661,1266 @@ void Application::OnSettingsChanged() {
     LoadConfiguration();
 }
 
-void Application::ShowNotification(const std::wstring& message) {
-    if (m_systemTrayManager) {
-        m_systemTrayManager->ShowBalloonTip(APP_NAME, message);
+void Application::OnDumpTrace() {
+    std::wstring path = GetModuleDirectory() + L"\\" + TRACE_FILE;
+    if (!Tracer::DumpChromeTrace(path.c_str())) {
+        OutputDebugString(L"Failed to write trace file\n");
     }
 }
 
-void Application::UpdateTrayIconState() {
-    if (!m_systemTrayManager || !m_desktopIconManager) {
+void Application::OnSaveLayout() {
+    TRACE_SPAN("app", "OnSaveLayout");
+    
+    IconLayout layout;
+    if (!m_desktopIconManager || !m_desktopIconManager->CaptureLayout(layout) ||
+        !layout.Save(GetModuleDirectory() + L"\\" + LAYOUT_FILE)) {
+        ShowNotification(L"Could not save the icon layout");
         return;
     }
     
-    IconState currentState = m_desktopIconManager->GetCurrentState();
-    m_systemTrayManager->UpdateTrayIcon(currentState);
+    if (m_configManager && m_configManager->GetShowNotifications()) {
+        ShowNotification(L"Icon layout saved");
+    }
 }
 
-bool Application::RegisterWindowClass() {
-    WNDCLASSEX wc = {};
-    wc.cbSize = sizeof(WNDCLASSEX);
-    wc.lpfnWndProc = WindowProc;
-    wc.hInstance = m_hInstance;
-    wc.lpszClassName = WINDOW_CLASS_NAME;
+void Application::OnRestoreLayout() {
+    TRACE_SPAN("app", "OnRestoreLayout");
     
-    return RegisterClassEx(&wc) != 0;
+    IconLayout layout;
+    if (!layout.Load(GetModuleDirectory() + L"\\" + LAYOUT_FILE)) {
+        ShowNotification(L"No saved icon layout");
+        return;
+    }
+    
+    // Fails while the desktop auto-arranges or selective mode is hiding icons
+    if (!m_desktopIconManager || !m_desktopIconManager->RestoreLayout(layout)) {
+        ShowNotification(L"Could not restore the icon layout");
+        return;
+    }
+    
+    if (m_configManager && m_configManager->GetShowNotifications()) {
+        ShowNotification(L"Icon layout restored");
+    }
 }
 
-LRESULT CALLBACK Application::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
-    Application* pThis = nullptr;
+void Application::OnSettingsClosed() {
+    // The hotkey may have been changed from the settings window
+    UpdateTrayIconState();
     
-    if (uMsg == WM_NCCREATE) {
-        CREATESTRUCT* pCreate = (CREATESTRUCT*)lParam;
-        pThis = (Application*)pCreate->lpCreateParams;
-        SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)pThis);
+    // Keep the window around for a while in case it is reopened
+    if (m_timerService) {
+        m_timerService->Schedule(TimerId::SettingsIdle, SETTINGS_IDLE_RELEASE_MS);
+    }
+    
+    NoteActivity();
+}
+
+void Application::OnSettingsIdleTimeout() {
+    if (m_settingsWindow && !m_settingsWindow->IsVisible()) {
+        ReleaseSettingsWindow();
+    }
+}
+
+void Application::OnTimerService() {
+    if (!m_timerService) {
+        return;
+    }
+    
+    uint32_t expired = m_timerService->TakeExpired();
+    
+    if (expired & TimerService::Bit(TimerId::SettingsIdle)) {
+        OnSettingsIdleTimeout();
+    }
+    
+    if (expired & TimerService::Bit(TimerId::FootprintTrim)) {
+        TrimFootprint();
+    }
+    
+    if (expired & TimerService::Bit(TimerId::DisplayLayoutRestore)) {
+        OnDisplayLayoutRestore();
+    }
+    
+    if ((expired & TimerService::Bit(TimerId::LayoutCapture)) && m_desktopIconManager) {
+        m_desktopIconManager->RecordLayout();
+    }
+    
+    if (expired & TimerService::Bit(TimerId::VirtualDesktopApply)) {
+        OnVirtualDesktopApply();
+    }
+    
+    if (expired & TimerService::Bit(TimerId::ContextRules)) {
+        OnContextRulesTimer();
+    }
+    
+    if (expired & TimerService::Bit(TimerId::IdleDeadline)) {
+        OnIdleDeadline();
+    }
+    
+    uint64_t cookie;
+    while (m_timerService && m_timerService->TakeExpiredCookie(cookie)) {
+        OnScheduleTimer(cookie);
+    }
+}
+
+void Application::OnShellReady() {
+    if (!m_shellWatcher) {
+        return;
+    }
+    
+    m_shellWatcher->ResetSignal();
+    if (!m_shellWatcher->IsWaiting() || !m_desktopIconManager) {
+        return;
+    }
+    
+    // DefView is created before its listview; keep waiting until both exist
+    if (!m_desktopIconManager->Initialize()) {
+        return;
+    }
+    
+    m_shellWatcher->StopWaiting();
+    OnDesktopAvailable();
+}
+
+void Application::OnTaskbarCreated() {
+    TRACE_SPAN("app", "OnTaskbarCreated");
+    Metrics::ShellStarts.Increment();
+    m_shellWatcher->MarkSignalTime();
+    
+    // A new Explorer has no tray icon from us
+    if (m_systemTrayManager) {
+        m_systemTrayManager->CreateTrayIcon();
+    }
+    
+    if (!m_desktopIconManager) {
+        return;
+    }
+    
+    // After a restart the desktop windows we knew are gone
+    if (m_desktopIconManager->Initialize()) {
+        m_shellWatcher->StopWaiting();
+        OnDesktopAvailable();
     } else {
-        pThis = (Application*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+        m_shellWatcher->BeginWaiting();
     }
+}
+
+void Application::OnDesktopAvailable() {
+    TRACE_SPAN("app", "OnDesktopAvailable");
     
-    if (pThis) {
-        return pThis->HandleMessage(hwnd, uMsg, wParam, lParam);
+    ApplyRememberedState();
+    OnIconsChanged();
+    
+    // The listview whose moves were tracked went away with the old Explorer
+    m_desktopIconManager->InvalidateIconIndex();
+    m_shellWatcher->StopTrackingIconMoves();
+    UpdateLayoutRecording();
+    
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    Metrics::ShellReadyLatency.Observe((now.QuadPart - m_shellWatcher->GetSignalTime()) * 1000000 / frequency.QuadPart);
+}
+
+void Application::ApplyRememberedState() {
+    if (!m_configManager || !m_desktopIconManager) {
+        return;
     }
     
-    return DefWindowProc(hwnd, uMsg, wParam, lParam);
+    // Icons an earlier run left off-screen go back before anything is
+    // hidden again
+    m_desktopIconManager->RecoverHiddenIcons(GetModuleDirectory() + L"\\" + HIDDEN_ICONS_FILE);
+    
+    // Restore last icon state if configured; the current virtual desktop's
+    // own state wins
+    bool remember = m_configManager->GetRememberState();
+    IconState lastState = remember ? m_configManager->GetLastIconState() : IconState::Unknown;
+    if (m_desktopWatcher && m_hasCurrentDesktop) {
+        m_configManager->GetDesktopIconState(m_currentDesktop, lastState);
+    }
+    
+    if (lastState == IconState::Hidden) {
+        m_desktopIconManager->HideDesktopIcons();
+    } else if (lastState == IconState::Visible || remember) {
+        m_desktopIconManager->ShowDesktopIcons();
+    }
+    
+    if (remember) {
+        ApplyRememberedMonitors();
+    }
+    
+    // A schedule or timed hide in effect wins over the remembered state
+    ApplySchedules();
+    
+    SaveToggleStrategy();
 }
 
-LRESULT Application::HandleMessage(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
-    switch (uMsg) {
-        case WM_HOTKEY:
-            if (wParam == ID_HOTKEY_TOGGLE) {
-                OnHotkeyPressed();
+void Application::UpdateDesktopWatching() {
+    if (!m_configManager || !m_timerService) {
+        return;
+    }
+    
+    if (!m_configManager->GetPerDesktop()) {
+        m_timerService->Cancel(TimerId::VirtualDesktopApply);
+        m_desktopWatcher.reset();
+        m_hasCurrentDesktop = false;
+        return;
+    }
+    
+    if (m_desktopWatcher) {
+        return;
+    }
+    
+    m_desktopWatcher = std::make_unique<VirtualDesktopWatcher>();
+    if (!m_desktopWatcher->Initialize(m_mainWindow)) {
+        OutputDebugString(L"Virtual desktops unavailable; icon state is not kept per desktop\n");
+        m_desktopWatcher.reset();
+        return;
+    }
+    
+    m_hasCurrentDesktop = m_desktopWatcher->GetCurrent(m_currentDesktop);
+    
+    // Desktops closed while the application was not running
+    std::vector<GUID> desktops;
+    if (m_desktopWatcher->GetDesktops(desktops)) {
+        m_configManager->PruneDesktopIconStates(desktops);
+    }
+}
+
+void Application::OnVirtualDesktopChanged() {
+    if (!m_desktopWatcher || !m_timerService) {
+        return;
+    }
+    
+    // The key also changes when desktops are created or renamed
+    GUID desktop;
+    if (!m_desktopWatcher->GetCurrent(desktop) ||
+        (m_hasCurrentDesktop && VirtualDesktopWatcher::IsSame(desktop, m_currentDesktop))) {
+        return;
+    }
+    
+    // Switched away before the previous switch was applied
+    if (m_timerService->IsScheduled(TimerId::VirtualDesktopApply)) {
+        Metrics::DesktopSwitchesCancelled.Increment();
+    }
+    
+    m_currentDesktop = desktop;
+    m_hasCurrentDesktop = true;
+    m_desktopSwitchTime = m_desktopWatcher->GetSignalTime();
+    m_timerService->Schedule(TimerId::VirtualDesktopApply, VIRTUAL_DESKTOP_APPLY_DELAY_MS, 20);
+}
+
+void Application::OnVirtualDesktopApply() {
+    TRACE_SPAN("app", "OnVirtualDesktopApply");
+    
+    if (!m_desktopWatcher || !m_desktopIconManager || !m_configManager || !m_hasCurrentDesktop) {
+        return;
+    }
+    
+    // Switched again and that notification is still queued; it brings its
+    // own apply
+    GUID desktop;
+    if (!m_desktopWatcher->GetCurrent(desktop) || !VirtualDesktopWatcher::IsSame(desktop, m_currentDesktop)) {
+        Metrics::DesktopSwitchesCancelled.Increment();
+        return;
+    }
+    
+    // A desktop seen for the first time keeps the icons as they are
+    IconState state;
+    if (!m_configManager->GetDesktopIconState(desktop, state)) {
+        RememberDesktopState();
+        return;
+    }
+    
+    bool visible = (state == IconState::Visible);
+    if (m_desktopIconManager->IsDesktopIconsVisible() != visible) {
+        bool applied = visible ? m_desktopIconManager->ShowDesktopIcons() : m_desktopIconManager->HideDesktopIcons();
+        if (!applied) {
+            return;
+        }
+        OnIconsChanged();
+    }
+    
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    m_lastDesktopSwitchUs = static_cast<uint64_t>((now.QuadPart - m_desktopSwitchTime) * 1000000 / frequency.QuadPart);
+    m_desktopSwitchesApplied++;
+    Metrics::DesktopSwitchesApplied.Increment();
+    Metrics::DesktopSwitchApplyDuration.Observe(m_lastDesktopSwitchUs);
+}
+
+void Application::RememberDesktopState() {
+    if (!m_desktopWatcher || !m_hasCurrentDesktop || !m_configManager || !m_desktopIconManager) {
+        return;
+    }
+    
+    IconState state = m_desktopIconManager->GetCurrentState();
+    if (state != IconState::Unknown) {
+        m_configManager->SetDesktopIconState(m_currentDesktop, state);
+    }
+}
+
+void Application::UpdateContextRules() {
+    if (!m_configManager || !m_timerService) {
+        return;
+    }
+    
+    // Compiled once per load; events only probe the table
+    {
+        ConfigSnapshotRef settings = m_configManager->GetSnapshot();
+        if (settings->contextRules) {
+            m_contextRules.Compile(settings->hideProcesses, settings->ignoreProcesses,
+                                   settings->hideWhenFullscreen, settings->hideWhenPresenting);
+        } else {
+            m_contextRules.Clear();
+        }
+    }
+    
+    if (m_contextRules.IsEmpty()) {
+        m_timerService->Cancel(TimerId::ContextRules);
+        m_contextWatcher.reset();
+        m_contextWantsHide = false;
+        m_contextOverride = false;
+        
+        if (m_contextHiding && m_desktopIconManager && m_desktopIconManager->ShowDesktopIcons()) {
+            Metrics::ContextShows.Increment();
+            OnIconsChanged();
+        }
+        m_contextHiding = false;
+        return;
+    }
+    
+    if (!m_contextWatcher) {
+        m_contextWatcher = std::make_unique<ContextWatcher>();
+        if (!m_contextWatcher->Initialize(m_mainWindow)) {
+            OutputDebugString(L"Foreground events unavailable; context rules are off\n");
+            m_contextWatcher.reset();
+            return;
+        }
+    }
+    
+    // The new rules may already apply to what is in the foreground
+    OnContextChanged();
+}
+
+bool Application::EvaluateContext() {
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    ContextRules::Context context;
+    m_contextWatcher->Capture(context);
+    bool hide = m_contextRules.ShouldHide(context);
+    
+    QueryPerformanceCounter(&end);
+    Metrics::ContextEvaluationDuration.Observe(static_cast<uint64_t>((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart));
+    
+    // Shown from outside the application meanwhile
+    ReleaseShownIcons();
+    
+    // The user's choice lasts until the context it was made in is over
+    if (!hide) {
+        m_contextOverride = false;
+    }
+    
+    m_contextWantsHide = hide;
+    return hide && !m_contextOverride;
+}
+
+void Application::OnContextChanged() {
+    TRACE_SPAN("app", "OnContextChanged");
+    
+    if (!m_contextWatcher || !m_desktopIconManager || !m_timerService) {
+        return;
+    }
+    
+    // Icons the user hid are not the rules' to show, nor to hide again
+    bool hide = EvaluateContext();
+    bool change = hide ? (!m_contextHiding && m_desktopIconManager->IsDesktopIconsVisible()) : m_contextHiding;
+    if (!change) {
+        m_timerService->Cancel(TimerId::ContextRules);
+        return;
+    }
+    
+    // Later events in the same direction keep the first deadline
+    if (!m_timerService->IsScheduled(TimerId::ContextRules)) {
+        m_timerService->Schedule(TimerId::ContextRules, hide ? CONTEXT_HIDE_DELAY_MS : CONTEXT_SHOW_DELAY_MS, 50);
+    }
+}
+
+void Application::OnContextRulesTimer() {
+    TRACE_SPAN("app", "OnContextRulesTimer");
+    
+    if (!m_contextWatcher || !m_desktopIconManager) {
+        return;
+    }
+    
+    // Events can be coalesced, so the context is checked once more
+    bool hide = EvaluateContext();
+    if (hide && !m_contextHiding && m_desktopIconManager->IsDesktopIconsVisible()) {
+        if (m_desktopIconManager->HideDesktopIcons()) {
+            m_contextHiding = true;
+            Metrics::ContextHides.Increment();
+            OnIconsChanged();
+        }
+    } else if (!hide && m_contextHiding) {
+        if (m_desktopIconManager->ShowDesktopIcons()) {
+            m_contextHiding = false;
+            Metrics::ContextShows.Increment();
+            OnIconsChanged();
+        }
+    }
+}
+
+bool Application::NoteManualToggle() {
+    // Shown by the user while idle-hidden (a remote command); the next input
+    // must not toggle them again
+    m_idleHiding = false;
+    
+    // A pending change would undo the user's toggle
+    if (m_contextHiding || m_contextWantsHide) {
+        m_contextHiding = false;
+        m_contextOverride = m_contextWantsHide;
+        if (m_timerService) {
+            m_timerService->Cancel(TimerId::ContextRules);
+        }
+    }
+    
+    if (!m_scheduleHiding && !m_scheduleWantsHide) {
+        return false;
+    }
+    
+    // Windows stay overridden until they end; a timed hide is over
+    m_scheduleHiding = false;
+    m_scheduleOverride = m_scheduleWantsHide;
+    if (m_timerService && m_timedHideTimer != 0) {
+        m_timerService->CancelCookie(m_timedHideTimer);
+        m_timedHideTimer = 0;
+    }
+    
+    if (!m_configManager || m_configManager->GetHiddenUntil() == 0) {
+        return false;
+    }
+    m_configManager->SetHiddenUntil(0);
+    return true;
+}
+
+void Application::UpdateIdleHiding() {
+    if (!m_configManager || !m_timerService) {
+        return;
+    }
+    
+    int minutes = m_configManager->GetIdleHideMinutes();
+    m_idleDetector.SetTimeout(static_cast<DWORD>(minutes) * 60 * 1000);
+    
+    if (!m_idleDetector.IsEnabled()) {
+        m_timerService->Cancel(TimerId::IdleDeadline);
+        m_idleDetector.StopInputWatch();
+        
+        if (m_idleHiding && m_desktopIconManager && m_desktopIconManager->ShowDesktopIcons()) {
+            Metrics::IdleResumes.Increment();
+            OnIconsChanged();
+        }
+        m_idleHiding = false;
+        return;
+    }
+    
+    // Already idle: the input watch brings it back
+    if (!m_idleDetector.IsIdle()) {
+        ArmIdleDeadline();
+    }
+}
+
+void Application::ArmIdleDeadline() {
+    LASTINPUTINFO input = { sizeof(input) };
+    if (!GetLastInputInfo(&input)) {
+        return;
+    }
+    
+    DWORD delay = m_idleDetector.Arm(GetTickCount(), input.dwTime);
+    if (delay == IdleDetector::NO_DEADLINE) {
+        m_timerService->Cancel(TimerId::IdleDeadline);
+    } else {
+        m_timerService->Schedule(TimerId::IdleDeadline, delay, IDLE_DEADLINE_TOLERANCE_MS);
+    }
+}
+
+void Application::OnIdleDeadline() {
+    TRACE_SPAN("app", "OnIdleDeadline");
+    
+    LASTINPUTINFO input = { sizeof(input) };
+    if (!m_timerService || !GetLastInputInfo(&input)) {
+        return;
+    }
+    
+    // Input since the deadline was armed only moves it; nothing watched
+    // that input as it happened
+    Metrics::IdleWakeups.Increment();
+    DWORD nextDelay = 0;
+    if (!m_idleDetector.OnDeadline(GetTickCount(), input.dwTime, nextDelay)) {
+        if (nextDelay != IdleDetector::NO_DEADLINE) {
+            m_timerService->Schedule(TimerId::IdleDeadline, nextDelay, IDLE_DEADLINE_TOLERANCE_MS);
+        }
+        return;
+    }
+    
+    // Without the input watch nothing would end the idle period
+    if (!m_idleDetector.StartInputWatch(m_mainWindow)) {
+        m_idleDetector.OnInput();
+        ArmIdleDeadline();
+        return;
+    }
+    
+    // Icons the user already hid stay theirs
+    if (m_desktopIconManager && m_desktopIconManager->IsDesktopIconsVisible() &&
+        m_desktopIconManager->HideDesktopIcons()) {
+        m_idleHiding = true;
+        Metrics::IdleHides.Increment();
+        OnIconsChanged();
+    }
+}
+
+void Application::OnIdleInput() {
+    // Raw input keeps arriving until the watch is removed; only the first
+    // input after going idle counts
+    if (!m_idleDetector.OnInput()) {
+        return;
+    }
+    
+    m_idleDetector.StopInputWatch();
+    
+    // Shown from outside the application meanwhile
+    ReleaseShownIcons();
+    if (m_idleHiding && m_desktopIconManager && m_desktopIconManager->ShowDesktopIcons()) {
+        Metrics::IdleResumes.Increment();
+        OnIconsChanged();
+    }
+    m_idleHiding = false;
+    
+    ArmIdleDeadline();
+    
+    // A context rule may want them hidden anyway
+    OnContextChanged();
+}
+
+void Application::UpdateSchedules() {
+    if (!m_configManager || !m_timerService) {
+        return;
+    }
+    
+    {
+        ConfigSnapshotRef settings = m_configManager->GetSnapshot();
+        std::vector<std::wstring> rejected;
+        m_schedule.SetWindows(settings->scheduleWindows, &rejected);
+        ReportRejectedEntries(L"Schedule", rejected, m_rejectedScheduleWindows);
+    }
+    
+    ArmScheduleTimers();
+}
+
+void Application::ArmScheduleTimers() {
+    if (!m_configManager || !m_timerService) {
+        return;
+    }
+    
+    for (TimerWheel::Handle handle : m_scheduleTimers) {
+        m_timerService->CancelCookie(handle);
+    }
+    m_scheduleTimers.clear();
+    m_timerService->CancelCookie(m_timedHideTimer);
+    m_timedHideTimer = 0;
+    
+    SYSTEMTIME local;
+    GetLocalTime(&local);
+    for (size_t i = 0; i < m_schedule.GetCount(); i++) {
+        m_scheduleTimers.push_back(m_timerService->ScheduleCookie(m_schedule.GetNextEdgeDelay(i, local),
+                                                                  COOKIE_SCHEDULE_WINDOW + i));
+    }
+    
+    // Rounded up so it does not fire just before the end and find it still on
+    ULONGLONG until = m_configManager->GetHiddenUntil();
+    ULONGLONG now = FileTimeNow();
+    if (until > now) {
+        m_timedHideTimer = m_timerService->ScheduleCookie((until - now) / FILETIME_TICKS_PER_MS + 1, COOKIE_TIMED_HIDE);
+    }
+}
+
+void Application::ApplySchedules() {
+    TRACE_SPAN("app", "ApplySchedules");
+    
+    if (!m_configManager || !m_desktopIconManager) {
+        return;
+    }
+    
+    ULONGLONG until = m_configManager->GetHiddenUntil();
+    if (until != 0 && until <= FileTimeNow()) {
+        m_configManager->SetHiddenUntil(0);
+        until = 0;
+    }
+    
+    SYSTEMTIME local;
+    GetLocalTime(&local);
+    bool hide = until != 0 || m_schedule.IsHideTime(local);
+    
+    // The user's choice lasts until the window it was made in is over
+    if (!hide) {
+        m_scheduleOverride = false;
+    }
+    m_scheduleWantsHide = hide;
+    hide = hide && !m_scheduleOverride;
+    
+    // Shown from outside the application meanwhile
+    ReleaseShownIcons();
+    bool visible = m_desktopIconManager->IsDesktopIconsVisible();
+    
+    if (hide && !m_scheduleHiding && visible) {
+        if (m_desktopIconManager->HideDesktopIcons()) {
+            m_scheduleHiding = true;
+            Metrics::ScheduleHides.Increment();
+            OnIconsChanged();
+        }
+    } else if (!hide && m_scheduleHiding) {
+        if (m_desktopIconManager->ShowDesktopIcons()) {
+            m_scheduleHiding = false;
+            Metrics::ScheduleShows.Increment();
+            OnIconsChanged();
+        }
+    }
+}
+
+void Application::OnHideIconsFor(uint32_t minutes) {
+    TRACE_SPAN("app", "OnHideIconsFor");
+    
+    if (!m_configManager || !m_desktopIconManager || !m_timerService || minutes == 0) {
+        return;
+    }
+    
+    // Stored as wall-clock time so it survives a restart or sleep
+    ULONGLONG delayMs = static_cast<ULONGLONG>(minutes) * 60 * 1000;
+    m_configManager->SetHiddenUntil(FileTimeNow() + delayMs * FILETIME_TICKS_PER_MS);
+    m_timerService->CancelCookie(m_timedHideTimer);
+    m_timedHideTimer = m_timerService->ScheduleCookie(delayMs, COOKIE_TIMED_HIDE);
+    
+    // Asked for explicitly, so icons already hidden come back afterwards too
+    m_scheduleOverride = false;
+    if (!m_desktopIconManager->IsDesktopIconsVisible()) {
+        m_scheduleHiding = true;
+    }
+    ApplySchedules();
+    
+    if (m_configManager->GetShowNotifications()) {
+        wchar_t message[64];
+        swprintf_s(message, L"Desktop icons are hidden for %u minutes", minutes);
+        ShowNotification(message);
+    }
+}
+
+void Application::OnScheduleTimer(uint64_t cookie) {
+    if (cookie == COOKIE_TIMED_HIDE) {
+        m_timedHideTimer = 0;
+    } else {
+        // The window's next edge, from the clock rather than by adding a day
+        size_t index = static_cast<size_t>(cookie - COOKIE_SCHEDULE_WINDOW);
+        if (index >= m_scheduleTimers.size()) {
+            return;
+        }
+        
+        SYSTEMTIME local;
+        GetLocalTime(&local);
+        m_scheduleTimers[index] = m_timerService->ScheduleCookie(m_schedule.GetNextEdgeDelay(index, local), cookie);
+    }
+    
+    ApplySchedules();
+}
+
+void Application::OnClockChanged() {
+    TRACE_SPAN("app", "OnClockChanged");
+    
+    if (!m_timerService) {
+        return;
+    }
+    
+    // Wall-clock deadlines moved against the tick count; tick deadlines
+    // that passed during sleep are due now rather than at the next wakeup
+    ArmScheduleTimers();
+    OnTimerService();
+    ApplySchedules();
+}
+
+void Application::UpdateDoubleClickToggle() {
+    if (!m_configManager || !m_commandBus) {
+        return;
+    }
+    
+    if (!m_configManager->GetSnapshot()->doubleClickToggle) {
+        m_clickWatcher.reset();
+        return;
+    }
+    
+    if (!m_clickWatcher) {
+        m_clickWatcher = std::make_unique<DesktopClickWatcher>();
+        if (!m_clickWatcher->Initialize(m_commandBus.get())) {
+            OutputDebugString(L"Mouse hook unavailable; double-click toggle is off\n");
+            m_clickWatcher.reset();
+        }
+    }
+}
+
+void Application::OnDesktopDoubleClick(POINT screenPoint) {
+    TRACE_SPAN("app", "OnDesktopDoubleClick");
+    
+    // Queued before the setting was turned off
+    if (!m_clickWatcher || !m_desktopIconManager || !m_configManager) {
+        return;
+    }
+    
+    if (!m_desktopIconManager->IsEmptyDesktopAt(screenPoint)) {
+        Metrics::DoubleClicksIgnored.Increment();
+        return;
+    }
+    
+    // The cursor may have moved on by the time this is dispatched, so a
+    // per-monitor toggle uses the monitor that was clicked
+    Metrics::DoubleClickToggles.Increment();
+    if (m_configManager->GetPerMonitor()) {
+        OnToggleMonitorIconsAt(screenPoint);
+    } else {
+        OnToggleDesktopIcons();
+    }
+}
+
+bool Application::MeasureDesktopSwitches(const std::wstring& path, uint32_t count, bool& allApplied) {
+    allApplied = false;
+    if (!m_initialized || !m_desktopIconManager || !m_configManager || !m_timerService) {
+        return false;
+    }
+    
+    // Two desktops with opposite states, and a third that is switched to
+    // and away from before its apply runs
+    static const GUID SIMULATED[3] = {
+        { 0x6d1f3a40, 0x5c2e, 0x4b7a, { 0x9e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } },
+        { 0x6d1f3a40, 0x5c2e, 0x4b7a, { 0x9e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 } },
+        { 0x6d1f3a40, 0x5c2e, 0x4b7a, { 0x9e, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03 } },
+    };
+    
+    // Simulated switches need only the window, not Explorer's registry key
+    if (!m_desktopWatcher) {
+        m_desktopWatcher = std::make_unique<VirtualDesktopWatcher>();
+        m_desktopWatcher->Initialize(m_mainWindow);
+    }
+    
+    bool wasVisible = m_desktopIconManager->IsDesktopIconsVisible();
+    m_configManager->SetDesktopIconState(SIMULATED[0], IconState::Hidden);
+    m_configManager->SetDesktopIconState(SIMULATED[1], IconState::Visible);
+    m_configManager->SetDesktopIconState(SIMULATED[2], IconState::Hidden);
+    
+    uint64_t cancelledBefore = Metrics::DesktopSwitchesCancelled.GetValue();
+    std::vector<uint64_t> latencies;
+    latencies.reserve(count);
+    int exitCode = 0;
+    bool running = true;
+    
+    for (uint32_t i = 0; i < count && running; i++) {
+        if (i % 4 == 3) {
+            m_desktopWatcher->Simulate(SIMULATED[2]);
+            running = PumpMessages(exitCode);
+        }
+        
+        uint32_t applied = m_desktopSwitchesApplied;
+        m_desktopWatcher->Simulate(SIMULATED[i % 2]);
+        
+        ULONGLONG deadline = GetTickCount64() + 2000;
+        while (running && m_desktopSwitchesApplied == applied) {
+            ULONGLONG now = GetTickCount64();
+            if (now >= deadline) {
+                break;
             }
+            MsgWaitForMultipleObjectsEx(0, nullptr, static_cast<DWORD>(deadline - now), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+            running = PumpMessages(exitCode);
+        }
+        
+        if (m_desktopSwitchesApplied != applied) {
+            latencies.push_back(m_lastDesktopSwitchUs);
+        }
+    }
+    
+    // Back to the real desktop and the state it had
+    m_timerService->Cancel(TimerId::VirtualDesktopApply);
+    m_desktopWatcher->StopSimulating();
+    m_hasCurrentDesktop = m_desktopWatcher->GetCurrent(m_currentDesktop);
+    for (const GUID& desktop : SIMULATED) {
+        m_configManager->RemoveDesktopIconState(desktop);
+    }
+    if (wasVisible) {
+        m_desktopIconManager->ShowDesktopIcons();
+    } else {
+        m_desktopIconManager->HideDesktopIcons();
+    }
+    
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](size_t p) -> uint64_t {
+        return latencies.empty() ? 0 : latencies[(latencies.size() - 1) * p / 100];
+    };
+    
+    char json[512];
+    int length = snprintf(json, sizeof(json),
+                          "{\n  \"version\": 1,\n  \"switches\": %lu,\n  \"applied\": %zu,\n  \"cancelled\": %llu,\n"
+                          "  \"settleDelayMs\": %lu,\n  \"p50Us\": %llu,\n  \"p95Us\": %llu,\n  \"maxUs\": %llu\n}\n",
+                          static_cast<unsigned long>(count), latencies.size(),
+                          static_cast<unsigned long long>(Metrics::DesktopSwitchesCancelled.GetValue() - cancelledBefore),
+                          static_cast<unsigned long>(VIRTUAL_DESKTOP_APPLY_DELAY_MS),
+                          static_cast<unsigned long long>(percentile(50)), static_cast<unsigned long long>(percentile(95)),
+                          static_cast<unsigned long long>(percentile(100)));
+    
+    HANDLE file = CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    DWORD written = 0;
+    bool success = WriteFile(file, json, static_cast<DWORD>(length), &written, nullptr) &&
+                   written == static_cast<DWORD>(length);
+    CloseHandle(file);
+    
+    allApplied = latencies.size() == count;
+    return success;
+}
+
+void Application::ApplyRememberedMonitors() {
+    std::vector<std::wstring> devices = m_configManager->GetHiddenMonitors();
+    if (devices.empty()) {
+        return;
+    }
+    
+    // Monitors no longer connected stay remembered for when they return
+    m_monitorToggleTick = GetTickCount();
+    for (const std::wstring& device : devices) {
+        m_desktopIconManager->SetMonitorVisibility(device.c_str(), false);
+    }
+}
+
+void Application::OnToggleMonitorIcons() {
+    POINT cursor = {};
+    if (!GetCursorPos(&cursor)) {
+        OnToggleDesktopIcons();
+        return;
+    }
+    
+    OnToggleMonitorIconsAt(cursor);
+}
+
+void Application::OnToggleMonitorIconsAt(POINT screenPoint) {
+    TRACE_SPAN("app", "OnToggleMonitorIcons");
+    
+    if (!m_desktopIconManager || !m_configManager) {
+        return;
+    }
+    
+    wchar_t device[IconSpatialIndex::DEVICE_NAME_LENGTH];
+    if (!IconSpatialIndex::GetDeviceAt(screenPoint, device) ||
+        (GetSystemMetrics(SM_CMONITORS) < 2 && !m_desktopIconManager->IsMonitorHidden(device))) {
+        OnToggleDesktopIcons();
+        return;
+    }
+    
+    bool show = m_desktopIconManager->IsMonitorHidden(device);
+    m_monitorToggleTick = GetTickCount();
+    if (!m_desktopIconManager->SetMonitorVisibility(device, show)) {
+        if (!m_shellWatcher || !m_shellWatcher->IsWaiting()) {
+            ShowErrorMessage(L"Failed to toggle the icons on this monitor");
+        }
+        return;
+    }
+    
+    // Forgotten again if the state is not to be remembered
+    if (m_configManager->GetRememberState()) {
+        m_configManager->SetHiddenMonitors(m_desktopIconManager->GetHiddenMonitors());
+        m_configManager->SaveSettings();
+    }
+    
+    if (m_configManager->GetShowNotifications()) {
+        ShowNotification(show ? L"Icons on this monitor are now visible" : L"Icons on this monitor are now hidden");
+    }
+}
+
+void Application::UpdateLayoutRecording() {
+    if (!m_configManager || !m_desktopIconManager || !m_timerService) {
+        return;
+    }
+    
+    ConfigSnapshotRef settings = m_configManager->GetSnapshot();
+    
+    if (!settings->layoutPerDisplay) {
+        m_timerService->Cancel(TimerId::DisplayLayoutRestore);
+        m_desktopIconManager->CloseLayoutStore();
+    } else if (!m_desktopIconManager->IsLayoutStoreOpen() &&
+               !m_desktopIconManager->OpenLayoutStore(GetModuleDirectory() + L"\\" + LAYOUT_STORE_FILE)) {
+        OutputDebugString(L"Layout store unavailable; layouts are not kept per display\n");
+    }
+    
+    if (!settings->layoutHistory) {
+        m_desktopIconManager->CloseLayoutHistory();
+    } else {
+        LayoutHistory::Retention retention;
+        retention.maxAgeDays = static_cast<uint32_t>(settings->historyRetentionDays);
+        retention.maxBytes = static_cast<uint64_t>(settings->historyMaxSizeKB) * 1024;
+        if (!m_desktopIconManager->OpenLayoutHistory(GetModuleDirectory() + L"\\" + LAYOUT_HISTORY_FILE, retention)) {
+            OutputDebugString(L"Layout history unavailable\n");
+        }
+    }
+    
+    bool recording = m_desktopIconManager->IsLayoutStoreOpen() || m_desktopIconManager->IsLayoutHistoryOpen();
+    if (!recording) {
+        m_timerService->Cancel(TimerId::LayoutCapture);
+    }
+    
+    // Per-monitor and double-click toggles also need moves, to know when
+    // their icon indexes are stale
+    if (!recording && !settings->perMonitor && !settings->doubleClickToggle) {
+        if (m_shellWatcher) {
+            m_shellWatcher->StopTrackingIconMoves();
+        }
+        return;
+    }
+    
+    // Without a desktop this is called again from OnDesktopAvailable()
+    HWND listView = m_desktopIconManager->GetListViewWindow();
+    if (!m_shellWatcher || !listView || m_shellWatcher->IsWaiting() ||
+        m_shellWatcher->IsTrackingIconMoves()) {
+        return;
+    }
+    
+    // Record the icons as found, in case the setup changes before they move
+    if (m_shellWatcher->TrackIconMoves(listView) && recording) {
+        m_timerService->Schedule(TimerId::LayoutCapture, LAYOUT_CAPTURE_DELAY_MS);
+    }
+}
+
+void Application::FlushLayoutCapture() {
+    if (m_timerService && m_desktopIconManager && m_timerService->IsScheduled(TimerId::LayoutCapture)) {
+        m_timerService->Cancel(TimerId::LayoutCapture);
+        m_desktopIconManager->RecordLayout();
+    }
+}
+
+void Application::OnUndoLayout() {
+    TRACE_SPAN("app", "OnUndoLayout");
+    
+    if (!m_desktopIconManager || !m_desktopIconManager->IsLayoutHistoryOpen()) {
+        ShowNotification(L"Icon layout history is turned off");
+        return;
+    }
+    
+    // Moves not recorded yet are the change to undo
+    FlushLayoutCapture();
+    
+    if (!m_desktopIconManager->UndoLayoutChange()) {
+        ShowNotification(L"No earlier icon layout to go back to");
+        return;
+    }
+    
+    if (m_configManager && m_configManager->GetShowNotifications()) {
+        ShowNotification(L"Icon layout change undone");
+    }
+}
+
+void Application::OnRestoreLayoutAt(uint32_t minutesAgo) {
+    TRACE_SPAN("app", "OnRestoreLayoutAt");
+    
+    if (!m_desktopIconManager || !m_desktopIconManager->IsLayoutHistoryOpen()) {
+        ShowNotification(L"Icon layout history is turned off");
+        return;
+    }
+    
+    FlushLayoutCapture();
+    
+    constexpr uint64_t FILETIME_PER_MINUTE = 60ull * 10000000;
+    uint64_t now = LayoutHistory::Now();
+    uint64_t back = static_cast<uint64_t>(minutesAgo) * FILETIME_PER_MINUTE;
+    if (back >= now || !m_desktopIconManager->RestoreLayoutAt(now - back)) {
+        ShowNotification(L"No icon layout recorded that long ago");
+        return;
+    }
+    
+    if (m_configManager && m_configManager->GetShowNotifications()) {
+        ShowNotification(L"Earlier icon layout restored");
+    }
+}
+
+void Application::OnDisplayChange() {
+    if (m_desktopIconManager) {
+        m_desktopIconManager->InvalidateIconIndex();
+    }
+    
+    if (!m_timerService || !m_desktopIconManager || !m_desktopIconManager->IsLayoutStoreOpen()) {
+        return;
+    }
+    
+    // A capture now would record Explorer's rearrangement under the new
+    // setup; repeated changes while docking push the restore back
+    m_timerService->Cancel(TimerId::LayoutCapture);
+    m_timerService->Schedule(TimerId::DisplayLayoutRestore, DISPLAY_LAYOUT_RESTORE_DELAY_MS, 250);
+}
+
+void Application::OnIconsMoved() {
+    if (!m_shellWatcher || !m_timerService || !m_desktopIconManager) {
+        return;
+    }
+    
+    m_shellWatcher->ResetIconMoveSignal();
+    
+    // A monitor toggle keeps the index up to date with its own moves
+    if (GetTickCount() - m_monitorToggleTick >= MONITOR_TOGGLE_MOVE_GRACE_MS) {
+        m_desktopIconManager->InvalidateIconIndex();
+    }
+    
+    // Moves after a display change are Explorer's, undone by the restore
+    if ((m_desktopIconManager->IsLayoutStoreOpen() || m_desktopIconManager->IsLayoutHistoryOpen()) &&
+        !m_timerService->IsScheduled(TimerId::DisplayLayoutRestore)) {
+        m_timerService->Schedule(TimerId::LayoutCapture, LAYOUT_CAPTURE_DELAY_MS);
+    }
+}
+
+void Application::OnDisplayLayoutRestore() {
+    TRACE_SPAN("app", "OnDisplayLayoutRestore");
+    
+    if (!m_desktopIconManager) {
+        return;
+    }
+    
+    // A setup seen for the first time starts with the icons as they are
+    if (!m_desktopIconManager->RestoreDisplayLayout()) {
+        m_desktopIconManager->RecordLayout();
+    }
+}
+
+void Application::NoteActivity() {
+    if (!m_timerService || !m_configManager) {
+        return;
+    }
+    
+    ConfigSnapshotRef settings = m_configManager->GetSnapshot();
+    if (settings->footprintMode) {
+        m_timerService->Schedule(TimerId::FootprintTrim, settings->trimIdleSeconds * 1000);
+    } else {
+        m_timerService->Cancel(TimerId::FootprintTrim);
+    }
+}
+
+void Application::TrimFootprint() {
+    TRACE_SPAN("app", "TrimFootprint");
+    
+    // Everything released here is rebuilt on next use
+    if (m_settingsWindow && !m_settingsWindow->IsVisible()) {
+        ReleaseSettingsWindow();
+    }
+    
+    if (m_systemTrayManager) {
+        m_systemTrayManager->ReleaseCachedResources();
+    }
+    
+    MemoryFootprint::TrimWorkingSet();
+}
+
+void Application::CollectFootprint(MemoryFootprint& footprint) {
+    footprint.Add("tracer", Tracer::GetMemoryUsage());
+    
+    if (m_desktopIconManager) {
+        footprint.Add("desktop", m_desktopIconManager->GetMemoryUsage());
+    }
+    
+    if (m_ipcServer) {
+        footprint.Add("ipc", m_ipcServer->GetMemoryUsage());
+    }
+    
+    if (m_systemTrayManager) {
+        footprint.Add("tray", m_systemTrayManager->GetMemoryUsage());
+    }
+    
+    if (m_configManager) {
+        footprint.Add("config", m_configManager->GetMemoryUsage());
+    }
+    
+    if (!m_contextRules.IsEmpty()) {
+        footprint.Add("contextRules", m_contextRules.GetMemoryUsage());
+    }
+    
+    if (m_timerService) {
+        footprint.Add("timers", m_timerService->GetMemoryUsage());
+    }
+    
+    if (m_commandBus) {
+        footprint.Add("commandBus", sizeof(CommandBus));
+    }
+    
+    if (m_settingsWindow) {
+        footprint.Add("settingsWindow", sizeof(SettingsWindow));
+    }
+    
+    if (m_sharedState) {
+        // The mapping is committed a page at a time
+        footprint.Add("sharedState", 4096);
+    }
+    
+    if (m_sharedAssets) {
+        // Zero when the section is shared by every session on the machine
+        footprint.Add("sharedAssets", m_sharedAssets->GetPrivateBytes());
+    }
+}
+
+bool Application::WriteFootprintReport(const std::wstring& path, bool& withinBudget) {
+    MemoryFootprint footprint;
+    CollectFootprint(footprint);
+    
+    if (!footprint.CaptureProcess()) {
+        return false;
+    }
+    
+    size_t budgetBytes = 0;
+    if (m_configManager) {
+        budgetBytes = static_cast<size_t>(m_configManager->GetWorkingSetBudgetKB()) * 1024;
+    }
+    
+    withinBudget = budgetBytes == 0 || footprint.GetWorkingSetBytes() <= budgetBytes;
+    return footprint.WriteReport(path, budgetBytes);
+}
+
+SettingsWindow* Application::EnsureSettingsWindow() {
+    if (m_settingsWindow) {
+        return m_settingsWindow.get();
+    }
+    
+    auto settingsWindow = std::make_unique<SettingsWindow>();
+    settingsWindow->SetHotkeyManager(m_hotkeyManager.get());
+    settingsWindow->SetConfigManager(m_configManager.get());
+    
+    if (!settingsWindow->Create(m_mainWindow, m_hInstance)) {
+        return nullptr;
+    }
+    
+    m_settingsWindow = std::move(settingsWindow);
+    return m_settingsWindow.get();
+}
+
+void Application::ReleaseSettingsWindow() {
+    if (m_timerService) {
+        m_timerService->Cancel(TimerId::SettingsIdle);
+    }
+    m_settingsWindow.reset();
+}
+
+void Application::ReportRejectedEntries(const wchar_t* section, const std::vector<std::wstring>& rejected,
+                                        std::wstring& reported) {
+    std::wstring entries;
+    for (const std::wstring& entry : rejected) {
+        entries += entries.empty() ? L"\"" : L", \"";
+        entries += entry;
+        entries += L"\"";
+    }
+    
+    if (!entries.empty()) {
+        OutputDebugString((L"Invalid entries in [" + std::wstring(section) + L"] ignored: " + entries + L"\n").c_str());
+    }
+    
+    // A reload with the same mistakes is not worth another notification
+    if (entries == reported) {
+        return;
+    }
+    reported = entries;
+    
+    if (!entries.empty()) {
+        ShowNotification((L"Some entries in the [" + std::wstring(section) + L"] section are invalid and were ignored").c_str());
+    }
+}
+
+void Application::ShowNotification(const wchar_t* message) {
+    if (m_systemTrayManager) {
+        m_systemTrayManager->ShowBalloonTip(APP_NAME, message);
+    }
+}
+
+void Application::OnIconsChanged() {
+    ReleaseShownIcons();
+    UpdateTrayIconState();
+}
+
+void Application::ReleaseShownIcons() {
+    if (!m_desktopIconManager || !m_desktopIconManager->IsDesktopIconsVisible()) {
+        return;
+    }
+    
+    // However they came back (a virtual desktop switch, a schedule, the
+    // user), a later hide by something else must not be undone when the
+    // context ends, on the next input or on exit
+    m_contextHiding = false;
+    m_idleHiding = false;
+    m_scheduleHiding = false;
+}
+
+void Application::UpdateTrayIconState() {
+    if (!m_desktopIconManager) {
+        return;
+    }
+    
+    IconState currentState = m_desktopIconManager->GetCurrentState();
+    if (!m_systemTrayManager) {
+        return;
+    }
+    m_systemTrayManager->UpdateTrayIcon(currentState);
+    
+    if (m_ipcServer) {
+        m_ipcServer->PublishState(currentState);
+    }
+    
+    if (m_sharedState && m_hotkeyManager) {
+        m_sharedState->Publish(currentState, m_hotkeyManager->GetCurrentConfig());
+    }
+}
+
+bool Application::RegisterWindowClass() {
+    WNDCLASSEX wc = {};
+    wc.cbSize = sizeof(WNDCLASSEX);
+    wc.lpfnWndProc = WindowProc;
+    wc.hInstance = m_hInstance;
+    wc.lpszClassName = WINDOW_CLASS_NAME;
+    
+    return RegisterClassEx(&wc) != 0;
+}
+
+LRESULT CALLBACK Application::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    Application* pThis = nullptr;
+    
+    if (uMsg == WM_NCCREATE) {
+        CREATESTRUCT* pCreate = (CREATESTRUCT*)lParam;
+        pThis = (Application*)pCreate->lpCreateParams;
+        SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)pThis);
+    } else {
+        pThis = (Application*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+    }
+    
+    if (pThis) {
+        return pThis->HandleMessage(hwnd, uMsg, wParam, lParam);
+    }
+    
+    return DefWindowProc(hwnd, uMsg, wParam, lParam);
+}
+
+LRESULT Application::HandleMessage(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    // Registered message, so it cannot be a case label
+    if (m_shellWatcher && uMsg == m_shellWatcher->GetTaskbarCreatedMessage()) {
+        OnTaskbarCreated();
+        return 0;
+    }
+    
+    switch (uMsg) {
+        case WM_HOTKEY:
+            if (wParam == ID_HOTKEY_TOGGLE && m_commandBus) {
+                m_commandBus->Post(CommandType::ToggleIcons, CommandSource::Hotkey);
+            }
+            return 0;
+            
+        case WM_COMMAND_BUS:
+            DrainCommands();
             return 0;
             
         case WM_TRAYICON:
@@ -320,7 +1936,69 @@ LRESULT Application::HandleMessage(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM l
             return 0;
             
         case WM_SETTINGS_CHANGED:
-            OnSettingsChanged();
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::ReloadSettings, CommandSource::Internal);
+            }
+            return 0;
+            
+        case WM_SETTINGS_CLOSED:
+            OnSettingsClosed();
+            return 0;
+            
+        case WM_SHELL_READY:
+            OnShellReady();
+            return 0;
+            
+        case WM_ICONS_MOVED:
+            OnIconsMoved();
+            return 0;
+            
+        case WM_VIRTUAL_DESKTOP_CHANGED:
+            OnVirtualDesktopChanged();
+            return 0;
+            
+        case WM_CONTEXT_CHANGED:
+            if (m_contextWatcher) {
+                m_contextWatcher->ResetSignal();
+            }
+            OnContextChanged();
+            return 0;
+            
+        case WM_APPBAR_NOTIFY:
+            if (m_contextWatcher && m_contextWatcher->OnAppBarNotify(wParam, lParam)) {
+                OnContextChanged();
+            }
+            return 0;
+            
+        case WM_INPUT:
+            OnIdleInput();
+            break;
+            
+        case WM_DISPLAYCHANGE:
+            OnDisplayChange();
+            break;
+            
+        case WM_POWERBROADCAST:
+            if (wParam == PBT_APMRESUMEAUTOMATIC) {
+                OnClockChanged();
+            }
+            break;
+            
+        case WM_TIMECHANGE:
+            OnClockChanged();
+            break;
+            
+        case WM_TIMER:
+            if (wParam == ID_TIMER_SERVICE) {
+                OnTimerService();
+                return 0;
+            }
+            break;
+            
+        case WM_ENDSESSION:
+            if (wParam) {
+                OnEndSession();
+            }
             return 0;
             
         case WM_DESTROY:
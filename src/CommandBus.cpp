@@ -0,0 +1,80 @@
+#include "CommandBus.h"
+#include "Metrics.h"
+
+CommandBus::CommandBus()
+    : m_targetWindow(nullptr)
+    , m_wakePending(false)
+    , m_droppedCount(0) {
+}
+
+CommandBus::~CommandBus() {
+    Cleanup();
+}
+
+bool CommandBus::Initialize(HWND targetWindow) {
+    if (!targetWindow || !IsWindow(targetWindow)) {
+        return false;
+    }
+    
+    m_targetWindow.store(targetWindow, std::memory_order_release);
+    return true;
+}
+
+void CommandBus::Cleanup() {
+    m_targetWindow.store(nullptr, std::memory_order_release);
+}
+
+bool CommandBus::Post(const Command& command) {
+    if (!m_queue.TryPush(command)) {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        Metrics::CommandsDropped.Increment();
+        return false;
+    }
+    
+    Wake();
+    return true;
+}
+
+bool CommandBus::PostAll(const Command* commands, size_t count) {
+    if (!m_queue.TryPushAll(commands, count)) {
+        m_droppedCount.fetch_add(count, std::memory_order_relaxed);
+        Metrics::CommandsDropped.Increment(count);
+        return false;
+    }
+    
+    Wake();
+    return true;
+}
+
+void CommandBus::Wake() {
+    // Only the producer that flips the flag posts the wake-up; the rest ride
+    // along on the same drain
+    if (!m_wakePending.exchange(true, std::memory_order_acq_rel)) {
+        HWND target = m_targetWindow.load(std::memory_order_acquire);
+        if (!target || !PostMessage(target, WM_COMMAND_BUS, 0, 0)) {
+            m_wakePending.store(false, std::memory_order_release);
+        }
+    }
+}
+
+bool CommandBus::Post(CommandType type, CommandSource source, uint32_t argument) {
+    Command command;
+    command.type = type;
+    command.source = source;
+    command.argument = argument;
+    return Post(command);
+}
+
+void CommandBus::BeginDrain() {
+    // Clear before popping so a command pushed during the drain either gets
+    // popped here or triggers a fresh wake-up
+    m_wakePending.store(false, std::memory_order_seq_cst);
+}
+
+bool CommandBus::TryTake(Command& command) {
+    return m_queue.TryPop(command);
+}
+
+uint64_t CommandBus::GetDroppedCount() const {
+    return m_droppedCount.load(std::memory_order_relaxed);
+}
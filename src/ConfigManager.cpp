@@ -1,26 +1,119 @@
 #include "ConfigManager.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
 #include <shlobj.h>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr const wchar_t* DESKTOP_STATES_SECTION = L"VirtualDesktopStates";
+    constexpr const wchar_t* RULES_SECTION = L"Rules";
+    
+    // Key is the prefix followed by a number only (Hide12, not HideWhenFullscreen)
+    bool IsNumberedKey(const wchar_t* line, const wchar_t* separator, const wchar_t* prefix) {
+        size_t prefixLength = wcslen(prefix);
+        if (static_cast<size_t>(separator - line) <= prefixLength || _wcsnicmp(line, prefix, prefixLength) != 0) {
+            return false;
+        }
+        
+        for (const wchar_t* c = line + prefixLength; c < separator; c++) {
+            if (*c < L'0' || *c > L'9') {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}
+    constexpr size_t GUID_TEXT_LENGTH = 38;
+    
+    bool GuidLess(const DesktopIconState& entry, const GUID& desktop) {
+        return memcmp(&entry.desktop, &desktop, sizeof(GUID)) < 0;
+    }
+    
+    void FormatGuid(const GUID& guid, wchar_t (&text)[GUID_TEXT_LENGTH + 1]) {
+        swprintf_s(text, L"{%08lX-%04hX-%04hX-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+                   guid.Data1, guid.Data2, guid.Data3,
+                   guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+                   guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+    }
+    
+    bool ParseGuid(const wchar_t* text, size_t length, GUID& guid) {
+        if (length != GUID_TEXT_LENGTH || text[0] != L'{' || text[GUID_TEXT_LENGTH - 1] != L'}') {
+            return false;
+        }
+        
+        unsigned long data1 = 0;
+        unsigned int data2 = 0, data3 = 0, data4[8] = {};
+        int fields = swscanf_s(text, L"{%8lx-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x}",
+                               &data1, &data2, &data3, &data4[0], &data4[1], &data4[2], &data4[3],
+                               &data4[4], &data4[5], &data4[6], &data4[7]);
+        if (fields != 11) {
+            return false;
+        }
+        
+        guid.Data1 = data1;
+        guid.Data2 = static_cast<unsigned short>(data2);
+        guid.Data3 = static_cast<unsigned short>(data3);
+        for (size_t i = 0; i < 8; i++) {
+            guid.Data4[i] = static_cast<unsigned char>(data4[i]);
+        }
+        return true;
+    }
+}
+
+ConfigSnapshotRef::ConfigSnapshotRef(const ConfigManager* owner, const ConfigSnapshot* snapshot,
+                                     std::atomic<const ConfigSnapshot*>* slot)
+    : m_owner(owner)
+    , m_snapshot(snapshot)
+    , m_slot(slot) {
+}
+
+ConfigSnapshotRef::ConfigSnapshotRef(ConfigSnapshotRef&& other) noexcept
+    : m_owner(other.m_owner)
+    , m_snapshot(other.m_snapshot)
+    , m_slot(other.m_slot) {
+    
+    other.m_owner = nullptr;
+}
+
+ConfigSnapshotRef::~ConfigSnapshotRef() {
+    if (m_owner) {
+        m_owner->ReleaseReader(m_snapshot, m_slot);
+    }
+}
 
 ConfigManager::ConfigManager()
-    : m_startWithWindows(false)
-    , m_showNotifications(true)
-    , m_rememberState(true)
+    : m_current(nullptr)
+    , m_sharedReaders(0)
+    , m_retiredCount(0)
     , m_lastIconState(IconState::Visible)
+    , m_desktopStates{}
+    , m_desktopStateCount(0)
     , m_initialized(false) {
     
-    // Set default hotkey configuration
-    m_hotkeyConfig.ctrl = true;
-    m_hotkeyConfig.alt = true;
-    m_hotkeyConfig.shift = false;
-    m_hotkeyConfig.win = false;
-    m_hotkeyConfig.vkCode = 'D';
+    // Defaults until the file is loaded (Ctrl+Alt+D)
+    ConfigSnapshot* defaults = new ConfigSnapshot();
+    defaults->hotkeyConfig.ctrl = true;
+    defaults->hotkeyConfig.alt = true;
+    defaults->hotkeyConfig.shift = false;
+    defaults->hotkeyConfig.win = false;
+    defaults->hotkeyConfig.vkCode = 'D';
+    m_current.store(defaults);
 }
 
 ConfigManager::~ConfigManager() {
     if (m_initialized) {
         SaveSettings();
     }
+    
+    // No readers can be left once the owner is being destroyed
+    delete m_current.load();
+    for (const ConfigSnapshot* snapshot : m_retired) {
+        delete snapshot;
+    }
 }
 
 bool ConfigManager::Initialize() {
@@ -37,91 +130,644 @@ bool ConfigManager::Initialize() {
 }
 
 bool ConfigManager::LoadSettings() {
+    TRACE_SPAN("config", "LoadSettings");
+    ALLOCATION_SCOPE(Config);
+    
     if (m_configFilePath.empty()) {
         return false;
     }
     
+    ConfigSnapshot* snapshot = new ConfigSnapshot();
+    
     // Load hotkey configuration
-    m_hotkeyConfig.ctrl = ReadIniInt(L"Hotkey", L"Ctrl", 1) != 0;
-    m_hotkeyConfig.alt = ReadIniInt(L"Hotkey", L"Alt", 1) != 0;
-    m_hotkeyConfig.shift = ReadIniInt(L"Hotkey", L"Shift", 0) != 0;
-    m_hotkeyConfig.win = ReadIniInt(L"Hotkey", L"Win", 0) != 0;
-    m_hotkeyConfig.vkCode = ReadIniInt(L"Hotkey", L"KeyCode", 'D');
+    snapshot->hotkeyConfig.ctrl = ReadIniInt(L"Hotkey", L"Ctrl", 1) != 0;
+    snapshot->hotkeyConfig.alt = ReadIniInt(L"Hotkey", L"Alt", 1) != 0;
+    snapshot->hotkeyConfig.shift = ReadIniInt(L"Hotkey", L"Shift", 0) != 0;
+    snapshot->hotkeyConfig.win = ReadIniInt(L"Hotkey", L"Win", 0) != 0;
+    snapshot->hotkeyConfig.vkCode = ReadIniInt(L"Hotkey", L"KeyCode", 'D');
     
     // Load application settings
-    m_startWithWindows = ReadIniInt(L"Application", L"StartWithWindows", 0) != 0;
-    m_showNotifications = ReadIniInt(L"Application", L"ShowNotifications", 1) != 0;
-    m_rememberState = ReadIniInt(L"Application", L"RememberState", 1) != 0;
+    snapshot->startWithWindows = ReadIniInt(L"Application", L"StartWithWindows", 0) != 0;
+    snapshot->showNotifications = ReadIniInt(L"Application", L"ShowNotifications", 1) != 0;
+    snapshot->rememberState = ReadIniInt(L"Application", L"RememberState", 1) != 0;
     
     int lastState = ReadIniInt(L"Application", L"LastIconState", 1);
-    m_lastIconState = (lastState == 1) ? IconState::Visible : IconState::Hidden;
+    m_lastIconState.store((lastState == 1) ? IconState::Visible : IconState::Hidden);
+    
+    // Load diagnostics settings
+    snapshot->tracingEnabled = ReadIniInt(L"Diagnostics", L"Tracing", 1) != 0;
+    snapshot->metricsEnabled = ReadIniInt(L"Diagnostics", L"Metrics", 0) != 0;
+    snapshot->metricsFilePath = ReadIniString(L"Diagnostics", L"MetricsFile", L"");
+    snapshot->metricsIntervalSeconds = ReadIniInt(L"Diagnostics", L"MetricsIntervalSeconds", 15);
+    if (snapshot->metricsIntervalSeconds < 1) {
+        snapshot->metricsIntervalSeconds = 1;
+    }
+    
+    // Load memory settings
+    snapshot->footprintMode = ReadIniInt(L"Memory", L"FootprintMode", 0) != 0;
+    snapshot->trimIdleSeconds = ReadIniInt(L"Memory", L"TrimIdleSeconds", 300);
+    if (snapshot->trimIdleSeconds < 1) {
+        snapshot->trimIdleSeconds = 1;
+    }
+    
+    // Load desktop settings
+    snapshot->toggleStrategy = ReadIniString(L"Desktop", L"ToggleStrategy", L"");
+    snapshot->doubleClickToggle = ReadIniInt(L"Desktop", L"DoubleClickToggle", 0) != 0;
+    
+    // Load selective mode; keep patterns are numbered from 1 without gaps
+    snapshot->selectiveMode = ReadIniInt(L"Selective", L"Enabled", 0) != 0;
+    for (int i = 1; i <= MAX_SELECTIVE_RULES; i++) {
+        wchar_t key[16];
+        swprintf_s(key, L"Keep%d", i);
+        std::wstring pattern = ReadIniString(L"Selective", key, L"");
+        if (pattern.empty()) {
+            break;
+        }
+        snapshot->keepPatterns.push_back(pattern);
+    }
+    
+    // Load layout settings
+    snapshot->layoutPerDisplay = ReadIniInt(L"Layout", L"PerDisplay", 1) != 0;
+    snapshot->layoutHistory = ReadIniInt(L"Layout", L"History", 1) != 0;
+    snapshot->historyRetentionDays = ReadIniInt(L"Layout", L"HistoryRetentionDays", 30);
+    snapshot->historyMaxSizeKB = ReadIniInt(L"Layout", L"HistoryMaxSizeKB", 4096);
+    if (snapshot->historyRetentionDays < 0) {
+        snapshot->historyRetentionDays = 0;
+    }
+    if (snapshot->historyMaxSizeKB < 0) {
+        snapshot->historyMaxSizeKB = 0;
+    }
+    
+    // Load per-monitor settings; hidden monitors are numbered like keep patterns
+    snapshot->perMonitor = ReadIniInt(L"Monitors", L"PerMonitor", 0) != 0;
+    for (int i = 1; i <= MAX_HIDDEN_MONITORS; i++) {
+        wchar_t key[16];
+        swprintf_s(key, L"Hidden%d", i);
+        std::wstring device = ReadIniString(L"Monitors", key, L"");
+        if (device.empty()) {
+            break;
+        }
+        snapshot->hiddenMonitors.push_back(device);
+    }
+    
+    // Load virtual desktop settings; the state table is a section of
+    // {GUID}=state lines, so it is read in one call
+    snapshot->perDesktop = ReadIniInt(L"VirtualDesktops", L"PerDesktop", 0) != 0;
+    {
+        wchar_t section[MAX_DESKTOP_STATES * (GUID_TEXT_LENGTH + 4) + 1];
+        DWORD length = GetPrivateProfileSection(DESKTOP_STATES_SECTION, section, static_cast<DWORD>(std::size(section)),
+                                                m_configFilePath.c_str());
+        
+        std::lock_guard<std::mutex> lock(m_desktopStatesMutex);
+        m_desktopStateCount = 0;
+        for (const wchar_t* line = section; line < section + length && *line; line += wcslen(line) + 1) {
+            const wchar_t* separator = wcschr(line, L'=');
+            DesktopIconState entry;
+            if (!separator || !ParseGuid(line, static_cast<size_t>(separator - line), entry.desktop) ||
+                m_desktopStateCount >= static_cast<size_t>(MAX_DESKTOP_STATES)) {
+                continue;
+            }
+            
+            entry.state = _wtoi(separator + 1) != 0 ? IconState::Visible : IconState::Hidden;
+            DesktopIconState* end = m_desktopStates + m_desktopStateCount;
+            DesktopIconState* it = std::lower_bound(m_desktopStates, end, entry.desktop, GuidLess);
+            if (it == end || memcmp(&it->desktop, &entry.desktop, sizeof(GUID)) != 0) {
+                std::move_backward(it, end, end + 1);
+                *it = entry;
+                m_desktopStateCount++;
+            }
+        }
+    }
+    
+    // Load context rules. There can be thousands of process names, so the
+    // section is read in one call into a buffer grown until it fits, not
+    // one file read per key.
+    snapshot->contextRules = ReadIniInt(RULES_SECTION, L"Enabled", 0) != 0;
+    snapshot->hideWhenFullscreen = ReadIniInt(RULES_SECTION, L"HideWhenFullscreen", 1) != 0;
+    snapshot->hideWhenPresenting = ReadIniInt(RULES_SECTION, L"HideWhenPresenting", 1) != 0;
+    {
+        std::vector<wchar_t> section(4096);
+        DWORD length = 0;
+        for (;;) {
+            length = GetPrivateProfileSection(RULES_SECTION, section.data(), static_cast<DWORD>(section.size()),
+                                              m_configFilePath.c_str());
+            // The length is size - 2 when the section did not fit
+            if (length + 2 < section.size() || section.size() >= 2 * MAX_CONTEXT_RULES * (MAX_PATH + 16)) {
+                break;
+            }
+            section.resize(section.size() * 2);
+        }
+        
+        const wchar_t* end = section.data() + length;
+        for (const wchar_t* line = section.data(); line < end && *line; line += wcslen(line) + 1) {
+            const wchar_t* separator = wcschr(line, L'=');
+            if (!separator || separator[1] == L'\0') {
+                continue;
+            }
+            
+            if (IsNumberedKey(line, separator, L"Hide") && snapshot->hideProcesses.size() < static_cast<size_t>(MAX_CONTEXT_RULES)) {
+                snapshot->hideProcesses.push_back(separator + 1);
+            } else if (IsNumberedKey(line, separator, L"Ignore") && snapshot->ignoreProcesses.size() < static_cast<size_t>(MAX_CONTEXT_RULES)) {
+                snapshot->ignoreProcesses.push_back(separator + 1);
+            }
+        }
+    }
+    
+    // Load schedules; windows are numbered like keep patterns
+    for (int i = 1; i <= MAX_SCHEDULE_WINDOWS; i++) {
+        wchar_t key[16];
+        swprintf_s(key, L"Hide%d", i);
+        std::wstring window = ReadIniString(L"Schedule", key, L"");
+        if (window.empty()) {
+            break;
+        }
+        snapshot->scheduleWindows.push_back(window);
+    }
+    snapshot->hiddenUntil = _wcstoui64(ReadIniString(L"Schedule", L"HiddenUntil", L"0").c_str(), nullptr, 10);
+    
+    // Load idle settings
+    snapshot->idleHideMinutes = ReadIniInt(L"Idle", L"HideAfterMinutes", 0);
+    if (snapshot->idleHideMinutes < 0 || snapshot->idleHideMinutes > MAX_IDLE_HIDE_MINUTES) {
+        snapshot->idleHideMinutes = 0;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        Publish(snapshot);
+    }
+    
+    Metrics::ConfigLoads.Increment();
     
     return true;
 }
 
 bool ConfigManager::SaveSettings() {
+    TRACE_SPAN("config", "SaveSettings");
+    ALLOCATION_SCOPE(Config);
+    
     if (m_configFilePath.empty()) {
         return false;
     }
     
+    // Write one consistent version even if a setter runs meanwhile
+    ConfigSnapshotRef snapshot = GetSnapshot();
+    
     // Save hotkey configuration
-    if (!WriteIniInt(L"Hotkey", L"Ctrl", m_hotkeyConfig.ctrl ? 1 : 0) ||
-        !WriteIniInt(L"Hotkey", L"Alt", m_hotkeyConfig.alt ? 1 : 0) ||
-        !WriteIniInt(L"Hotkey", L"Shift", m_hotkeyConfig.shift ? 1 : 0) ||
-        !WriteIniInt(L"Hotkey", L"Win", m_hotkeyConfig.win ? 1 : 0) ||
-        !WriteIniInt(L"Hotkey", L"KeyCode", m_hotkeyConfig.vkCode)) {
+    if (!WriteIniInt(L"Hotkey", L"Ctrl", snapshot->hotkeyConfig.ctrl ? 1 : 0) ||
+        !WriteIniInt(L"Hotkey", L"Alt", snapshot->hotkeyConfig.alt ? 1 : 0) ||
+        !WriteIniInt(L"Hotkey", L"Shift", snapshot->hotkeyConfig.shift ? 1 : 0) ||
+        !WriteIniInt(L"Hotkey", L"Win", snapshot->hotkeyConfig.win ? 1 : 0) ||
+        !WriteIniInt(L"Hotkey", L"KeyCode", snapshot->hotkeyConfig.vkCode)) {
+        Metrics::ConfigWriteFailures.Increment();
         return false;
     }
     
     // Save application settings
-    if (!WriteIniInt(L"Application", L"StartWithWindows", m_startWithWindows ? 1 : 0) ||
-        !WriteIniInt(L"Application", L"ShowNotifications", m_showNotifications ? 1 : 0) ||
-        !WriteIniInt(L"Application", L"RememberState", m_rememberState ? 1 : 0) ||
-        !WriteIniInt(L"Application", L"LastIconState", (m_lastIconState == IconState::Visible) ? 1 : 0)) {
+    if (!WriteIniInt(L"Application", L"StartWithWindows", snapshot->startWithWindows ? 1 : 0) ||
+        !WriteIniInt(L"Application", L"ShowNotifications", snapshot->showNotifications ? 1 : 0) ||
+        !WriteIniInt(L"Application", L"RememberState", snapshot->rememberState ? 1 : 0) ||
+        !WriteIniInt(L"Application", L"LastIconState", (m_lastIconState.load() == IconState::Visible) ? 1 : 0)) {
+        Metrics::ConfigWriteFailures.Increment();
+        return false;
+    }
+    
+    // Save diagnostics settings
+    if (!WriteIniInt(L"Diagnostics", L"Tracing", snapshot->tracingEnabled ? 1 : 0) ||
+        !WriteIniInt(L"Diagnostics", L"Metrics", snapshot->metricsEnabled ? 1 : 0) ||
+        !WriteIniString(L"Diagnostics", L"MetricsFile", snapshot->metricsFilePath.c_str()) ||
+        !WriteIniInt(L"Diagnostics", L"MetricsIntervalSeconds", snapshot->metricsIntervalSeconds)) {
+        Metrics::ConfigWriteFailures.Increment();
+        return false;
+    }
+    
+    // Save memory settings
+    if (!WriteIniInt(L"Memory", L"FootprintMode", snapshot->footprintMode ? 1 : 0) ||
+        !WriteIniInt(L"Memory", L"TrimIdleSeconds", snapshot->trimIdleSeconds)) {
+        Metrics::ConfigWriteFailures.Increment();
+        return false;
+    }
+    
+    // Save desktop settings
+    if (!WriteIniString(L"Desktop", L"ToggleStrategy", snapshot->toggleStrategy.c_str()) ||
+        !WriteIniInt(L"Desktop", L"DoubleClickToggle", snapshot->doubleClickToggle ? 1 : 0) ||
+        !WriteIniInt(L"Selective", L"Enabled", snapshot->selectiveMode ? 1 : 0) ||
+        !WriteIniInt(L"Layout", L"PerDisplay", snapshot->layoutPerDisplay ? 1 : 0) ||
+        !WriteIniInt(L"Layout", L"History", snapshot->layoutHistory ? 1 : 0) ||
+        !WriteIniInt(L"Layout", L"HistoryRetentionDays", snapshot->historyRetentionDays) ||
+        !WriteIniInt(L"Layout", L"HistoryMaxSizeKB", snapshot->historyMaxSizeKB) ||
+        !WriteIniInt(L"Monitors", L"PerMonitor", snapshot->perMonitor ? 1 : 0) ||
+        !WriteIniInt(L"VirtualDesktops", L"PerDesktop", snapshot->perDesktop ? 1 : 0) ||
+        !WriteIniInt(RULES_SECTION, L"Enabled", snapshot->contextRules ? 1 : 0) ||
+        !WriteIniInt(L"Idle", L"HideAfterMinutes", snapshot->idleHideMinutes)) {
+        Metrics::ConfigWriteFailures.Increment();
         return false;
     }
     
+    // A timed hide that is over leaves no key behind
+    {
+        wchar_t hiddenUntil[24];
+        swprintf_s(hiddenUntil, L"%llu", snapshot->hiddenUntil);
+        if (!WriteIniString(L"Schedule", L"HiddenUntil", snapshot->hiddenUntil != 0 ? hiddenUntil : nullptr)) {
+            Metrics::ConfigWriteFailures.Increment();
+            return false;
+        }
+    }
+    
+    // Hidden monitors; keys past the last one are removed
+    for (int i = 1; i <= MAX_HIDDEN_MONITORS; i++) {
+        wchar_t key[16];
+        swprintf_s(key, L"Hidden%d", i);
+        size_t slot = static_cast<size_t>(i - 1);
+        const wchar_t* device = slot < snapshot->hiddenMonitors.size() ? snapshot->hiddenMonitors[slot].c_str() : nullptr;
+        if (!WriteIniString(L"Monitors", key, device)) {
+            Metrics::ConfigWriteFailures.Increment();
+            return false;
+        }
+    }
+    
+    // The state table replaces its whole section in one write
+    {
+        wchar_t section[MAX_DESKTOP_STATES * (GUID_TEXT_LENGTH + 4) + 1];
+        wchar_t* line = section;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_desktopStatesMutex);
+            for (count = 0; count < m_desktopStateCount; count++) {
+                const DesktopIconState& entry = m_desktopStates[count];
+                wchar_t guid[GUID_TEXT_LENGTH + 1];
+                FormatGuid(entry.desktop, guid);
+                int written = swprintf_s(line, static_cast<size_t>(section + std::size(section) - line), L"%s=%d",
+                                         guid, entry.state == IconState::Visible ? 1 : 0);
+                line += written + 1;
+            }
+        }
+        *line = L'\0';
+        
+        bool written = count == 0 ?
+            WritePrivateProfileString(DESKTOP_STATES_SECTION, nullptr, nullptr, m_configFilePath.c_str()) != 0 :
+            WritePrivateProfileSection(DESKTOP_STATES_SECTION, section, m_configFilePath.c_str()) != 0;
+        if (!written) {
+            Metrics::ConfigWriteFailures.Increment();
+            return false;
+        }
+    }
+    
+    Metrics::ConfigWrites.Increment();
+    
     return true;
 }
 
+ConfigSnapshotRef ConfigManager::GetSnapshot() const {
+    // Each thread starts at a slot of its own; Windows thread ids are
+    // multiples of four
+    size_t first = (GetCurrentThreadId() / 4) % READER_SLOTS;
+    const ConfigSnapshot* snapshot = m_current.load();
+    for (size_t i = 0; i < READER_SLOTS; i++) {
+        std::atomic<const ConfigSnapshot*>& slot = m_readerSlots[(first + i) % READER_SLOTS].snapshot;
+        const ConfigSnapshot* empty = nullptr;
+        if (slot.load(std::memory_order_relaxed) != nullptr || !slot.compare_exchange_strong(empty, snapshot)) {
+            continue;
+        }
+        
+        // Announced before checking that it is still current: a writer that
+        // swaps it out afterwards finds it in the slot
+        bool raced = false;
+        for (;;) {
+            const ConfigSnapshot* current = m_current.load();
+            if (current == snapshot) {
+                break;
+            }
+            snapshot = current;
+            slot.store(snapshot);
+            raced = true;
+        }
+        
+        // Meanwhile the slot may have kept a replaced one from being freed
+        if (raced && m_retiredCount.load() != 0) {
+            ReclaimRetired();
+        }
+        return ConfigSnapshotRef(this, snapshot, &slot);
+    }
+    
+    // Every slot taken: counted together, which holds back all reclamation
+    m_sharedReaders.fetch_add(1);
+    return ConfigSnapshotRef(this, m_current.load(), nullptr);
+}
+
+void ConfigManager::ReleaseReader(const ConfigSnapshot* snapshot, std::atomic<const ConfigSnapshot*>* slot) const {
+    // The last reader of a replaced snapshot frees it; readers of the
+    // current one never take the lock. A shared reader may have held back
+    // any of them.
+    bool shared = (slot == nullptr);
+    if (shared) {
+        m_sharedReaders.fetch_sub(1);
+    } else {
+        slot->store(nullptr);
+    }
+    
+    if (m_retiredCount.load() != 0 && (shared || snapshot != m_current.load())) {
+        ReclaimRetired();
+    }
+}
+
+void ConfigManager::Update(const std::function<void(ConfigSnapshot&)>& change) {
+    ALLOCATION_SCOPE(Config);
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    
+    // Only writers replace the pointer, so it is stable under the lock
+    ConfigSnapshot* snapshot = new ConfigSnapshot(*m_current.load());
+    change(*snapshot);
+    Publish(snapshot);
+}
+
+void ConfigManager::Publish(ConfigSnapshot* snapshot) {
+    // Called with m_writeMutex held
+    const ConfigSnapshot* previous = m_current.exchange(snapshot);
+    {
+        std::lock_guard<std::mutex> lock(m_retiredMutex);
+        m_retired.push_back(previous);
+        m_retiredCount.store(m_retired.size());
+    }
+    ReclaimRetired();
+}
+
+void ConfigManager::ReclaimRetired() const {
+    std::lock_guard<std::mutex> lock(m_retiredMutex);
+    
+    // Shared readers may hold any of them
+    if (m_sharedReaders.load() != 0) {
+        return;
+    }
+    
+    size_t kept = 0;
+    for (const ConfigSnapshot* snapshot : m_retired) {
+        if (IsReferenced(snapshot)) {
+            m_retired[kept++] = snapshot;
+        } else {
+            delete snapshot;
+        }
+    }
+    m_retired.resize(kept);
+    m_retiredCount.store(kept);
+}
+
+bool ConfigManager::IsReferenced(const ConfigSnapshot* snapshot) const {
+    // Every retired snapshot was unpublished before this check, so a reader
+    // that could still see one has it in its slot
+    for (const ReaderSlot& slot : m_readerSlots) {
+        if (slot.snapshot.load() == snapshot) {
+            return true;
+        }
+    }
+    return false;
+}
+
 HotkeyConfig ConfigManager::GetHotkeyConfig() const {
-    return m_hotkeyConfig;
+    return GetSnapshot()->hotkeyConfig;
 }
 
 void ConfigManager::SetHotkeyConfig(const HotkeyConfig& config) {
-    m_hotkeyConfig = config;
+    Update([&](ConfigSnapshot& snapshot) { snapshot.hotkeyConfig = config; });
 }
 
 bool ConfigManager::GetStartWithWindows() const {
-    return m_startWithWindows;
+    return GetSnapshot()->startWithWindows;
 }
 
 void ConfigManager::SetStartWithWindows(bool enable) {
-    m_startWithWindows = enable;
+    Update([&](ConfigSnapshot& snapshot) { snapshot.startWithWindows = enable; });
 }
 
 bool ConfigManager::GetShowNotifications() const {
-    return m_showNotifications;
+    return GetSnapshot()->showNotifications;
 }
 
 void ConfigManager::SetShowNotifications(bool enable) {
-    m_showNotifications = enable;
+    Update([&](ConfigSnapshot& snapshot) { snapshot.showNotifications = enable; });
 }
 
 bool ConfigManager::GetRememberState() const {
-    return m_rememberState;
+    return GetSnapshot()->rememberState;
 }
 
 void ConfigManager::SetRememberState(bool enable) {
-    m_rememberState = enable;
+    Update([&](ConfigSnapshot& snapshot) { snapshot.rememberState = enable; });
 }
 
 IconState ConfigManager::GetLastIconState() const {
-    return m_lastIconState;
+    return m_lastIconState.load();
 }
 
 void ConfigManager::SetLastIconState(IconState state) {
-    m_lastIconState = state;
+    m_lastIconState.store(state);
+}
+
+int ConfigManager::GetStartupBudgetMs(const std::wstring& phase) {
+    return ReadIniInt(L"StartupBudgets", phase.c_str(), 0);
+}
+
+bool ConfigManager::GetTracingEnabled() const {
+    return GetSnapshot()->tracingEnabled;
+}
+
+void ConfigManager::SetTracingEnabled(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.tracingEnabled = enable; });
+}
+
+bool ConfigManager::GetMetricsEnabled() const {
+    return GetSnapshot()->metricsEnabled;
+}
+
+void ConfigManager::SetMetricsEnabled(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.metricsEnabled = enable; });
+}
+
+std::wstring ConfigManager::GetMetricsFilePath() const {
+    return GetSnapshot()->metricsFilePath;
+}
+
+void ConfigManager::SetMetricsFilePath(const std::wstring& path) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.metricsFilePath = path; });
+}
+
+int ConfigManager::GetMetricsIntervalSeconds() const {
+    return GetSnapshot()->metricsIntervalSeconds;
+}
+
+void ConfigManager::SetMetricsIntervalSeconds(int seconds) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.metricsIntervalSeconds = seconds; });
+}
+
+bool ConfigManager::GetFootprintMode() const {
+    return GetSnapshot()->footprintMode;
+}
+
+void ConfigManager::SetFootprintMode(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.footprintMode = enable; });
+}
+
+int ConfigManager::GetTrimIdleSeconds() const {
+    return GetSnapshot()->trimIdleSeconds;
+}
+
+void ConfigManager::SetTrimIdleSeconds(int seconds) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.trimIdleSeconds = seconds; });
+}
+
+std::wstring ConfigManager::GetToggleStrategy() const {
+    return GetSnapshot()->toggleStrategy;
+}
+
+void ConfigManager::SetToggleStrategy(const std::wstring& name) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.toggleStrategy = name; });
+}
+
+bool ConfigManager::GetSelectiveMode() const {
+    return GetSnapshot()->selectiveMode;
+}
+
+void ConfigManager::SetSelectiveMode(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.selectiveMode = enable; });
+}
+
+bool ConfigManager::GetLayoutPerDisplay() const {
+    return GetSnapshot()->layoutPerDisplay;
+}
+
+void ConfigManager::SetLayoutPerDisplay(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.layoutPerDisplay = enable; });
+}
+
+bool ConfigManager::GetLayoutHistory() const {
+    return GetSnapshot()->layoutHistory;
+}
+
+void ConfigManager::SetLayoutHistory(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.layoutHistory = enable; });
+}
+
+bool ConfigManager::GetPerMonitor() const {
+    return GetSnapshot()->perMonitor;
+}
+
+void ConfigManager::SetPerMonitor(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.perMonitor = enable; });
+}
+
+std::vector<std::wstring> ConfigManager::GetHiddenMonitors() const {
+    return GetSnapshot()->hiddenMonitors;
+}
+
+void ConfigManager::SetHiddenMonitors(const std::vector<std::wstring>& devices) {
+    Update([&](ConfigSnapshot& snapshot) {
+        snapshot.hiddenMonitors.assign(devices.begin(),
+                                       devices.begin() + std::min(devices.size(), static_cast<size_t>(MAX_HIDDEN_MONITORS)));
+    });
+}
+
+bool ConfigManager::GetPerDesktop() const {
+    return GetSnapshot()->perDesktop;
+}
+
+void ConfigManager::SetPerDesktop(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.perDesktop = enable; });
+}
+
+bool ConfigManager::GetDesktopIconState(const GUID& desktop, IconState& state) const {
+    std::lock_guard<std::mutex> lock(m_desktopStatesMutex);
+    const DesktopIconState* end = m_desktopStates + m_desktopStateCount;
+    const DesktopIconState* it = std::lower_bound(m_desktopStates, end, desktop, GuidLess);
+    if (it == end || memcmp(&it->desktop, &desktop, sizeof(GUID)) != 0) {
+        return false;
+    }
+    
+    state = it->state;
+    return true;
+}
+
+void ConfigManager::SetDesktopIconState(const GUID& desktop, IconState state) {
+    std::lock_guard<std::mutex> lock(m_desktopStatesMutex);
+    DesktopIconState* end = m_desktopStates + m_desktopStateCount;
+    DesktopIconState* it = std::lower_bound(m_desktopStates, end, desktop, GuidLess);
+    if (it != end && memcmp(&it->desktop, &desktop, sizeof(GUID)) == 0) {
+        it->state = state;
+    } else if (m_desktopStateCount < static_cast<size_t>(MAX_DESKTOP_STATES)) {
+        std::move_backward(it, end, end + 1);
+        *it = { desktop, state };
+        m_desktopStateCount++;
+    }
+}
+
+void ConfigManager::RemoveDesktopIconState(const GUID& desktop) {
+    std::lock_guard<std::mutex> lock(m_desktopStatesMutex);
+    DesktopIconState* end = m_desktopStates + m_desktopStateCount;
+    DesktopIconState* it = std::lower_bound(m_desktopStates, end, desktop, GuidLess);
+    if (it != end && memcmp(&it->desktop, &desktop, sizeof(GUID)) == 0) {
+        std::move(it + 1, end, it);
+        m_desktopStateCount--;
+    }
+}
+
+void ConfigManager::PruneDesktopIconStates(const std::vector<GUID>& existing) {
+    std::lock_guard<std::mutex> lock(m_desktopStatesMutex);
+    DesktopIconState* removed = std::remove_if(m_desktopStates, m_desktopStates + m_desktopStateCount,
+        [&](const DesktopIconState& entry) {
+            return std::none_of(existing.begin(), existing.end(), [&](const GUID& desktop) {
+                return memcmp(&entry.desktop, &desktop, sizeof(GUID)) == 0;
+            });
+        });
+    m_desktopStateCount = static_cast<size_t>(removed - m_desktopStates);
+}
+
+bool ConfigManager::GetContextRules() const {
+    return GetSnapshot()->contextRules;
+}
+
+void ConfigManager::SetContextRules(bool enable) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.contextRules = enable; });
+}
+
+int ConfigManager::GetIdleHideMinutes() const {
+    return GetSnapshot()->idleHideMinutes;
+}
+
+void ConfigManager::SetIdleHideMinutes(int minutes) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.idleHideMinutes = minutes; });
+}
+
+ULONGLONG ConfigManager::GetHiddenUntil() const {
+    return GetSnapshot()->hiddenUntil;
+}
+
+void ConfigManager::SetHiddenUntil(ULONGLONG fileTime) {
+    Update([&](ConfigSnapshot& snapshot) { snapshot.hiddenUntil = fileTime; });
+}
+
+int ConfigManager::GetWorkingSetBudgetKB() {
+    return ReadIniInt(L"Memory", L"WorkingSetBudgetKB", 0);
+}
+
+size_t ConfigManager::GetMemoryUsage() {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    
+    ConfigSnapshotRef snapshot = GetSnapshot();
+    size_t bytes = sizeof(*this) + m_configFilePath.capacity() * sizeof(wchar_t);
+    bytes += (1 + m_retiredCount.load()) * sizeof(ConfigSnapshot);
+    bytes += snapshot->metricsFilePath.capacity() * sizeof(wchar_t);
+    bytes += snapshot->toggleStrategy.capacity() * sizeof(wchar_t);
+    for (const std::wstring& pattern : snapshot->keepPatterns) {
+        bytes += sizeof(pattern) + pattern.capacity() * sizeof(wchar_t);
+    }
+    for (const std::wstring& device : snapshot->hiddenMonitors) {
+        bytes += sizeof(device) + device.capacity() * sizeof(wchar_t);
+    }
+    for (const std::vector<std::wstring>* processes : { &snapshot->hideProcesses, &snapshot->ignoreProcesses,
+                                                        &snapshot->scheduleWindows }) {
+        for (const std::wstring& process : *processes) {
+            bytes += sizeof(process) + process.capacity() * sizeof(wchar_t);
+        }
+    }
+    return bytes;
 }
 
 std::wstring ConfigManager::GetConfigFilePath() const {
@@ -170,7 +816,89 @@ bool ConfigManager::CreateDefaultConfig() {
         "RememberState=1\r\n"
         "\r\n"
         "; Last known desktop icon state (1 = visible, 0 = hidden)\r\n"
-        "LastIconState=1\r\n";
+        "LastIconState=1\r\n"
+        "\r\n"
+        "[Diagnostics]\r\n"
+        "; Record timing spans for trace.json / crash-trace.json (1 = enabled, 0 = disabled)\r\n"
+        "Tracing=1\r\n"
+        "\r\n"
+        "; Export counters to a Prometheus text file (1 = enabled, 0 = disabled)\r\n"
+        "Metrics=0\r\n"
+        "\r\n"
+        "; Metrics file path (empty = metrics.prom next to the executable)\r\n"
+        "MetricsFile=\r\n"
+        "\r\n"
+        "; Minimum seconds between metrics file updates\r\n"
+        "MetricsIntervalSeconds=15\r\n"
+        "\r\n"
+        "[Memory]\r\n"
+        "; Release rebuildable state and trim the working set when idle (1 = enabled, 0 = disabled)\r\n"
+        "FootprintMode=0\r\n"
+        "\r\n"
+        "; Seconds without activity before trimming\r\n"
+        "TrimIdleSeconds=300\r\n"
+        "\r\n"
+        "[Desktop]\r\n"
+        "; How icons are toggled: listview, shell_command or hide_defview\r\n"
+        "; (empty = measure each on the first toggles and keep the fastest)\r\n"
+        "ToggleStrategy=\r\n"
+        "; Double-click empty desktop space to toggle the icons (1 = enabled, 0 = disabled)\r\n"
+        "DoubleClickToggle=0\r\n"
+        "\r\n"
+        "[Selective]\r\n"
+        "; Hide only the icons that match none of the Keep patterns (1 = enabled, 0 = disabled)\r\n"
+        "; Patterns are globs (* and ?) or regular expressions prefixed with re:\r\n"
+        "Enabled=0\r\n"
+        ";Keep1=*.lnk\r\n"
+        ";Keep2=re:^(Recycle Bin|This PC)$\r\n"
+        "\r\n"
+        "[Layout]\r\n"
+        "; Remember icon positions for each monitor setup and restore them when\r\n"
+        "; monitors are connected, disconnected or changed (1 = enabled, 0 = disabled)\r\n"
+        "PerDisplay=1\r\n"
+        "\r\n"
+        "; Keep a history of icon layouts for undo and going back in time (1 = enabled, 0 = disabled)\r\n"
+        "History=1\r\n"
+        "\r\n"
+        "; History older than this many days is dropped (0 = keep forever)\r\n"
+        "HistoryRetentionDays=30\r\n"
+        "\r\n"
+        "; Maximum size of the history file in KB (0 = unlimited)\r\n"
+        "HistoryMaxSizeKB=4096\r\n"
+        "\r\n"
+        "[Monitors]\r\n"
+        "; Hotkey and tray click toggle only the icons on the monitor under the\r\n"
+        "; mouse cursor (1 = enabled, 0 = disabled)\r\n"
+        "PerMonitor=0\r\n"
+        "; Hidden1, Hidden2, ... are written by the application\r\n"
+        "\r\n"
+        "[VirtualDesktops]\r\n"
+        "; Remember whether icons are shown or hidden on each virtual desktop and\r\n"
+        "; apply it when switching desktops (1 = enabled, 0 = disabled)\r\n"
+        "; The states are written to [VirtualDesktopStates] by the application\r\n"
+        "PerDesktop=0\r\n"
+        "\r\n"
+        "[Rules]\r\n"
+        "; Hide the icons while the user is presenting, watching something fullscreen\r\n"
+        "; or using one of the listed programs, and show them again afterwards\r\n"
+        "; (1 = enabled, 0 = disabled)\r\n"
+        "Enabled=0\r\n"
+        "HideWhenFullscreen=1\r\n"
+        "HideWhenPresenting=1\r\n"
+        "; Programs that hide the icons while in the foreground, and programs that\r\n"
+        "; never do, by executable name:\r\n"
+        ";Hide1=powerpnt.exe\r\n"
+        ";Ignore1=mstsc.exe\r\n"
+        "\r\n"
+        "[Idle]\r\n"
+        "; Hide the icons after this many minutes without mouse or keyboard input and\r\n"
+        "; show them again on the next input (0 = never)\r\n"
+        "HideAfterMinutes=0\r\n"
+        "\r\n"
+        "[Schedule]\r\n"
+        "; Daily times during which the icons are hidden, numbered Hide1, Hide2, ...\r\n"
+        "; (a window ending before it starts runs past midnight)\r\n"
+        ";Hide1=09:00-17:00\r\n";
     
     DWORD bytesWritten;
     bool success = WriteFile(hFile, defaultConfig, strlen(defaultConfig), &bytesWritten, nullptr);
@@ -179,12 +907,12 @@ bool ConfigManager::CreateDefaultConfig() {
     return success;
 }
 
-std::wstring ConfigManager::ReadIniString(const std::wstring& section, const std::wstring& key, const std::wstring& defaultValue) {
+std::wstring ConfigManager::ReadIniString(const wchar_t* section, const wchar_t* key, const wchar_t* defaultValue) {
     wchar_t buffer[1024];
     DWORD result = GetPrivateProfileString(
-        section.c_str(),
-        key.c_str(),
-        defaultValue.c_str(),
+        section,
+        key,
+        defaultValue,
         buffer,
         1024,
         m_configFilePath.c_str()
@@ -193,26 +921,29 @@ std::wstring ConfigManager::ReadIniString(const std::wstring& section, const std
     return std::wstring(buffer);
 }
 
-int ConfigManager::ReadIniInt(const std::wstring& section, const std::wstring& key, int defaultValue) {
+int ConfigManager::ReadIniInt(const wchar_t* section, const wchar_t* key, int defaultValue) {
     return GetPrivateProfileInt(
-        section.c_str(),
-        key.c_str(),
+        section,
+        key,
         defaultValue,
         m_configFilePath.c_str()
     );
 }
 
-bool ConfigManager::WriteIniString(const std::wstring& section, const std::wstring& key, const std::wstring& value) {
+bool ConfigManager::WriteIniString(const wchar_t* section, const wchar_t* key, const wchar_t* value) {
     return WritePrivateProfileString(
-        section.c_str(),
-        key.c_str(),
-        value.c_str(),
+        section,
+        key,
+        value,
         m_configFilePath.c_str()
     ) != 0;
 }
 
-bool ConfigManager::WriteIniInt(const std::wstring& section, const std::wstring& key, int value) {
-    return WriteIniString(section, key, std::to_wstring(value));
+bool ConfigManager::WriteIniInt(const wchar_t* section, const wchar_t* key, int value) {
+    // Fixed buffer: large enough for any int, no heap allocation
+    wchar_t buffer[16];
+    _itow_s(value, buffer, 10);
+    return WriteIniString(section, key, buffer);
 }
 
 std::wstring ConfigManager::GetExecutableDirectory() {
@@ -0,0 +1,121 @@
+#include "ContextRules.h"
+#include <cwctype>
+
+ContextRules::ContextRules()
+    : m_ruleCount(0)
+    , m_hideWhenFullscreen(false)
+    , m_hideWhenPresenting(false) {
+}
+
+ContextRules::~ContextRules() {
+}
+
+void ContextRules::Compile(const std::vector<std::wstring>& hideProcesses, const std::vector<std::wstring>& ignoreProcesses,
+                           bool hideWhenFullscreen, bool hideWhenPresenting) {
+    Clear();
+    m_hideWhenFullscreen = hideWhenFullscreen;
+    m_hideWhenPresenting = hideWhenPresenting;
+
+    size_t rules = hideProcesses.size() + ignoreProcesses.size();
+    if (rules == 0) {
+        return;
+    }
+
+    size_t capacity = 16;
+    while (capacity < rules * 2) {
+        capacity *= 2;
+    }
+    m_slots.assign(capacity, Slot{ 0, Action::None });
+
+    // Ignore is inserted last so it overrides Hide for the same name
+    for (const std::wstring& name : hideProcesses) {
+        if (!name.empty()) {
+            Insert(HashProcessName(name.c_str(), name.size()), Action::Hide);
+        }
+    }
+    for (const std::wstring& name : ignoreProcesses) {
+        if (!name.empty()) {
+            Insert(HashProcessName(name.c_str(), name.size()), Action::Ignore);
+        }
+    }
+}
+
+void ContextRules::Clear() {
+    m_slots = std::vector<Slot>();
+    m_ruleCount = 0;
+    m_hideWhenFullscreen = false;
+    m_hideWhenPresenting = false;
+}
+
+bool ContextRules::IsEmpty() const {
+    return m_ruleCount == 0 && !m_hideWhenFullscreen && !m_hideWhenPresenting;
+}
+
+size_t ContextRules::GetRuleCount() const {
+    return m_ruleCount;
+}
+
+bool ContextRules::ShouldHide(const Context& context) const {
+    Action action = Lookup(context.processHash);
+    if (action != Action::None) {
+        return action == Action::Hide;
+    }
+
+    return (context.fullscreen && m_hideWhenFullscreen) || (context.presenting && m_hideWhenPresenting);
+}
+
+ContextRules::Action ContextRules::Lookup(uint64_t processHash) const {
+    if (processHash == 0 || m_slots.empty()) {
+        return Action::None;
+    }
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(processHash) & mask; ; i = (i + 1) & mask) {
+        const Slot& slot = m_slots[i];
+        if (slot.hash == processHash) {
+            return slot.action;
+        }
+        if (slot.hash == 0) {
+            return Action::None;
+        }
+    }
+}
+
+uint64_t ContextRules::HashProcessName(const wchar_t* name, size_t length) {
+    // Rules name the executable; the foreground process comes with a path
+    size_t start = length;
+    while (start > 0 && name[start - 1] != L'\\' && name[start - 1] != L'/') {
+        start--;
+    }
+
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = start; i < length; i++) {
+        uint16_t c = static_cast<uint16_t>(towlower(name[i]));
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+        hash ^= static_cast<uint8_t>(c >> 8);
+        hash *= 1099511628211ull;
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+size_t ContextRules::GetMemoryUsage() const {
+    return m_slots.capacity() * sizeof(Slot);
+}
+
+void ContextRules::Insert(uint64_t hash, Action action) {
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask) {
+        Slot& slot = m_slots[i];
+        if (slot.hash == hash) {
+            slot.action = action;
+            return;
+        }
+        if (slot.hash == 0) {
+            slot = Slot{ hash, action };
+            m_ruleCount++;
+            return;
+        }
+    }
+}
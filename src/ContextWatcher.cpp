@@ -0,0 +1,139 @@
+#include "ContextWatcher.h"
+#include "Tracer.h"
+
+ContextWatcher* ContextWatcher::s_instance = nullptr;
+
+ContextWatcher::ContextWatcher()
+    : m_notifyWindow(nullptr)
+    , m_hook(nullptr)
+    , m_appBar(false)
+    , m_fullscreenApp(false)
+    , m_signalPending(false)
+    , m_cachedProcessId(0)
+    , m_cachedHash(0) {
+}
+
+ContextWatcher::~ContextWatcher() {
+    Cleanup();
+}
+
+bool ContextWatcher::Initialize(HWND notifyWindow) {
+    TRACE_SPAN("shell", "ContextWatcher::Initialize");
+
+    if (m_hook) {
+        return true;
+    }
+
+    if (!notifyWindow || (s_instance && s_instance != this)) {
+        return false;
+    }
+
+    m_notifyWindow = notifyWindow;
+    s_instance = this;
+    m_hook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, ForegroundEventProc,
+                             0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+    if (!m_hook) {
+        Cleanup();
+        return false;
+    }
+
+    // A zero-sized app bar reserves no screen space; it is only there for
+    // the fullscreen notifications. Without it, Capture() still sees
+    // fullscreen apps through the notification state.
+    APPBARDATA appBar = {};
+    appBar.cbSize = sizeof(appBar);
+    appBar.hWnd = m_notifyWindow;
+    appBar.uCallbackMessage = WM_APPBAR_NOTIFY;
+    m_appBar = SHAppBarMessage(ABM_NEW, &appBar) != 0;
+
+    return true;
+}
+
+void ContextWatcher::Cleanup() {
+    if (m_appBar) {
+        APPBARDATA appBar = {};
+        appBar.cbSize = sizeof(appBar);
+        appBar.hWnd = m_notifyWindow;
+        SHAppBarMessage(ABM_REMOVE, &appBar);
+        m_appBar = false;
+    }
+
+    if (m_hook) {
+        UnhookWinEvent(m_hook);
+        m_hook = nullptr;
+    }
+
+    if (s_instance == this) {
+        s_instance = nullptr;
+    }
+
+    m_notifyWindow = nullptr;
+    m_fullscreenApp = false;
+    m_signalPending = false;
+    m_cachedProcessId = 0;
+    m_cachedHash = 0;
+}
+
+bool ContextWatcher::OnAppBarNotify(WPARAM notification, LPARAM state) {
+    if (notification != ABN_FULLSCREENAPP) {
+        return false;
+    }
+
+    bool fullscreen = state != 0;
+    if (fullscreen == m_fullscreenApp) {
+        return false;
+    }
+
+    m_fullscreenApp = fullscreen;
+    return true;
+}
+
+void ContextWatcher::ResetSignal() {
+    m_signalPending = false;
+}
+
+void ContextWatcher::Capture(ContextRules::Context& context) {
+    DWORD processId = 0;
+    HWND foreground = GetForegroundWindow();
+    if (foreground) {
+        GetWindowThreadProcessId(foreground, &processId);
+    }
+
+    if (processId != m_cachedProcessId) {
+        m_cachedProcessId = processId;
+        m_cachedHash = processId ? HashProcess(processId) : 0;
+    }
+    context.processHash = m_cachedHash;
+
+    QUERY_USER_NOTIFICATION_STATE state = QUNS_ACCEPTS_NOTIFICATIONS;
+    bool queried = SUCCEEDED(SHQueryUserNotificationState(&state));
+    context.presenting = queried && state == QUNS_PRESENTATION_MODE;
+    context.fullscreen = m_fullscreenApp ||
+                         (queried && (state == QUNS_BUSY || state == QUNS_RUNNING_D3D_FULL_SCREEN));
+}
+
+void CALLBACK ContextWatcher::ForegroundEventProc(HWINEVENTHOOK, DWORD, HWND hwnd,
+                                                  LONG idObject, LONG,
+                                                  DWORD, DWORD) {
+    ContextWatcher* watcher = s_instance;
+    if (!watcher || !hwnd || idObject != OBJID_WINDOW || watcher->m_signalPending) {
+        return;
+    }
+
+    watcher->m_signalPending = true;
+    PostMessage(watcher->m_notifyWindow, WM_CONTEXT_CHANGED, 0, 0);
+}
+
+uint64_t ContextWatcher::HashProcess(DWORD processId) {
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!process) {
+        return 0;
+    }
+
+    wchar_t path[MAX_PATH];
+    DWORD length = MAX_PATH;
+    bool found = QueryFullProcessImageName(process, 0, path, &length) != 0;
+    CloseHandle(process);
+
+    return found ? ContextRules::HashProcessName(path, length) : 0;
+}
@@ -0,0 +1,142 @@
+#include "DesktopClickWatcher.h"
+#include "CommandBus.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include <cstdlib>
+
+DesktopClickWatcher* DesktopClickWatcher::s_instance = nullptr;
+
+DesktopClickWatcher::DesktopClickWatcher()
+    : m_commandBus(nullptr)
+    , m_threadId(0)
+    , m_hooked(false)
+    , m_doubleClickTime(500)
+    , m_doubleClickWidth(4)
+    , m_doubleClickHeight(4)
+    , m_frequency(1)
+    , m_lastDownPoint{}
+    , m_lastDownTime(0)
+    , m_lastDownValid(false) {
+}
+
+DesktopClickWatcher::~DesktopClickWatcher() {
+    Cleanup();
+}
+
+bool DesktopClickWatcher::Initialize(CommandBus* commandBus) {
+    if (m_hooked) {
+        return true;
+    }
+
+    if (!commandBus || s_instance) {
+        return false;
+    }
+
+    TRACE_SPAN("shell", "DesktopClickWatcher::Initialize");
+
+    m_commandBus = commandBus;
+    m_doubleClickTime = GetDoubleClickTime();
+    m_doubleClickWidth = GetSystemMetrics(SM_CXDOUBLECLK);
+    m_doubleClickHeight = GetSystemMetrics(SM_CYDOUBLECLK);
+    m_lastDownValid = false;
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    m_frequency = frequency.QuadPart;
+
+    HANDLE ready = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!ready) {
+        m_commandBus = nullptr;
+        return false;
+    }
+
+    s_instance = this;
+    m_thread = std::thread(&DesktopClickWatcher::HookLoop, this, ready);
+    WaitForSingleObject(ready, INFINITE);
+    CloseHandle(ready);
+
+    if (!m_hooked) {
+        m_thread.join();
+        s_instance = nullptr;
+        m_commandBus = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void DesktopClickWatcher::Cleanup() {
+    if (!m_hooked) {
+        return;
+    }
+
+    PostThreadMessage(m_threadId, WM_QUIT, 0, 0);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    s_instance = nullptr;
+    m_commandBus = nullptr;
+    m_threadId = 0;
+    m_hooked = false;
+}
+
+bool DesktopClickWatcher::IsRunning() const {
+    return m_hooked;
+}
+
+void DesktopClickWatcher::HookLoop(HANDLE ready) {
+    // The queue must exist before Cleanup() can post WM_QUIT to it
+    MSG message;
+    PeekMessage(&message, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+    m_threadId = GetCurrentThreadId();
+
+    // Every mouse event of the session waits for this thread
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    HHOOK hook = SetWindowsHookEx(WH_MOUSE_LL, MouseProc, GetModuleHandle(nullptr), 0);
+    m_hooked = hook != nullptr;
+    SetEvent(ready);
+
+    if (!hook) {
+        return;
+    }
+
+    // The hook is called from within GetMessage()
+    while (GetMessage(&message, nullptr, 0, 0) > 0) {
+    }
+
+    UnhookWindowsHookEx(hook);
+}
+
+LRESULT CALLBACK DesktopClickWatcher::MouseProc(int code, WPARAM wParam, LPARAM lParam) {
+    DesktopClickWatcher* watcher = s_instance;
+    if (code == HC_ACTION && wParam == WM_LBUTTONDOWN && watcher) {
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        watcher->OnButtonDown(*reinterpret_cast<const MSLLHOOKSTRUCT*>(lParam));
+        QueryPerformanceCounter(&end);
+        Metrics::ClickHookDuration.Observe(static_cast<uint64_t>((end.QuadPart - start.QuadPart) * 1000000 / watcher->m_frequency));
+    }
+
+    return CallNextHookEx(nullptr, code, wParam, lParam);
+}
+
+void DesktopClickWatcher::OnButtonDown(const MSLLHOOKSTRUCT& event) {
+    // Same rules as the system: within the double-click time and inside a
+    // rectangle of the double-click size centred on the first press
+    bool pair = m_lastDownValid &&
+                event.time - m_lastDownTime <= m_doubleClickTime &&
+                labs(event.pt.x - m_lastDownPoint.x) <= m_doubleClickWidth / 2 &&
+                labs(event.pt.y - m_lastDownPoint.y) <= m_doubleClickHeight / 2;
+
+    // A third press starts a new pair rather than forming one with the second
+    m_lastDownValid = !pair;
+    m_lastDownPoint = event.pt;
+    m_lastDownTime = event.time;
+
+    if (pair) {
+        m_commandBus->Post(CommandType::DesktopDoubleClick, CommandSource::Mouse,
+                           static_cast<uint32_t>(MAKELONG(static_cast<WORD>(event.pt.x), static_cast<WORD>(event.pt.y))));
+    }
+}
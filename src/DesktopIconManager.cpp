@@ -1,11 +1,19 @@
 #include "DesktopIconManager.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
+#include "DisplayTopology.h"
 #include <iostream>
 
 DesktopIconManager::DesktopIconManager()
     : m_currentState(IconState::Unknown)
-    , m_desktopListView(nullptr)
-    , m_progman(nullptr)
-    , m_shelldll_defview(nullptr) {
+    , m_selector(STRATEGY_COUNT, TOGGLE_CALIBRATION_SAMPLES)
+    , m_selectiveMode(false)
+    , m_layoutTopology(0)
+    , m_historyCursor(LayoutHistory::NPOS) {
+    m_strategies[static_cast<size_t>(ToggleStrategyId::ListView)] = std::make_unique<ListViewToggleStrategy>();
+    m_strategies[static_cast<size_t>(ToggleStrategyId::ShellCommand)] = std::make_unique<ShellCommandToggleStrategy>();
+    m_strategies[static_cast<size_t>(ToggleStrategyId::HideDefView)] = std::make_unique<HideDefViewToggleStrategy>();
 }
 
 DesktopIconManager::~DesktopIconManager() {
@@ -22,15 +30,391 @@ bool DesktopIconManager::Initialize() {
 }
 
 void DesktopIconManager::Cleanup() {
-    m_desktopListView = nullptr;
-    m_progman = nullptr;
-    m_shelldll_defview = nullptr;
+    RestoreHiddenIcons();
+    
+    m_windows = DesktopWindows();
     m_currentState = IconState::Unknown;
 }
 
+bool DesktopIconManager::RecoverHiddenIcons(const std::wstring& path) {
+    TRACE_SPAN("desktop", "RecoverHiddenIcons");
+    
+    m_hiddenIconsPath = path;
+    
+    // While this run hides icons the file is its own
+    if (m_selective.IsHiding() || m_monitors.IsHidingAny()) {
+        return true;
+    }
+    
+    // Nothing left over, or nothing usable
+    IconLayout layout;
+    if (!layout.Load(path)) {
+        DeleteFile(path.c_str());
+        return true;
+    }
+    
+    // Kept for the next start if Explorer cannot take the moves yet
+    if ((!ValidateDesktopWindows() && !FindDesktopWindows()) || !layout.Apply(m_windows.listView)) {
+        return false;
+    }
+    
+    DeleteFile(path.c_str());
+    InvalidateIconIndex();
+    return true;
+}
+
+void DesktopIconManager::RestoreHiddenIcons() {
+    // Explorer saves icon positions, so never leave icons off-screen
+    if (m_selective.IsHiding() && ValidateDesktopWindows()) {
+        m_selective.Restore(m_windows.listView);
+    }
+    if (m_monitors.IsHidingAny() && ValidateDesktopWindows()) {
+        m_monitors.RestoreAll(m_windows.listView);
+    }
+    
+    SaveHiddenIcons();
+}
+
+void DesktopIconManager::SaveHiddenIcons() {
+    if (m_hiddenIconsPath.empty()) {
+        return;
+    }
+    
+    // Written on every change, so the file never names icons already back
+    if (!m_selective.IsHiding() && !m_monitors.IsHidingAny()) {
+        DeleteFile(m_hiddenIconsPath.c_str());
+        return;
+    }
+    
+    if (!m_monitors.IsHidingAny()) {
+        m_selective.GetHiddenLayout().Save(m_hiddenIconsPath);
+        return;
+    }
+    
+    m_hiddenIcons.Clear();
+    if (m_selective.IsHiding()) {
+        const IconLayout& selective = m_selective.GetHiddenLayout();
+        for (size_t i = 0; i < selective.GetCount(); i++) {
+            m_hiddenIcons.Add(selective.GetEntry(i).name.c_str(), selective.GetEntry(i).position);
+        }
+    }
+    m_monitors.AppendHiddenLayouts(m_hiddenIcons);
+    m_hiddenIcons.Sort();
+    m_hiddenIcons.Save(m_hiddenIconsPath);
+}
+
+void DesktopIconManager::SetSelectedStrategy(const wchar_t* name) {
+    m_selector.Calibrate();
+    
+    for (size_t i = 0; name && i < STRATEGY_COUNT; ++i) {
+        if (wcscmp(m_strategies[i]->GetName(), name) == 0) {
+            m_selector.Select(i);
+            break;
+        }
+    }
+}
+
+const wchar_t* DesktopIconManager::GetSelectedStrategyName() const {
+    return m_selector.IsCalibrating() ? L"" : m_strategies[m_selector.GetSelected()]->GetName();
+}
+
+bool DesktopIconManager::TakeSelectionChanged() {
+    return m_selector.TakeSelectionChanged();
+}
+
+size_t DesktopIconManager::SetSelectiveMode(bool enabled, const std::vector<std::wstring>& keepPatterns,
+                                            std::vector<std::wstring>* rejectedPatterns) {
+    bool wasHiding = m_selective.IsHiding();
+    if (wasHiding && ValidateDesktopWindows()) {
+        m_selective.Restore(m_windows.listView);
+    }
+    
+    size_t rejected = m_selective.SetKeepRules(keepPatterns, rejectedPatterns);
+    bool selective = enabled && m_selective.HasRules();
+    
+    // Both move icons off-screen; selective mode takes over
+    if (selective && m_monitors.IsHidingAny() && ValidateDesktopWindows()) {
+        m_monitors.RestoreAll(m_windows.listView);
+    }
+    
+    // Selective hiding needs the listview itself to be shown
+    if (selective && !m_selectiveMode && ValidateDesktopWindows() && !IsDesktopIconsVisible()) {
+        SetDesktopIconVisibility(true);
+        wasHiding = true;
+    }
+    
+    m_selectiveMode = selective;
+    
+    if (wasHiding && ValidateDesktopWindows()) {
+        SetDesktopIconVisibility(false);
+    }
+    
+    UpdateCurrentState();
+    SaveHiddenIcons();
+    return rejected;
+}
+
+bool DesktopIconManager::IsSelectiveMode() const {
+    return m_selectiveMode;
+}
+
+bool DesktopIconManager::SetMonitorVisibility(const wchar_t* device, bool visible) {
+    TRACE_SPAN("desktop", "SetMonitorVisibility");
+    
+    if (!ValidateDesktopWindows() && !FindDesktopWindows()) {
+        Metrics::ToggleFailuresNotFound.Increment();
+        return false;
+    }
+    
+    // Selective mode would record the off-screen icons as its own
+    if (!visible && (m_selectiveMode || !IsDesktopIconsVisible())) {
+        return false;
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    bool applied = visible ? m_monitors.Show(m_windows.listView, device) : m_monitors.Hide(m_windows.listView, device);
+    m_hitGrid.Invalidate();
+    SaveHiddenIcons();
+    
+    QueryPerformanceCounter(&end);
+    Metrics::MonitorToggleDuration.Observe((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+    return applied;
+}
+
+bool DesktopIconManager::IsMonitorHidden(const wchar_t* device) const {
+    return m_monitors.IsHidden(device);
+}
+
+bool DesktopIconManager::IsHidingMonitors() const {
+    return m_monitors.IsHidingAny();
+}
+
+std::vector<std::wstring> DesktopIconManager::GetHiddenMonitors() const {
+    return m_monitors.GetHiddenDevices();
+}
+
+void DesktopIconManager::InvalidateIconIndex() {
+    m_monitors.InvalidateIndex();
+    m_hitGrid.Invalidate();
+}
+
+bool DesktopIconManager::IsEmptyDesktopAt(POINT screenPoint) {
+    TRACE_SPAN("desktop", "IsEmptyDesktopAt");
+    
+    if (!ValidateDesktopWindows() && !FindDesktopWindows()) {
+        return false;
+    }
+    
+    // Windows in front of the desktop, the taskbar included, get the click
+    HWND hit = WindowFromPoint(screenPoint);
+    if (!hit || (hit != m_windows.listView && hit != m_windows.defView && hit != m_windows.progman &&
+                 hit != GetParent(m_windows.defView))) {
+        return false;
+    }
+    
+    // Nothing to hit while the icons are hidden as a whole; icons hidden by
+    // selective mode or a monitor toggle are off-screen and not in the grid
+    if (!IsWindowVisible(m_windows.listView)) {
+        return true;
+    }
+    
+    if (!m_hitGrid.Prepare(m_windows.listView)) {
+        return false;
+    }
+    
+    POINT client = screenPoint;
+    ScreenToClient(m_windows.listView, &client);
+    return m_hitGrid.HitTest(client) == IconHitGrid::NPOS;
+}
+
+bool DesktopIconManager::CaptureLayout(IconLayout& layout) {
+    if (m_selective.IsHiding() || m_monitors.IsHidingAny() || (!ValidateDesktopWindows() && !FindDesktopWindows())) {
+        return false;
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    bool captured = layout.Capture(m_windows.listView);
+    
+    QueryPerformanceCounter(&end);
+    Metrics::LayoutCaptureDuration.Observe((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+    return captured;
+}
+
+bool DesktopIconManager::RestoreLayout(const IconLayout& layout, size_t* moved) {
+    if (m_selective.IsHiding() || m_monitors.IsHidingAny() || (!ValidateDesktopWindows() && !FindDesktopWindows())) {
+        return false;
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    bool restored = layout.Apply(m_windows.listView, moved);
+    
+    QueryPerformanceCounter(&end);
+    Metrics::LayoutRestoreDuration.Observe((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+    return restored;
+}
+
+bool DesktopIconManager::OpenLayoutStore(const std::wstring& path) {
+    m_layoutTopology = 0;
+    return m_layoutStore.Open(path);
+}
+
+void DesktopIconManager::CloseLayoutStore() {
+    m_layoutStore.Close();
+    m_displayLayout.Clear();
+    m_layoutTopology = 0;
+}
+
+bool DesktopIconManager::IsLayoutStoreOpen() const {
+    return m_layoutStore.IsOpen();
+}
+
+bool DesktopIconManager::OpenLayoutHistory(const std::wstring& path, const LayoutHistory::Retention& retention) {
+    if (m_history.IsOpen()) {
+        m_history.SetRetention(retention);
+        return true;
+    }
+    
+    m_historyCursor = LayoutHistory::NPOS;
+    return m_history.Open(path, retention);
+}
+
+void DesktopIconManager::CloseLayoutHistory() {
+    m_history.Close();
+    m_historyLayout.Clear();
+    m_historyCursor = LayoutHistory::NPOS;
+}
+
+bool DesktopIconManager::IsLayoutHistoryOpen() const {
+    return m_history.IsOpen();
+}
+
+bool DesktopIconManager::RecordLayout() {
+    TRACE_SPAN("desktop", "RecordLayout");
+    
+    if ((!m_layoutStore.IsOpen() && !m_history.IsOpen()) || !CaptureLayout(m_displayLayout)) {
+        return false;
+    }
+    
+    bool recorded = true;
+    if (m_layoutStore.IsOpen()) {
+        DisplayTopology topology = DisplayTopology::Capture();
+        if (m_layoutStore.Store(topology.hash, m_displayLayout)) {
+            m_layoutTopology = topology.hash;
+        } else {
+            recorded = false;
+        }
+    }
+    
+    if (m_history.IsOpen()) {
+        // Icons moved by undo settle exactly where the snapshot had them
+        bool undone = m_historyCursor != LayoutHistory::NPOS && m_displayLayout.Equals(m_historyLayout);
+        if (!undone) {
+            m_history.Append(m_displayLayout, LayoutHistory::Now());
+            m_historyCursor = LayoutHistory::NPOS;
+            m_historyLayout.Clear();
+        }
+    }
+    
+    return recorded;
+}
+
+bool DesktopIconManager::UndoLayoutChange() {
+    size_t current = m_historyCursor != LayoutHistory::NPOS ? m_historyCursor : m_history.GetCount() - 1;
+    if (m_history.GetCount() == 0 || current == 0) {
+        return false;
+    }
+    
+    return RestoreHistory(current - 1);
+}
+
+bool DesktopIconManager::RestoreLayoutAt(uint64_t time) {
+    size_t index = m_history.Seek(time);
+    if (index == LayoutHistory::NPOS) {
+        return false;
+    }
+    
+    return RestoreHistory(index);
+}
+
+bool DesktopIconManager::RestoreHistory(size_t index) {
+    TRACE_SPAN("desktop", "RestoreHistory");
+    
+    if (!m_history.Load(index, m_historyLayout) || !RestoreLayout(m_historyLayout)) {
+        m_historyLayout.Clear();
+        return false;
+    }
+    
+    m_historyCursor = index;
+    return true;
+}
+
+bool DesktopIconManager::RestoreDisplayLayout(size_t* moved) {
+    TRACE_SPAN("desktop", "RestoreDisplayLayout");
+    
+    if (moved) {
+        *moved = 0;
+    }
+    
+    if (!m_layoutStore.IsOpen()) {
+        return false;
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    DisplayTopology topology = DisplayTopology::Capture();
+    if (topology.hash == m_layoutTopology) {
+        return true;
+    }
+    
+    bool found = m_layoutStore.Lookup(topology.hash, m_displayLayout);
+    
+    QueryPerformanceCounter(&end);
+    Metrics::LayoutLookupDuration.Observe((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+    
+    // Remembered even without a layout, so the first capture on this setup
+    // is not mistaken for a change
+    m_layoutTopology = topology.hash;
+    if (!found) {
+        return false;
+    }
+    
+    // Only icons that are out of place are moved
+    Metrics::LayoutDisplayRestores.Increment();
+    return RestoreLayout(m_displayLayout, moved);
+}
+
+HWND DesktopIconManager::GetListViewWindow() const {
+    return m_windows.listView;
+}
+
+size_t DesktopIconManager::GetMemoryUsage() const {
+    size_t bytes = sizeof(*this) + m_selective.GetMemoryUsage() + m_monitors.GetMemoryUsage() + m_hitGrid.GetMemoryUsage() +
+                   m_displayLayout.GetMemoryUsage() + m_history.GetMemoryUsage() + m_historyLayout.GetMemoryUsage() +
+                   m_hiddenIcons.GetMemoryUsage();
+    for (const auto& strategy : m_strategies) {
+        bytes += sizeof(*strategy);
+    }
+    return bytes;
+}
+
 bool DesktopIconManager::ToggleDesktopIcons() {
+    TRACE_SPAN("desktop", "ToggleDesktopIcons");
+    ALLOCATION_SCOPE(Desktop);
+    
     if (!ValidateDesktopWindows()) {
         if (!FindDesktopWindows()) {
+            Metrics::ToggleFailuresNotFound.Increment();
             return false;
         }
     }
@@ -42,6 +426,7 @@ bool DesktopIconManager::ToggleDesktopIcons() {
 bool DesktopIconManager::ShowDesktopIcons() {
     if (!ValidateDesktopWindows()) {
         if (!FindDesktopWindows()) {
+            Metrics::ToggleFailuresNotFound.Increment();
             return false;
         }
     }
@@ -52,6 +437,7 @@ bool DesktopIconManager::ShowDesktopIcons() {
 bool DesktopIconManager::HideDesktopIcons() {
     if (!ValidateDesktopWindows()) {
         if (!FindDesktopWindows()) {
+            Metrics::ToggleFailuresNotFound.Increment();
             return false;
         }
     }
@@ -64,12 +450,21 @@ IconState DesktopIconManager::GetCurrentState() const {
 }
 
 bool DesktopIconManager::IsDesktopIconsVisible() const {
-    if (!m_desktopListView || !IsWindow(m_desktopListView)) {
+    if (m_selective.IsHiding()) {
+        return false;
+    }
+    
+    if (!m_windows.listView || !IsWindow(m_windows.listView)) {
         return true; // Default to visible if we can't determine
     }
     
-    LONG style = GetWindowLong(m_desktopListView, GWL_STYLE);
-    return (style & WS_VISIBLE) != 0;
+    // Strategies hide different windows; the icons show only if both are visible
+    if ((GetWindowLong(m_windows.listView, GWL_STYLE) & WS_VISIBLE) == 0) {
+        return false;
+    }
+    
+    return !m_windows.defView || !IsWindow(m_windows.defView) ||
+           (GetWindowLong(m_windows.defView, GWL_STYLE) & WS_VISIBLE) != 0;
 }
 
 HWND DesktopIconManager::FindDesktopListView() {
@@ -104,67 +499,131 @@ HWND DesktopIconManager::FindDesktopListView() {
 }
 
 bool DesktopIconManager::SetDesktopIconVisibility(bool visible) {
-    if (!m_desktopListView || !IsWindow(m_desktopListView)) {
+    TRACE_SPAN("desktop", "SetDesktopIconVisibility");
+    
+    if (!m_windows.listView || !IsWindow(m_windows.listView)) {
+        Metrics::ToggleFailuresInvalidWindow.Increment();
         return false;
     }
     
-    // Show or hide the desktop listview
-    int showCmd = visible ? SW_SHOW : SW_HIDE;
-    ShowWindow(m_desktopListView, showCmd);
+    // Already there; also keeps no-op restores out of the calibration
+    if (IsDesktopIconsVisible() == visible) {
+        UpdateCurrentState();
+        return true;
+    }
     
-    // Force a refresh of the desktop
-    RefreshDesktop();
+    if (m_selectiveMode) {
+        return SetSelectiveVisibility(visible);
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    // Calibration measures the strategies in turn; otherwise the selected
+    // one goes first and the rest are fallbacks, fastest measured first
+    size_t selected = m_selector.IsCalibrating() ? StrategySelector::NPOS : m_selector.GetSelected();
+    size_t index = m_selector.Apply(visible, [this, visible](size_t strategy, uint64_t& latencyUs) {
+        return TryStrategy(strategy, visible, latencyUs);
+    });
     
-    // Update our state
     UpdateCurrentState();
     
+    if (index == StrategySelector::NPOS) {
+        return false;
+    }
+    
+    if (selected != StrategySelector::NPOS && index != selected) {
+        Metrics::ToggleStrategyFailovers.Increment();
+    }
+    
+    QueryPerformanceCounter(&end);
+    Metrics::TogglesTotal.Increment();
+    Metrics::ToggleDuration.Observe((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+    Metrics::IconsVisible.Set(m_currentState == IconState::Visible ? 1 : 0);
+    
     return true;
 }
 
-bool DesktopIconManager::RefreshDesktop() {
-    // Refresh the desktop to ensure changes are visible
-    InvalidateRect(nullptr, nullptr, TRUE);
+bool DesktopIconManager::SetSelectiveVisibility(bool visible) {
+    TRACE_SPAN("desktop", "SetSelectiveVisibility");
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
     
-    // Send a message to refresh the desktop
-    HWND desktop = GetDesktopWindow();
-    if (desktop) {
-        InvalidateRect(desktop, nullptr, TRUE);
-        UpdateWindow(desktop);
+    bool applied = visible ? m_selective.Restore(m_windows.listView) : m_selective.Hide(m_windows.listView);
+    UpdateCurrentState();
+    SaveHiddenIcons();
+    
+    if (!applied) {
+        Metrics::ToggleFailuresSelective.Increment();
+        return false;
     }
     
-    // Also try to refresh the shell
-    SHChangeNotify(SHCNE_ASSOCCHANGED, SHCNF_IDLIST, nullptr, nullptr);
+    QueryPerformanceCounter(&end);
+    Metrics::TogglesTotal.Increment();
+    Metrics::ToggleDuration.Observe((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+    Metrics::IconsVisible.Set(m_currentState == IconState::Visible ? 1 : 0);
     
     return true;
 }
 
+bool DesktopIconManager::TryStrategy(size_t index, bool visible, uint64_t& latencyUs) {
+    IToggleStrategy* strategy = m_strategies[index].get();
+    if (!strategy->IsAvailable(m_windows)) {
+        return false;
+    }
+    
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    
+    // Some shells accept a change and ignore it, so check the result too
+    bool applied = strategy->Apply(m_windows, visible) && IsDesktopIconsVisible() == visible;
+    
+    QueryPerformanceCounter(&end);
+    latencyUs = (end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart;
+    
+    if (!applied) {
+        Metrics::ToggleStrategyFailures.Increment();
+    }
+    
+    return applied;
+}
+
 bool DesktopIconManager::FindDesktopWindows() {
-    m_progman = FindWindow(L"Progman", L"Program Manager");
-    if (!m_progman) {
+    TRACE_SPAN("desktop", "FindDesktopWindows");
+    ALLOCATION_SCOPE(Desktop);
+    
+    m_windows = DesktopWindows();
+    
+    m_windows.progman = FindWindow(L"Progman", L"Program Manager");
+    if (!m_windows.progman) {
         return false;
     }
     
-    m_desktopListView = FindDesktopListView();
-    if (!m_desktopListView) {
+    m_windows.listView = FindDesktopListView();
+    if (!m_windows.listView) {
         return false;
     }
     
     // Find the SHELLDLL_DefView window
-    HWND parent = GetParent(m_desktopListView);
+    HWND parent = GetParent(m_windows.listView);
     if (parent) {
         wchar_t className[256];
         if (GetClassName(parent, className, 256) && 
             wcscmp(className, L"SHELLDLL_DefView") == 0) {
-            m_shelldll_defview = parent;
+            m_windows.defView = parent;
         }
     }
     
-    return m_desktopListView != nullptr;
+    return m_windows.listView != nullptr;
 }
 
 bool DesktopIconManager::ValidateDesktopWindows() {
-    return m_desktopListView && IsWindow(m_desktopListView) &&
-           m_progman && IsWindow(m_progman);
+    return m_windows.listView && IsWindow(m_windows.listView) &&
+           m_windows.progman && IsWindow(m_windows.progman);
 }
 
 void DesktopIconManager::UpdateCurrentState() {
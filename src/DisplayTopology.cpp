@@ -0,0 +1,81 @@
+#include "DisplayTopology.h"
+#include "Tracer.h"
+#include <shellscalingapi.h>
+#include <algorithm>
+
+namespace {
+    // More than anyone connects; the rest would not change the hash much
+    constexpr size_t MAX_MONITORS = 16;
+
+    struct Monitor {
+        RECT rect;
+        UINT dpi;
+        bool primary;
+    };
+
+    struct MonitorList {
+        Monitor monitors[MAX_MONITORS];
+        size_t count;
+    };
+
+    BOOL CALLBACK CollectMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM context) {
+        MonitorList* list = reinterpret_cast<MonitorList*>(context);
+        if (list->count == MAX_MONITORS) {
+            return FALSE;
+        }
+
+        MONITORINFO info = {};
+        info.cbSize = sizeof(info);
+        if (!GetMonitorInfo(monitor, &info)) {
+            return TRUE;
+        }
+
+        UINT dpiX = 0, dpiY = 0;
+        if (FAILED(GetDpiForMonitor(monitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY))) {
+            dpiX = 0;
+        }
+
+        Monitor& entry = list->monitors[list->count++];
+        entry.rect = info.rcMonitor;
+        entry.dpi = dpiX;
+        entry.primary = (info.dwFlags & MONITORINFOF_PRIMARY) != 0;
+        return TRUE;
+    }
+
+    void HashValue(uint64_t& hash, int64_t value) {
+        // FNV-1a, one byte at a time
+        for (int i = 0; i < 8; i++) {
+            hash ^= static_cast<uint8_t>(value >> (i * 8));
+            hash *= 1099511628211ull;
+        }
+    }
+}
+
+DisplayTopology DisplayTopology::Capture() {
+    TRACE_SPAN("layout", "DisplayTopology::Capture");
+
+    MonitorList list;
+    list.count = 0;
+    EnumDisplayMonitors(nullptr, nullptr, CollectMonitor, reinterpret_cast<LPARAM>(&list));
+
+    std::sort(list.monitors, list.monitors + list.count, [](const Monitor& a, const Monitor& b) {
+        return a.rect.left != b.rect.left ? a.rect.left < b.rect.left : a.rect.top < b.rect.top;
+    });
+
+    uint64_t hash = 14695981039346656037ull;
+    HashValue(hash, static_cast<int64_t>(list.count));
+    for (size_t i = 0; i < list.count; i++) {
+        const Monitor& monitor = list.monitors[i];
+        HashValue(hash, monitor.rect.left);
+        HashValue(hash, monitor.rect.top);
+        HashValue(hash, monitor.rect.right - monitor.rect.left);
+        HashValue(hash, monitor.rect.bottom - monitor.rect.top);
+        HashValue(hash, monitor.dpi);
+        HashValue(hash, monitor.primary ? 1 : 0);
+    }
+
+    DisplayTopology topology;
+    topology.hash = hash;
+    topology.monitorCount = list.count;
+    return topology;
+}
@@ -1,4 +1,6 @@
 #include "HotkeyManager.h"
+#include "Tracer.h"
+#include "Metrics.h"
 
 HotkeyManager::HotkeyManager()
     : m_targetWindow(nullptr)
@@ -38,6 +40,8 @@ void HotkeyManager::Cleanup() {
 }
 
 bool HotkeyManager::RegisterHotkey(const HotkeyConfig& config) {
+    TRACE_SPAN("hotkey", "RegisterHotkey");
+    
     if (!m_initialized || !IsValidHotkey(config)) {
         return false;
     }
@@ -46,16 +50,20 @@ bool HotkeyManager::RegisterHotkey(const HotkeyConfig& config) {
     UnregisterHotkey();
     
     m_currentConfig = config;
+    Metrics::HotkeyRegistrations.Increment();
     
     if (RegisterSystemHotkey()) {
         m_hotkeyRegistered = true;
         return true;
     }
     
+    Metrics::HotkeyRegistrationFailures.Increment();
     return false;
 }
 
 bool HotkeyManager::UnregisterHotkey() {
+    TRACE_SPAN("hotkey", "UnregisterHotkey");
+    
     if (!m_hotkeyRegistered) {
         return true;
     }
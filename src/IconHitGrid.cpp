@@ -0,0 +1,199 @@
+#include "IconHitGrid.h"
+#include "RemoteListView.h"
+#include "Tracer.h"
+#include <algorithm>
+
+IconHitGrid::IconHitGrid()
+    : m_bounds{}
+    , m_iconSize{ 1, 1 }
+    , m_cellSize{ 1, 1 }
+    , m_columns(0)
+    , m_rows(0)
+    , m_stale(true) {
+}
+
+IconHitGrid::~IconHitGrid() {
+}
+
+bool IconHitGrid::Prepare(HWND listView) {
+    if (!listView) {
+        return false;
+    }
+
+    // A count change is seen even when the move hook is not running
+    size_t count = static_cast<size_t>(SendMessage(listView, LVM_GETITEMCOUNT, 0, 0));
+    if (!m_stale && count == m_icons.size()) {
+        return true;
+    }
+
+    RemoteListView remote;
+    if (!remote.Open(listView)) {
+        return false;
+    }
+
+    return Refresh(remote, listView);
+}
+
+bool IconHitGrid::Refresh(RemoteListView& remote, HWND listView) {
+    TRACE_SPAN("desktop", "IconHitGrid::Refresh");
+
+    RECT client;
+    if (!GetClientRect(listView, &client)) {
+        return false;
+    }
+
+    SIZE spacing = remote.GetItemSpacing();
+    int count = std::max(remote.GetItemCount(), 0);
+    if (static_cast<size_t>(count) != m_icons.size() || !EqualRect(&client, &m_bounds) ||
+        spacing.cx != m_iconSize.cx || spacing.cy != m_iconSize.cy) {
+        Reset(client, spacing, static_cast<size_t>(count));
+    }
+
+    std::unique_ptr<POINT[]> positions(new POINT[RemoteListView::BATCH_SIZE]);
+    for (int first = 0; first < count; first += static_cast<int>(RemoteListView::BATCH_SIZE)) {
+        size_t batch = std::min(RemoteListView::BATCH_SIZE, static_cast<size_t>(count - first));
+        size_t read = remote.ReadPositions(first, positions.get(), batch);
+        if (read < batch) {
+            m_stale = true;
+            return false;
+        }
+
+        for (size_t i = 0; i < read; i++) {
+            SetPosition(static_cast<size_t>(first) + i, positions[i]);
+        }
+    }
+
+    m_stale = false;
+    return true;
+}
+
+void IconHitGrid::Invalidate() {
+    m_stale = true;
+}
+
+void IconHitGrid::Reset(const RECT& bounds, SIZE iconSize, size_t count) {
+    m_bounds = bounds;
+    m_iconSize.cx = std::max<LONG>(iconSize.cx, 1);
+    m_iconSize.cy = std::max<LONG>(iconSize.cy, 1);
+    m_cellSize = m_iconSize;
+
+    LONG width = std::max<LONG>(bounds.right - bounds.left, 1);
+    LONG height = std::max<LONG>(bounds.bottom - bounds.top, 1);
+    for (;;) {
+        m_columns = static_cast<int>((width + m_cellSize.cx - 1) / m_cellSize.cx);
+        m_rows = static_cast<int>((height + m_cellSize.cy - 1) / m_cellSize.cy);
+        if (static_cast<size_t>(m_columns) * static_cast<size_t>(m_rows) <= MAX_CELLS) {
+            break;
+        }
+
+        // Larger cells still hold every icon that starts in them
+        m_cellSize.cx *= 2;
+        m_cellSize.cy *= 2;
+    }
+
+    m_heads.assign(static_cast<size_t>(m_columns) * static_cast<size_t>(m_rows), NONE);
+    m_icons.assign(count, Icon{ { 0, 0 }, NONE, NONE, NONE });
+    m_stale = true;
+}
+
+void IconHitGrid::SetPosition(size_t index, POINT position) {
+    if (index >= m_icons.size()) {
+        return;
+    }
+
+    // Moving within a cell needs no relinking
+    Icon& icon = m_icons[index];
+    uint32_t cell = CellOf(position);
+    icon.position = position;
+    if (cell == icon.cell) {
+        return;
+    }
+
+    uint32_t item = static_cast<uint32_t>(index);
+    Unlink(item);
+    Link(item, cell);
+}
+
+size_t IconHitGrid::HitTest(POINT point) const {
+    if (point.x < m_bounds.left || point.x >= m_bounds.right ||
+        point.y < m_bounds.top || point.y >= m_bounds.bottom) {
+        return NPOS;
+    }
+
+    int column = static_cast<int>((point.x - m_bounds.left) / m_cellSize.cx);
+    int row = static_cast<int>((point.y - m_bounds.top) / m_cellSize.cy);
+
+    for (int r = row; r >= row - 1 && r >= 0; r--) {
+        for (int c = column; c >= column - 1 && c >= 0; c--) {
+            uint32_t item = m_heads[static_cast<size_t>(r) * static_cast<size_t>(m_columns) + static_cast<size_t>(c)];
+            for (; item != NONE; item = m_icons[item].next) {
+                const POINT& position = m_icons[item].position;
+                if (point.x >= position.x && point.x < position.x + m_iconSize.cx &&
+                    point.y >= position.y && point.y < position.y + m_iconSize.cy) {
+                    return item;
+                }
+            }
+        }
+    }
+
+    return NPOS;
+}
+
+size_t IconHitGrid::GetCount() const {
+    return m_icons.size();
+}
+
+size_t IconHitGrid::GetMemoryUsage() const {
+    return m_heads.capacity() * sizeof(uint32_t) + m_icons.capacity() * sizeof(Icon);
+}
+
+uint32_t IconHitGrid::CellOf(POINT position) const {
+    // An icon starting just left of or above the client area still covers
+    // part of it and goes into the first column or row; icons further out,
+    // such as those moved off-screen, are not in the grid
+    if (position.x < m_bounds.left - m_iconSize.cx || position.x >= m_bounds.right ||
+        position.y < m_bounds.top - m_iconSize.cy || position.y >= m_bounds.bottom) {
+        return NONE;
+    }
+
+    LONG column = std::max<LONG>(position.x - m_bounds.left, 0) / m_cellSize.cx;
+    LONG row = std::max<LONG>(position.y - m_bounds.top, 0) / m_cellSize.cy;
+    return static_cast<uint32_t>(row * m_columns + column);
+}
+
+void IconHitGrid::Link(uint32_t index, uint32_t cell) {
+    Icon& icon = m_icons[index];
+    icon.cell = cell;
+    icon.prev = NONE;
+    icon.next = NONE;
+    if (cell == NONE) {
+        return;
+    }
+
+    icon.next = m_heads[cell];
+    if (icon.next != NONE) {
+        m_icons[icon.next].prev = index;
+    }
+    m_heads[cell] = index;
+}
+
+void IconHitGrid::Unlink(uint32_t index) {
+    Icon& icon = m_icons[index];
+    if (icon.cell == NONE) {
+        return;
+    }
+
+    if (icon.prev != NONE) {
+        m_icons[icon.prev].next = icon.next;
+    } else {
+        m_heads[icon.cell] = icon.next;
+    }
+
+    if (icon.next != NONE) {
+        m_icons[icon.next].prev = icon.prev;
+    }
+
+    icon.cell = NONE;
+    icon.prev = NONE;
+    icon.next = NONE;
+}
@@ -0,0 +1,324 @@
+#include "IconLayout.h"
+#include "RemoteListView.h"
+#include "Tracer.h"
+#include <algorithm>
+
+namespace {
+    constexpr size_t HEADER_SIZE = 20;
+    constexpr size_t ENTRY_SIZE = 16;
+    constexpr size_t CHECKSUM_OFFSET = 16;
+
+    // Far more than any desktop; guards against reading garbage
+    constexpr LONGLONG MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+    bool NameLess(const IconLayout::Entry& a, const IconLayout::Entry& b) {
+        return a.name < b.name;
+    }
+
+    void PutU16(uint8_t* p, uint16_t value) {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void PutU32(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+        p[2] = static_cast<uint8_t>(value >> 16);
+        p[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    uint16_t GetU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t GetU32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) |
+               (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) |
+               (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint32_t Fnv1a(const uint8_t* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+}
+
+IconLayout::IconLayout() {
+}
+
+IconLayout::~IconLayout() {
+}
+
+bool IconLayout::Capture(HWND listView) {
+    TRACE_SPAN("layout", "Capture");
+
+    RemoteListView remote;
+    if (!remote.Open(listView)) {
+        return false;
+    }
+
+    std::unique_ptr<RemoteListView::Item[]> items(new RemoteListView::Item[RemoteListView::BATCH_SIZE]);
+    int count = remote.GetItemCount();
+
+    m_entries.clear();
+    m_entries.reserve(static_cast<size_t>(count));
+
+    for (int first = 0; first < count; first += static_cast<int>(RemoteListView::BATCH_SIZE)) {
+        size_t batch = std::min(RemoteListView::BATCH_SIZE, static_cast<size_t>(count - first));
+        size_t read = remote.ReadItems(first, items.get(), batch);
+        if (read < batch) {
+            return false;
+        }
+
+        for (size_t i = 0; i < read; i++) {
+            Add(items[i].name, items[i].position);
+        }
+    }
+
+    Sort();
+    return true;
+}
+
+bool IconLayout::Apply(HWND listView, size_t* moved) const {
+    TRACE_SPAN("layout", "Apply");
+
+    if (moved) {
+        *moved = 0;
+    }
+
+    if ((GetWindowLong(listView, GWL_STYLE) & LVS_AUTOARRANGE) != 0) {
+        return false;
+    }
+
+    RemoteListView remote;
+    if (!remote.Open(listView)) {
+        return false;
+    }
+
+    std::unique_ptr<RemoteListView::Item[]> items(new RemoteListView::Item[RemoteListView::BATCH_SIZE]);
+    std::vector<bool> used(m_entries.size(), false);
+    int count = remote.GetItemCount();
+    size_t moves = 0;
+    bool complete = true;
+
+    // One repaint for the whole layout instead of one per icon
+    remote.SetRedraw(false);
+
+    for (int first = 0; first < count; first += static_cast<int>(RemoteListView::BATCH_SIZE)) {
+        size_t batch = std::min(RemoteListView::BATCH_SIZE, static_cast<size_t>(count - first));
+        size_t read = remote.ReadItems(first, items.get(), batch);
+
+        for (size_t i = 0; i < read; i++) {
+            Entry key = { items[i].name, {} };
+            auto range = std::equal_range(m_entries.begin(), m_entries.end(), key, NameLess);
+
+            for (auto it = range.first; it != range.second; ++it) {
+                size_t slot = static_cast<size_t>(it - m_entries.begin());
+                if (used[slot]) {
+                    continue;
+                }
+
+                used[slot] = true;
+                if (items[i].position.x != it->position.x || items[i].position.y != it->position.y) {
+                    if (remote.MoveItem(first + static_cast<int>(i), it->position)) {
+                        moves++;
+                    } else {
+                        complete = false;
+                    }
+                }
+                break;
+            }
+        }
+
+        if (read < batch) {
+            complete = false;
+            break;
+        }
+    }
+
+    // Sends the queued moves
+    if (!remote.SetRedraw(true)) {
+        complete = false;
+    }
+
+    if (moved) {
+        *moved = moves;
+    }
+    return complete;
+}
+
+void IconLayout::Add(const wchar_t* name, POINT position) {
+    m_entries.push_back({ name, position });
+}
+
+void IconLayout::Sort() {
+    // Stable, so equal names keep their listview order
+    std::stable_sort(m_entries.begin(), m_entries.end(), NameLess);
+}
+
+void IconLayout::Clear() {
+    m_entries = std::vector<Entry>();
+}
+
+bool IconLayout::IsEmpty() const {
+    return m_entries.empty();
+}
+
+size_t IconLayout::GetCount() const {
+    return m_entries.size();
+}
+
+const IconLayout::Entry& IconLayout::GetEntry(size_t index) const {
+    return m_entries[index];
+}
+
+size_t IconLayout::GetMemoryUsage() const {
+    size_t bytes = m_entries.capacity() * sizeof(Entry);
+    for (const Entry& entry : m_entries) {
+        bytes += entry.name.capacity() * sizeof(wchar_t);
+    }
+    return bytes;
+}
+
+bool IconLayout::Equals(const IconLayout& other) const {
+    if (m_entries.size() != other.m_entries.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const Entry& a = m_entries[i];
+        const Entry& b = other.m_entries[i];
+        if (a.position.x != b.position.x || a.position.y != b.position.y || a.name != b.name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void IconLayout::Serialize(std::vector<uint8_t>& buffer) const {
+    size_t nameChars = 0;
+    for (const Entry& entry : m_entries) {
+        nameChars += entry.name.size();
+    }
+
+    buffer.assign(HEADER_SIZE + m_entries.size() * ENTRY_SIZE + nameChars * 2, 0);
+    uint8_t* header = buffer.data();
+    uint8_t* entryData = header + HEADER_SIZE;
+    uint8_t* nameData = entryData + m_entries.size() * ENTRY_SIZE;
+
+    PutU32(header, FILE_MAGIC);
+    PutU16(header + 4, FILE_VERSION);
+    PutU16(header + 6, 0);
+    PutU32(header + 8, static_cast<uint32_t>(m_entries.size()));
+    PutU32(header + 12, static_cast<uint32_t>(nameChars));
+
+    uint32_t nameOffset = 0;
+    for (const Entry& entry : m_entries) {
+        PutU32(entryData, static_cast<uint32_t>(entry.position.x));
+        PutU32(entryData + 4, static_cast<uint32_t>(entry.position.y));
+        PutU32(entryData + 8, nameOffset);
+        PutU32(entryData + 12, static_cast<uint32_t>(entry.name.size()));
+        entryData += ENTRY_SIZE;
+
+        for (wchar_t c : entry.name) {
+            PutU16(nameData, static_cast<uint16_t>(c));
+            nameData += 2;
+        }
+        nameOffset += static_cast<uint32_t>(entry.name.size());
+    }
+
+    PutU32(header + CHECKSUM_OFFSET, Fnv1a(header + HEADER_SIZE, buffer.size() - HEADER_SIZE));
+}
+
+bool IconLayout::Deserialize(const uint8_t* data, size_t size) {
+    if (size < HEADER_SIZE || GetU32(data) != FILE_MAGIC || GetU16(data + 4) != FILE_VERSION) {
+        return false;
+    }
+
+    uint64_t entryCount = GetU32(data + 8);
+    uint64_t nameChars = GetU32(data + 12);
+    if (HEADER_SIZE + entryCount * ENTRY_SIZE + nameChars * 2 != size ||
+        GetU32(data + CHECKSUM_OFFSET) != Fnv1a(data + HEADER_SIZE, size - HEADER_SIZE)) {
+        return false;
+    }
+
+    const uint8_t* entryData = data + HEADER_SIZE;
+    const uint8_t* nameData = entryData + entryCount * ENTRY_SIZE;
+
+    std::vector<Entry> entries;
+    entries.reserve(static_cast<size_t>(entryCount));
+    for (uint64_t i = 0; i < entryCount; i++, entryData += ENTRY_SIZE) {
+        uint64_t offset = GetU32(entryData + 8);
+        uint64_t length = GetU32(entryData + 12);
+        if (offset + length > nameChars) {
+            return false;
+        }
+
+        Entry entry;
+        entry.position.x = static_cast<LONG>(static_cast<int32_t>(GetU32(entryData)));
+        entry.position.y = static_cast<LONG>(static_cast<int32_t>(GetU32(entryData + 4)));
+        entry.name.resize(static_cast<size_t>(length));
+        for (uint64_t c = 0; c < length; c++) {
+            entry.name[static_cast<size_t>(c)] = static_cast<wchar_t>(GetU16(nameData + (offset + c) * 2));
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    m_entries = std::move(entries);
+    Sort();
+    return true;
+}
+
+bool IconLayout::Save(const std::wstring& path) const {
+    TRACE_SPAN("layout", "Save");
+
+    std::vector<uint8_t> buffer;
+    Serialize(buffer);
+
+    // A crash mid-write must not destroy the previous layout
+    std::wstring tempPath = path + L".tmp";
+    HANDLE file = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    DWORD written = 0;
+    bool success = WriteFile(file, buffer.data(), static_cast<DWORD>(buffer.size()), &written, nullptr) &&
+                   written == buffer.size();
+    CloseHandle(file);
+
+    if (!success || !MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFile(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool IconLayout::Load(const std::wstring& path) {
+    TRACE_SPAN("layout", "Load");
+
+    HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(HEADER_SIZE) || size.QuadPart > MAX_FILE_SIZE) {
+        CloseHandle(file);
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(static_cast<size_t>(size.QuadPart));
+    DWORD read = 0;
+    bool success = ReadFile(file, buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr) &&
+                   read == buffer.size();
+    CloseHandle(file);
+
+    return success && Deserialize(buffer.data(), buffer.size());
+}
@@ -0,0 +1,129 @@
+#include "IconSchedule.h"
+
+namespace {
+    constexpr uint32_t MINUTES_PER_DAY = 24 * 60;
+    constexpr ULONGLONG MS_PER_MINUTE = 60 * 1000;
+
+    // "HH:MM", advancing text past it; "24:00" is the end of the day (1440)
+    bool ParseTime(const wchar_t*& text, uint16_t& minutes) {
+        uint32_t hour = 0, minute = 0;
+        int digits = 0;
+        for (; *text >= L'0' && *text <= L'9' && digits < 2; text++, digits++) {
+            hour = hour * 10 + static_cast<uint32_t>(*text - L'0');
+        }
+        if (digits == 0 || *text++ != L':') {
+            return false;
+        }
+
+        digits = 0;
+        for (; *text >= L'0' && *text <= L'9' && digits < 2; text++, digits++) {
+            minute = minute * 10 + static_cast<uint32_t>(*text - L'0');
+        }
+        if (digits != 2 || hour > 24 || minute > 59 || (hour == 24 && minute != 0)) {
+            return false;
+        }
+
+        minutes = static_cast<uint16_t>(hour * 60 + minute);
+        return true;
+    }
+
+    bool IsInside(const IconSchedule::Window& window, uint32_t minute) {
+        if (window.start <= window.end) {
+            return minute >= window.start && minute < window.end;
+        }
+        return minute >= window.start || minute < window.end;
+    }
+}
+
+IconSchedule::IconSchedule() {
+}
+
+IconSchedule::~IconSchedule() {
+}
+
+size_t IconSchedule::SetWindows(const std::vector<std::wstring>& specs, std::vector<std::wstring>* rejectedSpecs) {
+    m_windows.clear();
+
+    size_t rejected = 0;
+    for (const std::wstring& spec : specs) {
+        Window window;
+        if (Parse(spec.c_str(), window)) {
+            m_windows.push_back(window);
+        } else {
+            rejected++;
+            if (rejectedSpecs) {
+                rejectedSpecs->push_back(spec);
+            }
+        }
+    }
+
+    return rejected;
+}
+
+void IconSchedule::Clear() {
+    m_windows = std::vector<Window>();
+}
+
+bool IconSchedule::IsEmpty() const {
+    return m_windows.empty();
+}
+
+size_t IconSchedule::GetCount() const {
+    return m_windows.size();
+}
+
+bool IconSchedule::IsHideTime(const SYSTEMTIME& local) const {
+    uint32_t minute = local.wHour * 60u + local.wMinute;
+    for (const Window& window : m_windows) {
+        if (IsInside(window, minute)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ULONGLONG IconSchedule::GetNextEdgeDelay(size_t index, const SYSTEMTIME& local) const {
+    const Window& window = m_windows[index];
+    uint32_t minute = local.wHour * 60u + local.wMinute;
+    uint32_t edge = IsInside(window, minute) ? window.end : window.start;
+
+    // Counted to the edge's first second, from the current second
+    uint32_t minutes = (edge + MINUTES_PER_DAY - minute) % MINUTES_PER_DAY;
+    if (minutes == 0) {
+        minutes = MINUTES_PER_DAY;
+    }
+
+    ULONGLONG intoMinute = local.wSecond * 1000ull + local.wMilliseconds;
+    return minutes * MS_PER_MINUTE - intoMinute;
+}
+
+bool IconSchedule::Parse(const wchar_t* text, Window& window) {
+    while (*text == L' ') {
+        text++;
+    }
+    // "24:00" only ends a window
+    if (!ParseTime(text, window.start) || window.start == MINUTES_PER_DAY) {
+        return false;
+    }
+
+    while (*text == L' ') {
+        text++;
+    }
+    if (*text++ != L'-') {
+        return false;
+    }
+
+    while (*text == L' ') {
+        text++;
+    }
+    if (!ParseTime(text, window.end)) {
+        return false;
+    }
+
+    while (*text == L' ') {
+        text++;
+    }
+
+    // An empty window would never hide anything
+    return *text == L'\0' && window.start != window.end;
+}
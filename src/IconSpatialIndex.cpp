@@ -0,0 +1,129 @@
+#include "IconSpatialIndex.h"
+#include "RemoteListView.h"
+#include "Tracer.h"
+#include <algorithm>
+
+namespace {
+    struct MonitorList {
+        std::vector<IconSpatialIndex::Monitor>* monitors;
+        POINT origin; // Screen position of the listview's client origin
+    };
+
+    BOOL CALLBACK CollectMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM context) {
+        MonitorList* list = reinterpret_cast<MonitorList*>(context);
+
+        MONITORINFOEX info = {};
+        info.cbSize = sizeof(info);
+        if (!GetMonitorInfo(monitor, &info)) {
+            return TRUE;
+        }
+
+        IconSpatialIndex::Monitor entry;
+        wcscpy_s(entry.device, info.szDevice);
+        entry.bounds = info.rcMonitor;
+        OffsetRect(&entry.bounds, -list->origin.x, -list->origin.y);
+        list->monitors->push_back(std::move(entry));
+        return TRUE;
+    }
+}
+
+IconSpatialIndex::IconSpatialIndex()
+    : m_itemCount(0)
+    , m_valid(false) {
+}
+
+IconSpatialIndex::~IconSpatialIndex() {
+}
+
+bool IconSpatialIndex::Build(RemoteListView& remote, HWND listView) {
+    TRACE_SPAN("desktop", "IconSpatialIndex::Build");
+
+    Invalidate();
+    m_monitors.clear();
+
+    // The desktop listview spans the virtual screen, but its client origin
+    // is not necessarily the primary monitor's corner
+    MonitorList list;
+    list.monitors = &m_monitors;
+    list.origin = { 0, 0 };
+    ClientToScreen(listView, &list.origin);
+    EnumDisplayMonitors(nullptr, nullptr, CollectMonitor, reinterpret_cast<LPARAM>(&list));
+
+    SIZE spacing = remote.GetItemSpacing();
+    std::unique_ptr<RemoteListView::Item[]> items(new RemoteListView::Item[RemoteListView::BATCH_SIZE]);
+    int count = remote.GetItemCount();
+
+    for (int first = 0; first < count; first += static_cast<int>(RemoteListView::BATCH_SIZE)) {
+        size_t batch = std::min(RemoteListView::BATCH_SIZE, static_cast<size_t>(count - first));
+        size_t read = remote.ReadItems(first, items.get(), batch);
+        if (read < batch) {
+            return false;
+        }
+
+        for (size_t i = 0; i < read; i++) {
+            POINT center = { items[i].position.x + spacing.cx / 2, items[i].position.y + spacing.cy / 2 };
+            for (Monitor& monitor : m_monitors) {
+                if (PtInRect(&monitor.bounds, center)) {
+                    monitor.items.push_back({ first + static_cast<int>(i), items[i].name, items[i].position });
+                    break;
+                }
+            }
+        }
+    }
+
+    m_itemCount = count;
+    m_valid = true;
+    return true;
+}
+
+void IconSpatialIndex::Invalidate() {
+    m_valid = false;
+}
+
+bool IconSpatialIndex::IsValid(const RemoteListView& remote) const {
+    return m_valid && remote.GetItemCount() == m_itemCount;
+}
+
+size_t IconSpatialIndex::GetMonitorCount() const {
+    return m_monitors.size();
+}
+
+IconSpatialIndex::Monitor& IconSpatialIndex::GetMonitor(size_t index) {
+    return m_monitors[index];
+}
+
+size_t IconSpatialIndex::FindMonitor(const wchar_t* device) const {
+    for (size_t i = 0; i < m_monitors.size(); i++) {
+        if (wcscmp(m_monitors[i].device, device) == 0) {
+            return i;
+        }
+    }
+    return NPOS;
+}
+
+size_t IconSpatialIndex::GetMemoryUsage() const {
+    size_t bytes = m_monitors.capacity() * sizeof(Monitor);
+    for (const Monitor& monitor : m_monitors) {
+        bytes += monitor.items.capacity() * sizeof(Item);
+        for (const Item& item : monitor.items) {
+            bytes += item.name.capacity() * sizeof(wchar_t);
+        }
+    }
+    return bytes;
+}
+
+bool IconSpatialIndex::GetDeviceAt(POINT screenPoint, wchar_t (&device)[DEVICE_NAME_LENGTH]) {
+    HMONITOR monitor = MonitorFromPoint(screenPoint, MONITOR_DEFAULTTONULL);
+    if (!monitor) {
+        return false;
+    }
+
+    MONITORINFOEX info = {};
+    info.cbSize = sizeof(info);
+    if (!GetMonitorInfo(monitor, &info)) {
+        return false;
+    }
+
+    wcscpy_s(device, info.szDevice);
+    return true;
+}
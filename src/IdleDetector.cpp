@@ -0,0 +1,111 @@
+#include "IdleDetector.h"
+
+namespace {
+    // Generic desktop controls: mouse, keyboard
+    constexpr WORD USAGE_PAGE_GENERIC = 0x01;
+    constexpr WORD USAGE_MOUSE = 0x02;
+    constexpr WORD USAGE_KEYBOARD = 0x06;
+
+    // Input between reading the last-input time and the clock can put the
+    // former ahead by a few milliseconds
+    DWORD Elapsed(DWORD now, DWORD lastInput) {
+        return static_cast<LONG>(now - lastInput) > 0 ? now - lastInput : 0;
+    }
+}
+
+IdleDetector::IdleDetector()
+    : m_timeout(0)
+    , m_idle(false)
+    , m_watching(false)
+    , m_wakeups(0) {
+}
+
+IdleDetector::~IdleDetector() {
+    StopInputWatch();
+}
+
+void IdleDetector::SetTimeout(DWORD timeoutMs) {
+    m_timeout = timeoutMs;
+    if (m_timeout == 0) {
+        m_idle = false;
+    }
+}
+
+DWORD IdleDetector::GetTimeout() const {
+    return m_timeout;
+}
+
+bool IdleDetector::IsEnabled() const {
+    return m_timeout != 0;
+}
+
+DWORD IdleDetector::Arm(DWORD now, DWORD lastInput) const {
+    if (m_timeout == 0 || m_idle) {
+        return NO_DEADLINE;
+    }
+
+    DWORD elapsed = Elapsed(now, lastInput);
+    return elapsed >= m_timeout ? 0 : m_timeout - elapsed;
+}
+
+bool IdleDetector::OnDeadline(DWORD now, DWORD lastInput, DWORD& nextDelay) {
+    m_wakeups++;
+
+    if (m_timeout == 0 || m_idle) {
+        nextDelay = NO_DEADLINE;
+        return false;
+    }
+
+    DWORD elapsed = Elapsed(now, lastInput);
+    if (elapsed < m_timeout) {
+        nextDelay = m_timeout - elapsed;
+        return false;
+    }
+
+    m_idle = true;
+    nextDelay = NO_DEADLINE;
+    return true;
+}
+
+bool IdleDetector::OnInput() {
+    if (!m_idle) {
+        return false;
+    }
+
+    m_idle = false;
+    return true;
+}
+
+bool IdleDetector::IsIdle() const {
+    return m_idle;
+}
+
+uint32_t IdleDetector::GetWakeups() const {
+    return m_wakeups;
+}
+
+bool IdleDetector::StartInputWatch(HWND window) {
+    if (m_watching) {
+        return true;
+    }
+
+    RAWINPUTDEVICE devices[2] = {
+        { USAGE_PAGE_GENERIC, USAGE_MOUSE, RIDEV_INPUTSINK, window },
+        { USAGE_PAGE_GENERIC, USAGE_KEYBOARD, RIDEV_INPUTSINK, window }
+    };
+    m_watching = RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE)) != 0;
+    return m_watching;
+}
+
+void IdleDetector::StopInputWatch() {
+    if (!m_watching) {
+        return;
+    }
+
+    RAWINPUTDEVICE devices[2] = {
+        { USAGE_PAGE_GENERIC, USAGE_MOUSE, RIDEV_REMOVE, nullptr },
+        { USAGE_PAGE_GENERIC, USAGE_KEYBOARD, RIDEV_REMOVE, nullptr }
+    };
+    RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE));
+    m_watching = false;
+}
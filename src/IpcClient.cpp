@@ -0,0 +1,156 @@
+#include "IpcClient.h"
+
+IpcClient::IpcClient()
+    : m_pipe(INVALID_HANDLE_VALUE)
+    , m_event(nullptr)
+    , m_nextRequestId(1) {
+}
+
+IpcClient::~IpcClient() {
+    Close();
+}
+
+bool IpcClient::Connect(DWORD timeoutMs) {
+    if (IsConnected()) {
+        return true;
+    }
+    
+    // Only the instance in our own session
+    wchar_t pipeName[Session::MAX_OBJECT_NAME];
+    Session::FormatPipeName(pipeName);
+    
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    
+    if (!m_event) {
+        m_event = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        if (!m_event) {
+            return false;
+        }
+    }
+    
+    for (;;) {
+        // Overlapped, so every read and write can be given up on
+        m_pipe = CreateFile(pipeName, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+        if (m_pipe != INVALID_HANDLE_VALUE) {
+            return true;
+        }
+        
+        DWORD error = GetLastError();
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) {
+            return false;
+        }
+        
+        if (error == ERROR_FILE_NOT_FOUND) {
+            // The running instance holds the mutex but has not created the
+            // pipe yet; it is still starting up
+            Sleep(10);
+        } else if (error == ERROR_PIPE_BUSY) {
+            // All instances busy: wait for one to free up
+            if (!WaitNamedPipe(pipeName, static_cast<DWORD>(deadline - now))) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+}
+
+void IpcClient::Close() {
+    if (m_pipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_pipe);
+        m_pipe = INVALID_HANDLE_VALUE;
+    }
+    if (m_event) {
+        CloseHandle(m_event);
+        m_event = nullptr;
+    }
+}
+
+bool IpcClient::IsConnected() const {
+    return m_pipe != INVALID_HANDLE_VALUE;
+}
+
+bool IpcClient::Transact(const Ipc::Opcode* ops, size_t count, DWORD timeoutMs,
+                         Ipc::Status& status, Ipc::WireState& state) {
+    if (!IsConnected()) {
+        return false;
+    }
+    
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    
+    uint8_t request[Ipc::HEADER_SIZE + Ipc::MAX_REQUEST_PAYLOAD];
+    uint32_t requestId = m_nextRequestId++;
+    size_t size = Ipc::EncodeRequest(request, sizeof(request), requestId, ops, count);
+    if (size == 0 || !WriteAll(request, size, deadline)) {
+        return false;
+    }
+    
+    uint8_t response[Ipc::RESPONSE_FRAME_SIZE];
+    if (!ReadAll(response, sizeof(response), deadline)) {
+        return false;
+    }
+    
+    uint32_t responseId = 0;
+    if (!Ipc::DecodeResponse(response, sizeof(response), responseId, status, state)) {
+        return false;
+    }
+    
+    return responseId == requestId;
+}
+
+bool IpcClient::WriteAll(const uint8_t* data, size_t size, ULONGLONG deadline) {
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = m_event;
+        BOOL started = WriteFile(m_pipe, data, static_cast<DWORD>(size), nullptr, &overlapped);
+        
+        DWORD written = 0;
+        if (!Finish(overlapped, started, deadline, written)) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool IpcClient::ReadAll(uint8_t* data, size_t size, ULONGLONG deadline) {
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = m_event;
+        BOOL started = ReadFile(m_pipe, data, static_cast<DWORD>(size), nullptr, &overlapped);
+        
+        DWORD read = 0;
+        if (!Finish(overlapped, started, deadline, read)) {
+            return false;
+        }
+        data += read;
+        size -= read;
+    }
+    return true;
+}
+
+bool IpcClient::Finish(OVERLAPPED& overlapped, BOOL started, ULONGLONG deadline, DWORD& transferred) {
+    if (!started && GetLastError() != ERROR_IO_PENDING) {
+        Close();
+        return false;
+    }
+    
+    ULONGLONG now = GetTickCount64();
+    DWORD remaining = now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+    if (!started && WaitForSingleObject(m_event, remaining) != WAIT_OBJECT_0) {
+        // Too late; the transfer must be over before its buffer goes away
+        CancelIoEx(m_pipe, &overlapped);
+        GetOverlappedResult(m_pipe, &overlapped, &transferred, TRUE);
+        Close();
+        return false;
+    }
+    
+    if (!GetOverlappedResult(m_pipe, &overlapped, &transferred, FALSE) || transferred == 0) {
+        Close();
+        return false;
+    }
+    return true;
+}
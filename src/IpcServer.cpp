@@ -0,0 +1,537 @@
+#include "IpcServer.h"
+#include "CommandBus.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
+#include <cstring>
+
+namespace {
+    constexpr ULONG_PTR KEY_IO = 0;
+    constexpr ULONG_PTR KEY_COMPLETIONS = 1;
+    constexpr ULONG_PTR KEY_SHUTDOWN = 2;
+    
+    // How long shutdown waits for cancelled I/O to come back
+    constexpr DWORD SHUTDOWN_DRAIN_MS = 1000;
+}
+
+IpcServer::IpcServer()
+    : m_commandBus(nullptr)
+    , m_completionPort(nullptr)
+    , m_firstInstanceCreated(false)
+    , m_stopping(false)
+    , m_initialized(false)
+    , m_publishedState(static_cast<uint8_t>(Ipc::WireState::Unknown)) {
+    
+    m_pipeName[0] = L'\0';
+}
+
+IpcServer::~IpcServer() {
+    Cleanup();
+}
+
+size_t IpcServer::GetMemoryUsage() const {
+    size_t bytes = sizeof(*this);
+    if (m_connections) {
+        bytes += MAX_CONNECTIONS * sizeof(Connection);
+    }
+    return bytes;
+}
+
+bool IpcServer::Initialize(CommandBus* commandBus) {
+    if (m_initialized) {
+        return true;
+    }
+    
+    if (!commandBus) {
+        return false;
+    }
+    
+    m_commandBus = commandBus;
+    Session::FormatPipeName(m_pipeName);
+    
+    m_completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    if (!m_completionPort) {
+        return false;
+    }
+    
+    m_connections = std::make_unique<Connection[]>(MAX_CONNECTIONS);
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        Connection& connection = m_connections[i];
+        connection.pipe = INVALID_HANDLE_VALUE;
+        connection.state = SlotState::Free;
+        connection.slot = static_cast<uint32_t>(i);
+        connection.generation = 0;
+        connection.connectIo = { {}, IoKind::Connect, false, &connection };
+        connection.readIo = { {}, IoKind::Read, false, &connection };
+        connection.writeIo = { {}, IoKind::Write, false, &connection };
+        connection.awaitingCompletion = false;
+        connection.awaitingRequestId = 0;
+        connection.readSize = 0;
+        connection.writeSize = 0;
+        connection.sendSize = 0;
+    }
+    
+    // Create the first instance up front so a name clash fails Initialize
+    if (!StartListening(m_connections[0])) {
+        CloseHandle(m_completionPort);
+        m_completionPort = nullptr;
+        m_connections.reset();
+        return false;
+    }
+    
+    m_worker = std::thread(&IpcServer::WorkerLoop, this);
+    m_initialized = true;
+    return true;
+}
+
+void IpcServer::Cleanup() {
+    if (!m_initialized) {
+        return;
+    }
+    
+    PostQueuedCompletionStatus(m_completionPort, 0, KEY_SHUTDOWN, nullptr);
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    
+    CloseHandle(m_completionPort);
+    m_completionPort = nullptr;
+    m_connections.reset();
+    m_commandBus = nullptr;
+    m_stopping = false;
+    m_initialized = false;
+}
+
+void IpcServer::PublishState(IconState state) {
+    m_publishedState.store(static_cast<uint8_t>(Ipc::ToWireState(state)), std::memory_order_release);
+}
+
+void IpcServer::CompleteRequest(uint64_t cookie, IconState state) {
+    if (!m_initialized) {
+        return;
+    }
+    
+    PublishState(state);
+    
+    Completion completion;
+    completion.cookie = cookie;
+    completion.state = state;
+    if (m_completions.TryPush(completion)) {
+        PostQueuedCompletionStatus(m_completionPort, 0, KEY_COMPLETIONS, nullptr);
+    }
+}
+
+void IpcServer::WorkerLoop() {
+    EnsureListening();
+    
+    for (;;) {
+        DWORD bytes = 0;
+        ULONG_PTR key = 0;
+        LPOVERLAPPED overlapped = nullptr;
+        BOOL success = GetQueuedCompletionStatus(m_completionPort, &bytes, &key, &overlapped, INFINITE);
+        
+        if (key == KEY_SHUTDOWN) {
+            break;
+        }
+        
+        if (key == KEY_COMPLETIONS) {
+            DrainCompletions();
+            continue;
+        }
+        
+        if (overlapped) {
+            OnIoCompleted(*reinterpret_cast<IoContext*>(overlapped), success != FALSE, bytes);
+        }
+    }
+    
+    CancelAllAndWait();
+}
+
+void IpcServer::DrainCompletions() {
+    Completion completion;
+    while (m_completions.TryPop(completion)) {
+        uint32_t slot = Ipc::CookieSlot(completion.cookie);
+        uint32_t generation = Ipc::CookieGeneration(completion.cookie);
+        if (slot >= MAX_CONNECTIONS) {
+            continue;
+        }
+        
+        Connection& connection = m_connections[slot];
+        if (connection.state != SlotState::Connected ||
+            connection.generation != generation ||
+            !connection.awaitingCompletion) {
+            continue; // Client went away while the batch was running
+        }
+        
+        connection.awaitingCompletion = false;
+        QueueResponse(connection, connection.awaitingRequestId, Ipc::Status::Ok,
+                      Ipc::ToWireState(completion.state));
+        ProcessRequests(connection);
+    }
+}
+
+void IpcServer::OnIoCompleted(IoContext& io, bool success, DWORD bytes) {
+    Connection& connection = *io.connection;
+    io.pending = false;
+    
+    if (connection.state == SlotState::Closing) {
+        if (!HasPendingIo(connection)) {
+            FinishClose(connection);
+        }
+        return;
+    }
+    
+    switch (io.kind) {
+        case IoKind::Connect:
+            if (success) {
+                OnConnected(connection);
+            } else {
+                CloseConnection(connection);
+            }
+            break;
+            
+        case IoKind::Read:
+            if (!success || bytes == 0) {
+                CloseConnection(connection);
+                break;
+            }
+            connection.readSize += bytes;
+            ProcessRequests(connection);
+            break;
+            
+        case IoKind::Write:
+            if (!success) {
+                CloseConnection(connection);
+                break;
+            }
+            connection.sendSize = 0;
+            IssueWrite(connection);
+            // A full write buffer may have stalled request processing
+            ProcessRequests(connection);
+            break;
+    }
+}
+
+void IpcServer::CancelAllAndWait() {
+    m_stopping = true;
+    
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        Connection& connection = m_connections[i];
+        if (connection.state != SlotState::Free) {
+            CloseConnection(connection);
+        }
+    }
+    
+    // Cancelled operations still complete through the port and still own
+    // their OVERLAPPED, so wait for them before the connections are freed
+    ULONGLONG deadline = GetTickCount64() + SHUTDOWN_DRAIN_MS;
+    for (;;) {
+        bool anyPending = false;
+        for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+            if (m_connections[i].state != SlotState::Free) {
+                anyPending = true;
+                break;
+            }
+        }
+        
+        ULONGLONG now = GetTickCount64();
+        if (!anyPending || now >= deadline) {
+            break;
+        }
+        
+        DWORD bytes = 0;
+        ULONG_PTR key = 0;
+        LPOVERLAPPED overlapped = nullptr;
+        BOOL success = GetQueuedCompletionStatus(m_completionPort, &bytes, &key, &overlapped,
+                                                 static_cast<DWORD>(deadline - now));
+        if (overlapped && key == KEY_IO) {
+            OnIoCompleted(*reinterpret_cast<IoContext*>(overlapped), success != FALSE, bytes);
+        }
+    }
+}
+
+void IpcServer::EnsureListening() {
+    size_t listening = 0;
+    for (size_t i = 0; i < MAX_CONNECTIONS; i++) {
+        if (m_connections[i].state == SlotState::Listening) {
+            listening++;
+        }
+    }
+    
+    for (size_t i = 0; i < MAX_CONNECTIONS && listening < LISTEN_BACKLOG; i++) {
+        if (m_connections[i].state == SlotState::Free && StartListening(m_connections[i])) {
+            listening++;
+        }
+    }
+}
+
+bool IpcServer::StartListening(Connection& connection) {
+    DWORD openMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+    if (!m_firstInstanceCreated) {
+        // Refuse to share the name with a pipe someone else created first
+        openMode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+    }
+    
+    HANDLE pipe = CreateNamedPipe(
+        m_pipeName,
+        openMode,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+        PIPE_UNLIMITED_INSTANCES,
+        BUFFER_SIZE,
+        BUFFER_SIZE,
+        0,
+        nullptr
+    );
+    
+    if (pipe == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    if (!CreateIoCompletionPort(pipe, m_completionPort, KEY_IO, 0)) {
+        CloseHandle(pipe);
+        return false;
+    }
+    
+    m_firstInstanceCreated = true;
+    connection.pipe = pipe;
+    connection.state = SlotState::Listening;
+    connection.awaitingCompletion = false;
+    connection.readSize = 0;
+    connection.writeSize = 0;
+    connection.sendSize = 0;
+    
+    ZeroMemory(&connection.connectIo.overlapped, sizeof(OVERLAPPED));
+    connection.connectIo.pending = true;
+    
+    if (ConnectNamedPipe(pipe, &connection.connectIo.overlapped)) {
+        return true; // Completion is still queued to the port
+    }
+    
+    DWORD error = GetLastError();
+    if (error == ERROR_IO_PENDING) {
+        return true;
+    }
+    
+    connection.connectIo.pending = false;
+    if (error == ERROR_PIPE_CONNECTED) {
+        // Client connected between create and connect; no packet is queued
+        OnConnected(connection);
+        return true;
+    }
+    
+    CloseHandle(pipe);
+    connection.pipe = INVALID_HANDLE_VALUE;
+    connection.state = SlotState::Free;
+    return false;
+}
+
+void IpcServer::OnConnected(Connection& connection) {
+    connection.state = SlotState::Connected;
+    IssueRead(connection);
+    EnsureListening();
+}
+
+void IpcServer::CloseConnection(Connection& connection) {
+    if (connection.state == SlotState::Free || connection.state == SlotState::Closing) {
+        return;
+    }
+    
+    connection.state = SlotState::Closing;
+    connection.awaitingCompletion = false;
+    
+    if (HasPendingIo(connection)) {
+        CancelIoEx(connection.pipe, nullptr);
+    } else {
+        FinishClose(connection);
+    }
+}
+
+void IpcServer::FinishClose(Connection& connection) {
+    if (connection.pipe != INVALID_HANDLE_VALUE) {
+        DisconnectNamedPipe(connection.pipe);
+        CloseHandle(connection.pipe);
+        connection.pipe = INVALID_HANDLE_VALUE;
+    }
+    
+    // Invalidates cookies still travelling through the command bus
+    connection.generation++;
+    connection.state = SlotState::Free;
+    
+    if (!m_stopping) {
+        EnsureListening();
+    }
+}
+
+bool IpcServer::HasPendingIo(const Connection& connection) const {
+    return connection.connectIo.pending || connection.readIo.pending || connection.writeIo.pending;
+}
+
+void IpcServer::IssueRead(Connection& connection) {
+    if (connection.state != SlotState::Connected || connection.readIo.pending ||
+        connection.readSize >= BUFFER_SIZE) {
+        return;
+    }
+    
+    ZeroMemory(&connection.readIo.overlapped, sizeof(OVERLAPPED));
+    connection.readIo.pending = true;
+    
+    if (!ReadFile(connection.pipe, connection.readBuffer + connection.readSize,
+                  static_cast<DWORD>(BUFFER_SIZE - connection.readSize), nullptr,
+                  &connection.readIo.overlapped) &&
+        GetLastError() != ERROR_IO_PENDING) {
+        connection.readIo.pending = false;
+        CloseConnection(connection);
+    }
+}
+
+void IpcServer::IssueWrite(Connection& connection) {
+    if (connection.state != SlotState::Connected || connection.writeIo.pending ||
+        connection.writeSize == 0) {
+        return;
+    }
+    
+    // Everything queued so far goes out in one write
+    memcpy(connection.sendBuffer, connection.writeBuffer, connection.writeSize);
+    connection.sendSize = connection.writeSize;
+    connection.writeSize = 0;
+    
+    ZeroMemory(&connection.writeIo.overlapped, sizeof(OVERLAPPED));
+    connection.writeIo.pending = true;
+    
+    if (!WriteFile(connection.pipe, connection.sendBuffer, static_cast<DWORD>(connection.sendSize),
+                   nullptr, &connection.writeIo.overlapped) &&
+        GetLastError() != ERROR_IO_PENDING) {
+        connection.writeIo.pending = false;
+        CloseConnection(connection);
+    }
+}
+
+void IpcServer::ProcessRequests(Connection& connection) {
+    size_t offset = 0;
+    
+    while (connection.state == SlotState::Connected && !connection.awaitingCompletion) {
+        size_t available = connection.readSize - offset;
+        if (available < Ipc::HEADER_SIZE) {
+            break;
+        }
+        
+        const uint8_t* frame = connection.readBuffer + offset;
+        uint32_t payloadSize = Ipc::ReadU32(frame);
+        if (payloadSize < Ipc::MIN_REQUEST_PAYLOAD || payloadSize > Ipc::MAX_REQUEST_PAYLOAD) {
+            CloseConnection(connection); // Not speaking our protocol
+            return;
+        }
+        
+        if (available < Ipc::HEADER_SIZE + payloadSize) {
+            break;
+        }
+        
+        // Back off until the client reads its earlier responses
+        if (connection.writeSize + Ipc::RESPONSE_FRAME_SIZE > BUFFER_SIZE) {
+            break;
+        }
+        
+        if (!HandleRequest(connection, frame + Ipc::HEADER_SIZE, payloadSize)) {
+            CloseConnection(connection);
+            return;
+        }
+        
+        offset += Ipc::HEADER_SIZE + payloadSize;
+    }
+    
+    if (offset > 0) {
+        memmove(connection.readBuffer, connection.readBuffer + offset, connection.readSize - offset);
+        connection.readSize -= offset;
+    }
+    
+    IssueWrite(connection);
+    IssueRead(connection);
+}
+
+bool IpcServer::HandleRequest(Connection& connection, const uint8_t* payload, uint32_t size) {
+    TRACE_SPAN("ipc", "HandleRequest");
+    ALLOCATION_SCOPE(Ipc);
+    Metrics::IpcRequests.Increment();
+    
+    uint32_t requestId = Ipc::ReadU32(payload);
+    uint32_t count = payload[4];
+    
+    if (count == 0 || size != Ipc::MIN_REQUEST_PAYLOAD + count) {
+        QueueResponse(connection, requestId, Ipc::Status::BadRequest, Ipc::WireState::Unknown);
+        return true;
+    }
+    
+    // Validate the whole batch before posting anything
+    int lastCommand = -1;
+    for (uint32_t i = 0; i < count; i++) {
+        switch (static_cast<Ipc::Opcode>(payload[5 + i])) {
+            case Ipc::Opcode::Toggle:
+            case Ipc::Opcode::Show:
+            case Ipc::Opcode::Hide:
+            case Ipc::Opcode::ShowSettings:
+            case Ipc::Opcode::DumpTrace:
+            case Ipc::Opcode::SaveLayout:
+            case Ipc::Opcode::RestoreLayout:
+            case Ipc::Opcode::UndoLayout:
+                lastCommand = static_cast<int>(i);
+                break;
+            case Ipc::Opcode::QueryState:
+                break;
+            default:
+                QueueResponse(connection, requestId, Ipc::Status::BadRequest, Ipc::WireState::Unknown);
+                return true;
+        }
+    }
+    
+    // Pure queries are answered straight away
+    if (lastCommand < 0) {
+        QueueResponse(connection, requestId, Ipc::Status::Ok,
+                      static_cast<Ipc::WireState>(m_publishedState.load(std::memory_order_acquire)));
+        return true;
+    }
+    
+    // Posted as one block so a full bus rejects all of it; Busy then means
+    // nothing ran and the client can simply retry the request
+    static_assert(Ipc::MAX_OPS_PER_REQUEST <= CommandBus::QUEUE_CAPACITY, "A batch must fit in the command bus");
+    Command commands[Ipc::MAX_OPS_PER_REQUEST];
+    size_t commandCount = 0;
+    for (int i = 0; i <= lastCommand; i++) {
+        Command command;
+        command.source = CommandSource::Ipc;
+        
+        switch (static_cast<Ipc::Opcode>(payload[5 + i])) {
+            case Ipc::Opcode::Toggle: command.type = CommandType::ToggleIcons; break;
+            case Ipc::Opcode::Show: command.type = CommandType::ShowIcons; break;
+            case Ipc::Opcode::Hide: command.type = CommandType::HideIcons; break;
+            case Ipc::Opcode::ShowSettings: command.type = CommandType::ShowSettings; break;
+            case Ipc::Opcode::DumpTrace: command.type = CommandType::DumpTrace; break;
+            case Ipc::Opcode::SaveLayout: command.type = CommandType::SaveLayout; break;
+            case Ipc::Opcode::RestoreLayout: command.type = CommandType::RestoreLayout; break;
+            case Ipc::Opcode::UndoLayout: command.type = CommandType::UndoLayout; break;
+            default: continue;
+        }
+        
+        // Only the last command reports back; the bus keeps our order
+        if (i == lastCommand) {
+            command.cookie = Ipc::MakeCookie(connection.slot, connection.generation);
+        }
+        
+        commands[commandCount++] = command;
+    }
+    
+    if (!m_commandBus->PostAll(commands, commandCount)) {
+        QueueResponse(connection, requestId, Ipc::Status::Busy,
+                      static_cast<Ipc::WireState>(m_publishedState.load(std::memory_order_acquire)));
+        return true;
+    }
+    
+    connection.awaitingCompletion = true;
+    connection.awaitingRequestId = requestId;
+    return true;
+}
+
+void IpcServer::QueueResponse(Connection& connection, uint32_t requestId, Ipc::Status status, Ipc::WireState state) {
+    connection.writeSize += Ipc::EncodeResponse(connection.writeBuffer + connection.writeSize,
+                                                BUFFER_SIZE - connection.writeSize,
+                                                requestId, status, state);
+}
@@ -0,0 +1,674 @@
+#include "LayoutHistory.h"
+#include "Tracer.h"
+#include <algorithm>
+
+namespace {
+    constexpr size_t FILE_HEADER_SIZE = 8;
+    constexpr size_t RECORD_HEADER_SIZE = 20;
+    constexpr uint8_t KIND_KEYFRAME = 0;
+    constexpr uint8_t KIND_DELTA = 1;
+
+    // Same limit as a layout file
+    constexpr uint32_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+    // Retention shrinks an oversized file to this fraction of the limit, so
+    // it is not rewritten on every append
+    constexpr uint64_t RETENTION_TARGET_PERCENT = 75;
+
+    constexpr uint64_t FILETIME_PER_DAY = 24ull * 60 * 60 * 10000000;
+
+    void PutU16(uint8_t* p, uint16_t value) {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void PutU32(uint8_t* p, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            p[i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    void PutU64(uint8_t* p, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            p[i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    uint16_t GetU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t GetU32(const uint8_t* p) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(p[i]) << (i * 8);
+        }
+        return value;
+    }
+
+    uint64_t GetU64(const uint8_t* p) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= static_cast<uint64_t>(p[i]) << (i * 8);
+        }
+        return value;
+    }
+
+    uint32_t Fnv1a(const uint8_t* data, size_t size) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // LEB128 varints; signed values are zigzag-encoded first so small
+    // moves in either direction take one or two bytes
+    void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void PutSigned(std::vector<uint8_t>& out, int64_t value) {
+        PutVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    class VarintReader {
+    public:
+        VarintReader(const uint8_t* data, size_t size) : m_data(data), m_end(data + size), m_failed(false) {}
+
+        uint64_t Read() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (m_data == m_end) {
+                    m_failed = true;
+                    return 0;
+                }
+                uint8_t byte = *m_data++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            m_failed = true;
+            return 0;
+        }
+
+        int64_t ReadSigned() {
+            uint64_t value = Read();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        bool Failed() const { return m_failed; }
+        bool AtEnd() const { return m_data == m_end; }
+
+    private:
+        const uint8_t* m_data;
+        const uint8_t* m_end;
+        bool m_failed;
+    };
+
+    bool SetPosition(HANDLE file, uint64_t offset) {
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        return SetFilePointerEx(file, position, nullptr, FILE_BEGIN) != 0;
+    }
+
+    bool ReadExact(HANDLE file, void* buffer, DWORD size) {
+        DWORD read = 0;
+        return ReadFile(file, buffer, size, &read, nullptr) && read == size;
+    }
+
+    bool WriteExact(HANDLE file, const void* buffer, DWORD size) {
+        DWORD written = 0;
+        return WriteFile(file, buffer, size, &written, nullptr) && written == size;
+    }
+}
+
+LayoutHistory::LayoutHistory()
+    : m_file(INVALID_HANDLE_VALUE)
+    , m_fileSize(0) {
+}
+
+LayoutHistory::~LayoutHistory() {
+    Close();
+}
+
+bool LayoutHistory::Open(const std::wstring& path, const Retention& retention) {
+    TRACE_SPAN("layout", "LayoutHistory::Open");
+
+    Close();
+
+    m_file = CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    m_path = path;
+    m_retention = retention;
+
+    if (!ReadIndex()) {
+        Close();
+        return false;
+    }
+
+    // Deltas need the latest snapshot to diff against. A record that is
+    // complete but does not check out is cut off with everything after it.
+    if (!m_records.empty() && !Load(m_records.size() - 1, m_latest) && !CutAfterLastLoadable()) {
+        Close();
+        return false;
+    }
+
+    ApplyRetention(Now());
+    return true;
+}
+
+void LayoutHistory::Close() {
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+
+    m_fileSize = 0;
+    m_records = std::vector<Record>();
+    m_keyframes = std::vector<size_t>();
+    m_latest.Clear();
+    m_buffer = std::vector<uint8_t>();
+}
+
+bool LayoutHistory::IsOpen() const {
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+void LayoutHistory::SetRetention(const Retention& retention) {
+    m_retention = retention;
+    ApplyRetention(Now());
+}
+
+bool LayoutHistory::Append(const IconLayout& layout, uint64_t time) {
+    TRACE_SPAN("layout", "LayoutHistory::Append");
+
+    if (!IsOpen()) {
+        return false;
+    }
+
+    bool keyframe = m_records.empty();
+    if (!keyframe) {
+        if (!EncodeDelta(m_latest, layout, m_buffer)) {
+            return false;
+        }
+        keyframe = m_records.size() - m_keyframes.back() >= KEYFRAME_INTERVAL;
+    }
+
+    if (keyframe) {
+        layout.Serialize(m_buffer);
+    } else {
+        // A delta rewriting most of the desktop is better stored whole
+        std::vector<uint8_t> full;
+        layout.Serialize(full);
+        if (m_buffer.size() * 2 > full.size()) {
+            m_buffer.swap(full);
+            keyframe = true;
+        }
+    }
+
+    // Records are always rebuilt from the earliest one, so keep them in order
+    if (!m_records.empty() && time < m_records.back().time) {
+        time = m_records.back().time;
+    }
+
+    if (!WriteRecord(keyframe, time, m_buffer)) {
+        return false;
+    }
+
+    m_latest = layout;
+    ApplyRetention(time);
+    return true;
+}
+
+size_t LayoutHistory::GetCount() const {
+    return m_records.size();
+}
+
+uint64_t LayoutHistory::GetTime(size_t index) const {
+    return index < m_records.size() ? m_records[index].time : 0;
+}
+
+size_t LayoutHistory::Seek(uint64_t time) const {
+    auto it = std::upper_bound(m_records.begin(), m_records.end(), time,
+                               [](uint64_t value, const Record& record) { return value < record.time; });
+    if (it == m_records.begin()) {
+        return NPOS;
+    }
+    return static_cast<size_t>(it - m_records.begin()) - 1;
+}
+
+bool LayoutHistory::Load(size_t index, IconLayout& layout) {
+    TRACE_SPAN("layout", "LayoutHistory::Load");
+
+    if (index >= m_records.size()) {
+        return false;
+    }
+
+    // Start from the keyframe at or before the snapshot
+    auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), index);
+    if (keyframe == m_keyframes.begin()) {
+        return false;
+    }
+    size_t first = *(keyframe - 1);
+
+    if (!ReadPayload(m_records[first], m_buffer) || !layout.Deserialize(m_buffer.data(), m_buffer.size())) {
+        return false;
+    }
+
+    IconLayout next;
+    for (size_t i = first + 1; i <= index; i++) {
+        if (!ReadPayload(m_records[i], m_buffer) ||
+            !ApplyDelta(layout, m_buffer.data(), m_buffer.size(), next)) {
+            return false;
+        }
+        std::swap(layout, next);
+    }
+
+    return true;
+}
+
+size_t LayoutHistory::GetMemoryUsage() const {
+    return m_records.capacity() * sizeof(Record) +
+           m_keyframes.capacity() * sizeof(size_t) +
+           m_latest.GetMemoryUsage() +
+           m_buffer.capacity() +
+           m_path.capacity() * sizeof(wchar_t);
+}
+
+uint64_t LayoutHistory::Now() {
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+}
+
+bool LayoutHistory::ReadIndex() {
+    m_records.clear();
+    m_keyframes.clear();
+    m_latest.Clear();
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_file, &size)) {
+        return false;
+    }
+    m_fileSize = static_cast<uint64_t>(size.QuadPart);
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    bool valid = m_fileSize >= FILE_HEADER_SIZE && SetPosition(m_file, 0) &&
+                 ReadExact(m_file, header, FILE_HEADER_SIZE) &&
+                 GetU32(header) == FILE_MAGIC && GetU16(header + 4) == FILE_VERSION;
+
+    // A new or unreadable file starts over
+    if (!valid) {
+        PutU32(header, FILE_MAGIC);
+        PutU16(header + 4, FILE_VERSION);
+        PutU16(header + 6, 0);
+        if (!SetPosition(m_file, 0) || !SetEndOfFile(m_file) || !WriteExact(m_file, header, FILE_HEADER_SIZE)) {
+            return false;
+        }
+        m_fileSize = FILE_HEADER_SIZE;
+        return true;
+    }
+
+    // Only the record headers are read; payloads are read when rebuilding
+    uint64_t offset = FILE_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= m_fileSize) {
+        if (!SetPosition(m_file, offset) || !ReadExact(m_file, header, RECORD_HEADER_SIZE)) {
+            break;
+        }
+
+        Record record;
+        record.size = GetU32(header);
+        record.keyframe = header[4] == KIND_KEYFRAME;
+        record.time = GetU64(header + 8);
+        record.offset = offset + RECORD_HEADER_SIZE;
+
+        bool known = header[4] == KIND_KEYFRAME || (header[4] == KIND_DELTA && !m_keyframes.empty());
+        if (!known || record.size > MAX_PAYLOAD_SIZE || record.offset + record.size > m_fileSize ||
+            (!m_records.empty() && record.time < m_records.back().time)) {
+            break;
+        }
+
+        if (record.keyframe) {
+            m_keyframes.push_back(m_records.size());
+        }
+        m_records.push_back(record);
+        offset = record.offset + record.size;
+    }
+
+    // Cut off a record torn by a crash so appends continue after the last
+    // complete one
+    if (offset != m_fileSize) {
+        if (!SetPosition(m_file, offset) || !SetEndOfFile(m_file)) {
+            return false;
+        }
+        m_fileSize = offset;
+    }
+
+    return true;
+}
+
+// Rebuilds the newest keyframe group record by record and keeps what
+// rebuilds. If its keyframe is damaged the whole group goes and the group
+// before it is tried, down to an empty file.
+bool LayoutHistory::CutAfterLastLoadable() {
+    while (!m_keyframes.empty()) {
+        size_t first = m_keyframes.back();
+        size_t loadable = first;
+        if (ReadPayload(m_records[first], m_buffer) && m_latest.Deserialize(m_buffer.data(), m_buffer.size())) {
+            loadable++;
+            IconLayout next;
+            while (loadable < m_records.size() && ReadPayload(m_records[loadable], m_buffer) &&
+                   ApplyDelta(m_latest, m_buffer.data(), m_buffer.size(), next)) {
+                std::swap(m_latest, next);
+                loadable++;
+            }
+        }
+
+        if (!Truncate(loadable)) {
+            return false;
+        }
+        if (loadable > first) {
+            return true;
+        }
+    }
+
+    m_latest.Clear();
+    return true;
+}
+
+bool LayoutHistory::Truncate(size_t count) {
+    uint64_t end = count < m_records.size() ? m_records[count].offset - RECORD_HEADER_SIZE : m_fileSize;
+    if (!SetPosition(m_file, end) || !SetEndOfFile(m_file)) {
+        return false;
+    }
+
+    m_records.resize(count);
+    while (!m_keyframes.empty() && m_keyframes.back() >= count) {
+        m_keyframes.pop_back();
+    }
+    m_fileSize = end;
+    return true;
+}
+
+bool LayoutHistory::ReadPayload(const Record& record, std::vector<uint8_t>& payload) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    payload.resize(record.size);
+
+    if (!SetPosition(m_file, record.offset - RECORD_HEADER_SIZE) ||
+        !ReadExact(m_file, header, RECORD_HEADER_SIZE) ||
+        (record.size > 0 && !ReadExact(m_file, payload.data(), record.size))) {
+        return false;
+    }
+
+    return GetU32(header + 16) == Fnv1a(payload.data(), payload.size());
+}
+
+bool LayoutHistory::WriteRecord(bool keyframe, uint64_t time, const std::vector<uint8_t>& payload) {
+    if (payload.size() > MAX_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE] = {};
+    PutU32(header, static_cast<uint32_t>(payload.size()));
+    header[4] = keyframe ? KIND_KEYFRAME : KIND_DELTA;
+    PutU64(header + 8, time);
+    PutU32(header + 16, Fnv1a(payload.data(), payload.size()));
+
+    if (!SetPosition(m_file, m_fileSize) ||
+        !WriteExact(m_file, header, RECORD_HEADER_SIZE) ||
+        !WriteExact(m_file, payload.data(), static_cast<DWORD>(payload.size()))) {
+        // Drop whatever part made it to disk
+        SetPosition(m_file, m_fileSize);
+        SetEndOfFile(m_file);
+        return false;
+    }
+
+    Record record;
+    record.time = time;
+    record.offset = m_fileSize + RECORD_HEADER_SIZE;
+    record.size = static_cast<uint32_t>(payload.size());
+    record.keyframe = keyframe;
+
+    if (keyframe) {
+        m_keyframes.push_back(m_records.size());
+    }
+    m_records.push_back(record);
+    m_fileSize = record.offset + record.size;
+    return true;
+}
+
+void LayoutHistory::ApplyRetention(uint64_t now) {
+    if (m_keyframes.size() < 2) {
+        return;
+    }
+
+    uint64_t cutoff = 0;
+    if (m_retention.maxAgeDays > 0 && now > m_retention.maxAgeDays * FILETIME_PER_DAY) {
+        cutoff = now - m_retention.maxAgeDays * FILETIME_PER_DAY;
+    }
+
+    bool tooOld = m_records.front().time < cutoff;
+    bool tooBig = m_retention.maxBytes > 0 && m_fileSize > m_retention.maxBytes;
+    if (!tooOld && !tooBig) {
+        return;
+    }
+
+    uint64_t targetBytes = m_retention.maxBytes * RETENTION_TARGET_PERCENT / 100;
+
+    // Drop whole keyframe groups from the front; the newest one always stays
+    size_t keep = 0;
+    for (size_t next = 1; next < m_keyframes.size(); next++) {
+        uint64_t keptBytes = FILE_HEADER_SIZE + m_fileSize - (m_records[m_keyframes[keep]].offset - RECORD_HEADER_SIZE);
+        bool groupTooOld = m_records[m_keyframes[next] - 1].time < cutoff;
+        bool stillTooBig = m_retention.maxBytes > 0 && keptBytes > targetBytes;
+        if (!groupTooOld && !stillTooBig) {
+            break;
+        }
+        keep = next;
+    }
+
+    if (keep > 0) {
+        DropBefore(m_keyframes[keep]);
+    }
+}
+
+bool LayoutHistory::DropBefore(size_t first) {
+    TRACE_SPAN("layout", "LayoutHistory::DropBefore");
+
+    uint64_t start = m_records[first].offset - RECORD_HEADER_SIZE;
+    std::wstring tempPath = m_path + L".tmp";
+
+    HANDLE temp = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (temp == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    uint8_t header[FILE_HEADER_SIZE];
+    PutU32(header, FILE_MAGIC);
+    PutU16(header + 4, FILE_VERSION);
+    PutU16(header + 6, 0);
+    bool success = WriteExact(temp, header, FILE_HEADER_SIZE) && SetPosition(m_file, start);
+
+    // The kept records are copied unchanged
+    uint8_t chunk[64 * 1024];
+    for (uint64_t copied = start; success && copied < m_fileSize; ) {
+        DWORD size = static_cast<DWORD>(std::min<uint64_t>(sizeof(chunk), m_fileSize - copied));
+        success = ReadExact(m_file, chunk, size) && WriteExact(temp, chunk, size);
+        copied += size;
+    }
+    CloseHandle(temp);
+
+    if (success) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+        success = MoveFileEx(tempPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+
+        m_file = CreateFile(m_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            Close();
+            return false;
+        }
+    }
+
+    if (!success) {
+        DeleteFile(tempPath.c_str());
+        return false;
+    }
+
+    uint64_t shift = start - FILE_HEADER_SIZE;
+    m_records.erase(m_records.begin(), m_records.begin() + static_cast<ptrdiff_t>(first));
+    for (Record& record : m_records) {
+        record.offset -= shift;
+    }
+
+    m_keyframes.clear();
+    for (size_t i = 0; i < m_records.size(); i++) {
+        if (m_records[i].keyframe) {
+            m_keyframes.push_back(i);
+        }
+    }
+
+    m_fileSize -= shift;
+    return true;
+}
+
+// Both layouts are sorted by name. Walking them together pairs equal names
+// in order; unpaired old entries are removed and unpaired new ones added.
+// Indices refer to the old layout and are stored as gaps from the previous
+// one.
+bool LayoutHistory::EncodeDelta(const IconLayout& from, const IconLayout& to, std::vector<uint8_t>& payload) {
+    std::vector<size_t> removed;
+    std::vector<size_t> moved;   // Pairs of old index, new index
+    std::vector<size_t> added;   // New indices
+
+    size_t i = 0, j = 0;
+    while (i < from.GetCount() || j < to.GetCount()) {
+        if (j == to.GetCount() || (i < from.GetCount() && from.GetEntry(i).name < to.GetEntry(j).name)) {
+            removed.push_back(i++);
+        } else if (i == from.GetCount() || to.GetEntry(j).name < from.GetEntry(i).name) {
+            added.push_back(j++);
+        } else {
+            const POINT& a = from.GetEntry(i).position;
+            const POINT& b = to.GetEntry(j).position;
+            if (a.x != b.x || a.y != b.y) {
+                moved.push_back(i);
+                moved.push_back(j);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    payload.clear();
+    if (removed.empty() && moved.empty() && added.empty()) {
+        return false;
+    }
+
+    PutVarint(payload, removed.size());
+    size_t previous = 0;
+    for (size_t index : removed) {
+        PutVarint(payload, index - previous);
+        previous = index;
+    }
+
+    PutVarint(payload, moved.size() / 2);
+    previous = 0;
+    for (size_t k = 0; k < moved.size(); k += 2) {
+        const POINT& a = from.GetEntry(moved[k]).position;
+        const POINT& b = to.GetEntry(moved[k + 1]).position;
+        PutVarint(payload, moved[k] - previous);
+        PutSigned(payload, static_cast<int64_t>(b.x) - a.x);
+        PutSigned(payload, static_cast<int64_t>(b.y) - a.y);
+        previous = moved[k];
+    }
+
+    PutVarint(payload, added.size());
+    for (size_t index : added) {
+        const IconLayout::Entry& entry = to.GetEntry(index);
+        PutVarint(payload, entry.name.size());
+        for (wchar_t c : entry.name) {
+            PutVarint(payload, static_cast<uint16_t>(c));
+        }
+        PutSigned(payload, entry.position.x);
+        PutSigned(payload, entry.position.y);
+    }
+
+    return true;
+}
+
+// Kept entries stay in their old order and added ones follow; the stable
+// sort then reproduces the new layout exactly, duplicate names included
+bool LayoutHistory::ApplyDelta(const IconLayout& from, const uint8_t* data, size_t size, IconLayout& to) {
+    VarintReader reader(data, size);
+    size_t count = from.GetCount();
+    std::vector<bool> removed(count, false);
+    std::vector<POINT> positions(count);
+    for (size_t i = 0; i < count; i++) {
+        positions[i] = from.GetEntry(i).position;
+    }
+
+    uint64_t removedCount = reader.Read();
+    uint64_t index = 0;
+    for (uint64_t k = 0; k < removedCount && !reader.Failed(); k++) {
+        index += reader.Read();
+        if (index >= count) {
+            return false;
+        }
+        removed[static_cast<size_t>(index)] = true;
+    }
+
+    uint64_t movedCount = reader.Read();
+    index = 0;
+    for (uint64_t k = 0; k < movedCount && !reader.Failed(); k++) {
+        index += reader.Read();
+        if (index >= count) {
+            return false;
+        }
+        POINT& position = positions[static_cast<size_t>(index)];
+        position.x = static_cast<LONG>(position.x + reader.ReadSigned());
+        position.y = static_cast<LONG>(position.y + reader.ReadSigned());
+    }
+
+    to.Clear();
+    for (size_t i = 0; i < count; i++) {
+        if (!removed[i]) {
+            to.Add(from.GetEntry(i).name.c_str(), positions[i]);
+        }
+    }
+
+    uint64_t addedCount = reader.Read();
+    std::wstring name;
+    for (uint64_t k = 0; k < addedCount && !reader.Failed(); k++) {
+        uint64_t length = reader.Read();
+        if (length > size) {
+            return false;
+        }
+        name.resize(static_cast<size_t>(length));
+        for (size_t c = 0; c < name.size(); c++) {
+            name[c] = static_cast<wchar_t>(reader.Read());
+        }
+        POINT position;
+        position.x = static_cast<LONG>(reader.ReadSigned());
+        position.y = static_cast<LONG>(reader.ReadSigned());
+        to.Add(name.c_str(), position);
+    }
+
+    if (reader.Failed() || !reader.AtEnd()) {
+        return false;
+    }
+
+    to.Sort();
+    return true;
+}
@@ -0,0 +1,281 @@
+#include "LayoutStore.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace LayoutStoreFormat;
+
+namespace {
+    // Same limit as a single layout file, times the number of records
+    constexpr uint64_t MAX_STORE_SIZE = 256ull * 1024 * 1024;
+}
+
+LayoutStore::LayoutStore()
+    : m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+    , m_view(nullptr)
+    , m_size(0) {
+}
+
+LayoutStore::~LayoutStore() {
+    Close();
+}
+
+bool LayoutStore::Open(const std::wstring& path) {
+    TRACE_SPAN("layout", "LayoutStore::Open");
+
+    Close();
+
+    // Not shared: another session running from the same folder keeps its
+    // layouts to itself rather than racing on the index
+    m_file = CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(m_file, &size) || static_cast<uint64_t>(size.QuadPart) > MAX_STORE_SIZE) {
+        Close();
+        return false;
+    }
+
+    uint64_t mapSize = std::max<uint64_t>(static_cast<uint64_t>(size.QuadPart), INITIAL_SIZE);
+    if (!Map(mapSize)) {
+        Close();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(m_view);
+    bool valid = header->magic == FILE_MAGIC && header->version == FILE_VERSION &&
+                 header->entryCount == MAX_LAYOUTS &&
+                 header->dataEnd >= DATA_OFFSET && header->dataEnd <= m_size;
+
+    for (size_t i = 0; valid && i < MAX_LAYOUTS; i++) {
+        const IndexEntry& entry = header->entries[i];
+        valid = entry.topology == 0 ||
+                (entry.offset >= DATA_OFFSET && static_cast<uint64_t>(entry.offset) + entry.size <= header->dataEnd);
+    }
+
+    if (!valid) {
+        Reset();
+    }
+
+    return true;
+}
+
+void LayoutStore::Close() {
+    Unmap();
+
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+
+    m_buffer = std::vector<uint8_t>();
+}
+
+bool LayoutStore::IsOpen() const {
+    return m_view != nullptr;
+}
+
+bool LayoutStore::Store(uint64_t topology, const IconLayout& layout) {
+    TRACE_SPAN("layout", "LayoutStore::Store");
+
+    if (!m_view || topology == 0) {
+        return false;
+    }
+
+    layout.Serialize(m_buffer);
+    uint64_t needed = m_buffer.size();
+    if (needed > MAX_STORE_SIZE - DATA_OFFSET) {
+        return false;
+    }
+
+    Header* header = reinterpret_cast<Header*>(m_view);
+    IndexEntry* entry = FindSlot(topology);
+
+    // Overwrite in place while the record still fits
+    if (entry->topology == topology && needed <= entry->size) {
+        memcpy(m_view + entry->offset, m_buffer.data(), m_buffer.size());
+        entry->size = static_cast<uint32_t>(needed);
+        entry->lastUsed = ++header->useCounter;
+        return true;
+    }
+
+    // Room first; the record being replaced stays live until the new one
+    // is written, so it is compacted along with the rest
+    if (header->dataEnd + needed > m_size) {
+        Compact();
+    }
+
+    if (header->dataEnd + needed > m_size) {
+        uint64_t size = std::max(m_size * 2, header->dataEnd + needed);
+        if (size > MAX_STORE_SIZE || !Grow(size)) {
+            return false;
+        }
+
+        header = reinterpret_cast<Header*>(m_view);
+        entry = FindSlot(topology);
+    }
+
+    uint32_t offset = header->dataEnd;
+    memcpy(m_view + offset, m_buffer.data(), m_buffer.size());
+    header->dataEnd += static_cast<uint32_t>(needed);
+
+    entry->topology = topology;
+    entry->offset = offset;
+    entry->size = static_cast<uint32_t>(needed);
+    entry->lastUsed = ++header->useCounter;
+    return true;
+}
+
+bool LayoutStore::Lookup(uint64_t topology, IconLayout& layout) {
+    TRACE_SPAN("layout", "LayoutStore::Lookup");
+
+    IndexEntry* entry = m_view ? Find(topology) : nullptr;
+    if (!entry || !layout.Deserialize(m_view + entry->offset, entry->size)) {
+        return false;
+    }
+
+    Header* header = reinterpret_cast<Header*>(m_view);
+    entry->lastUsed = ++header->useCounter;
+    return true;
+}
+
+size_t LayoutStore::GetCount() const {
+    if (!m_view) {
+        return 0;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(m_view);
+    return static_cast<size_t>(std::count_if(header->entries, header->entries + MAX_LAYOUTS,
+                                             [](const IndexEntry& entry) { return entry.topology != 0; }));
+}
+
+size_t LayoutStore::GetMappedBytes() const {
+    return m_view ? static_cast<size_t>(m_size) : 0;
+}
+
+bool LayoutStore::Map(uint64_t size) {
+    m_mapping = CreateFileMapping(m_file, nullptr, PAGE_READWRITE,
+                                  static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (!m_mapping) {
+        return false;
+    }
+
+    m_view = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(size)));
+    if (!m_view) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+        return false;
+    }
+
+    m_size = size;
+    return true;
+}
+
+void LayoutStore::Unmap() {
+    if (m_view) {
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+    }
+
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+
+    m_size = 0;
+}
+
+bool LayoutStore::Grow(uint64_t size) {
+    TRACE_SPAN("layout", "LayoutStore::Grow");
+
+    // Mapping a larger size extends the file; the old view has to go first
+    Unmap();
+    if (Map(size)) {
+        return true;
+    }
+
+    // Keep the store usable at its old size
+    LARGE_INTEGER fileSize = {};
+    if (GetFileSizeEx(m_file, &fileSize)) {
+        Map(static_cast<uint64_t>(fileSize.QuadPart));
+    }
+    return false;
+}
+
+void LayoutStore::Compact() {
+    TRACE_SPAN("layout", "LayoutStore::Compact");
+
+    Header* header = reinterpret_cast<Header*>(m_view);
+
+    IndexEntry* live[MAX_LAYOUTS];
+    size_t liveCount = 0;
+    for (IndexEntry& entry : header->entries) {
+        if (entry.topology != 0) {
+            live[liveCount++] = &entry;
+        }
+    }
+
+    // Moving records down in file order never overwrites one not yet moved
+    std::sort(live, live + liveCount, [](const IndexEntry* a, const IndexEntry* b) {
+        return a->offset < b->offset;
+    });
+
+    uint32_t next = DATA_OFFSET;
+    for (size_t i = 0; i < liveCount; i++) {
+        if (live[i]->offset != next) {
+            memmove(m_view + next, m_view + live[i]->offset, live[i]->size);
+            live[i]->offset = next;
+        }
+        next += live[i]->size;
+    }
+
+    header->dataEnd = next;
+}
+
+void LayoutStore::Reset() {
+    memset(m_view, 0, DATA_OFFSET);
+
+    Header* header = reinterpret_cast<Header*>(m_view);
+    header->magic = FILE_MAGIC;
+    header->version = FILE_VERSION;
+    header->entryCount = MAX_LAYOUTS;
+    header->dataEnd = DATA_OFFSET;
+}
+
+IndexEntry* LayoutStore::Find(uint64_t topology) {
+    if (topology == 0) {
+        return nullptr;
+    }
+
+    Header* header = reinterpret_cast<Header*>(m_view);
+    for (IndexEntry& entry : header->entries) {
+        if (entry.topology == topology) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+IndexEntry* LayoutStore::FindSlot(uint64_t topology) {
+    IndexEntry* existing = Find(topology);
+    if (existing) {
+        return existing;
+    }
+
+    // An unused entry, or else the least recently used one
+    Header* header = reinterpret_cast<Header*>(m_view);
+    IndexEntry* slot = &header->entries[0];
+    for (IndexEntry& entry : header->entries) {
+        if (entry.topology == 0) {
+            return &entry;
+        }
+        if (entry.lastUsed < slot->lastUsed) {
+            slot = &entry;
+        }
+    }
+    return slot;
+}
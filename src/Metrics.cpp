@@ -0,0 +1,290 @@
+#include "Metrics.h"
+#include "AllocationTracker.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+    constexpr size_t MAX_METRICS = 64;
+    
+    // Plain arrays so registration works during static initialization
+    Metric* g_metrics[MAX_METRICS];
+    size_t g_metricCount = 0;
+    
+    std::atomic<bool> g_dirty(false);
+    std::atomic<HANDLE> g_dirtyEvent(nullptr);
+    
+    const uint64_t TOGGLE_BUCKETS_US[] = { 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 };
+    const uint64_t LOOKUP_BUCKETS_US[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+    const uint64_t HOOK_BUCKETS_US[] = { 1, 2, 5, 10, 25, 50, 100, 250, 1000, 10000 };
+    const uint64_t SHELL_READY_BUCKETS_US[] = { 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000 };
+}
+
+Metric::Metric(MetricType type, const char* family, const char* labels, const char* help)
+    : m_type(type)
+    , m_family(family)
+    , m_labels(labels)
+    , m_help(help) {
+    
+    if (g_metricCount < MAX_METRICS) {
+        g_metrics[g_metricCount++] = this;
+    }
+}
+
+void Metric::MarkDirty() {
+    // Only the first change after a snapshot pays for the SetEvent
+    if (!g_dirty.load(std::memory_order_relaxed) &&
+        !g_dirty.exchange(true, std::memory_order_acq_rel)) {
+        HANDLE dirtyEvent = g_dirtyEvent.load(std::memory_order_acquire);
+        if (dirtyEvent) {
+            SetEvent(dirtyEvent);
+        }
+    }
+}
+
+Histogram::Histogram(const char* family, const char* labels, const char* help,
+                     const uint64_t* upperBoundsUs, size_t bucketCount)
+    : Metric(MetricType::Histogram, family, labels, help)
+    , m_bucketCount(bucketCount < MAX_BUCKETS ? bucketCount : MAX_BUCKETS)
+    , m_count(0)
+    , m_sumUs(0) {
+    
+    for (size_t i = 0; i < m_bucketCount; i++) {
+        m_upperBoundsUs[i] = upperBoundsUs[i];
+    }
+    
+    for (size_t i = 0; i <= MAX_BUCKETS; i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::Observe(uint64_t valueUs) {
+    size_t bucket = 0;
+    while (bucket < m_bucketCount && valueUs > m_upperBoundsUs[bucket]) {
+        bucket++;
+    }
+    
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(valueUs, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    MarkDirty();
+}
+
+namespace Metrics {
+    Counter TogglesTotal("dit_toggles_total", "", "Desktop icon visibility changes applied");
+    Counter ToggleFailuresNotFound("dit_toggle_failures_total", "reason=\"desktop_not_found\"", "Failed desktop icon visibility changes by reason");
+    Counter ToggleFailuresInvalidWindow("dit_toggle_failures_total", "reason=\"invalid_window\"", "Failed desktop icon visibility changes by reason");
+    Counter ToggleFailuresSelective("dit_toggle_failures_total", "reason=\"selective_failed\"", "Failed desktop icon visibility changes by reason");
+    Counter ToggleStrategyFailures("dit_toggle_strategy_failures_total", "", "Toggle strategy attempts that did not change visibility");
+    Counter ToggleStrategyFailovers("dit_toggle_strategy_failovers_total", "", "Times the selected toggle strategy stopped working and another one replaced it");
+    Histogram ToggleDuration("dit_toggle_duration_seconds", "", "Time to apply a desktop icon visibility change",
+                             TOGGLE_BUCKETS_US, sizeof(TOGGLE_BUCKETS_US) / sizeof(TOGGLE_BUCKETS_US[0]));
+    Gauge IconsVisible("dit_icons_visible", "", "1 if desktop icons are currently visible");
+    Histogram LayoutCaptureDuration("dit_layout_duration_seconds", "operation=\"capture\"", "Time to read or apply a desktop icon layout",
+                                    TOGGLE_BUCKETS_US, sizeof(TOGGLE_BUCKETS_US) / sizeof(TOGGLE_BUCKETS_US[0]));
+    Histogram LayoutRestoreDuration("dit_layout_duration_seconds", "operation=\"restore\"", "Time to read or apply a desktop icon layout",
+                                    TOGGLE_BUCKETS_US, sizeof(TOGGLE_BUCKETS_US) / sizeof(TOGGLE_BUCKETS_US[0]));
+    Histogram LayoutLookupDuration("dit_layout_lookup_seconds", "", "Time to identify the monitor setup and find its stored layout",
+                                   LOOKUP_BUCKETS_US, sizeof(LOOKUP_BUCKETS_US) / sizeof(LOOKUP_BUCKETS_US[0]));
+    Counter LayoutDisplayRestores("dit_layout_display_restores_total", "", "Stored layouts applied after a monitor setup change");
+    Gauge SelectiveItemsHidden("dit_selective_items_hidden", "", "Desktop icons currently hidden by selective mode");
+    Gauge MonitorsHidden("dit_monitors_hidden", "", "Monitors whose desktop icons are currently hidden");
+    Histogram MonitorToggleDuration("dit_monitor_toggle_duration_seconds", "", "Time to hide or show the desktop icons of one monitor",
+                                    TOGGLE_BUCKETS_US, sizeof(TOGGLE_BUCKETS_US) / sizeof(TOGGLE_BUCKETS_US[0]));
+    Counter IconIndexHits("dit_icon_index_lookups_total", "result=\"hit\"", "Per-monitor icon lookups by whether the cached index was usable");
+    Counter IconIndexBuilds("dit_icon_index_lookups_total", "result=\"build\"", "Per-monitor icon lookups by whether the cached index was usable");
+    Histogram DesktopSwitchApplyDuration("dit_desktop_switch_apply_seconds", "", "Time from a virtual desktop switch to its icon state being applied",
+                                         TOGGLE_BUCKETS_US, sizeof(TOGGLE_BUCKETS_US) / sizeof(TOGGLE_BUCKETS_US[0]));
+    Counter DesktopSwitchesApplied("dit_desktop_switches_total", "result=\"applied\"", "Virtual desktop switches by whether their icon state was applied");
+    Counter DesktopSwitchesCancelled("dit_desktop_switches_total", "result=\"cancelled\"", "Virtual desktop switches by whether their icon state was applied");
+    Histogram ContextEvaluationDuration("dit_context_evaluation_seconds", "", "Time to capture and evaluate the context after a foreground or fullscreen change",
+                                        LOOKUP_BUCKETS_US, sizeof(LOOKUP_BUCKETS_US) / sizeof(LOOKUP_BUCKETS_US[0]));
+    Counter ContextHides("dit_context_actions_total", "action=\"hide\"", "Desktop icon visibility changes made by context rules");
+    Counter ContextShows("dit_context_actions_total", "action=\"show\"", "Desktop icon visibility changes made by context rules");
+    Counter IdleWakeups("dit_idle_deadline_wakeups_total", "", "Idle deadlines that fired and read the last input time");
+    Counter IdleHides("dit_idle_actions_total", "action=\"hide\"", "Desktop icon visibility changes made by idle hiding");
+    Counter IdleResumes("dit_idle_actions_total", "action=\"show\"", "Desktop icon visibility changes made by idle hiding");
+    Counter ScheduleHides("dit_schedule_actions_total", "action=\"hide\"", "Desktop icon visibility changes made by schedules and timed hides");
+    Counter ScheduleShows("dit_schedule_actions_total", "action=\"show\"", "Desktop icon visibility changes made by schedules and timed hides");
+    Histogram ClickHookDuration("dit_click_hook_seconds", "", "Time the low-level mouse hook spends on a left button press",
+                                HOOK_BUCKETS_US, sizeof(HOOK_BUCKETS_US) / sizeof(HOOK_BUCKETS_US[0]));
+    Counter DoubleClickToggles("dit_desktop_double_clicks_total", "result=\"toggle\"", "Double-clicks seen by the double-click toggle");
+    Counter DoubleClicksIgnored("dit_desktop_double_clicks_total", "result=\"ignored\"", "Double-clicks seen by the double-click toggle");
+    Counter HotkeyRegistrations("dit_hotkey_registrations_total", "", "Global hotkey registration attempts");
+    Counter HotkeyRegistrationFailures("dit_hotkey_registration_failures_total", "", "Global hotkey registrations rejected by the system");
+    Counter CommandsDispatched("dit_commands_dispatched_total", "", "Commands handled by the UI thread");
+    Counter CommandsDropped("dit_commands_dropped_total", "", "Commands dropped because the command bus was full");
+    Counter IpcRequests("dit_ipc_requests_total", "", "Requests received on the control pipe");
+    Counter ConfigLoads("dit_config_loads_total", "", "Settings file loads");
+    Counter ConfigWrites("dit_config_writes_total", "", "Settings file saves");
+    Counter ConfigWriteFailures("dit_config_write_failures_total", "", "Settings file saves that failed");
+    Counter TrayUpdates("dit_tray_updates_total", "", "Tray icon updates");
+    Counter MainLoopWakeups("dit_main_loop_wakeups_total", "", "Times the UI thread woke from its message wait");
+    Counter TimerWakeups("dit_timer_wakeups_total", "", "Shared timer expirations handled by the UI thread");
+    Gauge TimersPending("dit_timers_pending", "", "Timers scheduled on the shared timer wheel");
+    Counter ShellStarts("dit_shell_starts_total", "", "Times the taskbar was created while the application was running");
+    Histogram ShellReadyLatency("dit_shell_ready_to_applied_seconds", "", "Time from the desktop appearing to the remembered state being applied",
+                                SHELL_READY_BUCKETS_US, sizeof(SHELL_READY_BUCKETS_US) / sizeof(SHELL_READY_BUCKETS_US[0]));
+}
+
+MetricsExporter::MetricsExporter()
+    : m_intervalMs(0)
+    , m_stopEvent(nullptr) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+bool MetricsExporter::Start(const std::wstring& path, DWORD intervalMs) {
+    if (m_writer.joinable()) {
+        return true;
+    }
+    
+    m_path = path;
+    m_intervalMs = intervalMs;
+    
+    m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!m_stopEvent) {
+        return false;
+    }
+    
+    if (!g_dirtyEvent.load(std::memory_order_acquire)) {
+        HANDLE dirtyEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!dirtyEvent) {
+            CloseHandle(m_stopEvent);
+            m_stopEvent = nullptr;
+            return false;
+        }
+        g_dirtyEvent.store(dirtyEvent, std::memory_order_release);
+    }
+    
+    // Make sure the first snapshot is written promptly
+    g_dirty.store(true, std::memory_order_release);
+    SetEvent(g_dirtyEvent.load(std::memory_order_acquire));
+    
+    m_writer = std::thread(&MetricsExporter::WriterLoop, this);
+    return true;
+}
+
+void MetricsExporter::Stop() {
+    if (!m_writer.joinable()) {
+        return;
+    }
+    
+    SetEvent(m_stopEvent);
+    m_writer.join();
+    
+    // Final snapshot so the file reflects the state at exit
+    WriteSnapshot(m_path);
+    
+    CloseHandle(m_stopEvent);
+    m_stopEvent = nullptr;
+}
+
+void MetricsExporter::WriterLoop() {
+    ALLOCATION_SCOPE(Diagnostics);
+    
+    HANDLE handles[] = { m_stopEvent, g_dirtyEvent.load(std::memory_order_acquire) };
+    
+    for (;;) {
+        // Sleep until a metric changes; no periodic wakeups while idle
+        DWORD result = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+        if (result != WAIT_OBJECT_0 + 1) {
+            break;
+        }
+        
+        // Coalesce further changes for one interval before writing
+        if (WaitForSingleObject(m_stopEvent, m_intervalMs) == WAIT_OBJECT_0) {
+            break;
+        }
+        
+        g_dirty.store(false, std::memory_order_release);
+        WriteSnapshot(m_path);
+    }
+}
+
+bool MetricsExporter::WriteSnapshot(const std::wstring& path) {
+    std::string text;
+    char line[512];
+    const char* previousFamily = nullptr;
+    
+    for (size_t i = 0; i < g_metricCount; i++) {
+        const Metric* metric = g_metrics[i];
+        
+        if (!previousFamily || strcmp(previousFamily, metric->GetFamily()) != 0) {
+            const char* type = (metric->GetType() == MetricType::Counter) ? "counter" :
+                               (metric->GetType() == MetricType::Gauge) ? "gauge" : "histogram";
+            snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n",
+                     metric->GetFamily(), metric->GetHelp(), metric->GetFamily(), type);
+            text += line;
+            previousFamily = metric->GetFamily();
+        }
+        
+        const char* labels = metric->GetLabels();
+        bool hasLabels = labels[0] != '\0';
+        
+        switch (metric->GetType()) {
+            case MetricType::Counter:
+                snprintf(line, sizeof(line), "%s%s%s%s %llu\n", metric->GetFamily(),
+                         hasLabels ? "{" : "", labels, hasLabels ? "}" : "",
+                         static_cast<unsigned long long>(static_cast<const Counter*>(metric)->GetValue()));
+                text += line;
+                break;
+                
+            case MetricType::Gauge:
+                snprintf(line, sizeof(line), "%s%s%s%s %lld\n", metric->GetFamily(),
+                         hasLabels ? "{" : "", labels, hasLabels ? "}" : "",
+                         static_cast<long long>(static_cast<const Gauge*>(metric)->GetValue()));
+                text += line;
+                break;
+                
+            case MetricType::Histogram: {
+                const Histogram* histogram = static_cast<const Histogram*>(metric);
+                uint64_t cumulative = 0;
+                
+                for (size_t bucket = 0; bucket <= histogram->GetBucketCount(); bucket++) {
+                    cumulative += histogram->GetBucketValue(bucket);
+                    char bound[32];
+                    if (bucket < histogram->GetBucketCount()) {
+                        snprintf(bound, sizeof(bound), "%g", histogram->GetUpperBoundUs(bucket) / 1000000.0);
+                    } else {
+                        snprintf(bound, sizeof(bound), "+Inf");
+                    }
+                    snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%s\"} %llu\n", metric->GetFamily(),
+                             labels, hasLabels ? "," : "", bound, static_cast<unsigned long long>(cumulative));
+                    text += line;
+                }
+                
+                snprintf(line, sizeof(line), "%s_sum%s%s%s %g\n%s_count%s%s%s %llu\n",
+                         metric->GetFamily(), hasLabels ? "{" : "", labels, hasLabels ? "}" : "",
+                         histogram->GetSumUs() / 1000000.0,
+                         metric->GetFamily(), hasLabels ? "{" : "", labels, hasLabels ? "}" : "",
+                         static_cast<unsigned long long>(histogram->GetCount()));
+                text += line;
+                break;
+            }
+        }
+    }
+    
+    // Write to a temporary file and swap it in so scrapers never see a
+    // partially written snapshot
+    std::wstring tempPath = path + L".tmp";
+    HANDLE hFile = CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    DWORD bytesWritten = 0;
+    bool success = WriteFile(hFile, text.data(), static_cast<DWORD>(text.size()), &bytesWritten, nullptr) &&
+                   bytesWritten == text.size();
+    CloseHandle(hFile);
+    
+    if (!success) {
+        DeleteFile(tempPath.c_str());
+        return false;
+    }
+    
+    return MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+}
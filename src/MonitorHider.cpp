@@ -0,0 +1,148 @@
+#include "MonitorHider.h"
+#include "RemoteListView.h"
+#include "Tracer.h"
+#include "Metrics.h"
+
+namespace {
+    // Same spot SelectiveHider uses, outside any monitor layout
+    constexpr POINT OFFSCREEN_POSITION = { -32000, -32000 };
+
+    bool IsAutoArranged(HWND listView) {
+        return (GetWindowLong(listView, GWL_STYLE) & LVS_AUTOARRANGE) != 0;
+    }
+}
+
+MonitorHider::MonitorHider() {
+}
+
+MonitorHider::~MonitorHider() {
+}
+
+bool MonitorHider::Hide(HWND listView, const wchar_t* device) {
+    TRACE_SPAN("desktop", "MonitorHider::Hide");
+
+    if (FindHidden(device) != IconSpatialIndex::NPOS) {
+        return true;
+    }
+
+    if (IsAutoArranged(listView)) {
+        return false;
+    }
+
+    RemoteListView remote;
+    if (!remote.Open(listView) || !PrepareIndex(remote, listView)) {
+        return false;
+    }
+
+    size_t slot = m_index.FindMonitor(device);
+    if (slot == IconSpatialIndex::NPOS) {
+        return false;
+    }
+
+    IconSpatialIndex::Monitor& monitor = m_index.GetMonitor(slot);
+    HiddenMonitor hidden;
+    hidden.device = device;
+
+    // One repaint for the whole monitor instead of one per moved icon
+    remote.SetRedraw(false);
+    for (const IconSpatialIndex::Item& item : monitor.items) {
+        hidden.layout.Add(item.name.c_str(), item.position);
+        remote.MoveItem(item.index, OFFSCREEN_POSITION);
+    }
+    remote.SetRedraw(true); // Lost moves are undone by the saved positions too
+
+    hidden.layout.Sort();
+
+    // The icons are off-screen now; the index stays valid for the other
+    // monitors
+    monitor.items = std::vector<IconSpatialIndex::Item>();
+
+    m_hidden.push_back(std::move(hidden));
+    Metrics::MonitorsHidden.Set(static_cast<int64_t>(m_hidden.size()));
+    return true;
+}
+
+bool MonitorHider::Show(HWND listView, const wchar_t* device) {
+    TRACE_SPAN("desktop", "MonitorHider::Show");
+
+    size_t slot = FindHidden(device);
+    if (slot == IconSpatialIndex::NPOS) {
+        return true;
+    }
+
+    // Keep the saved positions if Explorer is gone, as SelectiveHider does
+    if (!m_hidden[slot].layout.Apply(listView)) {
+        return false;
+    }
+
+    m_hidden.erase(m_hidden.begin() + static_cast<ptrdiff_t>(slot));
+    m_index.Invalidate();
+    Metrics::MonitorsHidden.Set(static_cast<int64_t>(m_hidden.size()));
+    return true;
+}
+
+bool MonitorHider::RestoreAll(HWND listView) {
+    bool success = true;
+    while (!m_hidden.empty() && success) {
+        std::wstring device = m_hidden.back().device;
+        success = Show(listView, device.c_str());
+    }
+    return success;
+}
+
+bool MonitorHider::IsHidden(const wchar_t* device) const {
+    return FindHidden(device) != IconSpatialIndex::NPOS;
+}
+
+bool MonitorHider::IsHidingAny() const {
+    return !m_hidden.empty();
+}
+
+std::vector<std::wstring> MonitorHider::GetHiddenDevices() const {
+    std::vector<std::wstring> devices;
+    devices.reserve(m_hidden.size());
+    for (const HiddenMonitor& hidden : m_hidden) {
+        devices.push_back(hidden.device);
+    }
+    return devices;
+}
+
+void MonitorHider::AppendHiddenLayouts(IconLayout& layout) const {
+    for (const HiddenMonitor& hidden : m_hidden) {
+        for (size_t i = 0; i < hidden.layout.GetCount(); i++) {
+            const IconLayout::Entry& entry = hidden.layout.GetEntry(i);
+            layout.Add(entry.name.c_str(), entry.position);
+        }
+    }
+}
+
+void MonitorHider::InvalidateIndex() {
+    m_index.Invalidate();
+}
+
+size_t MonitorHider::GetMemoryUsage() const {
+    size_t bytes = m_index.GetMemoryUsage() + m_hidden.capacity() * sizeof(HiddenMonitor);
+    for (const HiddenMonitor& hidden : m_hidden) {
+        bytes += hidden.device.capacity() * sizeof(wchar_t) + hidden.layout.GetMemoryUsage();
+    }
+    return bytes;
+}
+
+bool MonitorHider::PrepareIndex(RemoteListView& remote, HWND listView) {
+    if (m_index.IsValid(remote)) {
+        Metrics::IconIndexHits.Increment();
+        return true;
+    }
+
+    Metrics::IconIndexBuilds.Increment();
+    return m_index.Build(remote, listView);
+}
+
+size_t MonitorHider::FindHidden(const wchar_t* device) const {
+    for (size_t i = 0; i < m_hidden.size(); i++) {
+        if (m_hidden[i].device == device) {
+            return i;
+        }
+    }
+    return IconSpatialIndex::NPOS;
+}
@@ -0,0 +1,168 @@
+#include "PatternRules.h"
+#include <cwctype>
+
+namespace {
+    constexpr const wchar_t* REGEX_PREFIX = L"re:";
+    constexpr size_t REGEX_PREFIX_LENGTH = 3;
+
+    bool EqualsIgnoreCase(const wchar_t* lowered, const wchar_t* name, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (lowered[i] != static_cast<wchar_t>(towlower(name[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+PatternRules::PatternRules() {
+}
+
+PatternRules::~PatternRules() {
+}
+
+bool PatternRules::Add(const std::wstring& pattern) {
+    if (pattern.empty()) {
+        return false;
+    }
+
+    Rule rule;
+
+    if (pattern.compare(0, REGEX_PREFIX_LENGTH, REGEX_PREFIX) == 0) {
+        // std::regex reports bad expressions only by throwing
+        try {
+            rule.regex = std::make_unique<std::wregex>(
+                pattern.substr(REGEX_PREFIX_LENGTH),
+                std::regex_constants::ECMAScript | std::regex_constants::icase | std::regex_constants::optimize);
+        } catch (const std::regex_error&) {
+            return false;
+        }
+
+        rule.kind = RuleKind::Regex;
+        m_rules.push_back(std::move(rule));
+        return true;
+    }
+
+    rule.text.reserve(pattern.size());
+    for (wchar_t c : pattern) {
+        rule.text.push_back(static_cast<wchar_t>(towlower(c)));
+    }
+
+    // Most rules are a name or an extension; match those directly
+    size_t wildcard = rule.text.find_first_of(L"*?");
+    if (wildcard == std::wstring::npos) {
+        rule.kind = RuleKind::Literal;
+    } else if (rule.text.find_first_of(L"*?", 1) == std::wstring::npos && rule.text[0] == L'*') {
+        rule.kind = RuleKind::Suffix;
+        rule.text.erase(0, 1);
+    } else if (wildcard == rule.text.size() - 1 && rule.text[wildcard] == L'*') {
+        rule.kind = RuleKind::Prefix;
+        rule.text.pop_back();
+    } else {
+        rule.kind = RuleKind::Glob;
+    }
+
+    m_rules.push_back(std::move(rule));
+    return true;
+}
+
+void PatternRules::Clear() {
+    m_rules.clear();
+}
+
+bool PatternRules::IsEmpty() const {
+    return m_rules.empty();
+}
+
+size_t PatternRules::GetCount() const {
+    return m_rules.size();
+}
+
+bool PatternRules::Matches(const wchar_t* name) const {
+    size_t length = wcslen(name);
+
+    for (const Rule& rule : m_rules) {
+        size_t ruleLength = rule.text.size();
+
+        switch (rule.kind) {
+            case RuleKind::Literal:
+                if (length == ruleLength && EqualsIgnoreCase(rule.text.c_str(), name, length)) {
+                    return true;
+                }
+                break;
+
+            case RuleKind::Prefix:
+                if (length >= ruleLength && EqualsIgnoreCase(rule.text.c_str(), name, ruleLength)) {
+                    return true;
+                }
+                break;
+
+            case RuleKind::Suffix:
+                if (length >= ruleLength &&
+                    EqualsIgnoreCase(rule.text.c_str(), name + length - ruleLength, ruleLength)) {
+                    return true;
+                }
+                break;
+
+            case RuleKind::Glob:
+                if (MatchGlob(rule.text.c_str(), name)) {
+                    return true;
+                }
+                break;
+
+            case RuleKind::Regex:
+                // MSVC's engine throws error_complexity or error_stack when a
+                // pattern backtracks too much; such a name does not match
+                try {
+                    if (std::regex_match(name, name + length, *rule.regex)) {
+                        return true;
+                    }
+                } catch (const std::regex_error&) {
+                }
+                break;
+        }
+    }
+
+    return false;
+}
+
+size_t PatternRules::GetMemoryUsage() const {
+    size_t bytes = m_rules.capacity() * sizeof(Rule);
+    for (const Rule& rule : m_rules) {
+        bytes += rule.text.capacity() * sizeof(wchar_t);
+        if (rule.regex) {
+            bytes += sizeof(std::wregex);
+        }
+    }
+    return bytes;
+}
+
+bool PatternRules::MatchGlob(const wchar_t* pattern, const wchar_t* name) {
+    // Iterative matcher; on a mismatch, retry from the last * one character
+    // further along the name. Linear in practice, no recursion.
+    const wchar_t* star = nullptr;
+    const wchar_t* resume = nullptr;
+
+    while (*name) {
+        wchar_t c = static_cast<wchar_t>(towlower(*name));
+
+        if (*pattern == L'*') {
+            star = pattern++;
+            resume = name;
+        } else if (*pattern == L'?' || *pattern == c) {
+            pattern++;
+            name++;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    while (*pattern == L'*') {
+        pattern++;
+    }
+
+    return *pattern == L'\0';
+}
@@ -0,0 +1,211 @@
+#include "RemoteListView.h"
+#include "Tracer.h"
+#include <cstddef>
+
+RemoteListView::RemoteListView()
+    : m_listView(nullptr)
+    , m_process(nullptr)
+    , m_remote(nullptr)
+    , m_moveCount(0) {
+}
+
+RemoteListView::~RemoteListView() {
+    Close();
+}
+
+bool RemoteListView::Open(HWND listView) {
+    TRACE_SPAN("desktop", "RemoteListView::Open");
+
+    Close();
+
+    if (!listView || !IsWindow(listView)) {
+        return false;
+    }
+
+    // Remote LVITEMs hold pointers, so both sides must have the same layout
+    BOOL wow64 = FALSE;
+    if (IsWow64Process(GetCurrentProcess(), &wow64) && wow64) {
+        return false;
+    }
+
+    DWORD processId = 0;
+    GetWindowThreadProcessId(listView, &processId);
+    if (processId == 0) {
+        return false;
+    }
+
+    m_process = OpenProcess(PROCESS_VM_OPERATION | PROCESS_VM_READ | PROCESS_VM_WRITE, FALSE, processId);
+    if (!m_process) {
+        return false;
+    }
+
+    m_remote = static_cast<BYTE*>(VirtualAllocEx(m_process, nullptr, BATCH_SIZE * sizeof(Slot),
+                                                 MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (!m_remote) {
+        Close();
+        return false;
+    }
+
+    // Every slot asks for its own text buffer; only the item index, which
+    // travels in wParam, changes between batches
+    m_local.reset(new Slot[BATCH_SIZE]);
+    m_results.reset(new Slot[BATCH_SIZE]);
+    m_moveIndices.reset(new int[BATCH_SIZE]);
+    m_movePositions.reset(new POINT[BATCH_SIZE]);
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        Slot& slot = m_local[i];
+        slot.item = {};
+        slot.item.mask = LVIF_TEXT;
+        slot.item.cchTextMax = static_cast<int>(MAX_ITEM_NAME);
+        slot.item.pszText = reinterpret_cast<LPWSTR>(m_remote + i * sizeof(Slot) + offsetof(Slot, text));
+    }
+
+    m_listView = listView;
+    return true;
+}
+
+void RemoteListView::Close() {
+    if (m_remote) {
+        FlushMoves();
+        VirtualFreeEx(m_process, m_remote, 0, MEM_RELEASE);
+        m_remote = nullptr;
+    }
+
+    if (m_process) {
+        CloseHandle(m_process);
+        m_process = nullptr;
+    }
+
+    m_local.reset();
+    m_results.reset();
+    m_moveIndices.reset();
+    m_movePositions.reset();
+    m_moveCount = 0;
+    m_listView = nullptr;
+}
+
+int RemoteListView::GetItemCount() const {
+    if (!m_listView) {
+        return 0;
+    }
+
+    return static_cast<int>(SendMessage(m_listView, LVM_GETITEMCOUNT, 0, 0));
+}
+
+SIZE RemoteListView::GetItemSpacing() const {
+    SIZE spacing = {};
+    if (!m_listView) {
+        return spacing;
+    }
+
+    DWORD packed = static_cast<DWORD>(SendMessage(m_listView, LVM_GETITEMSPACING, FALSE, 0));
+    spacing.cx = LOWORD(packed);
+    spacing.cy = HIWORD(packed);
+    return spacing;
+}
+
+size_t RemoteListView::ReadItems(int first, Item* items, size_t count) {
+    TRACE_SPAN("desktop", "RemoteListView::ReadItems");
+
+    if (!m_remote || count == 0 || count > BATCH_SIZE || !FlushMoves()) {
+        return 0;
+    }
+
+    // The listview may rewrite the LVITEMs, so the headers go out with
+    // every batch
+    SIZE_T bytes = count * sizeof(Slot);
+    if (!WriteProcessMemory(m_process, m_remote, m_local.get(), bytes, nullptr)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        BYTE* slot = m_remote + i * sizeof(Slot);
+        WPARAM index = static_cast<WPARAM>(first + static_cast<int>(i));
+        SendMessage(m_listView, LVM_GETITEMTEXT, index, reinterpret_cast<LPARAM>(slot + offsetof(Slot, item)));
+        SendMessage(m_listView, LVM_GETITEMPOSITION, index, reinterpret_cast<LPARAM>(slot + offsetof(Slot, position)));
+    }
+
+    // Read into a separate buffer so the request slots stay as written
+    if (!ReadProcessMemory(m_process, m_remote, m_results.get(), bytes, nullptr)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        Slot& result = m_results[i];
+        result.text[MAX_ITEM_NAME - 1] = L'\0';
+        wcscpy_s(items[i].name, result.text);
+        items[i].position = result.position;
+    }
+
+    return count;
+}
+
+size_t RemoteListView::ReadPositions(int first, POINT* positions, size_t count) {
+    TRACE_SPAN("desktop", "RemoteListView::ReadPositions");
+
+    if (!m_remote || count == 0 || count > BATCH_SIZE || !FlushMoves()) {
+        return 0;
+    }
+
+    // Overwrites the request headers, which ReadItems() sends again anyway
+    for (size_t i = 0; i < count; i++) {
+        WPARAM index = static_cast<WPARAM>(first + static_cast<int>(i));
+        SendMessage(m_listView, LVM_GETITEMPOSITION, index, reinterpret_cast<LPARAM>(m_remote + i * sizeof(POINT)));
+    }
+
+    if (!ReadProcessMemory(m_process, m_remote, positions, count * sizeof(POINT), nullptr)) {
+        return 0;
+    }
+
+    return count;
+}
+
+bool RemoteListView::MoveItem(int index, POINT position) {
+    if (!m_remote || (m_moveCount == BATCH_SIZE && !FlushMoves())) {
+        return false;
+    }
+
+    m_moveIndices[m_moveCount] = index;
+    m_movePositions[m_moveCount] = position;
+    m_moveCount++;
+    return true;
+}
+
+bool RemoteListView::FlushMoves() {
+    TRACE_SPAN("desktop", "RemoteListView::FlushMoves");
+
+    if (m_moveCount == 0) {
+        return true;
+    }
+
+    // Packed at the start of the remote buffer, like ReadPositions()
+    size_t count = m_moveCount;
+    m_moveCount = 0;
+    if (!WriteProcessMemory(m_process, m_remote, m_movePositions.get(), count * sizeof(POINT), nullptr)) {
+        return false;
+    }
+
+    // Unlike LVM_SETITEMPOSITION, which packs the point into 16-bit halves
+    // of lParam, this takes a POINT* (and reports nothing back)
+    for (size_t i = 0; i < count; i++) {
+        SendMessage(m_listView, LVM_SETITEMPOSITION32, static_cast<WPARAM>(m_moveIndices[i]),
+                    reinterpret_cast<LPARAM>(m_remote + i * sizeof(POINT)));
+    }
+
+    return true;
+}
+
+bool RemoteListView::SetRedraw(bool enable) {
+    if (!m_listView) {
+        return false;
+    }
+
+    // Painting comes back even if the moves could not be sent
+    bool flushed = !enable || FlushMoves();
+
+    SendMessage(m_listView, WM_SETREDRAW, enable ? TRUE : FALSE, 0);
+    if (enable) {
+        InvalidateRect(m_listView, nullptr, TRUE);
+    }
+    return flushed;
+}
@@ -0,0 +1,126 @@
+#include "SelectiveHider.h"
+#include "RemoteListView.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include <algorithm>
+
+namespace {
+    // Far outside any monitor layout
+    constexpr POINT OFFSCREEN_POSITION = { -32000, -32000 };
+
+    bool IsAutoArranged(HWND listView) {
+        return (GetWindowLong(listView, GWL_STYLE) & LVS_AUTOARRANGE) != 0;
+    }
+}
+
+SelectiveHider::SelectiveHider()
+    : m_hiding(false) {
+}
+
+SelectiveHider::~SelectiveHider() {
+}
+
+size_t SelectiveHider::SetKeepRules(const std::vector<std::wstring>& patterns, std::vector<std::wstring>* rejectedPatterns) {
+    m_keepRules.Clear();
+
+    size_t rejected = 0;
+    for (const std::wstring& pattern : patterns) {
+        if (!m_keepRules.Add(pattern)) {
+            rejected++;
+            if (rejectedPatterns) {
+                rejectedPatterns->push_back(pattern);
+            }
+        }
+    }
+
+    return rejected;
+}
+
+bool SelectiveHider::HasRules() const {
+    return !m_keepRules.IsEmpty();
+}
+
+bool SelectiveHider::Hide(HWND listView) {
+    TRACE_SPAN("desktop", "SelectiveHider::Hide");
+
+    if (m_hiding) {
+        return true;
+    }
+
+    if (IsAutoArranged(listView)) {
+        return false;
+    }
+
+    RemoteListView remote;
+    if (!remote.Open(listView)) {
+        return false;
+    }
+
+    std::unique_ptr<RemoteListView::Item[]> items(new RemoteListView::Item[RemoteListView::BATCH_SIZE]);
+    int count = remote.GetItemCount();
+    m_hidden.Clear();
+
+    // One repaint for the whole batch instead of one per moved icon
+    remote.SetRedraw(false);
+
+    for (int first = 0; first < count; first += static_cast<int>(RemoteListView::BATCH_SIZE)) {
+        size_t batch = std::min(RemoteListView::BATCH_SIZE, static_cast<size_t>(count - first));
+        size_t read = remote.ReadItems(first, items.get(), batch);
+
+        for (size_t i = 0; i < read; i++) {
+            if (m_keepRules.Matches(items[i].name)) {
+                continue;
+            }
+
+            m_hidden.Add(items[i].name, items[i].position);
+            remote.MoveItem(first + static_cast<int>(i), OFFSCREEN_POSITION);
+        }
+
+        if (read < batch) {
+            break;
+        }
+    }
+
+    // Even if some moves were lost, the saved positions put every icon back
+    remote.SetRedraw(true);
+    m_hidden.Sort();
+
+    m_hiding = true;
+    Metrics::SelectiveItemsHidden.Set(static_cast<int64_t>(m_hidden.GetCount()));
+    return true;
+}
+
+bool SelectiveHider::Restore(HWND listView) {
+    TRACE_SPAN("desktop", "SelectiveHider::Restore");
+
+    if (!m_hiding) {
+        return true;
+    }
+
+    // Keep the saved positions if Explorer is gone; a restarted Explorer
+    // loads the off-screen positions it saved and they are restored then
+    if (!m_hidden.Apply(listView)) {
+        return false;
+    }
+
+    m_hidden.Clear();
+    m_hiding = false;
+    Metrics::SelectiveItemsHidden.Set(0);
+    return true;
+}
+
+bool SelectiveHider::IsHiding() const {
+    return m_hiding;
+}
+
+size_t SelectiveHider::GetHiddenCount() const {
+    return m_hidden.GetCount();
+}
+
+const IconLayout& SelectiveHider::GetHiddenLayout() const {
+    return m_hidden;
+}
+
+size_t SelectiveHider::GetMemoryUsage() const {
+    return m_keepRules.GetMemoryUsage() + m_hidden.GetMemoryUsage();
+}
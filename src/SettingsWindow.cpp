@@ -92,6 +92,11 @@ void SettingsWindow::Hide() {
     StopHotkeyCapture();
     ShowWindow(m_hwnd, SW_HIDE);
     m_visible = false;
+    
+    // Let the owner know so it can release the window after a while
+    if (m_parentWindow) {
+        PostMessage(m_parentWindow, WM_SETTINGS_CLOSED, 0, 0);
+    }
 }
 
 void SettingsWindow::Destroy() {
@@ -119,15 +124,17 @@ void SettingsWindow::LoadSettings() {
         return;
     }
     
-    m_currentConfig = m_configManager->GetHotkeyConfig();
+    ConfigSnapshotRef settings = m_configManager->GetSnapshot();
+    
+    m_currentConfig = settings->hotkeyConfig;
     m_originalConfig = m_currentConfig;
     
     UpdateControlsFromConfig();
     
     // Load application settings
-    CheckDlgButton(m_hwnd, ID_HOTKEY_CTRL + 10, m_configManager->GetStartWithWindows() ? BST_CHECKED : BST_UNCHECKED);
-    CheckDlgButton(m_hwnd, ID_HOTKEY_CTRL + 11, m_configManager->GetShowNotifications() ? BST_CHECKED : BST_UNCHECKED);
-    CheckDlgButton(m_hwnd, ID_HOTKEY_CTRL + 12, m_configManager->GetRememberState() ? BST_CHECKED : BST_UNCHECKED);
+    CheckDlgButton(m_hwnd, ID_HOTKEY_CTRL + 10, settings->startWithWindows ? BST_CHECKED : BST_UNCHECKED);
+    CheckDlgButton(m_hwnd, ID_HOTKEY_CTRL + 11, settings->showNotifications ? BST_CHECKED : BST_UNCHECKED);
+    CheckDlgButton(m_hwnd, ID_HOTKEY_CTRL + 12, settings->rememberState ? BST_CHECKED : BST_UNCHECKED);
 }
 
 void SettingsWindow::SaveSettings() {
@@ -137,12 +144,17 @@ void SettingsWindow::SaveSettings() {
     
     UpdateConfigFromControls();
     
-    m_configManager->SetHotkeyConfig(m_currentConfig);
+    bool startWithWindows = IsDlgButtonChecked(m_hwnd, ID_HOTKEY_CTRL + 10) == BST_CHECKED;
+    bool showNotifications = IsDlgButtonChecked(m_hwnd, ID_HOTKEY_CTRL + 11) == BST_CHECKED;
+    bool rememberState = IsDlgButtonChecked(m_hwnd, ID_HOTKEY_CTRL + 12) == BST_CHECKED;
     
-    // Save application settings
-    m_configManager->SetStartWithWindows(IsDlgButtonChecked(m_hwnd, ID_HOTKEY_CTRL + 10) == BST_CHECKED);
-    m_configManager->SetShowNotifications(IsDlgButtonChecked(m_hwnd, ID_HOTKEY_CTRL + 11) == BST_CHECKED);
-    m_configManager->SetRememberState(IsDlgButtonChecked(m_hwnd, ID_HOTKEY_CTRL + 12) == BST_CHECKED);
+    // Publish all dialog changes as a single version
+    m_configManager->Update([&](ConfigSnapshot& settings) {
+        settings.hotkeyConfig = m_currentConfig;
+        settings.startWithWindows = startWithWindows;
+        settings.showNotifications = showNotifications;
+        settings.rememberState = rememberState;
+    });
     
     m_configManager->SaveSettings();
 }
@@ -221,7 +233,9 @@ bool SettingsWindow::RegisterWindowClass() {
     wc.hbrBackground = (HBRUSH)(COLOR_BTNFACE + 1);
     wc.lpszClassName = SETTINGS_CLASS_NAME;
 
-    return RegisterClassEx(&wc) != 0;
+    // The window may be created again after being released, in which case
+    // the class is still registered from the first time
+    return RegisterClassEx(&wc) != 0 || GetLastError() == ERROR_CLASS_ALREADY_EXISTS;
 }
 
 bool SettingsWindow::CreateControls() {
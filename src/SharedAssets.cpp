@@ -0,0 +1,315 @@
+#include "SharedAssets.h"
+#include <sddl.h>
+
+const SharedAssetStore* SharedAssetStore::s_active = nullptr;
+
+const wchar_t* LookupSharedKeyName(UINT vkCode) {
+    const SharedAssetStore* store = SharedAssetStore::GetActive();
+    return store ? store->GetKeyName(vkCode) : nullptr;
+}
+
+namespace {
+    // Readers only need to read; the creator keeps the handle it created
+    // the section with
+    constexpr const wchar_t* GLOBAL_SECTION_SDDL = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;WD)";
+    
+    // Another process created the section and is still filling it
+    constexpr int READY_WAIT_ATTEMPTS = 50;
+    
+    struct FixedKeyName {
+        UINT vkCode;
+        const wchar_t* name;
+    };
+    
+    // Keys whose names do not depend on the keyboard layout. GetKeyNameText
+    // also gets the navigation keys wrong (it reports their numpad twins)
+    // unless the extended-key bit is set.
+    const FixedKeyName FIXED_KEY_NAMES[] = {
+        { VK_BACK, L"Backspace" },
+        { VK_TAB, L"Tab" },
+        { VK_RETURN, L"Enter" },
+        { VK_PAUSE, L"Pause" },
+        { VK_ESCAPE, L"Esc" },
+        { VK_SPACE, L"Space" },
+        { VK_PRIOR, L"Page Up" },
+        { VK_NEXT, L"Page Down" },
+        { VK_END, L"End" },
+        { VK_HOME, L"Home" },
+        { VK_LEFT, L"Left" },
+        { VK_UP, L"Up" },
+        { VK_RIGHT, L"Right" },
+        { VK_DOWN, L"Down" },
+        { VK_SNAPSHOT, L"Print Screen" },
+        { VK_INSERT, L"Insert" },
+        { VK_DELETE, L"Delete" },
+        { VK_MULTIPLY, L"Num *" },
+        { VK_ADD, L"Num +" },
+        { VK_SUBTRACT, L"Num -" },
+        { VK_DECIMAL, L"Num ." },
+        { VK_DIVIDE, L"Num /" }
+    };
+}
+
+SharedAssetStore::SharedAssetStore()
+    : m_mapping(nullptr)
+    , m_section(nullptr)
+    , m_machineWide(false) {
+}
+
+SharedAssetStore::~SharedAssetStore() {
+    Cleanup();
+}
+
+bool SharedAssetStore::Initialize() {
+    if (m_section) {
+        return true;
+    }
+    
+    // Prefer one copy for the whole machine, then one per session
+    bool ready = OpenExisting(SharedAssets::GLOBAL_SECTION_NAME) ||
+                 CreateAndPublish(SharedAssets::GLOBAL_SECTION_NAME, true) ||
+                 CreateAndPublish(SharedAssets::LOCAL_SECTION_NAME, false);
+    
+    if (ready) {
+        s_active = this;
+    }
+    return ready;
+}
+
+void SharedAssetStore::Cleanup() {
+    if (s_active == this) {
+        s_active = nullptr;
+    }
+    
+    if (m_section) {
+        UnmapViewOfFile(m_section);
+        m_section = nullptr;
+    }
+    
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    
+    m_machineWide = false;
+}
+
+bool SharedAssetStore::IsMachineWide() const {
+    return m_section && m_machineWide;
+}
+
+size_t SharedAssetStore::GetPrivateBytes() const {
+    // A machine-wide section is shared by every session
+    return (m_section && !m_machineWide) ? sizeof(SharedAssets::Section) : 0;
+}
+
+const uint32_t* SharedAssetStore::GetIconPixels(bool visible) const {
+    return m_section ? m_section->iconPixels[visible ? 1 : 0] : nullptr;
+}
+
+const wchar_t* SharedAssetStore::GetKeyName(UINT vkCode) const {
+    if (!m_section || vkCode >= SharedAssets::KEY_COUNT || m_section->keyNames[vkCode][0] == L'\0') {
+        return nullptr;
+    }
+    return m_section->keyNames[vkCode];
+}
+
+const SharedAssetStore* SharedAssetStore::GetActive() {
+    return s_active;
+}
+
+bool SharedAssetStore::OpenExisting(const wchar_t* name) {
+    m_mapping = OpenFileMapping(FILE_MAP_READ, FALSE, name);
+    if (!m_mapping) {
+        return false;
+    }
+    
+    m_machineWide = true;
+    if (!MapReadOnly()) {
+        Cleanup();
+        return false;
+    }
+    return true;
+}
+
+bool SharedAssetStore::CreateAndPublish(const wchar_t* name, bool machineWide) {
+    SECURITY_ATTRIBUTES security = {};
+    PSECURITY_DESCRIPTOR descriptor = nullptr;
+    if (machineWide) {
+        if (!ConvertStringSecurityDescriptorToSecurityDescriptor(GLOBAL_SECTION_SDDL, SDDL_REVISION_1,
+                                                                 &descriptor, nullptr)) {
+            return false;
+        }
+        security.nLength = sizeof(security);
+        security.lpSecurityDescriptor = descriptor;
+    }
+    
+    // Creating in Global\ needs SeCreateGlobalPrivilege; ordinary sessions
+    // fail here and fall back to Local\.
+    m_mapping = CreateFileMapping(INVALID_HANDLE_VALUE, machineWide ? &security : nullptr,
+                                  PAGE_READWRITE, 0, sizeof(SharedAssets::Section), name);
+    bool created = m_mapping && GetLastError() != ERROR_ALREADY_EXISTS;
+    
+    if (descriptor) {
+        LocalFree(descriptor);
+    }
+    
+    if (!m_mapping) {
+        return false;
+    }
+    
+    m_machineWide = machineWide;
+    
+    if (created) {
+        auto* section = static_cast<SharedAssets::Section*>(
+            MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, sizeof(SharedAssets::Section)));
+        if (!section) {
+            Cleanup();
+            return false;
+        }
+        
+        section->magic = SharedAssets::SECTION_MAGIC;
+        section->version = SharedAssets::SECTION_VERSION;
+        bool rendered = RenderIcon(false, section->iconPixels[0]) &&
+                        RenderIcon(true, section->iconPixels[1]);
+        FillKeyNames(section->keyNames);
+        
+        // Leave "ready" clear if rendering failed so nobody uses the icons
+        if (rendered) {
+            section->ready.store(1, std::memory_order_release);
+        }
+        UnmapViewOfFile(section);
+        
+        if (!rendered) {
+            Cleanup();
+            return false;
+        }
+    }
+    
+    // From here on this process only reads the section
+    if (!MapReadOnly()) {
+        Cleanup();
+        return false;
+    }
+    return true;
+}
+
+bool SharedAssetStore::MapReadOnly() {
+    m_section = static_cast<const SharedAssets::Section*>(
+        MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, sizeof(SharedAssets::Section)));
+    if (!m_section) {
+        return false;
+    }
+    
+    if (!WaitUntilReady() ||
+        m_section->magic != SharedAssets::SECTION_MAGIC ||
+        m_section->version != SharedAssets::SECTION_VERSION) {
+        UnmapViewOfFile(m_section);
+        m_section = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool SharedAssetStore::WaitUntilReady() const {
+    for (int attempt = 0; attempt < READY_WAIT_ATTEMPTS; attempt++) {
+        if (m_section->ready.load(std::memory_order_acquire) != 0) {
+            return true;
+        }
+        Sleep(1);
+    }
+    return false;
+}
+
+bool SharedAssetStore::RenderIcon(bool visible, uint32_t* pixels) {
+    const int iconSize = static_cast<int>(SharedAssets::ICON_SIZE);
+    
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = iconSize;
+    info.bmiHeader.biHeight = -iconSize; // Top-down
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    
+    HDC hdc = GetDC(nullptr);
+    HDC hdcMem = CreateCompatibleDC(hdc);
+    void* bits = nullptr;
+    HBITMAP hBitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &bits, nullptr, 0);
+    if (!hdcMem || !hBitmap || !bits) {
+        if (hBitmap) {
+            DeleteObject(hBitmap);
+        }
+        if (hdcMem) {
+            DeleteDC(hdcMem);
+        }
+        ReleaseDC(nullptr, hdc);
+        return false;
+    }
+    
+    HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
+    
+    // Fill background
+    RECT rect = {0, 0, iconSize, iconSize};
+    FillRect(hdcMem, &rect, (HBRUSH)GetStockObject(WHITE_BRUSH));
+    
+    // Draw icon representation
+    HPEN hPen = CreatePen(PS_SOLID, 1, visible ? RGB(0, 128, 0) : RGB(128, 128, 128));
+    HPEN hOldPen = (HPEN)SelectObject(hdcMem, hPen);
+    
+    if (visible) {
+        // Draw a simple folder icon for visible state
+        Rectangle(hdcMem, 2, 6, 14, 14);
+        Rectangle(hdcMem, 2, 4, 8, 6);
+    } else {
+        // Draw a crossed-out folder for hidden state
+        Rectangle(hdcMem, 2, 6, 14, 14);
+        Rectangle(hdcMem, 2, 4, 8, 6);
+        MoveToEx(hdcMem, 2, 6, nullptr);
+        LineTo(hdcMem, 14, 14);
+        MoveToEx(hdcMem, 14, 6, nullptr);
+        LineTo(hdcMem, 2, 14);
+    }
+    
+    SelectObject(hdcMem, hOldPen);
+    DeleteObject(hPen);
+    GdiFlush();
+    
+    memcpy(pixels, bits, SharedAssets::ICON_PIXELS * sizeof(uint32_t));
+    
+    // Cleanup
+    SelectObject(hdcMem, hOldBitmap);
+    DeleteObject(hBitmap);
+    DeleteDC(hdcMem);
+    ReleaseDC(nullptr, hdc);
+    
+    return true;
+}
+
+void SharedAssetStore::FillKeyNames(wchar_t (*keyNames)[SharedAssets::KEY_NAME_LENGTH]) {
+    for (UINT vk = 0; vk < SharedAssets::KEY_COUNT; vk++) {
+        keyNames[vk][0] = L'\0';
+    }
+    
+    for (UINT vk = '0'; vk <= '9'; vk++) {
+        keyNames[vk][0] = static_cast<wchar_t>(vk);
+        keyNames[vk][1] = L'\0';
+    }
+    
+    for (UINT vk = 'A'; vk <= 'Z'; vk++) {
+        keyNames[vk][0] = static_cast<wchar_t>(vk);
+        keyNames[vk][1] = L'\0';
+    }
+    
+    for (UINT i = 0; i < 24; i++) {
+        swprintf_s(keyNames[VK_F1 + i], SharedAssets::KEY_NAME_LENGTH, L"F%u", i + 1);
+    }
+    
+    for (UINT i = 0; i < 10; i++) {
+        swprintf_s(keyNames[VK_NUMPAD0 + i], SharedAssets::KEY_NAME_LENGTH, L"Num %u", i);
+    }
+    
+    for (const FixedKeyName& key : FIXED_KEY_NAMES) {
+        wcscpy_s(keyNames[key.vkCode], SharedAssets::KEY_NAME_LENGTH, key.name);
+    }
+}
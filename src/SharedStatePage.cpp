@@ -0,0 +1,134 @@
+#include "SharedStatePage.h"
+#include "IpcProtocol.h"
+
+namespace {
+    uint64_t CurrentFileTime() {
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        return (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+    }
+}
+
+SharedStatePublisher::SharedStatePublisher()
+    : m_mapping(nullptr)
+    , m_page(nullptr) {
+    
+    m_changeEvents[0] = nullptr;
+    m_changeEvents[1] = nullptr;
+}
+
+SharedStatePublisher::~SharedStatePublisher() {
+    Cleanup();
+}
+
+bool SharedStatePublisher::Initialize() {
+    if (m_page) {
+        return true;
+    }
+    
+    m_mapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                  0, sizeof(SharedState::Page), SharedState::MAPPING_NAME);
+    if (!m_mapping) {
+        return false;
+    }
+    
+    m_page = static_cast<SharedState::Page*>(
+        MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedState::Page)));
+    if (!m_page) {
+        Cleanup();
+        return false;
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        m_changeEvents[i] = CreateEvent(nullptr, TRUE, FALSE, SharedState::CHANGE_EVENT_NAMES[i]);
+        if (!m_changeEvents[i]) {
+            Cleanup();
+            return false;
+        }
+    }
+    
+    // Readers may already hold the page from a previous run; keep the
+    // counter monotonic across restarts of the publisher
+    uint64_t changeCounter = 0;
+    if (m_page->magic == SharedState::PAGE_MAGIC && m_page->version == SharedState::PAGE_VERSION) {
+        changeCounter = m_page->changeCounter.load(std::memory_order_relaxed);
+    }
+    
+    uint32_t sequence = m_page->sequence.load(std::memory_order_relaxed) & ~1u;
+    m_page->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    m_page->magic = SharedState::PAGE_MAGIC;
+    m_page->version = SharedState::PAGE_VERSION;
+    m_page->publisherProcessId = GetCurrentProcessId();
+    m_page->publisherStartTime = CurrentFileTime();
+    m_page->iconState.store(static_cast<uint32_t>(Ipc::WireState::Unknown), std::memory_order_relaxed);
+    m_page->hotkeyModifiers.store(0, std::memory_order_relaxed);
+    m_page->hotkeyVirtualKey.store(0, std::memory_order_relaxed);
+    m_page->changeCounter.store(changeCounter, std::memory_order_relaxed);
+    
+    m_page->sequence.store(sequence + 2, std::memory_order_release);
+    return true;
+}
+
+void SharedStatePublisher::Cleanup() {
+    if (m_page) {
+        // Tell readers nobody is publishing any more
+        uint32_t sequence = m_page->sequence.load(std::memory_order_relaxed);
+        m_page->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_page->iconState.store(static_cast<uint32_t>(Ipc::WireState::Unknown), std::memory_order_relaxed);
+        m_page->publisherProcessId = 0;
+        m_page->sequence.store(sequence + 2, std::memory_order_release);
+        
+        UnmapViewOfFile(m_page);
+        m_page = nullptr;
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        if (m_changeEvents[i]) {
+            CloseHandle(m_changeEvents[i]);
+            m_changeEvents[i] = nullptr;
+        }
+    }
+    
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+}
+
+void SharedStatePublisher::Publish(IconState iconState, const HotkeyConfig& hotkey) {
+    if (!m_page) {
+        return;
+    }
+    
+    uint32_t state = static_cast<uint32_t>(Ipc::ToWireState(iconState));
+    uint32_t modifiers = hotkey.GetModifiers();
+    uint32_t virtualKey = hotkey.vkCode;
+    
+    // We are the only writer, so our own relaxed reads are exact
+    if (m_page->iconState.load(std::memory_order_relaxed) == state &&
+        m_page->hotkeyModifiers.load(std::memory_order_relaxed) == modifiers &&
+        m_page->hotkeyVirtualKey.load(std::memory_order_relaxed) == virtualKey) {
+        return;
+    }
+    
+    uint64_t changeCounter = m_page->changeCounter.load(std::memory_order_relaxed) + 1;
+    
+    uint32_t sequence = m_page->sequence.load(std::memory_order_relaxed);
+    m_page->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    m_page->iconState.store(state, std::memory_order_relaxed);
+    m_page->hotkeyModifiers.store(modifiers, std::memory_order_relaxed);
+    m_page->hotkeyVirtualKey.store(virtualKey, std::memory_order_relaxed);
+    m_page->changeCounter.store(changeCounter, std::memory_order_relaxed);
+    m_page->lastChangeTime.store(CurrentFileTime(), std::memory_order_relaxed);
+    
+    m_page->sequence.store(sequence + 2, std::memory_order_release);
+    
+    // Arm the event for the next change before signalling this one
+    ResetEvent(m_changeEvents[(changeCounter + 1) & 1]);
+    SetEvent(m_changeEvents[changeCounter & 1]);
+}
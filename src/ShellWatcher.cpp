@@ -0,0 +1,197 @@
+#include "ShellWatcher.h"
+#include "Tracer.h"
+
+ShellWatcher* ShellWatcher::s_waiting = nullptr;
+ShellWatcher* ShellWatcher::s_tracking = nullptr;
+
+ShellWatcher::ShellWatcher()
+    : m_notifyWindow(nullptr)
+    , m_taskbarCreatedMessage(0)
+    , m_hook(nullptr)
+    , m_signalPending(false)
+    , m_signalTime(0)
+    , m_moveHook(nullptr)
+    , m_trackedListView(nullptr)
+    , m_moveSignalPending(false) {
+}
+
+ShellWatcher::~ShellWatcher() {
+    Cleanup();
+}
+
+bool ShellWatcher::Initialize(HWND notifyWindow) {
+    if (!notifyWindow || !IsWindow(notifyWindow)) {
+        return false;
+    }
+
+    m_notifyWindow = notifyWindow;
+
+    m_taskbarCreatedMessage = RegisterWindowMessage(L"TaskbarCreated");
+    if (m_taskbarCreatedMessage == 0) {
+        return false;
+    }
+
+    // An elevated instance would otherwise never see the broadcast
+    ChangeWindowMessageFilterEx(m_notifyWindow, m_taskbarCreatedMessage, MSGFLT_ALLOW, nullptr);
+
+    return true;
+}
+
+void ShellWatcher::Cleanup() {
+    StopWaiting();
+    StopTrackingIconMoves();
+    m_notifyWindow = nullptr;
+    m_taskbarCreatedMessage = 0;
+}
+
+UINT ShellWatcher::GetTaskbarCreatedMessage() const {
+    return m_taskbarCreatedMessage;
+}
+
+bool ShellWatcher::BeginWaiting() {
+    if (m_hook) {
+        return true;
+    }
+
+    if (!m_notifyWindow || (s_waiting && s_waiting != this)) {
+        return false;
+    }
+
+    TRACE_SPAN("shell", "BeginWaiting");
+
+    // Out-of-context events are delivered to this thread's message loop, so
+    // the idle wait stays a plain MsgWaitForMultipleObjectsEx
+    s_waiting = this;
+    m_hook = SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_SHOW, nullptr, WinEventProc,
+                             0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+    if (!m_hook) {
+        s_waiting = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ShellWatcher::StopWaiting() {
+    if (m_hook) {
+        UnhookWinEvent(m_hook);
+        m_hook = nullptr;
+    }
+
+    if (s_waiting == this) {
+        s_waiting = nullptr;
+    }
+}
+
+bool ShellWatcher::IsWaiting() const {
+    return m_hook != nullptr;
+}
+
+void ShellWatcher::ResetSignal() {
+    m_signalPending = false;
+}
+
+LONGLONG ShellWatcher::GetSignalTime() const {
+    return m_signalTime;
+}
+
+void ShellWatcher::MarkSignalTime() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_signalTime = now.QuadPart;
+}
+
+bool ShellWatcher::TrackIconMoves(HWND listView) {
+    StopTrackingIconMoves();
+
+    if (!m_notifyWindow || !listView || (s_tracking && s_tracking != this)) {
+        return false;
+    }
+
+    DWORD processId = 0;
+    DWORD threadId = GetWindowThreadProcessId(listView, &processId);
+    if (threadId == 0) {
+        return false;
+    }
+
+    TRACE_SPAN("shell", "TrackIconMoves");
+
+    // Limited to the listview's thread so the rest of the session's
+    // location changes (carets, dragged windows) never reach this process
+    s_tracking = this;
+    m_trackedListView = listView;
+    m_moveHook = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, nullptr, MoveEventProc,
+                                 processId, threadId, WINEVENT_OUTOFCONTEXT);
+    if (!m_moveHook) {
+        s_tracking = nullptr;
+        m_trackedListView = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ShellWatcher::StopTrackingIconMoves() {
+    if (m_moveHook) {
+        UnhookWinEvent(m_moveHook);
+        m_moveHook = nullptr;
+    }
+
+    if (s_tracking == this) {
+        s_tracking = nullptr;
+    }
+
+    m_trackedListView = nullptr;
+    m_moveSignalPending = false;
+}
+
+bool ShellWatcher::IsTrackingIconMoves() const {
+    return m_moveHook != nullptr;
+}
+
+void ShellWatcher::ResetIconMoveSignal() {
+    m_moveSignalPending = false;
+}
+
+void CALLBACK ShellWatcher::MoveEventProc(HWINEVENTHOOK, DWORD, HWND hwnd,
+                                          LONG idObject, LONG idChild, DWORD, DWORD) {
+    // Listview items report their moves as children of the client object
+    ShellWatcher* watcher = s_tracking;
+    if (!watcher || idObject != OBJID_CLIENT || idChild == CHILDID_SELF ||
+        hwnd != watcher->m_trackedListView || watcher->m_moveSignalPending) {
+        return;
+    }
+
+    watcher->m_moveSignalPending = true;
+    PostMessage(watcher->m_notifyWindow, WM_ICONS_MOVED, 0, 0);
+}
+
+void CALLBACK ShellWatcher::WinEventProc(HWINEVENTHOOK, DWORD, HWND hwnd,
+                                         LONG idObject, LONG idChild, DWORD, DWORD) {
+    if (idObject != OBJID_WINDOW || idChild != CHILDID_SELF || !hwnd || !s_waiting) {
+        return;
+    }
+
+    s_waiting->OnWindowEvent(hwnd);
+}
+
+void ShellWatcher::OnWindowEvent(HWND hwnd) {
+    // Every window in the session passes through here while waiting, so
+    // drop everything quickly once a signal is already queued
+    if (m_signalPending) {
+        return;
+    }
+
+    wchar_t className[32];
+    if (!GetClassName(hwnd, className, 32)) {
+        return;
+    }
+
+    if (wcscmp(className, L"SysListView32") != 0 && wcscmp(className, L"SHELLDLL_DefView") != 0) {
+        return;
+    }
+
+    MarkSignalTime();
+    m_signalPending = true;
+    PostMessage(m_notifyWindow, WM_SHELL_READY, 0, 0);
+}
@@ -0,0 +1,137 @@
+#include "StartupProfiler.h"
+#include <cstdio>
+#include <cstring>
+
+StartupProfiler::StartupProfiler()
+    : m_phaseCount(0)
+    , m_phaseOpen(false)
+    , m_startTime(0)
+    , m_phaseStart(0)
+    , m_totalMs(0.0)
+    , m_totalBudgetMs(0.0) {
+    
+    QueryPerformanceFrequency(&m_frequency);
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_startTime = now.QuadPart;
+}
+
+void StartupProfiler::BeginPhase(const char* name) {
+    if (m_phaseOpen) {
+        EndPhase();
+    }
+    
+    if (m_phaseCount >= MAX_PHASES) {
+        return;
+    }
+    
+    Phase& phase = m_phases[m_phaseCount];
+    phase.name = name;
+    phase.elapsedMs = 0.0;
+    phase.budgetMs = 0.0;
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_phaseStart = now.QuadPart;
+    m_phaseOpen = true;
+}
+
+void StartupProfiler::EndPhase() {
+    if (!m_phaseOpen) {
+        return;
+    }
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_phases[m_phaseCount].elapsedMs = ElapsedMs(m_phaseStart, now.QuadPart);
+    m_phaseCount++;
+    m_phaseOpen = false;
+}
+
+void StartupProfiler::Finish() {
+    EndPhase();
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    m_totalMs = ElapsedMs(m_startTime, now.QuadPart);
+}
+
+void StartupProfiler::SetBudget(const char* name, double budgetMs) {
+    if (strcmp(name, "Total") == 0) {
+        m_totalBudgetMs = budgetMs;
+        return;
+    }
+    
+    for (size_t i = 0; i < m_phaseCount; i++) {
+        if (strcmp(m_phases[i].name, name) == 0) {
+            m_phases[i].budgetMs = budgetMs;
+        }
+    }
+}
+
+bool StartupProfiler::IsWithinBudget() const {
+    if (m_totalBudgetMs > 0.0 && m_totalMs > m_totalBudgetMs) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < m_phaseCount; i++) {
+        const Phase& phase = m_phases[i];
+        if (phase.budgetMs > 0.0 && phase.elapsedMs > phase.budgetMs) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+size_t StartupProfiler::GetPhaseCount() const {
+    return m_phaseCount;
+}
+
+const StartupProfiler::Phase& StartupProfiler::GetPhase(size_t index) const {
+    return m_phases[index];
+}
+
+double StartupProfiler::GetTotalMs() const {
+    return m_totalMs;
+}
+
+bool StartupProfiler::WriteReport(const std::wstring& path) const {
+    std::string json;
+    char line[256];
+    
+    snprintf(line, sizeof(line),
+             "{\n  \"version\": 1,\n  \"totalMs\": %.3f,\n  \"totalBudgetMs\": %.3f,\n  \"withinBudget\": %s,\n  \"phases\": [\n",
+             m_totalMs, m_totalBudgetMs, IsWithinBudget() ? "true" : "false");
+    json += line;
+    
+    for (size_t i = 0; i < m_phaseCount; i++) {
+        const Phase& phase = m_phases[i];
+        bool withinBudget = phase.budgetMs <= 0.0 || phase.elapsedMs <= phase.budgetMs;
+        snprintf(line, sizeof(line),
+                 "    { \"name\": \"%s\", \"ms\": %.3f, \"budgetMs\": %.3f, \"withinBudget\": %s }%s\n",
+                 phase.name, phase.elapsedMs, phase.budgetMs, withinBudget ? "true" : "false",
+                 (i + 1 < m_phaseCount) ? "," : "");
+        json += line;
+    }
+    
+    json += "  ]\n}\n";
+    
+    HANDLE hFile = CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    DWORD bytesWritten = 0;
+    bool success = WriteFile(hFile, json.data(), static_cast<DWORD>(json.size()), &bytesWritten, nullptr) &&
+                   bytesWritten == json.size();
+    CloseHandle(hFile);
+    
+    return success;
+}
+
+double StartupProfiler::ElapsedMs(LONGLONG from, LONGLONG to) const {
+    return (to - from) * 1000.0 / m_frequency.QuadPart;
+}
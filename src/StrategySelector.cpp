@@ -0,0 +1,136 @@
+#include "StrategySelector.h"
+
+StrategySelector::StrategySelector(size_t count, uint32_t calibrationSamples)
+    : m_count(count < MAX_STRATEGIES ? count : MAX_STRATEGIES)
+    , m_calibrationSamples(calibrationSamples)
+    , m_stats{}
+    , m_selected(0)
+    , m_hiddenBy(NPOS)
+    , m_calibrating(true)
+    , m_selectionChanged(false) {
+}
+
+StrategySelector::~StrategySelector() {
+}
+
+void StrategySelector::Calibrate() {
+    m_calibrating = true;
+}
+
+void StrategySelector::Select(size_t index) {
+    if (index < m_count) {
+        m_selected = index;
+        m_calibrating = false;
+    }
+}
+
+bool StrategySelector::IsCalibrating() const {
+    return m_calibrating;
+}
+
+size_t StrategySelector::GetSelected() const {
+    return m_selected;
+}
+
+bool StrategySelector::TakeSelectionChanged() {
+    bool changed = m_selectionChanged;
+    m_selectionChanged = false;
+    return changed;
+}
+
+size_t StrategySelector::First(bool visible) const {
+    if (!m_calibrating) {
+        return m_selected;
+    }
+
+    if (visible && m_hiddenBy != NPOS && !m_stats[m_hiddenBy].failed) {
+        return m_hiddenBy;
+    }
+
+    size_t next = NextCalibration();
+    if (next != NPOS) {
+        return next;
+    }
+
+    // Everything measured or failed, and no show has finished it yet
+    bool tried[MAX_STRATEGIES] = {};
+    return NextFallback(tried);
+}
+
+size_t StrategySelector::NextFallback(const bool* tried) const {
+    size_t next = NPOS;
+    uint64_t nextKey = 0;
+    for (size_t i = 0; i < m_count; ++i) {
+        if (tried[i]) {
+            continue;
+        }
+
+        // Failed strategies last, then unmeasured ones
+        uint64_t key = m_stats[i].failed ? UINT64_MAX :
+                       m_stats[i].bestLatencyUs ? m_stats[i].bestLatencyUs : UINT64_MAX - 1;
+        if (next == NPOS || key < nextKey) {
+            next = i;
+            nextKey = key;
+        }
+    }
+
+    return next;
+}
+
+size_t StrategySelector::NextCalibration() const {
+    // Fewest samples first, so the strategies take turns
+    size_t next = NPOS;
+    for (size_t i = 0; i < m_count; ++i) {
+        if (m_stats[i].failed || m_stats[i].samples >= m_calibrationSamples) {
+            continue;
+        }
+
+        if (next == NPOS || m_stats[i].samples < m_stats[next].samples) {
+            next = i;
+        }
+    }
+
+    return next;
+}
+
+void StrategySelector::Record(size_t index, bool visible, uint64_t latencyUs) {
+    Stats& stats = m_stats[index];
+    stats.failed = false;
+    stats.samples++;
+    if (stats.bestLatencyUs == 0 || latencyUs < stats.bestLatencyUs) {
+        stats.bestLatencyUs = latencyUs > 0 ? latencyUs : 1;
+    }
+
+    m_hiddenBy = visible ? NPOS : index;
+
+    if (m_calibrating) {
+        if (visible && NextCalibration() == NPOS) {
+            FinishCalibration();
+        }
+    } else if (index != m_selected) {
+        m_selected = index;
+        m_selectionChanged = true;
+    }
+}
+
+void StrategySelector::FinishCalibration() {
+    size_t best = NPOS;
+    for (size_t i = 0; i < m_count; ++i) {
+        if (m_stats[i].failed || m_stats[i].samples == 0) {
+            continue;
+        }
+
+        if (best == NPOS || m_stats[i].bestLatencyUs < m_stats[best].bestLatencyUs) {
+            best = i;
+        }
+    }
+
+    // Nothing worked yet; keep calibrating
+    if (best == NPOS) {
+        return;
+    }
+
+    m_selected = best;
+    m_calibrating = false;
+    m_selectionChanged = true;
+}
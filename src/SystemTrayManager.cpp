@@ -1,4 +1,9 @@
 #include "SystemTrayManager.h"
+#include "CommandBus.h"
+#include "SharedAssets.h"
+#include "Tracer.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
 #include <windowsx.h>
 
 SystemTrayManager::SystemTrayManager()
@@ -7,6 +12,8 @@ SystemTrayManager::SystemTrayManager()
     , m_contextMenu(nullptr)
     , m_initialized(false)
     , m_currentIconState(IconState::Visible)
+    , m_commandBus(nullptr)
+    , m_sharedAssets(nullptr)
     , m_iconVisible(nullptr)
     , m_iconHidden(nullptr) {
     
@@ -46,7 +53,14 @@ bool SystemTrayManager::Initialize(HWND targetWindow, HINSTANCE hInstance) {
     wcscpy_s(m_notifyIconData.szTip, APP_NAME);
     
     m_initialized = true;
-    return CreateTrayIcon();
+    
+    // Fails while the taskbar does not exist yet (early at logon); the icon
+    // is added again when the taskbar is created
+    if (!CreateTrayIcon()) {
+        OutputDebugString(L"Taskbar not available yet; tray icon deferred\n");
+    }
+    
+    return true;
 }
 
 void SystemTrayManager::Cleanup() {
@@ -76,20 +90,26 @@ bool SystemTrayManager::RemoveTrayIcon() {
 }
 
 bool SystemTrayManager::UpdateTrayIcon(IconState iconState) {
+    TRACE_SPAN("tray", "UpdateTrayIcon");
+    ALLOCATION_SCOPE(Tray);
+    
     if (!m_initialized) {
         return false;
     }
     
     m_currentIconState = iconState;
+    Metrics::TrayUpdates.Increment();
     
-    // Update icon
-    m_notifyIconData.hIcon = (iconState == IconState::Visible) ? m_iconVisible : m_iconHidden;
+    // Update icon, rebuilding it if it was released while idle
+    HICON& icon = (iconState == IconState::Visible) ? m_iconVisible : m_iconHidden;
+    if (!icon) {
+        icon = CreateCustomIcon(iconState == IconState::Visible);
+    }
+    m_notifyIconData.hIcon = icon;
     
-    // Update tooltip
-    std::wstring tooltip = APP_NAME;
-    tooltip += L" - Icons ";
-    tooltip += (iconState == IconState::Visible) ? L"Visible" : L"Hidden";
-    wcscpy_s(m_notifyIconData.szTip, tooltip.c_str());
+    // Update tooltip in place
+    swprintf_s(m_notifyIconData.szTip, L"%s - Icons %s", APP_NAME,
+               (iconState == IconState::Visible) ? L"Visible" : L"Hidden");
     
     // Update menu text
     UpdateMenuItemText();
@@ -97,7 +117,10 @@ bool SystemTrayManager::UpdateTrayIcon(IconState iconState) {
     return Shell_NotifyIcon(NIM_MODIFY, &m_notifyIconData) != FALSE;
 }
 
-bool SystemTrayManager::ShowBalloonTip(const std::wstring& title, const std::wstring& message, DWORD timeout) {
+bool SystemTrayManager::ShowBalloonTip(const wchar_t* title, const wchar_t* message, DWORD timeout) {
+    TRACE_SPAN("tray", "ShowBalloonTip");
+    ALLOCATION_SCOPE(Tray);
+    
     if (!m_initialized) {
         return false;
     }
@@ -106,14 +129,19 @@ bool SystemTrayManager::ShowBalloonTip(const std::wstring& title, const std::wst
     nid.uFlags |= NIF_INFO;
     nid.dwInfoFlags = NIIF_INFO;
     nid.uTimeout = timeout;
-    wcscpy_s(nid.szInfoTitle, title.c_str());
-    wcscpy_s(nid.szInfo, message.c_str());
+    wcscpy_s(nid.szInfoTitle, title);
+    wcscpy_s(nid.szInfo, message);
     
     return Shell_NotifyIcon(NIM_MODIFY, &nid) != FALSE;
 }
 
 bool SystemTrayManager::ShowContextMenu(int x, int y) {
-    if (!m_initialized || !m_contextMenu) {
+    if (!m_initialized) {
+        return false;
+    }
+    
+    // The menu may have been released while idle
+    if (!m_contextMenu && !CreateContextMenu()) {
         return false;
     }
     
@@ -139,20 +167,61 @@ bool SystemTrayManager::ShowContextMenu(int x, int y) {
 bool SystemTrayManager::HandleMenuCommand(UINT commandId) {
     switch (commandId) {
         case ID_MENU_TOGGLE:
-            if (m_toggleCallback) {
-                m_toggleCallback();
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::ToggleIcons, CommandSource::Menu);
+            }
+            return true;
+            
+        case ID_MENU_TOGGLE_MONITOR:
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::ToggleMonitorIcons, CommandSource::Menu);
+            }
+            return true;
+            
+        case ID_MENU_HIDE_FOR:
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::HideIconsFor, CommandSource::Menu, TIMED_HIDE_MINUTES);
+            }
+            return true;
+            
+        case ID_MENU_SAVE_LAYOUT:
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::SaveLayout, CommandSource::Menu);
+            }
+            return true;
+            
+        case ID_MENU_RESTORE_LAYOUT:
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::RestoreLayout, CommandSource::Menu);
+            }
+            return true;
+            
+        case ID_MENU_UNDO_LAYOUT:
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::UndoLayout, CommandSource::Menu);
+            }
+            return true;
+            
+        case ID_MENU_LAYOUT_HOUR_AGO:
+        case ID_MENU_LAYOUT_DAY_AGO:
+        case ID_MENU_LAYOUT_WEEK_AGO:
+            if (m_commandBus) {
+                uint32_t minutes = commandId == ID_MENU_LAYOUT_HOUR_AGO ? LAYOUT_HOUR_AGO_MINUTES :
+                                   commandId == ID_MENU_LAYOUT_DAY_AGO ? LAYOUT_DAY_AGO_MINUTES :
+                                   LAYOUT_WEEK_AGO_MINUTES;
+                m_commandBus->Post(CommandType::RestoreLayoutAt, CommandSource::Menu, minutes);
             }
             return true;
             
         case ID_MENU_SETTINGS:
-            if (m_settingsCallback) {
-                m_settingsCallback();
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::ShowSettings, CommandSource::Menu);
             }
             return true;
             
         case ID_MENU_EXIT:
-            if (m_exitCallback) {
-                m_exitCallback();
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::Exit, CommandSource::Menu);
             }
             return true;
             
@@ -162,6 +231,8 @@ bool SystemTrayManager::HandleMenuCommand(UINT commandId) {
 }
 
 bool SystemTrayManager::HandleTrayMessage(WPARAM wParam, LPARAM lParam) {
+    TRACE_SPAN("tray", "HandleTrayMessage");
+    
     if (wParam != ID_TRAY_ICON) {
         return false;
     }
@@ -169,8 +240,8 @@ bool SystemTrayManager::HandleTrayMessage(WPARAM wParam, LPARAM lParam) {
     switch (lParam) {
         case WM_LBUTTONUP:
             // Left click - toggle icons
-            if (m_toggleCallback) {
-                m_toggleCallback();
+            if (m_commandBus) {
+                m_commandBus->Post(CommandType::ToggleIcons, CommandSource::Tray);
             }
             return true;
             
@@ -200,16 +271,37 @@ IconState SystemTrayManager::GetIconState() const {
     return m_currentIconState;
 }
 
-void SystemTrayManager::SetToggleCallback(std::function<void()> callback) {
-    m_toggleCallback = callback;
+void SystemTrayManager::SetCommandBus(CommandBus* commandBus) {
+    m_commandBus = commandBus;
+}
+
+void SystemTrayManager::SetSharedAssets(const SharedAssetStore* sharedAssets) {
+    m_sharedAssets = sharedAssets;
 }
 
-void SystemTrayManager::SetSettingsCallback(std::function<void()> callback) {
-    m_settingsCallback = callback;
+void SystemTrayManager::ReleaseCachedResources() {
+    DestroyContextMenu();
+    
+    // The shell keeps its own copy of the icon it shows, but NIM_MODIFY
+    // re-sends ours, so only the other one can go
+    HICON& unused = (m_notifyIconData.hIcon == m_iconVisible) ? m_iconHidden : m_iconVisible;
+    if (unused) {
+        DestroyIcon(unused);
+        unused = nullptr;
+    }
 }
 
-void SystemTrayManager::SetExitCallback(std::function<void()> callback) {
-    m_exitCallback = callback;
+size_t SystemTrayManager::GetMemoryUsage() const {
+    // Each icon is a 16x16 colour bitmap plus a monochrome mask
+    const size_t iconBytes = 16 * 16 * 4 + 16 * 16 / 8;
+    size_t bytes = sizeof(*this);
+    if (m_iconVisible) {
+        bytes += iconBytes;
+    }
+    if (m_iconHidden) {
+        bytes += iconBytes;
+    }
+    return bytes;
 }
 
 bool SystemTrayManager::LoadIcons() {
@@ -239,7 +331,21 @@ bool SystemTrayManager::CreateContextMenu() {
     }
     
     // Add menu items
-    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_TOGGLE, GetToggleMenuText().c_str());
+    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_TOGGLE, GetToggleMenuText());
+    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_TOGGLE_MONITOR, L"Toggle Icons on This Monitor");
+    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_HIDE_FOR, L"Hide Icons for 25 Minutes");
+    AppendMenu(m_contextMenu, MF_SEPARATOR, 0, nullptr);
+    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_SAVE_LAYOUT, L"Save Icon Layout");
+    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_RESTORE_LAYOUT, L"Restore Icon Layout");
+    AppendMenu(m_contextMenu, MF_STRING, ID_MENU_UNDO_LAYOUT, L"Undo Icon Layout Change");
+    
+    HMENU historyMenu = CreatePopupMenu();
+    if (historyMenu) {
+        AppendMenu(historyMenu, MF_STRING, ID_MENU_LAYOUT_HOUR_AGO, L"An Hour Ago");
+        AppendMenu(historyMenu, MF_STRING, ID_MENU_LAYOUT_DAY_AGO, L"Yesterday");
+        AppendMenu(historyMenu, MF_STRING, ID_MENU_LAYOUT_WEEK_AGO, L"Last Week");
+        AppendMenu(m_contextMenu, MF_POPUP, reinterpret_cast<UINT_PTR>(historyMenu), L"Icon Layout From");
+    }
     AppendMenu(m_contextMenu, MF_SEPARATOR, 0, nullptr);
     AppendMenu(m_contextMenu, MF_STRING, ID_MENU_SETTINGS, L"Settings...");
     AppendMenu(m_contextMenu, MF_SEPARATOR, 0, nullptr);
@@ -256,59 +362,22 @@ void SystemTrayManager::DestroyContextMenu() {
 }
 
 HICON SystemTrayManager::CreateCustomIcon(bool visible) {
-    // Create a simple 16x16 icon
-    const int iconSize = 16;
-    HDC hdc = GetDC(nullptr);
-    HDC hdcMem = CreateCompatibleDC(hdc);
-    HBITMAP hBitmap = CreateCompatibleBitmap(hdc, iconSize, iconSize);
-    HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
-    
-    // Fill background
-    RECT rect = {0, 0, iconSize, iconSize};
-    FillRect(hdcMem, &rect, (HBRUSH)GetStockObject(WHITE_BRUSH));
-    
-    // Draw icon representation
-    HPEN hPen = CreatePen(PS_SOLID, 1, visible ? RGB(0, 128, 0) : RGB(128, 128, 128));
-    HPEN hOldPen = (HPEN)SelectObject(hdcMem, hPen);
-    
-    if (visible) {
-        // Draw a simple folder icon for visible state
-        Rectangle(hdcMem, 2, 6, 14, 14);
-        Rectangle(hdcMem, 2, 4, 8, 6);
-    } else {
-        // Draw a crossed-out folder for hidden state
-        Rectangle(hdcMem, 2, 6, 14, 14);
-        Rectangle(hdcMem, 2, 4, 8, 6);
-        MoveToEx(hdcMem, 2, 6, nullptr);
-        LineTo(hdcMem, 14, 14);
-        MoveToEx(hdcMem, 14, 6, nullptr);
-        LineTo(hdcMem, 2, 14);
+    // Use the bitmap every session shares; render our own only if the
+    // shared section is unavailable
+    uint32_t localPixels[SharedAssets::ICON_PIXELS];
+    const uint32_t* pixels = m_sharedAssets ? m_sharedAssets->GetIconPixels(visible) : nullptr;
+    if (!pixels) {
+        if (!SharedAssetStore::RenderIcon(visible, localPixels)) {
+            return nullptr;
+        }
+        pixels = localPixels;
     }
     
-    SelectObject(hdcMem, hOldPen);
-    DeleteObject(hPen);
-    
-    // Create mask bitmap
-    HBITMAP hMask = CreateBitmap(iconSize, iconSize, 1, 1, nullptr);
-    
-    // Create icon
-    ICONINFO iconInfo;
-    iconInfo.fIcon = TRUE;
-    iconInfo.xHotspot = 0;
-    iconInfo.yHotspot = 0;
-    iconInfo.hbmMask = hMask;
-    iconInfo.hbmColor = hBitmap;
-    
-    HICON hIcon = CreateIconIndirect(&iconInfo);
-    
-    // Cleanup
-    SelectObject(hdcMem, hOldBitmap);
-    DeleteObject(hBitmap);
-    DeleteObject(hMask);
-    DeleteDC(hdcMem);
-    ReleaseDC(nullptr, hdc);
+    // All-zero AND mask: the icon is fully opaque
+    const BYTE mask[SharedAssets::ICON_PIXELS / 8] = {};
     
-    return hIcon;
+    return CreateIcon(m_hInstance, SharedAssets::ICON_SIZE, SharedAssets::ICON_SIZE, 1, 32,
+                      mask, reinterpret_cast<const BYTE*>(pixels));
 }
 
 void SystemTrayManager::UpdateMenuItemText() {
@@ -317,9 +386,9 @@ void SystemTrayManager::UpdateMenuItemText() {
     }
     
     ModifyMenu(m_contextMenu, ID_MENU_TOGGLE, MF_BYCOMMAND | MF_STRING, 
-               ID_MENU_TOGGLE, GetToggleMenuText().c_str());
+               ID_MENU_TOGGLE, GetToggleMenuText());
 }
 
-std::wstring SystemTrayManager::GetToggleMenuText() const {
+const wchar_t* SystemTrayManager::GetToggleMenuText() const {
     return (m_currentIconState == IconState::Visible) ? L"Hide Desktop Icons" : L"Show Desktop Icons";
 }
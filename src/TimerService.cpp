@@ -0,0 +1,176 @@
+#include "TimerService.h"
+#include "Metrics.h"
+#include <algorithm>
+
+namespace {
+    constexpr size_t TIMER_COUNT = static_cast<size_t>(TimerId::Count);
+    
+    // WM_TIMER can arrive a tick early; treat deadlines this close as due
+    // rather than re-arming for a few milliseconds
+    constexpr ULONGLONG EARLY_FIRE_SLACK_MS = 16;
+    
+    // Wheel cookies: TimerIds as they are, cookie timers with the top bit set
+    constexpr uint64_t COOKIE_FLAG = 1ull << 63;
+}
+
+TimerService::TimerService()
+    : m_window(nullptr)
+    , m_nextExpiredCookie(0)
+    , m_armedDeadline(0) {
+    
+    for (size_t i = 0; i < TIMER_COUNT; i++) {
+        m_entries[i] = {};
+    }
+}
+
+TimerService::~TimerService() {
+    Cleanup();
+}
+
+bool TimerService::Initialize(HWND window) {
+    if (!window || !IsWindow(window)) {
+        return false;
+    }
+    
+    m_window = window;
+    return true;
+}
+
+void TimerService::Cleanup() {
+    for (size_t i = 0; i < TIMER_COUNT; i++) {
+        m_entries[i].handle = 0;
+    }
+    m_wheel.Clear();
+    m_expiredCookies.clear();
+    m_nextExpiredCookie = 0;
+    
+    Rearm();
+    m_window = nullptr;
+}
+
+void TimerService::Schedule(TimerId id, DWORD delayMs, DWORD toleranceMs) {
+    Entry& entry = m_entries[static_cast<size_t>(id)];
+    m_wheel.Cancel(entry.handle);
+    
+    ULONGLONG now = GetTickCount64();
+    entry.handle = m_wheel.Insert(now, now + delayMs, static_cast<uint64_t>(id));
+    entry.toleranceMs = toleranceMs;
+    
+    Rearm();
+}
+
+void TimerService::Cancel(TimerId id) {
+    Entry& entry = m_entries[static_cast<size_t>(id)];
+    if (entry.handle == 0) {
+        return;
+    }
+    
+    m_wheel.Cancel(entry.handle);
+    entry.handle = 0;
+    Rearm();
+}
+
+bool TimerService::IsScheduled(TimerId id) const {
+    return m_entries[static_cast<size_t>(id)].handle != 0;
+}
+
+size_t TimerService::GetScheduledCount() const {
+    return m_wheel.GetCount();
+}
+
+TimerWheel::Handle TimerService::ScheduleCookie(ULONGLONG delayMs, uint64_t cookie) {
+    ULONGLONG now = GetTickCount64();
+    TimerWheel::Handle handle = m_wheel.Insert(now, now + delayMs, cookie | COOKIE_FLAG);
+    
+    Rearm();
+    return handle;
+}
+
+void TimerService::CancelCookie(TimerWheel::Handle handle) {
+    if (m_wheel.Cancel(handle)) {
+        Rearm();
+    }
+}
+
+uint32_t TimerService::TakeExpired() {
+    Metrics::TimerWakeups.Increment();
+    
+    m_wheel.Advance(GetTickCount64() + EARLY_FIRE_SLACK_MS);
+    
+    // Cookies the caller did not take last time are dropped
+    m_expiredCookies.clear();
+    m_nextExpiredCookie = 0;
+    
+    uint32_t expired = 0;
+    uint64_t cookie;
+    while (m_wheel.PopExpired(cookie)) {
+        if (cookie & COOKIE_FLAG) {
+            m_expiredCookies.push_back(cookie & ~COOKIE_FLAG);
+            continue;
+        }
+        
+        m_entries[cookie].handle = 0;
+        expired |= Bit(static_cast<TimerId>(cookie));
+    }
+    
+    // The Win32 timer is periodic; always re-arm or kill it here
+    m_armedDeadline = 0;
+    Rearm();
+    
+    return expired;
+}
+
+bool TimerService::TakeExpiredCookie(uint64_t& cookie) {
+    if (m_nextExpiredCookie >= m_expiredCookies.size()) {
+        return false;
+    }
+    
+    cookie = m_expiredCookies[m_nextExpiredCookie++];
+    return true;
+}
+
+size_t TimerService::GetMemoryUsage() const {
+    return m_wheel.GetMemoryUsage() + m_expiredCookies.capacity() * sizeof(uint64_t);
+}
+
+void TimerService::Rearm() {
+    Metrics::TimersPending.Set(static_cast<int64_t>(m_wheel.GetCount()));
+    
+    if (!m_window) {
+        return;
+    }
+    
+    ULONGLONG earliest = 0;
+    if (!m_wheel.GetNextDeadline(earliest)) {
+        // Nothing scheduled: no timer at all while idle
+        if (m_armedDeadline != 0) {
+            KillTimer(m_window, ID_TIMER_SERVICE);
+            m_armedDeadline = 0;
+        }
+        return;
+    }
+    
+    if (earliest == m_armedDeadline) {
+        return;
+    }
+    
+    // The tightest tolerance of the scheduled TimerIds; cookie timers
+    // accept the default
+    DWORD tolerance = TIMER_DEFAULT_TOLERANCE_MS;
+    for (size_t i = 0; i < TIMER_COUNT; i++) {
+        if (m_entries[i].handle != 0 && m_entries[i].toleranceMs < tolerance) {
+            tolerance = m_entries[i].toleranceMs;
+        }
+    }
+    
+    ULONGLONG now = GetTickCount64();
+    UINT delay = (earliest > now) ? static_cast<UINT>(std::min<ULONGLONG>(earliest - now, USER_TIMER_MAXIMUM)) : USER_TIMER_MINIMUM;
+    if (delay < USER_TIMER_MINIMUM) {
+        delay = USER_TIMER_MINIMUM;
+    }
+    
+    // Re-using the ID replaces any previously armed deadline
+    if (SetCoalescableTimer(m_window, ID_TIMER_SERVICE, delay, nullptr, tolerance)) {
+        m_armedDeadline = earliest;
+    }
+}
@@ -0,0 +1,329 @@
+#include "TimerWheel.h"
+
+namespace {
+    constexpr uint64_t NO_TICK = ~0ull;
+
+    // Index of the lowest set bit, value non-zero (de Bruijn sequence)
+    uint32_t LowestBit(uint64_t value) {
+        static const uint8_t TABLE[64] = {
+            0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+            62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+            63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+            46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+        };
+        return TABLE[((value & (0 - value)) * 0x03F79D71B4CB0A89ull) >> 58];
+    }
+
+    uint64_t RotateRight(uint64_t value, uint32_t shift) {
+        return shift == 0 ? value : (value >> shift) | (value << (64 - shift));
+    }
+
+    uint64_t HandleOf(uint32_t index, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) | (index + 1);
+    }
+}
+
+TimerWheel::TimerWheel()
+    : m_free(NIL)
+    , m_expiredTail(NIL)
+    , m_current(0)
+    , m_count(0) {
+
+    for (uint32_t& head : m_heads) {
+        head = NIL;
+    }
+    for (uint64_t& bound : m_slotMin) {
+        bound = NO_TICK;
+    }
+    for (uint64_t& bits : m_occupied) {
+        bits = 0;
+    }
+}
+
+TimerWheel::~TimerWheel() {
+}
+
+TimerWheel::Handle TimerWheel::Insert(uint64_t nowMs, uint64_t deadlineMs, uint64_t cookie) {
+    // Nothing happens between the last processed tick and the next event,
+    // so the wheel can catch up to now for free. Keeping it close to now
+    // keeps new timers on the lower levels.
+    uint64_t nowTick = nowMs / TICK_MS;
+    uint64_t next = NextEventTick();
+    uint64_t reachable = (next == NO_TICK) ? nowTick : (next - 1 < nowTick ? next - 1 : nowTick);
+    if (reachable > m_current) {
+        m_current = reachable;
+    }
+
+    uint32_t index = Allocate();
+    Node& node = m_nodes[index];
+    node.deadline = (deadlineMs + TICK_MS - 1) / TICK_MS;
+    if (node.deadline <= m_current) {
+        node.deadline = m_current + 1;
+    }
+    node.cookie = cookie;
+
+    Place(index);
+    m_count++;
+    return HandleOf(index, node.generation);
+}
+
+bool TimerWheel::Cancel(Handle handle) {
+    uint32_t index = static_cast<uint32_t>(handle) - 1;
+    if (handle == 0 || index >= m_nodes.size() || m_nodes[index].generation != static_cast<uint32_t>(handle >> 32) ||
+        m_nodes[index].list == FREE_LIST) {
+        return false;
+    }
+
+    // Expired timers not popped yet are dropped as well
+    if (m_nodes[index].list != EXPIRED_LIST) {
+        m_count--;
+    }
+
+    Unlink(index);
+    Release(index);
+    return true;
+}
+
+bool TimerWheel::IsPending(Handle handle) const {
+    uint32_t index = static_cast<uint32_t>(handle) - 1;
+    if (handle == 0 || index >= m_nodes.size()) {
+        return false;
+    }
+
+    const Node& node = m_nodes[index];
+    return node.generation == static_cast<uint32_t>(handle >> 32) && node.list < EXPIRED_LIST;
+}
+
+size_t TimerWheel::GetCount() const {
+    return m_count;
+}
+
+bool TimerWheel::GetNextDeadline(uint64_t& deadlineMs) const {
+    if (m_count == 0) {
+        return false;
+    }
+
+    // Only the first occupied slot of each level can hold the earliest
+    // deadline: later slots start after it ends
+    uint64_t earliest = NO_TICK;
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        if (m_occupied[level] == 0) {
+            continue;
+        }
+
+        uint32_t shift = level * SLOT_BITS;
+        uint64_t start = ((m_current >> shift) + 1) << shift;
+        uint32_t first = static_cast<uint32_t>((start >> shift) & (SLOTS - 1));
+        uint32_t slot = (first + LowestBit(RotateRight(m_occupied[level], first))) & (SLOTS - 1);
+        uint64_t bound = m_slotMin[level * SLOTS + slot];
+        if (bound < earliest) {
+            earliest = bound;
+        }
+    }
+
+    deadlineMs = earliest * TICK_MS;
+    return true;
+}
+
+size_t TimerWheel::Advance(uint64_t nowMs) {
+    uint64_t nowTick = nowMs / TICK_MS;
+    size_t expired = 0;
+
+    for (;;) {
+        uint64_t tick = NextEventTick();
+        if (tick == NO_TICK || tick > nowTick) {
+            break;
+        }
+        m_current = tick;
+
+        // Higher levels first; what they hand down may be due right away
+        for (uint32_t level = LEVELS - 1; level > 0; level--) {
+            uint32_t shift = level * SLOT_BITS;
+            if ((tick & ((1ull << shift) - 1)) == 0) {
+                Cascade(level, static_cast<uint32_t>((tick >> shift) & (SLOTS - 1)));
+            }
+        }
+
+        uint32_t slot = static_cast<uint32_t>(tick & (SLOTS - 1));
+        while (m_heads[slot] != NIL) {
+            uint32_t index = m_heads[slot];
+            Unlink(index);
+            Link(index, EXPIRED_LIST);
+            m_count--;
+            expired++;
+        }
+    }
+
+    if (nowTick > m_current) {
+        m_current = nowTick;
+    }
+    return expired;
+}
+
+bool TimerWheel::PopExpired(uint64_t& cookie) {
+    uint32_t index = m_heads[EXPIRED_LIST];
+    if (index == NIL) {
+        return false;
+    }
+
+    cookie = m_nodes[index].cookie;
+    Unlink(index);
+    Release(index);
+    return true;
+}
+
+void TimerWheel::Reserve(size_t timers) {
+    m_nodes.reserve(timers);
+}
+
+void TimerWheel::Clear() {
+    m_nodes = std::vector<Node>();
+    m_free = NIL;
+    m_expiredTail = NIL;
+    m_count = 0;
+
+    for (uint32_t& head : m_heads) {
+        head = NIL;
+    }
+    for (uint64_t& bound : m_slotMin) {
+        bound = NO_TICK;
+    }
+    for (uint64_t& bits : m_occupied) {
+        bits = 0;
+    }
+}
+
+size_t TimerWheel::GetMemoryUsage() const {
+    return m_nodes.capacity() * sizeof(Node);
+}
+
+uint32_t TimerWheel::Allocate() {
+    uint32_t index = m_free;
+    if (index != NIL) {
+        m_free = m_nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(Node{ 0, 0, NIL, NIL, 0, FREE_LIST });
+    }
+    return index;
+}
+
+void TimerWheel::Release(uint32_t index) {
+    Node& node = m_nodes[index];
+    node.generation++;
+    node.list = FREE_LIST;
+    node.prev = NIL;
+    node.next = m_free;
+    m_free = index;
+}
+
+void TimerWheel::Link(uint32_t index, uint16_t list) {
+    Node& node = m_nodes[index];
+    node.list = list;
+
+    if (list == EXPIRED_LIST) {
+        node.next = NIL;
+        node.prev = m_expiredTail;
+        if (m_expiredTail != NIL) {
+            m_nodes[m_expiredTail].next = index;
+        } else {
+            m_heads[EXPIRED_LIST] = index;
+        }
+        m_expiredTail = index;
+        return;
+    }
+
+    node.prev = NIL;
+    node.next = m_heads[list];
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = index;
+    }
+    m_heads[list] = index;
+
+    m_occupied[list / SLOTS] |= 1ull << (list % SLOTS);
+}
+
+void TimerWheel::Unlink(uint32_t index) {
+    Node& node = m_nodes[index];
+    uint16_t list = node.list;
+
+    if (node.prev != NIL) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        m_heads[list] = node.next;
+    }
+    if (node.next != NIL) {
+        m_nodes[node.next].prev = node.prev;
+    } else if (list == EXPIRED_LIST) {
+        m_expiredTail = node.prev;
+    }
+
+    // The lower bound stays as it is until the slot empties; a stale one
+    // only arms the OS timer early
+    if (list < EXPIRED_LIST && m_heads[list] == NIL) {
+        m_occupied[list / SLOTS] &= ~(1ull << (list % SLOTS));
+        m_slotMin[list] = NO_TICK;
+    }
+
+    node.prev = NIL;
+    node.next = NIL;
+}
+
+void TimerWheel::Place(uint32_t index) {
+    uint64_t deadline = m_nodes[index].deadline;
+    uint64_t delta = deadline > m_current ? deadline - m_current : 0;
+
+    uint32_t level = 0;
+    while (level < LEVELS - 1 && delta >= (1ull << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+
+    // Beyond the last level: park in its furthest slot, re-sorted when it
+    // cascades
+    uint64_t position = deadline;
+    uint64_t span = 1ull << (LEVELS * SLOT_BITS);
+    if (delta >= span) {
+        position = m_current + span - 1;
+    }
+
+    uint32_t slot = static_cast<uint32_t>((position >> (level * SLOT_BITS)) & (SLOTS - 1));
+    uint16_t list = static_cast<uint16_t>(level * SLOTS + slot);
+    Link(index, list);
+
+    // A parked timer bounds its slot by where it is parked, not by its
+    // deadline, so the first occupied slot of a level stays the earliest
+    if (position < m_slotMin[list]) {
+        m_slotMin[list] = position;
+    }
+}
+
+uint64_t TimerWheel::NextEventTick() const {
+    uint64_t next = NO_TICK;
+
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        if (m_occupied[level] == 0) {
+            continue;
+        }
+
+        // Level 0 slots expire at their tick, higher ones cascade where
+        // their span begins
+        uint32_t shift = level * SLOT_BITS;
+        uint64_t start = ((m_current >> shift) + 1) << shift;
+        uint32_t first = static_cast<uint32_t>((start >> shift) & (SLOTS - 1));
+        uint64_t tick = start + (static_cast<uint64_t>(LowestBit(RotateRight(m_occupied[level], first))) << shift);
+        if (tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+void TimerWheel::Cascade(uint32_t level, uint32_t slot) {
+    uint16_t list = static_cast<uint16_t>(level * SLOTS + slot);
+    while (m_heads[list] != NIL) {
+        uint32_t index = m_heads[list];
+        Unlink(index);
+        Place(index);
+    }
+}
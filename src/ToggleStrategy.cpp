@@ -0,0 +1,117 @@
+#include "ToggleStrategy.h"
+#include "Tracer.h"
+
+namespace {
+    // WM_COMMAND id of DefView's "Show desktop icons" menu item
+    constexpr WPARAM DEFVIEW_TOGGLE_ICONS = 0x7402;
+
+    // A hung Explorer must not hang the UI thread with it
+    constexpr UINT SHELL_COMMAND_TIMEOUT_MS = 500;
+
+    bool IsStyleVisible(HWND window) {
+        return (GetWindowLong(window, GWL_STYLE) & WS_VISIBLE) != 0;
+    }
+
+    void ShowIfHidden(HWND window) {
+        if (window && IsWindow(window) && !IsStyleVisible(window)) {
+            ShowWindow(window, SW_SHOW);
+        }
+    }
+
+    bool ShellHidesIcons() {
+        SHELLSTATE state = {};
+        SHGetSetSettings(&state, SSF_HIDEICONS, FALSE);
+        return state.fHideIcons != 0;
+    }
+
+    bool SendToggleIcons(HWND defView) {
+        DWORD_PTR result = 0;
+        return SendMessageTimeout(defView, WM_COMMAND, DEFVIEW_TOGGLE_ICONS, 0,
+                                  SMTO_ABORTIFHUNG, SHELL_COMMAND_TIMEOUT_MS, &result) != 0;
+    }
+
+    // Turns the shell's "Show desktop icons" setting back on if a
+    // ShellCommandToggleStrategy hide left it off. The command toggles, so
+    // it is only sent while the setting is off.
+    bool ClearShellHide(HWND defView) {
+        if (!ShellHidesIcons()) {
+            return true;
+        }
+        return defView && IsWindow(defView) && SendToggleIcons(defView);
+    }
+
+    void RefreshDesktop() {
+        TRACE_SPAN("desktop", "RefreshDesktop");
+
+        // Refresh the desktop to ensure changes are visible
+        InvalidateRect(nullptr, nullptr, TRUE);
+
+        // Send a message to refresh the desktop
+        HWND desktop = GetDesktopWindow();
+        if (desktop) {
+            InvalidateRect(desktop, nullptr, TRUE);
+            UpdateWindow(desktop);
+        }
+
+        // Also try to refresh the shell
+        SHChangeNotify(SHCNE_ASSOCCHANGED, SHCNF_IDLIST, nullptr, nullptr);
+    }
+}
+
+bool ListViewToggleStrategy::IsAvailable(const DesktopWindows& windows) const {
+    return windows.listView && IsWindow(windows.listView);
+}
+
+bool ListViewToggleStrategy::Apply(const DesktopWindows& windows, bool visible) {
+    TRACE_SPAN("desktop", "ListViewToggleStrategy::Apply");
+
+    if (visible) {
+        if (!ClearShellHide(windows.defView)) {
+            return false;
+        }
+        ShowIfHidden(windows.defView);
+    }
+
+    ShowWindow(windows.listView, visible ? SW_SHOW : SW_HIDE);
+    RefreshDesktop();
+    return true;
+}
+
+bool ShellCommandToggleStrategy::IsAvailable(const DesktopWindows& windows) const {
+    return windows.defView && IsWindow(windows.defView);
+}
+
+bool ShellCommandToggleStrategy::Apply(const DesktopWindows& windows, bool visible) {
+    TRACE_SPAN("desktop", "ShellCommandToggleStrategy::Apply");
+
+    if (!visible) {
+        // The command toggles, so only send it when the shell disagrees
+        return ShellHidesIcons() || SendToggleIcons(windows.defView);
+    }
+
+    if (!ClearShellHide(windows.defView)) {
+        return false;
+    }
+
+    ShowIfHidden(windows.defView);
+    ShowIfHidden(windows.listView);
+    return true;
+}
+
+bool HideDefViewToggleStrategy::IsAvailable(const DesktopWindows& windows) const {
+    return windows.defView && IsWindow(windows.defView);
+}
+
+bool HideDefViewToggleStrategy::Apply(const DesktopWindows& windows, bool visible) {
+    TRACE_SPAN("desktop", "HideDefViewToggleStrategy::Apply");
+
+    if (visible) {
+        if (!ClearShellHide(windows.defView)) {
+            return false;
+        }
+        ShowIfHidden(windows.listView);
+    }
+
+    ShowWindow(windows.defView, visible ? SW_SHOW : SW_HIDE);
+    return true;
+}
@@ -0,0 +1,210 @@
+#include "Tracer.h"
+#include <cstdio>
+#include <cstring>
+
+thread_local Tracer::ThreadBuffer* Tracer::s_threadBuffer = nullptr;
+thread_local bool Tracer::s_threadBufferUnavailable = false;
+std::atomic<bool> Tracer::s_enabled(true);
+std::atomic<Tracer::ThreadBuffer*> Tracer::s_buffers[Tracer::MAX_THREADS];
+std::atomic<size_t> Tracer::s_bufferCount(0);
+wchar_t Tracer::s_crashTracePath[MAX_PATH] = {};
+LPTOP_LEVEL_EXCEPTION_FILTER Tracer::s_previousFilter = nullptr;
+
+namespace {
+    constexpr size_t WRITE_BUFFER_SIZE = 16 * 1024;
+    
+    // Set up by Tracer::Initialize. The crash filter may run on an almost
+    // exhausted stack, so dumps neither take 16 KB of it nor run a static
+    // initializer.
+    LONGLONG s_frequency = 0;
+    char s_writeBuffer[WRITE_BUFFER_SIZE];
+    std::atomic<bool> s_writing(false); // Guards s_writeBuffer
+    
+    // Buffered writer over s_writeBuffer that never allocates, so it is
+    // usable from the crash filter
+    class TraceFileWriter {
+    public:
+        explicit TraceFileWriter(HANDLE file) : m_file(file), m_size(0), m_failed(false) {}
+        ~TraceFileWriter() { Flush(); }
+        
+        void Append(const char* text, size_t length) {
+            if (m_size + length > WRITE_BUFFER_SIZE) {
+                Flush();
+            }
+            if (length > WRITE_BUFFER_SIZE) {
+                m_failed = true;
+                return;
+            }
+            memcpy(s_writeBuffer + m_size, text, length);
+            m_size += length;
+        }
+        
+        void Flush() {
+            if (m_size == 0) {
+                return;
+            }
+            DWORD written = 0;
+            if (!WriteFile(m_file, s_writeBuffer, static_cast<DWORD>(m_size), &written, nullptr) || written != m_size) {
+                m_failed = true;
+            }
+            m_size = 0;
+        }
+        
+        bool Failed() const { return m_failed; }
+        
+    private:
+        HANDLE m_file;
+        size_t m_size;
+        bool m_failed;
+    };
+}
+
+void Tracer::SetEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t Tracer::Now() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+void Tracer::Record(const char* category, const char* name, int64_t start, int64_t end) {
+    ThreadBuffer* buffer = s_threadBuffer;
+    if (!buffer) {
+        buffer = AcquireThreadBuffer();
+        if (!buffer) {
+            return;
+        }
+    }
+    
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[head & (RING_CAPACITY - 1)];
+    event.category = category;
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+size_t Tracer::GetMemoryUsage() {
+    size_t count = s_bufferCount.load(std::memory_order_relaxed);
+    if (count > MAX_THREADS) {
+        count = MAX_THREADS;
+    }
+    return count * sizeof(ThreadBuffer);
+}
+
+Tracer::ThreadBuffer* Tracer::AcquireThreadBuffer() {
+    if (s_threadBufferUnavailable) {
+        return nullptr;
+    }
+    
+    size_t index = s_bufferCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_THREADS) {
+        s_threadBufferUnavailable = true;
+        return nullptr;
+    }
+    
+    // Buffers live for the rest of the process so a dump can still read the
+    // spans of threads that have exited
+    ThreadBuffer* buffer = new ThreadBuffer();
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->threadId = GetCurrentThreadId();
+    
+    s_buffers[index].store(buffer, std::memory_order_release);
+    s_threadBuffer = buffer;
+    return buffer;
+}
+
+void Tracer::Initialize(const std::wstring& crashTracePath) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    s_frequency = frequency.QuadPart;
+    
+    wcscpy_s(s_crashTracePath, crashTracePath.c_str());
+    s_previousFilter = SetUnhandledExceptionFilter(CrashFilter);
+}
+
+bool Tracer::DumpChromeTrace(const wchar_t* path) {
+    // One dump at a time: the on-demand and crash paths share the buffer
+    if (s_frequency == 0 || s_writing.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+    
+    HANDLE hFile = CreateFile(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        s_writing.store(false, std::memory_order_release);
+        return false;
+    }
+    
+    const LONGLONG frequency = s_frequency;
+    const DWORD processId = GetCurrentProcessId();
+    bool success = true;
+    
+    {
+        TraceFileWriter writer(hFile);
+        char line[256];
+        bool first = true;
+        
+        const char* header = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        writer.Append(header, strlen(header));
+        
+        size_t bufferCount = s_bufferCount.load(std::memory_order_acquire);
+        if (bufferCount > MAX_THREADS) {
+            bufferCount = MAX_THREADS;
+        }
+        
+        for (size_t i = 0; i < bufferCount; i++) {
+            ThreadBuffer* buffer = s_buffers[i].load(std::memory_order_acquire);
+            if (!buffer) {
+                continue;
+            }
+            
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = (head > RING_CAPACITY) ? head - RING_CAPACITY : 0;
+            
+            for (uint64_t index = begin; index < head; index++) {
+                Event event = buffer->events[index & (RING_CAPACITY - 1)];
+                
+                // Skip slots the owning thread may have overwritten meanwhile
+                uint64_t currentHead = buffer->head.load(std::memory_order_acquire);
+                if (currentHead >= RING_CAPACITY && index <= currentHead - RING_CAPACITY) {
+                    continue;
+                }
+                
+                double startUs = event.start * 1000000.0 / frequency;
+                double durationUs = (event.end - event.start) * 1000000.0 / frequency;
+                int length = snprintf(line, sizeof(line),
+                    "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu}",
+                    first ? "" : ",\n", event.name, event.category, startUs, durationUs,
+                    static_cast<unsigned long>(processId), static_cast<unsigned long>(buffer->threadId));
+                if (length > 0 && static_cast<size_t>(length) < sizeof(line)) {
+                    writer.Append(line, length);
+                    first = false;
+                }
+            }
+        }
+        
+        const char* footer = "\n]}\n";
+        writer.Append(footer, strlen(footer));
+        writer.Flush();
+        success = !writer.Failed();
+    }
+    
+    CloseHandle(hFile);
+    s_writing.store(false, std::memory_order_release);
+    return success;
+}
+
+LONG WINAPI Tracer::CrashFilter(EXCEPTION_POINTERS* exceptionInfo) {
+    if (s_crashTracePath[0] != L'\0') {
+        DumpChromeTrace(s_crashTracePath);
+    }
+    
+    if (s_previousFilter) {
+        return s_previousFilter(exceptionInfo);
+    }
+    
+    return EXCEPTION_CONTINUE_SEARCH;
+}
@@ -0,0 +1,193 @@
+#include "VirtualDesktopWatcher.h"
+#include "Tracer.h"
+
+namespace {
+    constexpr const wchar_t* DESKTOPS_KEY = L"Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\VirtualDesktops";
+    constexpr const wchar_t* SESSION_KEY_FORMAT =
+        L"Software\\Microsoft\\Windows\\CurrentVersion\\Explorer\\SessionInfo\\%lu\\VirtualDesktops";
+    constexpr const wchar_t* CURRENT_VALUE = L"CurrentVirtualDesktop";
+    constexpr const wchar_t* LIST_VALUE = L"VirtualDesktopIDs";
+
+    bool HasCurrentValue(HKEY key) {
+        DWORD type = 0;
+        DWORD size = 0;
+        return RegQueryValueEx(key, CURRENT_VALUE, nullptr, &type, nullptr, &size) == ERROR_SUCCESS &&
+               type == REG_BINARY && size == sizeof(GUID);
+    }
+}
+
+VirtualDesktopWatcher::VirtualDesktopWatcher()
+    : m_notifyWindow(nullptr)
+    , m_key(nullptr)
+    , m_listKey(nullptr)
+    , m_event(nullptr)
+    , m_wait(nullptr)
+    , m_signalTime(0)
+    , m_simulating(false)
+    , m_simulated{} {
+}
+
+VirtualDesktopWatcher::~VirtualDesktopWatcher() {
+    Cleanup();
+}
+
+bool VirtualDesktopWatcher::Initialize(HWND notifyWindow) {
+    TRACE_SPAN("shell", "VirtualDesktopWatcher::Initialize");
+
+    Cleanup();
+    m_notifyWindow = notifyWindow;
+
+    if (!OpenDesktopsKey()) {
+        Cleanup();
+        return false;
+    }
+
+    m_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!m_event || !ArmNotification()) {
+        Cleanup();
+        return false;
+    }
+
+    // Not one-shot: the auto-reset event is signaled once per notification
+    // and the callback arms the next one
+    if (!RegisterWaitForSingleObject(&m_wait, m_event, OnKeyChanged, this, INFINITE, WT_EXECUTEDEFAULT)) {
+        m_wait = nullptr;
+        Cleanup();
+        return false;
+    }
+
+    return true;
+}
+
+void VirtualDesktopWatcher::Cleanup() {
+    // Waits for a running callback, which uses the key and the window
+    if (m_wait) {
+        UnregisterWaitEx(m_wait, INVALID_HANDLE_VALUE);
+        m_wait = nullptr;
+    }
+
+    if (m_event) {
+        CloseHandle(m_event);
+        m_event = nullptr;
+    }
+
+    if (m_listKey && m_listKey != m_key) {
+        RegCloseKey(m_listKey);
+    }
+    m_listKey = nullptr;
+
+    if (m_key) {
+        RegCloseKey(m_key);
+        m_key = nullptr;
+    }
+
+    // The window is kept so Simulate() works without the registry
+    m_simulating = false;
+}
+
+bool VirtualDesktopWatcher::IsActive() const {
+    return m_wait != nullptr;
+}
+
+bool VirtualDesktopWatcher::GetCurrent(GUID& desktop) const {
+    if (m_simulating) {
+        desktop = m_simulated;
+        return true;
+    }
+
+    if (!m_key) {
+        return false;
+    }
+
+    DWORD type = 0;
+    DWORD size = sizeof(desktop);
+    return RegQueryValueEx(m_key, CURRENT_VALUE, nullptr, &type, reinterpret_cast<BYTE*>(&desktop), &size) == ERROR_SUCCESS &&
+           type == REG_BINARY && size == sizeof(desktop);
+}
+
+bool VirtualDesktopWatcher::GetDesktops(std::vector<GUID>& desktops) const {
+    desktops.clear();
+    if (!m_listKey) {
+        return false;
+    }
+
+    DWORD type = 0;
+    DWORD size = 0;
+    if (RegQueryValueEx(m_listKey, LIST_VALUE, nullptr, &type, nullptr, &size) != ERROR_SUCCESS ||
+        type != REG_BINARY || size % sizeof(GUID) != 0) {
+        return false;
+    }
+
+    desktops.resize(size / sizeof(GUID));
+    if (RegQueryValueEx(m_listKey, LIST_VALUE, nullptr, &type, reinterpret_cast<BYTE*>(desktops.data()), &size) != ERROR_SUCCESS) {
+        desktops.clear();
+        return false;
+    }
+
+    desktops.resize(size / sizeof(GUID));
+    return !desktops.empty();
+}
+
+LONGLONG VirtualDesktopWatcher::GetSignalTime() const {
+    return m_signalTime.load(std::memory_order_acquire);
+}
+
+void VirtualDesktopWatcher::Simulate(const GUID& desktop) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    m_simulated = desktop;
+    m_simulating = true;
+    m_signalTime.store(now.QuadPart, std::memory_order_release);
+    PostMessage(m_notifyWindow, WM_VIRTUAL_DESKTOP_CHANGED, 0, 0);
+}
+
+void VirtualDesktopWatcher::StopSimulating() {
+    m_simulating = false;
+}
+
+void CALLBACK VirtualDesktopWatcher::OnKeyChanged(PVOID context, BOOLEAN) {
+    VirtualDesktopWatcher* watcher = static_cast<VirtualDesktopWatcher*>(context);
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    watcher->m_signalTime.store(now.QuadPart, std::memory_order_release);
+
+    // Arm again before reporting, so a switch made while the UI thread
+    // reads the value still signals
+    watcher->ArmNotification();
+    PostMessage(watcher->m_notifyWindow, WM_VIRTUAL_DESKTOP_CHANGED, 0, 0);
+}
+
+bool VirtualDesktopWatcher::ArmNotification() {
+    // Thread-agnostic, so the thread pool thread that re-arms it may exit
+    // without cancelling the notification
+    return RegNotifyChangeKeyValue(m_key, FALSE, REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+                                   m_event, TRUE) == ERROR_SUCCESS;
+}
+
+bool VirtualDesktopWatcher::OpenDesktopsKey() {
+    if (RegOpenKeyEx(HKEY_CURRENT_USER, DESKTOPS_KEY, 0, KEY_QUERY_VALUE | KEY_NOTIFY, &m_listKey) != ERROR_SUCCESS) {
+        m_listKey = nullptr;
+        return false;
+    }
+
+    // Windows 11 and late Windows 10 builds keep the current desktop next to
+    // the list; earlier ones per logon session. Before the first switch the
+    // value may be missing from both, and the list key is watched.
+    m_key = m_listKey;
+    if (HasCurrentValue(m_listKey)) {
+        return true;
+    }
+
+    DWORD sessionId = 0;
+    HKEY sessionKey = nullptr;
+    wchar_t path[160];
+    if (ProcessIdToSessionId(GetCurrentProcessId(), &sessionId) &&
+        swprintf_s(path, SESSION_KEY_FORMAT, sessionId) > 0 &&
+        RegOpenKeyEx(HKEY_CURRENT_USER, path, 0, KEY_QUERY_VALUE | KEY_NOTIFY, &sessionKey) == ERROR_SUCCESS) {
+        m_key = sessionKey;
+    }
+
+    return true;
+}
@@ -1,9 +1,11 @@
 #include "Application.h"
+#include "IpcClient.h"
+#include "SessionScope.h"
 #include <memory>
 
-// Check if another instance is already running
+// Check if another instance is already running in this session
 bool IsAnotherInstanceRunning() {
-    HANDLE hMutex = CreateMutex(nullptr, TRUE, L"DesktopIconTogglerMutex");
+    HANDLE hMutex = CreateMutex(nullptr, TRUE, Session::INSTANCE_MUTEX_NAME);
     if (GetLastError() == ERROR_ALREADY_EXISTS) {
         if (hMutex) {
             CloseHandle(hMutex);
@@ -19,6 +21,228 @@ void ShowErrorAndExit(const std::wstring& message) {
     ExitProcess(1);
 }
 
+// Everything the command line asks for, read in one pass
+struct LaunchOptions {
+    // --toggle, --show, --hide, --settings, --dump-trace, --save-layout,
+    // --restore-layout and --undo-layout, as control pipe opcodes
+    Ipc::Opcode ops[Ipc::MAX_OPS_PER_REQUEST];
+    size_t opCount = 0;
+    
+    // Measure-only launches. Reports go next to settings.ini unless a path
+    // is given.
+    bool measureStartup = false;
+    std::wstring startupReportPath;
+    bool measureFootprint = false;
+    std::wstring footprintReportPath;
+    bool measureIdle = false;
+    DWORD idleSeconds = IDLE_MEASURE_DEFAULT_SECONDS;
+    bool measureSwitch = false;
+    std::wstring switchReportPath;
+    bool measureSecondLaunch = false;
+    std::wstring secondLaunchReportPath;
+    
+    bool IsMeasuring() const {
+        return measureStartup || measureFootprint || measureIdle || measureSwitch || measureSecondLaunch;
+    }
+};
+
+// Matches --option and --option=value; value is nullptr without one
+bool MatchOption(const wchar_t* arg, const wchar_t* option, const wchar_t*& value) {
+    const size_t optionLength = wcslen(option);
+    if (_wcsnicmp(arg, option, optionLength) != 0) {
+        return false;
+    }
+    
+    if (arg[optionLength] == L'\0') {
+        value = nullptr;
+        return true;
+    }
+    if (arg[optionLength] == L'=') {
+        value = arg + optionLength + 1;
+        return true;
+    }
+    return false;
+}
+
+// The path given with a report option, or the default file next to
+// settings.ini
+std::wstring ReportPath(const wchar_t* value, const wchar_t* defaultFileName) {
+    if (value && *value) {
+        return value;
+    }
+    return GetModuleDirectory() + L"\\" + defaultFileName;
+}
+
+void ParseLaunchOptions(LaunchOptions& options) {
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLine(), &argc);
+    if (!argv) {
+        return;
+    }
+    
+    static const struct {
+        const wchar_t* option;
+        Ipc::Opcode op;
+    } OPS[] = {
+        { L"--toggle", Ipc::Opcode::Toggle },
+        { L"--show", Ipc::Opcode::Show },
+        { L"--hide", Ipc::Opcode::Hide },
+        { L"--settings", Ipc::Opcode::ShowSettings },
+        { L"--dump-trace", Ipc::Opcode::DumpTrace },
+        { L"--save-layout", Ipc::Opcode::SaveLayout },
+        { L"--restore-layout", Ipc::Opcode::RestoreLayout },
+        { L"--undo-layout", Ipc::Opcode::UndoLayout },
+    };
+    
+    for (int i = 1; i < argc; i++) {
+        const wchar_t* arg = argv[i];
+        const wchar_t* value = nullptr;
+        
+        bool isOp = false;
+        for (const auto& entry : OPS) {
+            if (_wcsicmp(arg, entry.option) == 0) {
+                if (options.opCount < Ipc::MAX_OPS_PER_REQUEST) {
+                    options.ops[options.opCount++] = entry.op;
+                }
+                isOp = true;
+                break;
+            }
+        }
+        if (isOp) {
+            continue;
+        }
+        
+        if (MatchOption(arg, L"--measure-startup", value)) {
+            options.measureStartup = true;
+            options.startupReportPath = ReportPath(value, L"startup-report.json");
+        } else if (MatchOption(arg, L"--measure-footprint", value)) {
+            options.measureFootprint = true;
+            options.footprintReportPath = ReportPath(value, L"footprint-report.json");
+        } else if (MatchOption(arg, L"--measure-idle", value)) {
+            options.measureIdle = true;
+            int seconds = value ? _wtoi(value) : 0;
+            if (seconds > 0) {
+                options.idleSeconds = static_cast<DWORD>(seconds);
+            }
+        } else if (MatchOption(arg, L"--measure-desktop-switch", value)) {
+            options.measureSwitch = true;
+            options.switchReportPath = ReportPath(value, L"desktop-switch-report.json");
+        } else if (MatchOption(arg, L"--measure-second-launch", value)) {
+            options.measureSecondLaunch = true;
+            options.secondLaunchReportPath = ReportPath(value, L"second-launch-report.json");
+        }
+    }
+    
+    LocalFree(argv);
+}
+
+// Exit codes for the --measure-* options
+constexpr int MEASURE_EXIT_OK = 0;
+constexpr int MEASURE_EXIT_REPORT_FAILED = 1;
+constexpr int MEASURE_EXIT_OVER_BUDGET = 2;
+constexpr int MEASURE_EXIT_ALREADY_RUNNING = 3;
+constexpr int MEASURE_EXIT_NOT_RUNNING = 4;
+
+// Sends the batch to the running instance; true once it has been applied
+bool Forward(const Ipc::Opcode* ops, size_t count) {
+    IpcClient client;
+    Ipc::Status status = Ipc::Status::BadRequest;
+    Ipc::WireState state = Ipc::WireState::Unknown;
+    bool forwarded = client.Connect(FORWARD_CONNECT_TIMEOUT_MS) &&
+                     client.Transact(ops, count, FORWARD_RESPONSE_TIMEOUT_MS, status, state) &&
+                     status == Ipc::Status::Ok;
+    client.Close();
+    return forwarded;
+}
+
+double ElapsedMs(const LARGE_INTEGER& since) {
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (now.QuadPart - since.QuadPart) * 1000.0 / frequency.QuadPart;
+}
+
+// Hand the command line to the running instance. This runs before COM,
+// windows or configuration are touched so the second process exits quickly.
+int ForwardToRunningInstance(const LaunchOptions& options, const LARGE_INTEGER& launchTime) {
+    // A plain second launch opens the running instance's settings
+    const Ipc::Opcode defaultOp = Ipc::Opcode::ShowSettings;
+    const Ipc::Opcode* ops = options.opCount > 0 ? options.ops : &defaultOp;
+    size_t count = options.opCount > 0 ? options.opCount : 1;
+    
+    bool forwarded = Forward(ops, count);
+    
+    double elapsedMs = ElapsedMs(launchTime);
+    if (elapsedMs > SECOND_LAUNCH_BUDGET_MS) {
+        wchar_t message[128];
+        swprintf_s(message, L"Forwarding to the running instance took %.1f ms (budget %.1f ms)\n",
+                   elapsedMs, SECOND_LAUNCH_BUDGET_MS);
+        OutputDebugString(message);
+    }
+    
+    if (!forwarded) {
+        ShowErrorAndExit(L"Desktop Icon Toggler is already running.\n\nCheck the system tray for the application icon.");
+    }
+    
+    return 0;
+}
+
+bool WriteSecondLaunchReport(const std::wstring& path, double elapsedMs, bool forwarded) {
+    char json[256];
+    int length = snprintf(json, sizeof(json),
+                          "{\n  \"version\": 1,\n  \"forwarded\": %s,\n  \"totalMs\": %.3f,\n"
+                          "  \"budgetMs\": %.3f,\n  \"withinBudget\": %s\n}\n",
+                          forwarded ? "true" : "false", elapsedMs, SECOND_LAUNCH_BUDGET_MS,
+                          elapsedMs <= SECOND_LAUNCH_BUDGET_MS ? "true" : "false");
+    
+    HANDLE hFile = CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    
+    DWORD bytesWritten = 0;
+    bool success = WriteFile(hFile, json, static_cast<DWORD>(length), &bytesWritten, nullptr) &&
+                   bytesWritten == static_cast<DWORD>(length);
+    CloseHandle(hFile);
+    
+    return success;
+}
+
+// Measure-only second launch: times the whole round trip to the running
+// instance against SECOND_LAUNCH_BUDGET_MS. Without other options it sends
+// a state query, which is answered without touching the desktop.
+int MeasureSecondLaunch(const LaunchOptions& options, const LARGE_INTEGER& launchTime) {
+    const Ipc::Opcode queryOp = Ipc::Opcode::QueryState;
+    const Ipc::Opcode* ops = options.opCount > 0 ? options.ops : &queryOp;
+    size_t count = options.opCount > 0 ? options.opCount : 1;
+    
+    bool forwarded = Forward(ops, count);
+    double elapsedMs = ElapsedMs(launchTime);
+    
+    if (!WriteSecondLaunchReport(options.secondLaunchReportPath, elapsedMs, forwarded)) {
+        return MEASURE_EXIT_REPORT_FAILED;
+    }
+    if (!forwarded) {
+        return MEASURE_EXIT_NOT_RUNNING;
+    }
+    return elapsedMs > SECOND_LAUNCH_BUDGET_MS ? MEASURE_EXIT_OVER_BUDGET : MEASURE_EXIT_OK;
+}
+
+CommandType ToCommandType(Ipc::Opcode op) {
+    switch (op) {
+        case Ipc::Opcode::Toggle: return CommandType::ToggleIcons;
+        case Ipc::Opcode::Show: return CommandType::ShowIcons;
+        case Ipc::Opcode::Hide: return CommandType::HideIcons;
+        case Ipc::Opcode::ShowSettings: return CommandType::ShowSettings;
+        case Ipc::Opcode::DumpTrace: return CommandType::DumpTrace;
+        case Ipc::Opcode::SaveLayout: return CommandType::SaveLayout;
+        case Ipc::Opcode::RestoreLayout: return CommandType::RestoreLayout;
+        case Ipc::Opcode::UndoLayout: return CommandType::UndoLayout;
+        default: return CommandType::None;
+    }
+}
+
 // Windows application entry point
 int WINAPI wWinMain(
     _In_ HINSTANCE hInstance,
@@ -30,9 +254,26 @@ int WINAPI wWinMain(
     UNREFERENCED_PARAMETER(lpCmdLine);
     UNREFERENCED_PARAMETER(nCmdShow);
     
-    // Check for another instance
+    LARGE_INTEGER launchTime;
+    QueryPerformanceCounter(&launchTime);
+    
+    LaunchOptions options;
+    ParseLaunchOptions(options);
+    
+    // Check for another instance and forward our command line to it
     if (IsAnotherInstanceRunning()) {
-        ShowErrorAndExit(L"Desktop Icon Toggler is already running.\n\nCheck the system tray for the application icon.");
+        if (options.measureSecondLaunch) {
+            return MeasureSecondLaunch(options, launchTime);
+        }
+        if (options.IsMeasuring()) {
+            return MEASURE_EXIT_ALREADY_RUNNING;
+        }
+        return ForwardToRunningInstance(options, launchTime);
+    }
+    
+    // The round trip needs an instance to talk to
+    if (options.measureSecondLaunch) {
+        return MEASURE_EXIT_NOT_RUNNING;
     }
     
     // Create and initialize application
@@ -42,6 +283,69 @@ int WINAPI wWinMain(
         ShowErrorAndExit(L"Failed to initialize Desktop Icon Toggler.\n\nPlease check that you have the necessary permissions and try again.");
     }
     
+    // Measure-only launch: report the startup phases and exit
+    if (options.measureStartup) {
+        int exitCode = MEASURE_EXIT_OK;
+        if (!app->WriteStartupReport(options.startupReportPath)) {
+            exitCode = MEASURE_EXIT_REPORT_FAILED;
+        } else if (!app->IsStartupWithinBudget()) {
+            exitCode = MEASURE_EXIT_OVER_BUDGET;
+        }
+        
+        app.reset();
+        return exitCode;
+    }
+    
+    // Measure-only launch: trim as footprint mode would and report
+    if (options.measureFootprint) {
+        app->TrimFootprint();
+        
+        bool withinBudget = true;
+        int exitCode = MEASURE_EXIT_OK;
+        if (!app->WriteFootprintReport(options.footprintReportPath, withinBudget)) {
+            exitCode = MEASURE_EXIT_REPORT_FAILED;
+        } else if (!withinBudget) {
+            exitCode = MEASURE_EXIT_OVER_BUDGET;
+        }
+        
+        app.reset();
+        return exitCode;
+    }
+    
+    // Measure-only launch: count idle wakeups against the budget and exit
+    if (options.measureIdle) {
+        uint64_t wakeups = app->MeasureIdleWakeups(options.idleSeconds * 1000);
+        double perMinute = wakeups * 60.0 / options.idleSeconds;
+        
+        wchar_t message[160];
+        swprintf_s(message, L"Idle for %lu s: %llu wakeups (%.2f per minute, budget %.2f)\n",
+                   options.idleSeconds, static_cast<unsigned long long>(wakeups), perMinute,
+                   IDLE_WAKEUP_BUDGET_PER_MINUTE);
+        OutputDebugString(message);
+        
+        app.reset();
+        return (perMinute > IDLE_WAKEUP_BUDGET_PER_MINUTE) ? MEASURE_EXIT_OVER_BUDGET : MEASURE_EXIT_OK;
+    }
+    
+    // Measure-only launch: time simulated desktop switches and report
+    if (options.measureSwitch) {
+        bool allApplied = false;
+        int exitCode = MEASURE_EXIT_OK;
+        if (!app->MeasureDesktopSwitches(options.switchReportPath, DESKTOP_SWITCH_MEASURE_COUNT, allApplied)) {
+            exitCode = MEASURE_EXIT_REPORT_FAILED;
+        } else if (!allApplied) {
+            exitCode = MEASURE_EXIT_OVER_BUDGET;
+        }
+        
+        app.reset();
+        return exitCode;
+    }
+    
+    // The first instance honours the same options once it is up
+    for (size_t i = 0; i < options.opCount; i++) {
+        app->PostCommand(ToCommandType(options.ops[i]));
+    }
+    
     // Run the application
     int exitCode = app->Run();
     
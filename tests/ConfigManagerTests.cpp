@@ -0,0 +1,86 @@
+#include "TestHarness.h"
+#include "ConfigManager.h"
+#include <atomic>
+#include <thread>
+
+// Snapshots are observed through GetMemoryUsage(), which counts the retired
+// ones still waiting for their readers
+
+TEST(ConfigManager, LastReaderFreesReplacedSnapshot) {
+    ConfigManager config;
+    size_t base = config.GetMemoryUsage();
+
+    {
+        ConfigSnapshotRef first = config.GetSnapshot();
+        ConfigSnapshotRef second = config.GetSnapshot();
+        config.SetIdleHideMinutes(5);
+        CHECK_EQ(config.GetMemoryUsage(), base + sizeof(ConfigSnapshot));
+
+        // Still the version they started reading
+        CHECK_EQ(first->idleHideMinutes, 0);
+        CHECK_EQ(second->idleHideMinutes, 0);
+        CHECK_EQ(config.GetIdleHideMinutes(), 5);
+
+        // Without another update, only the second release can free it
+        {
+            ConfigSnapshotRef moved(std::move(first));
+        }
+        CHECK_EQ(config.GetMemoryUsage(), base + sizeof(ConfigSnapshot));
+    }
+    CHECK_EQ(config.GetMemoryUsage(), base);
+}
+
+TEST(ConfigManager, ReadersBeyondTheSlots) {
+    ConfigManager config;
+    size_t base = config.GetMemoryUsage();
+
+    {
+        std::vector<ConfigSnapshotRef> readers;
+        for (int i = 0; i < 40; i++) {
+            readers.push_back(config.GetSnapshot());
+        }
+        config.SetIdleHideMinutes(5);
+        config.SetIdleHideMinutes(6);
+        CHECK_EQ(config.GetMemoryUsage(), base + 2 * sizeof(ConfigSnapshot));
+        for (const ConfigSnapshotRef& reader : readers) {
+            CHECK_EQ(reader->idleHideMinutes, 0);
+        }
+    }
+    CHECK_EQ(config.GetMemoryUsage(), base);
+}
+
+TEST(ConfigManager, ReadersSeeWholeVersions) {
+    ConfigManager config;
+
+    // Every version sets both fields to the same value
+    config.Update([](ConfigSnapshot& snapshot) { snapshot.trimIdleSeconds = snapshot.idleHideMinutes; });
+    size_t base = config.GetMemoryUsage();
+
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&config, &done, &torn]() {
+            while (!done.load()) {
+                ConfigSnapshotRef snapshot = config.GetSnapshot();
+                if (snapshot->idleHideMinutes != snapshot->trimIdleSeconds) {
+                    torn.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    for (int i = 1; i <= 2000; i++) {
+        config.Update([i](ConfigSnapshot& snapshot) {
+            snapshot.idleHideMinutes = i;
+            snapshot.trimIdleSeconds = i;
+        });
+    }
+    done.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    CHECK_EQ(torn.load(), 0);
+    CHECK_EQ(config.GetMemoryUsage(), base);
+}
@@ -0,0 +1,87 @@
+#include "TestHarness.h"
+#include "ContextRules.h"
+#include <cwchar>
+#include <string>
+
+namespace {
+    uint64_t Hash(const wchar_t* name) {
+        return ContextRules::HashProcessName(name, std::wcslen(name));
+    }
+
+    ContextRules::Context Foreground(const wchar_t* name, bool fullscreen = false, bool presenting = false) {
+        return ContextRules::Context{ name ? Hash(name) : 0, fullscreen, presenting };
+    }
+}
+
+TEST(ContextRules, HashIgnoresCaseAndDirectory) {
+    CHECK_EQ(Hash(L"POWERPNT.EXE"), Hash(L"powerpnt.exe"));
+    CHECK_EQ(Hash(L"C:\\Program Files\\Microsoft Office\\root\\Office16\\POWERPNT.EXE"), Hash(L"powerpnt.exe"));
+    CHECK_EQ(Hash(L"/usr/bin/powerpnt.exe"), Hash(L"powerpnt.exe"));
+    CHECK(Hash(L"powerpnt.exe") != Hash(L"mstsc.exe"));
+    CHECK(Hash(L"") != 0);
+}
+
+TEST(ContextRules, EmptyHidesNothing) {
+    ContextRules rules;
+    CHECK(rules.IsEmpty());
+    CHECK(!rules.ShouldHide(Foreground(L"powerpnt.exe", true, true)));
+    CHECK(rules.Lookup(Hash(L"powerpnt.exe")) == ContextRules::Action::None);
+}
+
+TEST(ContextRules, ProcessRules) {
+    ContextRules rules;
+    rules.Compile({ L"powerpnt.exe", L"vlc.exe" }, { L"mstsc.exe" }, false, false);
+    CHECK(!rules.IsEmpty());
+    CHECK_EQ(rules.GetRuleCount(), 3u);
+
+    CHECK(rules.ShouldHide(Foreground(L"C:\\Office\\POWERPNT.EXE")));
+    CHECK(rules.ShouldHide(Foreground(L"vlc.exe")));
+    CHECK(!rules.ShouldHide(Foreground(L"mstsc.exe")));
+    CHECK(!rules.ShouldHide(Foreground(L"notepad.exe")));
+    CHECK(!rules.ShouldHide(Foreground(nullptr)));
+}
+
+TEST(ContextRules, FullscreenAndPresenting) {
+    ContextRules rules;
+    rules.Compile({}, { L"mstsc.exe" }, true, false);
+    CHECK(rules.ShouldHide(Foreground(L"game.exe", true)));
+    CHECK(!rules.ShouldHide(Foreground(L"game.exe", false, true)));
+
+    // Ignore wins over fullscreen
+    CHECK(!rules.ShouldHide(Foreground(L"mstsc.exe", true)));
+
+    rules.Compile({}, {}, false, true);
+    CHECK(!rules.IsEmpty());
+    CHECK(rules.ShouldHide(Foreground(L"powerpnt.exe", false, true)));
+    CHECK(!rules.ShouldHide(Foreground(L"powerpnt.exe", true)));
+}
+
+TEST(ContextRules, IgnoreOverridesHide) {
+    ContextRules rules;
+    rules.Compile({ L"vlc.exe", L"VLC.EXE" }, { L"vlc.exe" }, false, false);
+    CHECK_EQ(rules.GetRuleCount(), 1u);
+    CHECK(rules.Lookup(Hash(L"vlc.exe")) == ContextRules::Action::Ignore);
+}
+
+TEST(ContextRules, ManyRules) {
+    std::vector<std::wstring> hide;
+    std::vector<std::wstring> ignore;
+    for (int i = 0; i < 4096; i++) {
+        (i % 2 ? ignore : hide).push_back(L"app" + std::to_wstring(i) + L".exe");
+    }
+
+    ContextRules rules;
+    rules.Compile(hide, ignore, false, false);
+    CHECK_EQ(rules.GetRuleCount(), 4096u);
+
+    for (int i = 0; i < 4096; i++) {
+        std::wstring name = L"APP" + std::to_wstring(i) + L".EXE";
+        ContextRules::Action expected = i % 2 ? ContextRules::Action::Ignore : ContextRules::Action::Hide;
+        CHECK(rules.Lookup(Hash(name.c_str())) == expected);
+    }
+    CHECK(rules.Lookup(Hash(L"app4096.exe")) == ContextRules::Action::None);
+
+    rules.Clear();
+    CHECK(rules.IsEmpty());
+    CHECK_EQ(rules.GetMemoryUsage(), 0u);
+}
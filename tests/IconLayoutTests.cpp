@@ -0,0 +1,101 @@
+#include "TestHarness.h"
+#include "IconLayout.h"
+#include "RemoteListView.h"
+#include <string>
+
+namespace {
+    using Win32Compat::FakeListView;
+
+    // count icons on a grid, named icon0, icon1, ...
+    void Fill(FakeListView& listView, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            std::wstring name = L"icon" + std::to_wstring(i);
+            listView.Add(name.c_str(), { static_cast<LONG>(i % 20) * 75, static_cast<LONG>(i / 20) * 100 });
+        }
+    }
+
+    void MoveAllOffscreen(FakeListView& listView) {
+        for (POINT& position : listView.positions) {
+            position = { -32000, -32000 };
+        }
+    }
+
+    bool AllOffscreen(const FakeListView& listView) {
+        for (const POINT& position : listView.positions) {
+            if (position.x != -32000 || position.y != -32000) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST(IconLayout, ApplyPutsIconsBack) {
+    FakeListView listView;
+    Fill(listView, 300);
+
+    IconLayout layout;
+    REQUIRE(layout.Capture(listView.Handle()));
+    CHECK_EQ(layout.GetCount(), 300u);
+
+    std::vector<POINT> saved = listView.positions;
+    MoveAllOffscreen(listView);
+
+    size_t moved = 0;
+    CHECK(layout.Apply(listView.Handle(), &moved));
+    CHECK_EQ(moved, 300u);
+    for (size_t i = 0; i < saved.size(); i++) {
+        CHECK(listView.positions[i].x == saved[i].x && listView.positions[i].y == saved[i].y);
+    }
+
+    // In place already: nothing to move
+    CHECK(layout.Apply(listView.Handle(), &moved));
+    CHECK_EQ(moved, 0u);
+}
+
+TEST(IconLayout, ApplyFailsOnShortRead) {
+    FakeListView listView;
+    Fill(listView, 300);
+
+    IconLayout layout;
+    REQUIRE(layout.Capture(listView.Handle()));
+    MoveAllOffscreen(listView);
+
+    // The first batch is read; sending its moves before the second read fails
+    listView.transfersLeft = 2;
+    CHECK(!layout.Apply(listView.Handle()));
+
+    // Still usable once the listview answers again
+    listView.transfersLeft = -1;
+    CHECK(layout.Apply(listView.Handle()));
+    CHECK_EQ(listView.positions[299].x, 19 * 75);
+}
+
+TEST(IconLayout, ApplyFailsWhenMovesAreLost) {
+    FakeListView listView;
+    Fill(listView, 10);
+
+    IconLayout layout;
+    REQUIRE(layout.Capture(listView.Handle()));
+    MoveAllOffscreen(listView);
+
+    // Reading works, the moves sent when painting resumes do not
+    listView.transfersLeft = 2;
+    CHECK(!layout.Apply(listView.Handle()));
+    CHECK(AllOffscreen(listView));
+
+    listView.transfersLeft = -1;
+    CHECK(layout.Apply(listView.Handle()));
+    CHECK(!AllOffscreen(listView));
+}
+
+TEST(IconLayout, ApplyRefusesAutoArrange) {
+    FakeListView listView;
+    Fill(listView, 10);
+
+    IconLayout layout;
+    REQUIRE(layout.Capture(listView.Handle()));
+
+    listView.style = LVS_AUTOARRANGE;
+    CHECK(!layout.Apply(listView.Handle()));
+}
@@ -0,0 +1,114 @@
+#include "TestHarness.h"
+#include "IconSchedule.h"
+
+namespace {
+    SYSTEMTIME At(WORD hour, WORD minute, WORD second = 0) {
+        SYSTEMTIME time = {};
+        time.wYear = 2026;
+        time.wMonth = 1;
+        time.wDay = 1;
+        time.wHour = hour;
+        time.wMinute = minute;
+        time.wSecond = second;
+        return time;
+    }
+
+    constexpr ULONGLONG MINUTE_MS = 60 * 1000;
+}
+
+TEST(IconSchedule, ParsesWindows) {
+    IconSchedule::Window window;
+    REQUIRE(IconSchedule::Parse(L"09:00-17:30", window));
+    CHECK_EQ(window.start, 9 * 60);
+    CHECK_EQ(window.end, 17 * 60 + 30);
+
+    REQUIRE(IconSchedule::Parse(L" 9:05 - 17:00 ", window));
+    CHECK_EQ(window.start, 9 * 60 + 5);
+
+    REQUIRE(IconSchedule::Parse(L"22:00-06:00", window));
+    CHECK_EQ(window.start, 22 * 60);
+    CHECK_EQ(window.end, 6 * 60);
+}
+
+TEST(IconSchedule, RejectsMalformedWindows) {
+    IconSchedule::Window window;
+    CHECK(!IconSchedule::Parse(L"", window));
+    CHECK(!IconSchedule::Parse(L"09:00", window));
+    CHECK(!IconSchedule::Parse(L"09:00-", window));
+    CHECK(!IconSchedule::Parse(L"9-17", window));
+    CHECK(!IconSchedule::Parse(L"09:0-17:00", window));
+    CHECK(!IconSchedule::Parse(L"09:60-17:00", window));
+    CHECK(!IconSchedule::Parse(L"25:00-17:00", window));
+    CHECK(!IconSchedule::Parse(L"24:01-17:00", window));
+    CHECK(!IconSchedule::Parse(L"09:00-17:00x", window));
+    CHECK(!IconSchedule::Parse(L"123:00-17:00", window));
+
+    // Empty windows would never hide anything
+    CHECK(!IconSchedule::Parse(L"09:00-09:00", window));
+}
+
+TEST(IconSchedule, CountsRejectedSpecs) {
+    IconSchedule schedule;
+    std::vector<std::wstring> rejected;
+    CHECK_EQ(schedule.SetWindows({ L"09:00-12:00", L"nonsense", L"13:00-17:00" }, &rejected), 1u);
+    REQUIRE(rejected.size() == 1);
+    CHECK(rejected[0] == L"nonsense");
+    CHECK_EQ(schedule.GetCount(), 2u);
+
+    schedule.Clear();
+    CHECK(schedule.IsEmpty());
+}
+
+TEST(IconSchedule, HideTime) {
+    IconSchedule schedule;
+    schedule.SetWindows({ L"09:00-17:00" });
+    CHECK(!schedule.IsHideTime(At(8, 59)));
+    CHECK(schedule.IsHideTime(At(9, 0)));
+    CHECK(schedule.IsHideTime(At(16, 59)));
+    CHECK(!schedule.IsHideTime(At(17, 0)));
+
+    schedule.SetWindows({ L"22:00-06:00" });
+    CHECK(schedule.IsHideTime(At(23, 0)));
+    CHECK(schedule.IsHideTime(At(0, 0)));
+    CHECK(schedule.IsHideTime(At(5, 59)));
+    CHECK(!schedule.IsHideTime(At(6, 0)));
+    CHECK(!schedule.IsHideTime(At(21, 59)));
+}
+
+TEST(IconSchedule, NextEdgeDelay) {
+    IconSchedule schedule;
+    schedule.SetWindows({ L"09:00-17:00" });
+
+    // Before the window: its start; inside: its end; after: tomorrow's start
+    CHECK_EQ(schedule.GetNextEdgeDelay(0, At(8, 0)), 60 * MINUTE_MS);
+    CHECK_EQ(schedule.GetNextEdgeDelay(0, At(9, 0)), 8 * 60 * MINUTE_MS);
+    CHECK_EQ(schedule.GetNextEdgeDelay(0, At(17, 0)), 16 * 60 * MINUTE_MS);
+
+    // Counted from the current second
+    CHECK_EQ(schedule.GetNextEdgeDelay(0, At(8, 59, 30)), 30 * 1000u);
+}
+
+TEST(IconSchedule, MidnightEndsWindows) {
+    IconSchedule::Window window;
+    REQUIRE(IconSchedule::Parse(L"00:00-24:00", window));
+    CHECK_EQ(window.start, 0);
+    CHECK_EQ(window.end, 24 * 60);
+
+    REQUIRE(IconSchedule::Parse(L"22:00-24:00", window));
+    CHECK_EQ(window.end, 24 * 60);
+
+    // 24:00 ends a day, it does not start one
+    CHECK(!IconSchedule::Parse(L"24:00-06:00", window));
+
+    IconSchedule schedule;
+    schedule.SetWindows({ L"00:00-24:00" });
+    CHECK(schedule.IsHideTime(At(0, 0)));
+    CHECK(schedule.IsHideTime(At(12, 0)));
+    CHECK(schedule.IsHideTime(At(23, 59)));
+    CHECK_EQ(schedule.GetNextEdgeDelay(0, At(23, 0)), 60 * MINUTE_MS);
+
+    schedule.SetWindows({ L"22:00-24:00" });
+    CHECK(schedule.IsHideTime(At(23, 59)));
+    CHECK(!schedule.IsHideTime(At(0, 0)));
+    CHECK_EQ(schedule.GetNextEdgeDelay(0, At(22, 30)), 90 * MINUTE_MS);
+}
@@ -0,0 +1,126 @@
+#include "TestHarness.h"
+#include "IdleDetector.h"
+
+namespace {
+    constexpr DWORD SECOND_MS = 1000;
+    constexpr DWORD MINUTE_MS = 60 * SECOND_MS;
+
+    // Drives a detector the way the application does, against a virtual
+    // clock: input every second while active, none while away
+    struct Session {
+        IdleDetector idle;
+        DWORD now;
+        DWORD lastInput;
+        DWORD deadline;
+        uint32_t hides = 0;
+        uint32_t resumes = 0;
+
+        Session(DWORD timeout, DWORD start)
+            : now(start)
+            , lastInput(start) {
+            idle.SetTimeout(timeout);
+            deadline = now + idle.Arm(now, lastInput);
+        }
+
+        void Run(DWORD duration, bool active) {
+            for (DWORD elapsed = 0; elapsed < duration; elapsed += SECOND_MS) {
+                now += SECOND_MS;
+                if (active) {
+                    lastInput = now;
+                    if (idle.OnInput()) {
+                        resumes++;
+                        deadline = now + idle.Arm(now, lastInput);
+                    }
+                }
+
+                if (!idle.IsIdle() && static_cast<LONG>(now - deadline) >= 0) {
+                    DWORD next;
+                    if (idle.OnDeadline(now, lastInput, next)) {
+                        hides++;
+                    } else {
+                        deadline = now + next;
+                    }
+                }
+            }
+        }
+    };
+}
+
+TEST(IdleDetector, DisabledNeverArms) {
+    IdleDetector idle;
+    CHECK(!idle.IsEnabled());
+    CHECK_EQ(idle.Arm(1000, 0), IdleDetector::NO_DEADLINE);
+
+    DWORD next = 0;
+    CHECK(!idle.OnDeadline(1000, 0, next));
+    CHECK_EQ(next, IdleDetector::NO_DEADLINE);
+    CHECK(!idle.OnInput());
+}
+
+TEST(IdleDetector, DeadlineFollowsLastInput) {
+    IdleDetector idle;
+    idle.SetTimeout(5 * MINUTE_MS);
+    CHECK_EQ(idle.Arm(10 * SECOND_MS, 0), 5 * MINUTE_MS - 10 * SECOND_MS);
+
+    // Input since arming moves the deadline instead of going idle
+    DWORD next = 0;
+    CHECK(!idle.OnDeadline(5 * MINUTE_MS, 4 * MINUTE_MS, next));
+    CHECK_EQ(next, 4 * MINUTE_MS);
+    CHECK(!idle.IsIdle());
+
+    CHECK(idle.OnDeadline(9 * MINUTE_MS, 4 * MINUTE_MS, next));
+    CHECK_EQ(next, IdleDetector::NO_DEADLINE);
+    CHECK(idle.IsIdle());
+    CHECK_EQ(idle.Arm(10 * MINUTE_MS, 4 * MINUTE_MS), IdleDetector::NO_DEADLINE);
+}
+
+TEST(IdleDetector, ResumeIsAnEdge) {
+    IdleDetector idle;
+    idle.SetTimeout(MINUTE_MS);
+
+    DWORD next = 0;
+    REQUIRE(idle.OnDeadline(MINUTE_MS, 0, next));
+    CHECK(idle.OnInput());
+    CHECK(!idle.OnInput());
+    CHECK(!idle.IsIdle());
+}
+
+TEST(IdleDetector, LastInputAheadOfClock) {
+    IdleDetector idle;
+    idle.SetTimeout(MINUTE_MS);
+    CHECK_EQ(idle.Arm(1000, 1005), MINUTE_MS);
+
+    DWORD next = 0;
+    CHECK(!idle.OnDeadline(1000, 1005, next));
+    CHECK_EQ(next, MINUTE_MS);
+}
+
+TEST(IdleDetector, TurningOffLeavesIdle) {
+    IdleDetector idle;
+    idle.SetTimeout(MINUTE_MS);
+
+    DWORD next = 0;
+    REQUIRE(idle.OnDeadline(MINUTE_MS, 0, next));
+    idle.SetTimeout(0);
+    CHECK(!idle.IsIdle());
+    CHECK(!idle.OnInput());
+}
+
+// A working day with a break, across the 49.7 day GetTickCount() wrap:
+// one wakeup per timeout while active instead of one per input
+TEST(IdleDetector, WorkingDayOnVirtualClock) {
+    Session session(5 * MINUTE_MS, 0xFFFF0000u);
+
+    session.Run(8 * 60 * MINUTE_MS, true);
+    CHECK_EQ(session.hides, 0u);
+    CHECK(session.idle.GetWakeups() <= 8 * 60 / 5 + 1);
+
+    session.Run(40 * MINUTE_MS, false);
+    CHECK_EQ(session.hides, 1u);
+    CHECK(session.idle.IsIdle());
+
+    session.Run(8 * 60 * MINUTE_MS, true);
+    CHECK_EQ(session.hides, 1u);
+    CHECK_EQ(session.resumes, 1u);
+    CHECK(session.idle.GetWakeups() <= 2 * (8 * 60 / 5 + 1) + 1);
+}
@@ -0,0 +1,50 @@
+#include "TestHarness.h"
+#include "IpcProtocol.h"
+
+TEST(IpcProtocol, CookiesAreNeverZero) {
+    // Slot 0 is the instance Initialize creates, so the first client of a
+    // fresh server usually gets it
+    CHECK(Ipc::MakeCookie(0, 0) != 0);
+    CHECK(Ipc::MakeCookie(0, 0xFFFFFFFF) != 0);
+}
+
+TEST(IpcProtocol, CookiesRoundTrip) {
+    const uint32_t slots[] = { 0, 1, 63 };
+    const uint32_t generations[] = { 0, 1, 0xFFFFFFFF };
+    for (uint32_t slot : slots) {
+        for (uint32_t generation : generations) {
+            uint64_t cookie = Ipc::MakeCookie(slot, generation);
+            CHECK_EQ(Ipc::CookieSlot(cookie), slot);
+            CHECK_EQ(Ipc::CookieGeneration(cookie), generation);
+        }
+    }
+
+    CHECK(Ipc::MakeCookie(0, 0) != Ipc::MakeCookie(0, 1));
+    CHECK(Ipc::MakeCookie(0, 0) != Ipc::MakeCookie(1, 0));
+}
+
+TEST(IpcProtocol, RequestAndResponseFrames) {
+    const Ipc::Opcode ops[] = { Ipc::Opcode::Hide, Ipc::Opcode::QueryState };
+    uint8_t buffer[Ipc::HEADER_SIZE + Ipc::MAX_REQUEST_PAYLOAD];
+    size_t size = Ipc::EncodeRequest(buffer, sizeof(buffer), 7, ops, 2);
+    REQUIRE(size == Ipc::HEADER_SIZE + Ipc::MIN_REQUEST_PAYLOAD + 2);
+    CHECK_EQ(Ipc::ReadU32(buffer), Ipc::MIN_REQUEST_PAYLOAD + 2);
+    CHECK_EQ(Ipc::ReadU32(buffer + 4), 7u);
+    CHECK_EQ(buffer[8], 2);
+    CHECK_EQ(buffer[9], static_cast<uint8_t>(Ipc::Opcode::Hide));
+
+    CHECK_EQ(Ipc::EncodeRequest(buffer, sizeof(buffer), 7, ops, 0), 0u);
+    CHECK_EQ(Ipc::EncodeRequest(buffer, 8, 7, ops, 2), 0u);
+
+    size = Ipc::EncodeResponse(buffer, sizeof(buffer), 7, Ipc::Status::Ok, Ipc::WireState::Hidden);
+    REQUIRE(size == Ipc::RESPONSE_FRAME_SIZE);
+
+    uint32_t requestId = 0;
+    Ipc::Status status = Ipc::Status::BadRequest;
+    Ipc::WireState state = Ipc::WireState::Unknown;
+    REQUIRE(Ipc::DecodeResponse(buffer, size, requestId, status, state));
+    CHECK_EQ(requestId, 7u);
+    CHECK(status == Ipc::Status::Ok);
+    CHECK(state == Ipc::WireState::Hidden);
+    CHECK(!Ipc::DecodeResponse(buffer, size - 1, requestId, status, state));
+}
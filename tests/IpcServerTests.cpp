@@ -0,0 +1,76 @@
+#include "TestHarness.h"
+#include "IpcServer.h"
+#include "IpcClient.h"
+#include "CommandBus.h"
+#include <atomic>
+#include <thread>
+
+// Runs the real pipe server, so Windows only, and it shares the session's
+// pipe name: close a running instance first.
+
+namespace {
+    struct ClientResult {
+        bool transacted = false;
+        Ipc::Status status = Ipc::Status::BadRequest;
+        Ipc::WireState state = Ipc::WireState::Unknown;
+    };
+
+    // Stands in for the application's message loop: drains the bus and
+    // completes every command that asks for it, as DispatchCommand does
+    void PumpUntil(HWND window, CommandBus& bus, IpcServer& server, const std::atomic<bool>& done) {
+        ULONGLONG deadline = GetTickCount64() + FORWARD_CONNECT_TIMEOUT_MS + FORWARD_RESPONSE_TIMEOUT_MS;
+        while (!done.load() && GetTickCount64() < deadline) {
+            MSG msg;
+            while (PeekMessage(&msg, window, 0, 0, PM_REMOVE)) {
+                if (msg.message != WM_COMMAND_BUS) {
+                    continue;
+                }
+
+                bus.BeginDrain();
+                Command command;
+                while (bus.TryTake(command)) {
+                    if (command.source == CommandSource::Ipc && command.cookie != 0) {
+                        server.CompleteRequest(command.cookie, IconState::Hidden);
+                    }
+                }
+            }
+            Sleep(1);
+        }
+    }
+}
+
+TEST(IpcServer, FirstRequestGetsAReply) {
+    HWND window = CreateWindowEx(0, L"STATIC", L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, nullptr, nullptr);
+    REQUIRE(window != nullptr);
+
+    CommandBus bus;
+    IpcServer server;
+    bool started = bus.Initialize(window) && server.Initialize(&bus);
+    if (!started) {
+        DestroyWindow(window);
+    }
+    REQUIRE(started);
+
+    // The first client of a fresh server gets slot 0 at generation 0
+    ClientResult result;
+    std::atomic<bool> done(false);
+    std::thread client([&result, &done]() {
+        IpcClient ipc;
+        const Ipc::Opcode op = Ipc::Opcode::Hide;
+        result.transacted = ipc.Connect(FORWARD_CONNECT_TIMEOUT_MS) &&
+                            ipc.Transact(&op, 1, FORWARD_RESPONSE_TIMEOUT_MS, result.status, result.state);
+        ipc.Close();
+        done.store(true);
+    });
+
+    PumpUntil(window, bus, server, done);
+    client.join();
+
+    server.Cleanup();
+    bus.Cleanup();
+    DestroyWindow(window);
+
+    CHECK(result.transacted);
+    CHECK(result.status == Ipc::Status::Ok);
+    CHECK(result.state == Ipc::WireState::Hidden);
+}
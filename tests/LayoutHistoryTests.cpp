@@ -0,0 +1,332 @@
+#include "TestHarness.h"
+#include "LayoutHistory.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    const wchar_t* const HISTORY_PATH = L"layout-history-test.dat";
+    constexpr uint64_t FILETIME_PER_MINUTE = 60ull * 10000000;
+
+    LayoutHistory::Retention KeepEverything() {
+        LayoutHistory::Retention retention;
+        retention.maxAgeDays = 0;
+        retention.maxBytes = 0;
+        return retention;
+    }
+
+    uint64_t FileSize() {
+        FILE* file = std::fopen("layout-history-test.dat", "rb");
+        if (!file) {
+            return 0;
+        }
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fclose(file);
+        return static_cast<uint64_t>(size);
+    }
+
+    // Damages one byte in place; the file keeps its size
+    void FlipByte(uint64_t offset) {
+        FILE* file = std::fopen("layout-history-test.dat", "r+b");
+        if (!file) {
+            return;
+        }
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        int byte = std::fgetc(file);
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        std::fputc(byte ^ 0xFF, file);
+        std::fclose(file);
+    }
+
+    void RemoveFile() {
+        std::remove("layout-history-test.dat");
+    }
+
+    IconLayout Grid(size_t count) {
+        IconLayout layout;
+        for (size_t i = 0; i < count; i++) {
+            std::wstring name = L"Icon " + std::to_wstring(i);
+            layout.Add(name.c_str(), { static_cast<LONG>(i % 10) * 75, static_cast<LONG>(i / 10) * 100 });
+        }
+        layout.Sort();
+        return layout;
+    }
+
+    // The next snapshot: a few icons moved in either direction, an
+    // occasional one removed or added
+    IconLayout Edit(const IconLayout& layout, std::mt19937& random, int step) {
+        IconLayout next;
+        for (size_t i = 0; i < layout.GetCount(); i++) {
+            IconLayout::Entry entry = layout.GetEntry(i);
+            if (random() % 100 == 0) {
+                continue;
+            }
+            if (random() % 10 == 0) {
+                entry.position.x += static_cast<LONG>(random() % 300) - 150;
+                entry.position.y -= static_cast<LONG>(random() % 80);
+            }
+            next.Add(entry.name.c_str(), entry.position);
+        }
+        if (random() % 4 == 0) {
+            std::wstring name = L"New " + std::to_wstring(step);
+            next.Add(name.c_str(), { static_cast<LONG>(random() % 2000), static_cast<LONG>(random() % 1000) });
+        }
+        next.Sort();
+        return next;
+    }
+}
+
+TEST(LayoutHistory, RebuildsEverySnapshot) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    std::mt19937 random(1);
+    std::vector<IconLayout> snapshots;
+    IconLayout layout = Grid(80);
+    uint64_t time = LayoutHistory::Now();
+
+    // Several keyframe groups, so loads cross keyframes and deltas
+    for (int step = 0; step < 3 * static_cast<int>(LayoutHistory::KEYFRAME_INTERVAL) + 5; step++) {
+        time += FILETIME_PER_MINUTE;
+        if (history.Append(layout, time)) {
+            snapshots.push_back(layout);
+        }
+        layout = Edit(layout, random, step);
+    }
+    REQUIRE(history.GetCount() == snapshots.size());
+
+    IconLayout loaded;
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        REQUIRE(history.Load(i, loaded));
+        CHECK(loaded.Equals(snapshots[i]));
+    }
+
+    // And again from the file alone
+    history.Close();
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+    REQUIRE(history.GetCount() == snapshots.size());
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        REQUIRE(history.Load(i, loaded));
+        CHECK(loaded.Equals(snapshots[i]));
+    }
+
+    history.Close();
+    RemoveFile();
+}
+
+TEST(LayoutHistory, DeltasAreSmall) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    IconLayout layout = Grid(200);
+    uint64_t time = LayoutHistory::Now();
+    REQUIRE(history.Append(layout, time));
+    uint64_t keyframeSize = FileSize();
+
+    // One icon nudged: the delta names one entry with small coordinates
+    IconLayout moved;
+    for (size_t i = 0; i < layout.GetCount(); i++) {
+        IconLayout::Entry entry = layout.GetEntry(i);
+        if (i == 17) {
+            entry.position.x += 3;
+            entry.position.y -= 2;
+        }
+        moved.Add(entry.name.c_str(), entry.position);
+    }
+    moved.Sort();
+    REQUIRE(history.Append(moved, time + FILETIME_PER_MINUTE));
+    CHECK(FileSize() - keyframeSize < 64);
+
+    history.Close();
+    RemoveFile();
+}
+
+TEST(LayoutHistory, SkipsUnchangedLayouts) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    IconLayout layout = Grid(10);
+    uint64_t time = LayoutHistory::Now();
+    CHECK(history.Append(layout, time));
+    CHECK(!history.Append(layout, time + FILETIME_PER_MINUTE));
+    CHECK_EQ(history.GetCount(), 1u);
+
+    history.Close();
+    RemoveFile();
+}
+
+TEST(LayoutHistory, SeeksByTime) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    std::mt19937 random(2);
+    IconLayout layout = Grid(20);
+    uint64_t start = LayoutHistory::Now();
+    for (int step = 0; step < 10; step++) {
+        REQUIRE(history.Append(layout, start + step * 10 * FILETIME_PER_MINUTE));
+        IconLayout next;
+        do {
+            next = Edit(layout, random, step);
+        } while (next.Equals(layout));
+        layout = next;
+    }
+
+    CHECK_EQ(history.Seek(start - 1), LayoutHistory::NPOS);
+    CHECK_EQ(history.Seek(start), 0u);
+    CHECK_EQ(history.Seek(start + 15 * FILETIME_PER_MINUTE), 1u);
+    CHECK_EQ(history.Seek(start + 90 * FILETIME_PER_MINUTE), 9u);
+    CHECK_EQ(history.Seek(start + 1000 * FILETIME_PER_MINUTE), 9u);
+
+    history.Close();
+    RemoveFile();
+}
+
+TEST(LayoutHistory, CutsDamagedTail) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    std::mt19937 random(3);
+    IconLayout layout = Grid(30);
+    uint64_t time = LayoutHistory::Now();
+    std::vector<IconLayout> snapshots;
+    for (int step = 0; step < 5; step++) {
+        if (history.Append(layout, time + step * FILETIME_PER_MINUTE)) {
+            snapshots.push_back(layout);
+        }
+        layout = Edit(layout, random, step);
+    }
+    history.Close();
+
+    // A write torn in the middle of the last record
+    uint64_t size = FileSize();
+    std::vector<char> bytes(static_cast<size_t>(size));
+    FILE* file = std::fopen("layout-history-test.dat", "rb");
+    REQUIRE(file);
+    REQUIRE(std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+    std::fclose(file);
+    file = std::fopen("layout-history-test.dat", "wb");
+    REQUIRE(file);
+    std::fwrite(bytes.data(), 1, bytes.size() - 5, file);
+    std::fclose(file);
+
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+    REQUIRE(history.GetCount() == snapshots.size() - 1);
+
+    IconLayout loaded;
+    REQUIRE(history.Load(history.GetCount() - 1, loaded));
+    CHECK(loaded.Equals(snapshots[snapshots.size() - 2]));
+
+    // Appending continues from the cut
+    CHECK(history.Append(snapshots.back(), time + 10 * FILETIME_PER_MINUTE));
+    REQUIRE(history.Load(history.GetCount() - 1, loaded));
+    CHECK(loaded.Equals(snapshots.back()));
+
+    history.Close();
+    RemoveFile();
+}
+
+TEST(LayoutHistory, CutsDamagedRecords) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    std::mt19937 random(5);
+    IconLayout layout = Grid(30);
+    uint64_t time = LayoutHistory::Now();
+    std::vector<IconLayout> snapshots;
+    std::vector<uint64_t> sizes; // File size after each snapshot
+    for (int step = 0; step < 6; step++) {
+        if (history.Append(layout, time + step * FILETIME_PER_MINUTE)) {
+            snapshots.push_back(layout);
+            sizes.push_back(FileSize());
+        }
+        layout = Edit(layout, random, step);
+    }
+    history.Close();
+    REQUIRE(snapshots.size() >= 3);
+
+    // A complete last record whose payload no longer matches its checksum
+    // is cut from the file, not just skipped
+    FlipByte(sizes.back() - 1);
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+    CHECK_EQ(history.GetCount(), snapshots.size() - 1);
+    CHECK_EQ(FileSize(), sizes[sizes.size() - 2]);
+
+    IconLayout loaded;
+    REQUIRE(history.Load(history.GetCount() - 1, loaded));
+    CHECK(loaded.Equals(snapshots[snapshots.size() - 2]));
+
+    // Appending diffs against the last good snapshot and survives a reopen
+    CHECK(history.Append(snapshots.back(), time + 10 * FILETIME_PER_MINUTE));
+    history.Close();
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+    CHECK_EQ(history.GetCount(), snapshots.size());
+    REQUIRE(history.Load(history.GetCount() - 1, loaded));
+    CHECK(loaded.Equals(snapshots.back()));
+    history.Close();
+
+    // Without its keyframe nothing in the group rebuilds; back to the header
+    FlipByte(sizes.front() - 1);
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+    CHECK_EQ(history.GetCount(), 0u);
+    CHECK_EQ(FileSize(), 8u);
+
+    CHECK(history.Append(snapshots.front(), time + 20 * FILETIME_PER_MINUTE));
+    REQUIRE(history.Load(0, loaded));
+    CHECK(loaded.Equals(snapshots.front()));
+
+    history.Close();
+    RemoveFile();
+}
+
+TEST(LayoutHistory, RetentionDropsWholeGroups) {
+    RemoveFile();
+
+    LayoutHistory history;
+    REQUIRE(history.Open(HISTORY_PATH, KeepEverything()));
+
+    std::mt19937 random(4);
+    IconLayout layout = Grid(60);
+    uint64_t time = LayoutHistory::Now() - 10 * 24 * 60 * FILETIME_PER_MINUTE;
+    std::vector<IconLayout> snapshots;
+    for (int step = 0; step < 4 * static_cast<int>(LayoutHistory::KEYFRAME_INTERVAL); step++) {
+        time += 60 * FILETIME_PER_MINUTE;
+        if (history.Append(layout, time)) {
+            snapshots.push_back(layout);
+        }
+        layout = Edit(layout, random, step);
+    }
+
+    uint64_t fullSize = FileSize();
+    LayoutHistory::Retention retention = KeepEverything();
+    retention.maxBytes = fullSize / 2;
+    history.SetRetention(retention);
+
+    CHECK(FileSize() <= retention.maxBytes);
+    REQUIRE(history.GetCount() > 0);
+    REQUIRE(history.GetCount() < snapshots.size());
+
+    // What is left is the newest snapshots, still loadable
+    size_t dropped = snapshots.size() - history.GetCount();
+    CHECK_EQ(dropped % LayoutHistory::KEYFRAME_INTERVAL, 0u);
+    IconLayout loaded;
+    for (size_t i = 0; i < history.GetCount(); i++) {
+        REQUIRE(history.Load(i, loaded));
+        CHECK(loaded.Equals(snapshots[dropped + i]));
+    }
+
+    history.Close();
+    RemoveFile();
+}
@@ -0,0 +1,50 @@
+#include "TestHarness.h"
+#include "MpscQueue.h"
+
+TEST(MpscQueue, PushAllKeepsOrder) {
+    MpscQueue<int, 8> queue;
+    REQUIRE(queue.TryPush(1));
+
+    int values[] = { 2, 3, 4 };
+    REQUIRE(queue.TryPushAll(values, 3));
+
+    int value = 0;
+    for (int expected = 1; expected <= 4; expected++) {
+        REQUIRE(queue.TryPop(value));
+        CHECK_EQ(value, expected);
+    }
+    CHECK(!queue.TryPop(value));
+}
+
+TEST(MpscQueue, PushAllIsAllOrNothing) {
+    MpscQueue<int, 8> queue;
+    for (int i = 0; i < 6; i++) {
+        REQUIRE(queue.TryPush(i));
+    }
+
+    // Three do not fit in the two free slots, so none may go in
+    int values[] = { 10, 11, 12 };
+    CHECK(!queue.TryPushAll(values, 3));
+
+    int value = 0;
+    for (int i = 0; i < 6; i++) {
+        REQUIRE(queue.TryPop(value));
+        CHECK_EQ(value, i);
+    }
+    CHECK(!queue.TryPop(value));
+
+    // Room again, across the end of the ring
+    REQUIRE(queue.TryPushAll(values, 3));
+    for (int expected = 10; expected <= 12; expected++) {
+        REQUIRE(queue.TryPop(value));
+        CHECK_EQ(value, expected);
+    }
+}
+
+TEST(MpscQueue, PushAllRejectsMoreThanCapacity) {
+    MpscQueue<int, 4> queue;
+    int values[5] = {};
+    CHECK(!queue.TryPushAll(values, 5));
+    CHECK(queue.TryPushAll(values, 4));
+    CHECK(!queue.TryPush(0));
+}
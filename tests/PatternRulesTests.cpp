@@ -0,0 +1,84 @@
+#include "TestHarness.h"
+#include "PatternRules.h"
+
+TEST(PatternRules, EmptyMatchesNothing) {
+    PatternRules rules;
+    CHECK(rules.IsEmpty());
+    CHECK(!rules.Matches(L"Recycle Bin"));
+    CHECK(!rules.Add(L""));
+    CHECK(rules.IsEmpty());
+}
+
+TEST(PatternRules, Literal) {
+    PatternRules rules;
+    REQUIRE(rules.Add(L"Recycle Bin"));
+    CHECK(rules.Matches(L"Recycle Bin"));
+    CHECK(rules.Matches(L"RECYCLE BIN"));
+    CHECK(!rules.Matches(L"Recycle Bin 2"));
+    CHECK(!rules.Matches(L"Recycle"));
+    CHECK(!rules.Matches(L""));
+}
+
+TEST(PatternRules, Prefix) {
+    PatternRules rules;
+    REQUIRE(rules.Add(L"Project*"));
+    CHECK(rules.Matches(L"Project"));
+    CHECK(rules.Matches(L"project notes.txt"));
+    CHECK(!rules.Matches(L"My Project"));
+    CHECK(!rules.Matches(L"Proj"));
+}
+
+TEST(PatternRules, Suffix) {
+    PatternRules rules;
+    REQUIRE(rules.Add(L"*.LNK"));
+    CHECK(rules.Matches(L"Browser.lnk"));
+    CHECK(rules.Matches(L".lnk"));
+    CHECK(!rules.Matches(L"Browser.lnk.txt"));
+    CHECK(!rules.Matches(L"lnk"));
+}
+
+TEST(PatternRules, Glob) {
+    PatternRules rules;
+    REQUIRE(rules.Add(L"report-*-q?.pdf"));
+    CHECK(rules.Matches(L"report-2026-q3.pdf"));
+    CHECK(rules.Matches(L"REPORT--Q1.PDF"));
+    CHECK(!rules.Matches(L"report-2026-q10.pdf"));
+    CHECK(!rules.Matches(L"report-2026-q3.pdf.bak"));
+
+    // Backtracks past an early partial match
+    PatternRules nested;
+    REQUIRE(nested.Add(L"*a*b?c"));
+    CHECK(nested.Matches(L"xxaxxbxxabzc"));
+    CHECK(!nested.Matches(L"xxaxxbxxabc"));
+}
+
+TEST(PatternRules, Regex) {
+    PatternRules rules;
+    REQUIRE(rules.Add(L"re:(notes|todo)-[0-9]+\\.txt"));
+    CHECK(rules.Matches(L"notes-12.txt"));
+    CHECK(rules.Matches(L"TODO-3.TXT"));
+
+    // The whole name must match
+    CHECK(!rules.Matches(L"old notes-12.txt"));
+    CHECK(!rules.Matches(L"notes-.txt"));
+
+    CHECK(!rules.Add(L"re:(unclosed"));
+    CHECK_EQ(rules.GetCount(), 1u);
+}
+
+TEST(PatternRules, AnyRuleMatches) {
+    PatternRules rules;
+    REQUIRE(rules.Add(L"Recycle Bin"));
+    REQUIRE(rules.Add(L"*.lnk"));
+    REQUIRE(rules.Add(L"re:[a-c]+"));
+    CHECK_EQ(rules.GetCount(), 3u);
+
+    CHECK(rules.Matches(L"recycle bin"));
+    CHECK(rules.Matches(L"Mail.lnk"));
+    CHECK(rules.Matches(L"abcab"));
+    CHECK(!rules.Matches(L"notes.txt"));
+
+    rules.Clear();
+    CHECK(rules.IsEmpty());
+    CHECK(!rules.Matches(L"recycle bin"));
+}
@@ -0,0 +1,148 @@
+#include "TestHarness.h"
+#include "StrategySelector.h"
+
+namespace {
+    // A desktop whose icons three strategies hide in different places, and
+    // strategies that each only undo their own hide: the worst case for a
+    // show by a different strategy than the hide
+    struct FakeDesktop {
+        static constexpr size_t COUNT = 3;
+
+        bool hiddenBy[COUNT] = {};
+        bool broken[COUNT] = {};
+        uint64_t latencyUs[COUNT] = { 300, 100, 200 };
+        size_t attempts[COUNT] = {};
+
+        bool IsVisible() const {
+            for (bool hidden : hiddenBy) {
+                if (hidden) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Applies and verifies, like DesktopIconManager::TryStrategy
+        bool Apply(size_t strategy, bool visible, uint64_t& latency) {
+            attempts[strategy]++;
+            latency = latencyUs[strategy];
+            if (!broken[strategy]) {
+                hiddenBy[strategy] = !visible;
+            }
+            return IsVisible() == visible;
+        }
+    };
+
+    size_t Toggle(StrategySelector& selector, FakeDesktop& desktop, bool visible) {
+        return selector.Apply(visible, [&](size_t strategy, uint64_t& latency) {
+            return desktop.Apply(strategy, visible, latency);
+        });
+    }
+}
+
+TEST(StrategySelector, CalibrationLeavesIconsVisible) {
+    StrategySelector selector(FakeDesktop::COUNT, 2);
+    FakeDesktop desktop;
+
+    int toggles = 0;
+    while (selector.IsCalibrating() && toggles < 100) {
+        REQUIRE(Toggle(selector, desktop, false) != StrategySelector::NPOS);
+        CHECK(!desktop.IsVisible());
+        REQUIRE(Toggle(selector, desktop, true) != StrategySelector::NPOS);
+        CHECK(desktop.IsVisible());
+        toggles += 2;
+    }
+
+    CHECK(!selector.IsCalibrating());
+    CHECK_EQ(toggles, 6);
+    for (size_t attempts : desktop.attempts) {
+        CHECK_EQ(attempts, 2u);
+    }
+
+    // The fastest is kept
+    CHECK_EQ(selector.GetSelected(), 1u);
+    CHECK(selector.TakeSelectionChanged());
+    CHECK(!selector.TakeSelectionChanged());
+}
+
+TEST(StrategySelector, ShowGoesToTheStrategyThatHid) {
+    StrategySelector selector(FakeDesktop::COUNT, 2);
+    FakeDesktop desktop;
+
+    size_t hid = Toggle(selector, desktop, false);
+    REQUIRE(hid != StrategySelector::NPOS);
+    CHECK_EQ(Toggle(selector, desktop, true), hid);
+
+    // The next pair measures another strategy
+    size_t next = Toggle(selector, desktop, false);
+    CHECK(next != hid);
+    CHECK_EQ(Toggle(selector, desktop, true), next);
+}
+
+TEST(StrategySelector, CalibrationSkipsBrokenStrategies) {
+    StrategySelector selector(FakeDesktop::COUNT, 2);
+    FakeDesktop desktop;
+    desktop.broken[0] = true;
+
+    for (int toggle = 0; toggle < 20 && selector.IsCalibrating(); toggle++) {
+        bool visible = toggle % 2 != 0;
+        CHECK(Toggle(selector, desktop, visible) != 0);
+        CHECK_EQ(desktop.IsVisible(), visible);
+    }
+
+    CHECK(!selector.IsCalibrating());
+    CHECK(selector.GetSelected() != 0);
+}
+
+TEST(StrategySelector, FailsOverFastestFirst) {
+    StrategySelector selector(FakeDesktop::COUNT, 2);
+    FakeDesktop desktop;
+    while (selector.IsCalibrating()) {
+        Toggle(selector, desktop, false);
+        Toggle(selector, desktop, true);
+    }
+    selector.TakeSelectionChanged();
+
+    // The selection (1) breaks: 2 is the next fastest
+    desktop.broken[1] = true;
+    CHECK_EQ(Toggle(selector, desktop, false), 2u);
+    CHECK_EQ(selector.GetSelected(), 2u);
+    CHECK(selector.TakeSelectionChanged());
+    CHECK_EQ(Toggle(selector, desktop, true), 2u);
+    CHECK(desktop.IsVisible());
+}
+
+TEST(StrategySelector, NothingWorks) {
+    StrategySelector selector(FakeDesktop::COUNT, 2);
+    FakeDesktop desktop;
+    for (bool& broken : desktop.broken) {
+        broken = true;
+    }
+
+    CHECK_EQ(Toggle(selector, desktop, false), StrategySelector::NPOS);
+    CHECK(selector.IsCalibrating());
+    CHECK(!selector.TakeSelectionChanged());
+
+    // Once one works again, calibration carries on
+    desktop.broken[2] = false;
+    CHECK_EQ(Toggle(selector, desktop, false), 2u);
+    CHECK_EQ(Toggle(selector, desktop, true), 2u);
+}
+
+TEST(StrategySelector, ExplicitSelection) {
+    StrategySelector selector(FakeDesktop::COUNT, 2);
+    FakeDesktop desktop;
+
+    selector.Select(2);
+    CHECK(!selector.IsCalibrating());
+    CHECK_EQ(Toggle(selector, desktop, false), 2u);
+    CHECK_EQ(Toggle(selector, desktop, true), 2u);
+    CHECK(!selector.TakeSelectionChanged());
+
+    // Out of range is ignored
+    selector.Select(FakeDesktop::COUNT);
+    CHECK_EQ(selector.GetSelected(), 2u);
+
+    selector.Calibrate();
+    CHECK(selector.IsCalibrating());
+}
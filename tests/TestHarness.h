@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+
+// A minimal test registry: TEST(Group, Name) registers a function, CHECK
+// records a failure and carries on, REQUIRE leaves the test. The runner
+// takes a group name so CTest can list each group as its own test.
+namespace TestHarness {
+    using TestFunction = void (*)();
+
+    struct TestCase {
+        const char* group;
+        const char* name;
+        TestFunction function;
+        TestCase* next;
+    };
+
+    void Register(TestCase* test);
+    void Fail(const char* file, int line, const char* expression);
+
+    struct Registrar {
+        explicit Registrar(TestCase* test) { Register(test); }
+    };
+}
+
+#define TEST(group, name)                                                              \
+    static void group##_##name();                                                      \
+    static TestHarness::TestCase group##_##name##_case = {#group, #name, group##_##name, nullptr}; \
+    static TestHarness::Registrar group##_##name##_registrar(&group##_##name##_case);  \
+    static void group##_##name()
+
+#define CHECK(expression)                                              \
+    do {                                                               \
+        if (!(expression)) {                                           \
+            TestHarness::Fail(__FILE__, __LINE__, #expression);        \
+        }                                                              \
+    } while (0)
+
+#define REQUIRE(expression)                                            \
+    do {                                                               \
+        if (!(expression)) {                                           \
+            TestHarness::Fail(__FILE__, __LINE__, #expression);        \
+            return;                                                    \
+        }                                                              \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) CHECK((actual) == (expected))
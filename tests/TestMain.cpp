@@ -0,0 +1,49 @@
+#include "TestHarness.h"
+
+namespace {
+    TestHarness::TestCase* g_first = nullptr;
+    TestHarness::TestCase** g_last = &g_first;
+    int g_failures = 0;
+}
+
+namespace TestHarness {
+    void Register(TestCase* test) {
+        *g_last = test;
+        g_last = &test->next;
+    }
+
+    void Fail(const char* file, int line, const char* expression) {
+        std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+        g_failures++;
+    }
+}
+
+// Runs every test, or only those of the group named on the command line
+int main(int argc, char* argv[]) {
+    const char* group = argc > 1 ? argv[1] : nullptr;
+
+    int run = 0;
+    int failed = 0;
+    for (TestHarness::TestCase* test = g_first; test; test = test->next) {
+        if (group && std::strcmp(group, test->group) != 0) {
+            continue;
+        }
+
+        int before = g_failures;
+        test->function();
+        run++;
+
+        if (g_failures != before) {
+            std::fprintf(stderr, "FAILED %s.%s\n", test->group, test->name);
+            failed++;
+        }
+    }
+
+    if (run == 0) {
+        std::fprintf(stderr, "No tests in group %s\n", group ? group : "(all)");
+        return 1;
+    }
+
+    std::printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include "TestHarness.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+    std::vector<uint64_t> PopAll(TimerWheel& wheel) {
+        std::vector<uint64_t> cookies;
+        uint64_t cookie;
+        while (wheel.PopExpired(cookie)) {
+            cookies.push_back(cookie);
+        }
+        return cookies;
+    }
+}
+
+TEST(TimerWheel, ExpiresAtDeadline) {
+    TimerWheel wheel;
+    wheel.Insert(1000, 1100, 7);
+    CHECK_EQ(wheel.GetCount(), 1u);
+
+    CHECK_EQ(wheel.Advance(1050), 0u);
+    CHECK(PopAll(wheel).empty());
+
+    CHECK_EQ(wheel.Advance(1100 + TimerWheel::TICK_MS), 1u);
+    std::vector<uint64_t> cookies = PopAll(wheel);
+    REQUIRE(cookies.size() == 1);
+    CHECK_EQ(cookies[0], 7u);
+    CHECK_EQ(wheel.GetCount(), 0u);
+}
+
+TEST(TimerWheel, PastDeadlineExpiresOnNextTick) {
+    TimerWheel wheel;
+    wheel.Insert(5000, 10, 1);
+    CHECK_EQ(wheel.Advance(5000 + TimerWheel::TICK_MS), 1u);
+    CHECK_EQ(PopAll(wheel).size(), 1u);
+}
+
+TEST(TimerWheel, CancelIsHarmlessAfterExpiry) {
+    TimerWheel wheel;
+    TimerWheel::Handle cancelled = wheel.Insert(0, 500, 1);
+    TimerWheel::Handle expired = wheel.Insert(0, 100, 2);
+
+    CHECK(wheel.Cancel(cancelled));
+    CHECK(!wheel.Cancel(cancelled));
+    CHECK(!wheel.IsPending(cancelled));
+
+    wheel.Advance(1000);
+    std::vector<uint64_t> cookies = PopAll(wheel);
+    REQUIRE(cookies.size() == 1);
+    CHECK_EQ(cookies[0], 2u);
+    CHECK(!wheel.Cancel(expired));
+
+    // A reused node must not answer to the old handle
+    TimerWheel::Handle reused = wheel.Insert(1000, 2000, 3);
+    CHECK(!wheel.Cancel(expired));
+    CHECK(wheel.IsPending(reused));
+}
+
+TEST(TimerWheel, ExpiresInDeadlineOrder) {
+    TimerWheel wheel;
+    wheel.Insert(0, 300, 3);
+    wheel.Insert(0, 100, 1);
+    wheel.Insert(0, 200, 2);
+
+    wheel.Advance(1000);
+    std::vector<uint64_t> cookies = PopAll(wheel);
+    REQUIRE(cookies.size() == 3);
+    CHECK_EQ(cookies[0], 1u);
+    CHECK_EQ(cookies[1], 2u);
+    CHECK_EQ(cookies[2], 3u);
+}
+
+TEST(TimerWheel, NextDeadlineSkipsEmptyTime) {
+    TimerWheel wheel;
+    uint64_t deadline = 0;
+    CHECK(!wheel.GetNextDeadline(deadline));
+
+    // Beyond level 0, so the timer cascades on the way
+    uint64_t due = 3ull * 24 * 60 * 60 * 1000;
+    wheel.Insert(0, due, 1);
+    REQUIRE(wheel.GetNextDeadline(deadline));
+    CHECK(deadline <= due + TimerWheel::TICK_MS);
+
+    size_t wakeups = 0;
+    uint64_t now = 0;
+    while (wheel.GetCount() > 0 && wakeups < 100) {
+        REQUIRE(wheel.GetNextDeadline(deadline));
+        now = std::max(now, deadline);
+        wheel.Advance(now);
+        wakeups++;
+    }
+
+    CHECK_EQ(wheel.GetCount(), 0u);
+    CHECK(now >= due);
+    CHECK(wakeups <= TimerWheel::LEVELS + 1);
+    CHECK_EQ(PopAll(wheel).size(), 1u);
+}
+
+// Random inserts, cancels and advances against a plain map of deadlines:
+// nothing expires early, nothing is more than a tick late, and the next
+// deadline is never after the earliest pending one
+TEST(TimerWheel, MatchesReference) {
+    std::mt19937_64 random(42);
+
+    for (int round = 0; round < 10; round++) {
+        TimerWheel wheel;
+        std::map<uint64_t, std::pair<uint64_t, TimerWheel::Handle>> pending; // Cookie -> deadline, handle
+        uint64_t now = random() % (1ull << 40);
+        uint64_t nextCookie = 0;
+
+        for (int step = 0; step < 20000; step++) {
+            int operation = static_cast<int>(random() % 10);
+            if (operation < 5) {
+                uint64_t range = random() % 4 == 0 ? 400ull * 3600 * 1000 : (random() % 2 ? 100000 : 2000);
+                uint64_t deadline = now + random() % range;
+                TimerWheel::Handle handle = wheel.Insert(now, deadline, nextCookie);
+                pending[nextCookie++] = { std::max(deadline, now), handle };
+            } else if (operation < 7 && !pending.empty()) {
+                auto it = pending.begin();
+                std::advance(it, static_cast<long>(random() % pending.size()));
+                CHECK(wheel.Cancel(it->second.second));
+                pending.erase(it);
+            } else {
+                uint64_t next = 0;
+                bool hasNext = wheel.GetNextDeadline(next);
+                REQUIRE(hasNext == !pending.empty());
+
+                uint64_t earliest = UINT64_MAX;
+                for (const auto& entry : pending) {
+                    earliest = std::min(earliest, entry.second.first);
+                }
+                if (hasNext) {
+                    CHECK(next <= earliest + TimerWheel::TICK_MS);
+                }
+
+                now += hasNext && random() % 3 == 0 ? (next > now ? next - now : 0) : random() % 5000;
+                wheel.Advance(now);
+
+                for (uint64_t cookie : PopAll(wheel)) {
+                    auto it = pending.find(cookie);
+                    REQUIRE(it != pending.end());
+                    CHECK(it->second.first <= now);
+                    pending.erase(it);
+                }
+                for (const auto& entry : pending) {
+                    CHECK(entry.second.first + 2 * TimerWheel::TICK_MS > now);
+                }
+            }
+
+            REQUIRE(wheel.GetCount() == pending.size());
+        }
+    }
+}
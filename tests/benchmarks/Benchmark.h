@@ -0,0 +1,50 @@
+#pragma once
+
+#include "TestHarness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Timing helpers for the opt-in benchmarks. A benchmark is a TEST like the
+// unit tests, so it can CHECK that what it timed gave the right answer, and
+// it prints one line per measurement.
+namespace Benchmark {
+    using Clock = std::chrono::steady_clock;
+
+    inline double ElapsedNs(Clock::time_point since) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - since).count();
+    }
+
+    // Average nanoseconds per body(i) over `iterations` calls
+    template<typename Body>
+    double TimePerCallNs(size_t iterations, Body body) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            body(i);
+        }
+        return ElapsedNs(start) / static_cast<double>(iterations);
+    }
+
+    // Value at fraction p (0..1) of the samples; reorders them
+    inline double Percentile(std::vector<double>& samples, double p) {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+        return samples[index];
+    }
+
+    // Keeps the optimizer from dropping work whose result is otherwise unused.
+    // One sink per thread, so threads timed together share no cache line.
+    inline void Consume(size_t value) {
+        static thread_local volatile size_t sink = 0;
+        sink = sink ^ value;
+    }
+
+    inline void Report(const std::string& name, double value, const char* unit) {
+        std::printf("  %-56s %12.2f %s\n", name.c_str(), value, unit);
+    }
+}
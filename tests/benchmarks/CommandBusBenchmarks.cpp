@@ -0,0 +1,115 @@
+#include "Benchmark.h"
+#include "CommandBus.h"
+#include <atomic>
+#include <thread>
+
+// The command bus between producers (hotkey, tray, pipe threads) and the UI
+// thread. The wake-up message goes to a fake window that only counts it, so
+// the consumer here polls the queue instead of waiting for the message.
+
+namespace {
+    struct BusWindow : Win32Compat::FakeWindow {
+        LRESULT OnMessage(UINT, WPARAM, LPARAM) override { return 0; }
+    };
+
+    uint64_t NowNs() {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return static_cast<uint64_t>(now.QuadPart);
+    }
+}
+
+TEST(CommandBus, PostAndTake) {
+    BusWindow window;
+    CommandBus bus;
+    REQUIRE(bus.Initialize(window.Handle()));
+
+    // The UI thread posting to itself, as the menu and hotkey paths do
+    const size_t ITERATIONS = 5000000;
+    size_t taken = 0;
+    double ns = Benchmark::TimePerCallNs(ITERATIONS, [&](size_t i) {
+        bus.Post(CommandType::ToggleIcons, CommandSource::Hotkey, static_cast<uint32_t>(i));
+        bus.BeginDrain();
+        Command command;
+        while (bus.TryTake(command)) {
+            taken++;
+        }
+    });
+
+    CHECK_EQ(taken, ITERATIONS);
+    CHECK_EQ(bus.GetDroppedCount(), 0u);
+    Benchmark::Report("post + drain, one thread", ns, "ns");
+}
+
+TEST(CommandBus, ProducerScaling) {
+    const size_t COMMANDS_PER_PRODUCER = 500000;
+    const size_t PRODUCER_COUNTS[] = { 1, 2, 4, 8 };
+
+    for (size_t producerCount : PRODUCER_COUNTS) {
+        BusWindow window;
+        CommandBus bus;
+        REQUIRE(bus.Initialize(window.Handle()));
+
+        // Producers retry when the queue is full; every command carries the
+        // time it was first offered
+        std::atomic<bool> go(false);
+        std::atomic<size_t> retries(0);
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < producerCount; p++) {
+            producers.emplace_back([&]() {
+                while (!go.load()) {}
+                for (size_t i = 0; i < COMMANDS_PER_PRODUCER; i++) {
+                    Command command;
+                    command.type = CommandType::ToggleIcons;
+                    command.source = CommandSource::Ipc;
+                    command.cookie = NowNs();
+                    while (!bus.Post(command)) {
+                        retries.fetch_add(1, std::memory_order_relaxed);
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        // One latency sample in 64 keeps the consumer close to its real cost
+        const size_t total = producerCount * COMMANDS_PER_PRODUCER;
+        std::vector<double> latencies;
+        latencies.reserve(total / 64 + 1);
+        size_t taken = 0;
+
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        go.store(true);
+        while (taken < total) {
+            bus.BeginDrain();
+            Command command;
+            bool any = false;
+            while (bus.TryTake(command)) {
+                if (taken++ % 64 == 0) {
+                    latencies.push_back(static_cast<double>(NowNs() - command.cookie));
+                }
+                any = true;
+            }
+            if (!any) {
+                std::this_thread::yield();
+            }
+        }
+        double elapsedNs = Benchmark::ElapsedNs(start);
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+
+        CHECK_EQ(taken, total);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu producers, throughput", producerCount);
+        Benchmark::Report(label, static_cast<double>(total) * 1000.0 / elapsedNs, "M/s");
+        std::snprintf(label, sizeof(label), "%zu producers, post to take p50", producerCount);
+        Benchmark::Report(label, Benchmark::Percentile(latencies, 0.50) / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "%zu producers, post to take p99", producerCount);
+        Benchmark::Report(label, Benchmark::Percentile(latencies, 0.99) / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "%zu producers, wake-ups per 1000 commands", producerCount);
+        Benchmark::Report(label, static_cast<double>(window.posted.load()) * 1000.0 / static_cast<double>(total), "");
+        std::snprintf(label, sizeof(label), "%zu producers, full-queue retries per 1000 commands", producerCount);
+        Benchmark::Report(label, static_cast<double>(retries.load()) * 1000.0 / static_cast<double>(total), "");
+    }
+}
@@ -0,0 +1,102 @@
+#include "Benchmark.h"
+#include "ConfigManager.h"
+#include <atomic>
+#include <thread>
+
+// Read-heavy settings access from several threads, with and without a
+// writer publishing new versions. The single shared reader counter that
+// GetSnapshot() used before is timed alongside for comparison.
+
+namespace {
+    const size_t READS_PER_THREAD = 2000000;
+    const size_t THREAD_COUNTS[] = { 1, 2, 4, 8 };
+
+    // Runs body on threadCount threads at once; millions of reads per second
+    // over all of them. Flat as threads are added means they contend.
+    template<typename Body>
+    double ReadsPerSecond(size_t threadCount, Body body) {
+        std::atomic<size_t> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([&]() {
+                ready.fetch_add(1);
+                while (!go.load()) {}
+                for (size_t i = 0; i < READS_PER_THREAD; i++) {
+                    body(i);
+                }
+            });
+        }
+        while (ready.load() != threadCount) {}
+
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        go.store(true);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        return static_cast<double>(threadCount * READS_PER_THREAD) * 1000.0 / Benchmark::ElapsedNs(start);
+    }
+}
+
+TEST(Config, ReadScaling) {
+    ConfigManager config;
+    size_t base = config.GetMemoryUsage();
+
+    for (bool writing : { false, true }) {
+        // About a thousand versions a second, far more than any user makes
+        std::atomic<bool> stop(false);
+        std::atomic<size_t> versions(0);
+        std::thread writer;
+        if (writing) {
+            writer = std::thread([&]() {
+                while (!stop.load()) {
+                    config.SetIdleHideMinutes(static_cast<int>(versions.fetch_add(1) % 60));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+        }
+
+        for (size_t threadCount : THREAD_COUNTS) {
+            double rate = ReadsPerSecond(threadCount, [&config](size_t) {
+                ConfigSnapshotRef snapshot = config.GetSnapshot();
+                Benchmark::Consume(static_cast<size_t>(snapshot->idleHideMinutes));
+            });
+
+            char label[96];
+            std::snprintf(label, sizeof(label), "GetSnapshot, %zu threads%s", threadCount, writing ? ", writer" : "");
+            Benchmark::Report(label, rate, "M/s");
+        }
+
+        stop.store(true);
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (writing) {
+            Benchmark::Report("versions published meanwhile", static_cast<double>(versions.load()), "");
+        }
+
+        // Nothing left retired once the readers are gone
+        CHECK_EQ(config.GetMemoryUsage(), base);
+    }
+}
+
+TEST(Config, SharedCounterForComparison) {
+    // What every GetSnapshot() and release did before: one counter for all
+    // readers, so every read writes the same cache line
+    std::atomic<uint32_t> activeReaders(0);
+    std::atomic<const int*> current(nullptr);
+    int value = 7;
+    current.store(&value);
+
+    for (size_t threadCount : THREAD_COUNTS) {
+        double rate = ReadsPerSecond(threadCount, [&](size_t) {
+            activeReaders.fetch_add(1);
+            Benchmark::Consume(static_cast<size_t>(*current.load()));
+            activeReaders.fetch_sub(1);
+        });
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "shared counter, %zu threads", threadCount);
+        Benchmark::Report(label, rate, "M/s");
+    }
+}
@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+#include "ContextRules.h"
+#include <cwchar>
+#include <random>
+#include <string>
+
+// Context rule evaluation with 16 to 4096 process rules, over a stream of
+// foreground changes where most processes are not listed, and what
+// compiling the rules and hashing a process path cost.
+
+namespace {
+    const size_t RULE_COUNTS[] = { 16, 256, 4096 };
+    const size_t EVENTS = 10000000;
+    const size_t FOREGROUND_POOL = 1024; // Distinct contexts cycled through
+
+    std::wstring ProcessName(size_t i) {
+        wchar_t name[64];
+        std::swprintf(name, 64, L"App%zu.exe", i);
+        return name;
+    }
+
+    uint64_t Hash(const std::wstring& name) {
+        return ContextRules::HashProcessName(name.c_str(), name.size());
+    }
+}
+
+TEST(Context, EvaluationScaling) {
+    for (size_t ruleCount : RULE_COUNTS) {
+        // One in eight rules exempts a process instead of hiding for it
+        std::vector<std::wstring> hide, ignore;
+        for (size_t i = 0; i < ruleCount; i++) {
+            (i % 8 == 0 ? ignore : hide).push_back(ProcessName(i));
+        }
+
+        ContextRules rules;
+        double compileNs = 0.0;
+        for (int run = 0; run < 5; run++) {
+            Benchmark::Clock::time_point start = Benchmark::Clock::now();
+            rules.Compile(hide, ignore, true, true);
+            double ns = Benchmark::ElapsedNs(start);
+            compileNs = (run == 0 || ns < compileNs) ? ns : compileNs;
+        }
+        CHECK_EQ(rules.GetRuleCount(), ruleCount);
+
+        // A quarter of the foreground processes are listed, and now and
+        // then one is fullscreen
+        std::mt19937 random(47);
+        std::vector<ContextRules::Context> contexts(FOREGROUND_POOL);
+        std::vector<bool> wanted(FOREGROUND_POOL);
+        for (size_t i = 0; i < FOREGROUND_POOL; i++) {
+            bool listed = random() % 4 == 0;
+            size_t process = listed ? random() % ruleCount : ruleCount + random() % 100000;
+            contexts[i] = { Hash(ProcessName(process)), random() % 16 == 0, false };
+            wanted[i] = !(listed && process % 8 == 0) && (listed || contexts[i].fullscreen);
+        }
+
+        size_t hides = 0;
+        double ns = Benchmark::TimePerCallNs(EVENTS, [&](size_t i) {
+            hides += rules.ShouldHide(contexts[i % FOREGROUND_POOL]) ? 1 : 0;
+        });
+
+        size_t expected = 0;
+        for (size_t i = 0; i < EVENTS; i++) {
+            expected += wanted[i % FOREGROUND_POOL] ? 1 : 0;
+        }
+        CHECK_EQ(hides, expected);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "evaluate, %zu rules", ruleCount);
+        Benchmark::Report(label, ns, "ns");
+        std::snprintf(label, sizeof(label), "compile, %zu rules", ruleCount);
+        Benchmark::Report(label, compileNs / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "table memory, %zu rules", ruleCount);
+        Benchmark::Report(label, static_cast<double>(rules.GetMemoryUsage()) / 1024.0, "KB");
+    }
+}
+
+TEST(Context, HashProcessPath) {
+    // Done once per foreground process, not per evaluation
+    const std::wstring path = L"C:\\Program Files\\Microsoft Office\\root\\Office16\\POWERPNT.EXE";
+    uint64_t hash = 0;
+    double ns = Benchmark::TimePerCallNs(1000000, [&](size_t) {
+        hash ^= ContextRules::HashProcessName(path.c_str(), path.size());
+    });
+    Benchmark::Consume(static_cast<size_t>(hash));
+    Benchmark::Report("hash a full process path", ns, "ns");
+}
@@ -0,0 +1,208 @@
+#include "Benchmark.h"
+#include "IconHitGrid.h"
+#include "RemoteListView.h"
+#include "DesktopClickWatcher.h"
+#include "CommandBus.h"
+#include <random>
+
+// Double-click handling from both ends: hit tests in the icon grid on a
+// desktop of four 4K monitors, checked against and timed next to a linear
+// scan over every icon; relinking the grid after a few icons moved; and the
+// mouse hook's work per button press, up to the push onto the command bus.
+
+namespace {
+    using Win32Compat::FakeListView;
+
+    const RECT DESKTOP = { 0, 0, 15360, 2160 };
+    const SIZE SPACING = { 75, 100 };
+    const size_t COUNTS[] = { 100, 1000, 10000 };
+    const size_t POINTS = 200000;
+
+    std::vector<POINT> Scatter(size_t count, std::mt19937& random) {
+        std::vector<POINT> positions(count);
+        for (POINT& position : positions) {
+            position = { static_cast<LONG>(random() % (DESKTOP.right - SPACING.cx)),
+                         static_cast<LONG>(random() % (DESKTOP.bottom - SPACING.cy)) };
+        }
+        return positions;
+    }
+
+    bool Covers(const POINT& position, const POINT& point) {
+        return point.x >= position.x && point.x < position.x + SPACING.cx &&
+               point.y >= position.y && point.y < position.y + SPACING.cy;
+    }
+
+    // What the grid replaces
+    size_t LinearHitTest(const std::vector<POINT>& positions, const POINT& point) {
+        for (size_t i = 0; i < positions.size(); i++) {
+            if (Covers(positions[i], point)) {
+                return i;
+            }
+        }
+        return IconHitGrid::NPOS;
+    }
+
+    struct BusWindow : Win32Compat::FakeWindow {
+        LRESULT OnMessage(UINT, WPARAM, LPARAM) override { return 0; }
+    };
+}
+
+TEST(HitGrid, HitTestScaling) {
+    for (size_t count : COUNTS) {
+        std::mt19937 random(50);
+        std::vector<POINT> positions = Scatter(count, random);
+
+        IconHitGrid grid;
+        grid.Reset(DESKTOP, SPACING, count);
+        for (size_t i = 0; i < count; i++) {
+            grid.SetPosition(i, positions[i]);
+        }
+
+        std::vector<POINT> points(POINTS);
+        for (POINT& point : points) {
+            point = { static_cast<LONG>(random() % DESKTOP.right), static_cast<LONG>(random() % DESKTOP.bottom) };
+        }
+
+        // Overlapping icons may answer with different ones; either must
+        // cover the point
+        size_t mismatches = 0;
+        size_t hits = 0;
+        for (const POINT& point : points) {
+            size_t expected = LinearHitTest(positions, point);
+            size_t found = grid.HitTest(point);
+            bool agree = (found == IconHitGrid::NPOS) == (expected == IconHitGrid::NPOS) &&
+                         (found == IconHitGrid::NPOS || Covers(positions[found], point));
+            mismatches += agree ? 0 : 1;
+            hits += found != IconHitGrid::NPOS ? 1 : 0;
+        }
+        CHECK_EQ(mismatches, 0u);
+
+        double gridNs = Benchmark::TimePerCallNs(POINTS, [&](size_t i) {
+            Benchmark::Consume(grid.HitTest(points[i]));
+        });
+        size_t scanPoints = POINTS / 20;
+        double scanNs = Benchmark::TimePerCallNs(scanPoints, [&](size_t i) {
+            Benchmark::Consume(LinearHitTest(positions, points[i]));
+        });
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu icons, grid hit test", count);
+        Benchmark::Report(label, gridNs, "ns");
+        std::snprintf(label, sizeof(label), "%zu icons, linear scan", count);
+        Benchmark::Report(label, scanNs / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "%zu icons, points on an icon", count);
+        Benchmark::Report(label, 100.0 * static_cast<double>(hits) / static_cast<double>(POINTS), "%");
+    }
+}
+
+TEST(HitGrid, RelinkAfterMoves) {
+    for (size_t count : COUNTS) {
+        std::mt19937 random(51);
+        FakeListView listView;
+        listView.client = DESKTOP;
+        std::vector<POINT> positions = Scatter(count, random);
+        for (size_t i = 0; i < count; i++) {
+            listView.Add(L"Item", positions[i]);
+        }
+
+        IconHitGrid grid;
+        REQUIRE(grid.Prepare(listView.Handle()));
+
+        // 1% of the icons dragged somewhere else, then the grid brought up
+        // to date: first the relinking alone, then with reading the
+        // positions back from the listview as the next hit test does
+        const size_t ROUNDS = 20;
+        std::vector<double> relinks, refreshes;
+        bool refreshed = true;
+        for (size_t round = 0; round < ROUNDS; round++) {
+            std::vector<POINT> moved = Scatter(count, random);
+            for (size_t i = round % 100; i < count; i += 100) {
+                positions[i] = moved[i];
+            }
+
+            Benchmark::Clock::time_point start = Benchmark::Clock::now();
+            for (size_t i = 0; i < count; i++) {
+                grid.SetPosition(i, positions[i]);
+            }
+            relinks.push_back(Benchmark::ElapsedNs(start));
+
+            for (size_t i = round % 100; i < count; i += 100) {
+                listView.positions[i] = Scatter(1, random)[0];
+                positions[i] = listView.positions[i];
+            }
+            grid.Invalidate();
+            start = Benchmark::Clock::now();
+            refreshed = refreshed && grid.Prepare(listView.Handle());
+            refreshes.push_back(Benchmark::ElapsedNs(start));
+        }
+        CHECK(refreshed);
+
+        size_t wrong = 0;
+        for (size_t i = 0; i < count; i++) {
+            POINT inside = { positions[i].x + 1, positions[i].y + 1 };
+            size_t found = grid.HitTest(inside);
+            wrong += found != IconHitGrid::NPOS && Covers(positions[found], inside) ? 0 : 1;
+        }
+        CHECK_EQ(wrong, 0u);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu icons, 1%% moved, relink", count);
+        Benchmark::Report(label, Benchmark::Percentile(relinks, 0.50) / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "%zu icons, 1%% moved, read back and relink", count);
+        Benchmark::Report(label, Benchmark::Percentile(refreshes, 0.50) / 1000.0, "us");
+    }
+}
+
+TEST(HitGrid, HookPathPerPress) {
+    BusWindow window;
+    CommandBus bus;
+    REQUIRE(bus.Initialize(window.Handle()));
+    DesktopClickWatcher watcher;
+    REQUIRE(watcher.Initialize(&bus));
+
+    // Batches stay below the bus capacity and are drained between timings
+    const size_t BATCH = 128;
+    const size_t BATCHES = 4000;
+    MSLLHOOKSTRUCT event = {};
+    DWORD time = 0;
+    size_t taken = 0;
+    double singleNs = 0.0, pairNs = 0.0;
+
+    for (size_t batch = 0; batch < BATCHES; batch++) {
+        // Presses far apart never pair
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        for (size_t i = 0; i < BATCH; i++) {
+            event.pt = { static_cast<LONG>((i & 1) * 1000), 500 };
+            event.time = time += 1000;
+            Win32Compat::SendMouseInput(WM_LBUTTONDOWN, event);
+        }
+        singleNs += Benchmark::ElapsedNs(start);
+
+        // Two presses on the same spot; the second one posts the pair
+        start = Benchmark::Clock::now();
+        for (size_t i = 0; i < BATCH; i++) {
+            event.pt = { 300, 300 };
+            event.time = time += 1000;
+            Win32Compat::SendMouseInput(WM_LBUTTONDOWN, event);
+            event.time = time += 100;
+            Win32Compat::SendMouseInput(WM_LBUTTONDOWN, event);
+        }
+        pairNs += Benchmark::ElapsedNs(start);
+
+        bus.BeginDrain();
+        Command command;
+        while (bus.TryTake(command)) {
+            taken += command.type == CommandType::DesktopDoubleClick ? 1 : 0;
+        }
+    }
+
+    watcher.Cleanup();
+    bus.Cleanup();
+    CHECK_EQ(taken, BATCH * BATCHES);
+    CHECK_EQ(bus.GetDroppedCount(), 0u);
+
+    double perSingle = singleNs / static_cast<double>(BATCH * BATCHES);
+    double perPair = pairNs / static_cast<double>(BATCH * BATCHES);
+    Benchmark::Report("hook, press without a pair", perSingle, "ns");
+    Benchmark::Report("hook, press completing a pair (with the bus push)", perPair - perSingle, "ns");
+}
@@ -0,0 +1,103 @@
+#include "Benchmark.h"
+#include "IdleDetector.h"
+
+// Idle detection against a virtual clock: a working day of input every
+// second, a break, then more work, started just before the GetTickCount()
+// wrap. Counts the deadline wakeups the detector needs next to polling the
+// last-input time every second.
+
+namespace {
+    constexpr DWORD SECOND_MS = 1000;
+    constexpr DWORD MINUTE_MS = 60 * SECOND_MS;
+    constexpr DWORD WORK_MS = 8 * 60 * MINUTE_MS;
+    constexpr DWORD BREAK_MS = 40 * MINUTE_MS;
+    constexpr DWORD WRAP_START = 0xFFFF0000u;
+
+    // The application's side: the one armed deadline, and input delivered
+    // every second while active
+    struct Session {
+        IdleDetector idle;
+        DWORD now;
+        DWORD lastInput;
+        DWORD deadline;
+        uint32_t hides = 0;
+        uint32_t resumes = 0;
+
+        Session(DWORD timeout, DWORD start)
+            : now(start)
+            , lastInput(start) {
+            idle.SetTimeout(timeout);
+            deadline = now + idle.Arm(now, lastInput);
+        }
+
+        void Run(DWORD duration, bool active) {
+            for (DWORD elapsed = 0; elapsed < duration; elapsed += SECOND_MS) {
+                now += SECOND_MS;
+                if (active) {
+                    lastInput = now;
+                    if (idle.OnInput()) {
+                        resumes++;
+                        deadline = now + idle.Arm(now, lastInput);
+                    }
+                }
+
+                if (!idle.IsIdle() && static_cast<LONG>(now - deadline) >= 0) {
+                    DWORD next;
+                    if (idle.OnDeadline(now, lastInput, next)) {
+                        hides++;
+                    } else {
+                        deadline = now + next;
+                    }
+                }
+            }
+        }
+    };
+}
+
+TEST(Idle, WorkingDayWakeups) {
+    const DWORD TIMEOUTS_MIN[] = { 1, 5, 15, 30 };
+
+    for (DWORD timeoutMin : TIMEOUTS_MIN) {
+        Session session(timeoutMin * MINUTE_MS, WRAP_START);
+
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        session.Run(WORK_MS, true);
+        uint32_t firstDay = session.idle.GetWakeups();
+        session.Run(BREAK_MS, false);
+        uint32_t afterBreak = session.idle.GetWakeups();
+        session.Run(WORK_MS, true);
+        double simulatedNs = Benchmark::ElapsedNs(start);
+
+        // Went idle once during the break and resumed on the first input
+        CHECK_EQ(session.hides, 1u);
+        CHECK_EQ(session.resumes, 1u);
+        CHECK(!session.idle.IsIdle());
+        CHECK(session.now < WRAP_START);
+        CHECK(firstDay <= WORK_MS / (timeoutMin * MINUTE_MS) + 1);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%u min timeout, wakeups in the first 8 h", timeoutMin);
+        Benchmark::Report(label, static_cast<double>(firstDay), "");
+        std::snprintf(label, sizeof(label), "%u min timeout, wakeups in the break", timeoutMin);
+        Benchmark::Report(label, static_cast<double>(afterBreak - firstDay), "");
+        std::snprintf(label, sizeof(label), "%u min timeout, wakeups in the second 8 h", timeoutMin);
+        Benchmark::Report(label, static_cast<double>(session.idle.GetWakeups() - afterBreak), "");
+        std::snprintf(label, sizeof(label), "%u min timeout, simulating 16 h 40 min", timeoutMin);
+        Benchmark::Report(label, simulatedNs / 1e6, "ms");
+    }
+
+    Benchmark::Report("polling every second, wakeups per 8 h", static_cast<double>(WORK_MS / SECOND_MS), "");
+}
+
+TEST(Idle, DeadlineCost) {
+    // A deadline that finds input meanwhile and moves on
+    IdleDetector idle;
+    idle.SetTimeout(5 * MINUTE_MS);
+    DWORD next = 0;
+    double ns = Benchmark::TimePerCallNs(10000000, [&](size_t i) {
+        DWORD now = static_cast<DWORD>(i) * SECOND_MS;
+        Benchmark::Consume(idle.OnDeadline(now, now - SECOND_MS, next) ? 1 : 0);
+    });
+    Benchmark::Consume(next);
+    Benchmark::Report("deadline with input meanwhile", ns, "ns");
+}
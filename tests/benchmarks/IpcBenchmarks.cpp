@@ -0,0 +1,136 @@
+#include "Benchmark.h"
+#include "IpcServer.h"
+#include "IpcClient.h"
+#include "CommandBus.h"
+#include <atomic>
+#include <thread>
+
+// Round trips through the real control pipe with many clients at once, so
+// Windows only; close a running instance first, the pipe name is shared.
+// Queries are answered by the pipe thread; commands also travel through the
+// command bus to this thread, which completes them as DispatchCommand does.
+
+namespace {
+    const size_t CLIENT_COUNTS[] = { 1, 8, 32, 60 };
+    const size_t REQUESTS_PER_CLIENT = 2000;
+
+    struct ClientStats {
+        std::vector<double> roundTrips; // ns
+        size_t busy = 0;
+        size_t failed = 0;
+    };
+
+    double NowNs() {
+        LARGE_INTEGER frequency, now;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&now);
+        return static_cast<double>(now.QuadPart) * 1e9 / static_cast<double>(frequency.QuadPart);
+    }
+
+    void RunClient(Ipc::Opcode op, ClientStats& stats) {
+        IpcClient ipc;
+        if (!ipc.Connect(FORWARD_CONNECT_TIMEOUT_MS)) {
+            stats.failed = REQUESTS_PER_CLIENT;
+            return;
+        }
+
+        stats.roundTrips.reserve(REQUESTS_PER_CLIENT);
+        for (size_t i = 0; i < REQUESTS_PER_CLIENT; i++) {
+            Ipc::Status status = Ipc::Status::BadRequest;
+            Ipc::WireState state = Ipc::WireState::Unknown;
+            double start = NowNs();
+            if (!ipc.Transact(&op, 1, FORWARD_RESPONSE_TIMEOUT_MS, status, state)) {
+                stats.failed += REQUESTS_PER_CLIENT - i;
+                break;
+            }
+            stats.roundTrips.push_back(NowNs() - start);
+            stats.busy += (status == Ipc::Status::Busy) ? 1 : 0;
+        }
+        ipc.Close();
+    }
+
+    // Stands in for the application's message loop until every client is done
+    void Pump(CommandBus& bus, IpcServer& server, const std::atomic<size_t>& running) {
+        while (running.load() != 0) {
+            MSG msg;
+            while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+                if (msg.message != WM_COMMAND_BUS) {
+                    continue;
+                }
+
+                bus.BeginDrain();
+                Command command;
+                while (bus.TryTake(command)) {
+                    if (command.source == CommandSource::Ipc && command.cookie != 0) {
+                        server.CompleteRequest(command.cookie, IconState::Hidden);
+                    }
+                }
+            }
+            MsgWaitForMultipleObjectsEx(0, nullptr, 1, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        }
+    }
+
+    void MeasureRoundTrips(Ipc::Opcode op, const char* name) {
+        HWND window = CreateWindowEx(0, L"STATIC", L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, nullptr, nullptr);
+        REQUIRE(window != nullptr);
+
+        CommandBus bus;
+        IpcServer server;
+        bool started = bus.Initialize(window) && server.Initialize(&bus);
+        if (!started) {
+            DestroyWindow(window);
+        }
+        REQUIRE(started);
+
+        for (size_t clientCount : CLIENT_COUNTS) {
+            std::vector<ClientStats> stats(clientCount);
+            std::atomic<size_t> running(clientCount);
+            std::vector<std::thread> clients;
+
+            double start = NowNs();
+            for (size_t c = 0; c < clientCount; c++) {
+                clients.emplace_back([op, &stats, &running, c]() {
+                    RunClient(op, stats[c]);
+                    running.fetch_sub(1);
+                });
+            }
+            Pump(bus, server, running);
+            for (std::thread& client : clients) {
+                client.join();
+            }
+            double elapsedNs = NowNs() - start;
+
+            std::vector<double> roundTrips;
+            size_t busy = 0;
+            size_t failed = 0;
+            for (const ClientStats& client : stats) {
+                roundTrips.insert(roundTrips.end(), client.roundTrips.begin(), client.roundTrips.end());
+                busy += client.busy;
+                failed += client.failed;
+            }
+            CHECK_EQ(failed, 0u);
+
+            char label[96];
+            std::snprintf(label, sizeof(label), "%s, %zu clients, requests", name, clientCount);
+            Benchmark::Report(label, static_cast<double>(roundTrips.size()) * 1e9 / elapsedNs, "/s");
+            std::snprintf(label, sizeof(label), "%s, %zu clients, round trip p50", name, clientCount);
+            Benchmark::Report(label, Benchmark::Percentile(roundTrips, 0.50) / 1000.0, "us");
+            std::snprintf(label, sizeof(label), "%s, %zu clients, round trip p99", name, clientCount);
+            Benchmark::Report(label, Benchmark::Percentile(roundTrips, 0.99) / 1000.0, "us");
+            std::snprintf(label, sizeof(label), "%s, %zu clients, busy answers", name, clientCount);
+            Benchmark::Report(label, static_cast<double>(busy), "");
+        }
+
+        server.Cleanup();
+        bus.Cleanup();
+        DestroyWindow(window);
+    }
+}
+
+TEST(Ipc, QueryRoundTrips) {
+    MeasureRoundTrips(Ipc::Opcode::QueryState, "query");
+}
+
+TEST(Ipc, CommandRoundTrips) {
+    MeasureRoundTrips(Ipc::Opcode::Hide, "hide");
+}
@@ -0,0 +1,115 @@
+#include "Benchmark.h"
+#include "IconLayout.h"
+#include <cwchar>
+#include <string>
+
+// Capturing and restoring icon layouts of 100 to 10,000 icons through the
+// fake listview, plus the in-memory encoding used by the layout store and
+// history. Explorer's side of each message is not included.
+
+namespace {
+    using Win32Compat::FakeListView;
+
+    const size_t COUNTS[] = { 100, 1000, 10000 };
+
+    void Fill(FakeListView& listView, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            wchar_t name[64];
+            std::swprintf(name, 64, L"Desktop item %zu.lnk", i);
+            listView.Add(name, { static_cast<LONG>(i % 100) * 75, static_cast<LONG>(i / 100) * 100 });
+        }
+    }
+
+    // Runs body a few times and keeps the fastest; the first run also pays
+    // for the vectors growing
+    template<typename Body>
+    double BestOfNs(size_t runs, Body body) {
+        double best = 0.0;
+        for (size_t run = 0; run < runs; run++) {
+            Benchmark::Clock::time_point start = Benchmark::Clock::now();
+            body();
+            double ns = Benchmark::ElapsedNs(start);
+            best = (run == 0 || ns < best) ? ns : best;
+        }
+        return best;
+    }
+}
+
+TEST(Layout, CaptureRestoreScaling) {
+    for (size_t count : COUNTS) {
+        FakeListView listView;
+        Fill(listView, count);
+        std::vector<POINT> original = listView.positions;
+
+        IconLayout layout;
+        bool captured = true;
+        double captureNs = BestOfNs(5, [&]() { captured = captured && layout.Capture(listView.Handle()); });
+        REQUIRE(captured);
+        CHECK_EQ(layout.GetCount(), count);
+
+        // Every icon moved, then only a handful, as after a resolution change
+        // and after the user dragged a few
+        bool applied = true;
+        size_t moved = 0;
+        double restoreAllNs = BestOfNs(5, [&]() {
+            for (POINT& position : listView.positions) {
+                position = { -32000, -32000 };
+            }
+            applied = applied && layout.Apply(listView.Handle(), &moved);
+        });
+        CHECK(applied);
+        CHECK_EQ(moved, count);
+
+        double restoreFewNs = BestOfNs(5, [&]() {
+            for (size_t i = 0; i < count; i += 100) {
+                listView.positions[i] = { -32000, -32000 };
+            }
+            applied = applied && layout.Apply(listView.Handle(), &moved);
+        });
+        CHECK(applied);
+        CHECK_EQ(moved, (count + 99) / 100);
+
+        bool back = true;
+        for (size_t i = 0; i < count; i++) {
+            back = back && listView.positions[i].x == original[i].x && listView.positions[i].y == original[i].y;
+        }
+        CHECK(back);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "capture, %zu icons", count);
+        Benchmark::Report(label, captureNs / 1e6, "ms");
+        std::snprintf(label, sizeof(label), "restore, %zu icons, all moved", count);
+        Benchmark::Report(label, restoreAllNs / 1e6, "ms");
+        std::snprintf(label, sizeof(label), "restore, %zu icons, 1%% moved", count);
+        Benchmark::Report(label, restoreFewNs / 1e6, "ms");
+        std::snprintf(label, sizeof(label), "capture + full restore per icon, %zu icons", count);
+        Benchmark::Report(label, (captureNs + restoreAllNs) / static_cast<double>(count), "ns");
+    }
+}
+
+TEST(Layout, EncodingScaling) {
+    for (size_t count : COUNTS) {
+        FakeListView listView;
+        Fill(listView, count);
+        IconLayout layout;
+        REQUIRE(layout.Capture(listView.Handle()));
+
+        std::vector<uint8_t> buffer;
+        double serializeNs = BestOfNs(5, [&]() {
+            buffer.clear();
+            layout.Serialize(buffer);
+        });
+
+        IconLayout decoded;
+        bool ok = true;
+        double deserializeNs = BestOfNs(5, [&]() { ok = ok && decoded.Deserialize(buffer.data(), buffer.size()); });
+        CHECK(ok);
+        CHECK(decoded.Equals(layout));
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "serialize, %zu icons (%zu bytes)", count, buffer.size());
+        Benchmark::Report(label, serializeNs / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "deserialize, %zu icons", count);
+        Benchmark::Report(label, deserializeNs / 1000.0, "us");
+    }
+}
@@ -0,0 +1,95 @@
+#include "Benchmark.h"
+#include "Metrics.h"
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// What updating a metric costs from the hot paths, alone and with several
+// threads updating at once, and what the exporter's snapshot costs. The
+// metrics are the application's own globals; nothing else touches them here.
+
+namespace {
+    const size_t THREAD_COUNTS[] = { 1, 2, 4, 8 };
+    const size_t UPDATES_PER_THREAD = 2000000;
+
+    // One metric per thread, each on its own cache line
+    Counter* const OWN_COUNTERS[] = {
+        &Metrics::IdleWakeups, &Metrics::TimerWakeups, &Metrics::MainLoopWakeups, &Metrics::TrayUpdates,
+        &Metrics::CommandsDispatched, &Metrics::IpcRequests, &Metrics::ConfigLoads, &Metrics::DoubleClickToggles
+    };
+
+    // Aggregate updates per second over every thread, in millions
+    template<typename Update>
+    double UpdatesPerSecond(size_t threadCount, Update update) {
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([t, &update]() {
+                for (size_t i = 0; i < UPDATES_PER_THREAD; i++) {
+                    update(t, i);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        return static_cast<double>(threadCount * UPDATES_PER_THREAD) * 1e3 / Benchmark::ElapsedNs(start);
+    }
+}
+
+TEST(Metrics, UpdateCost) {
+    const size_t UPDATES = 10000000;
+    double baseline = Benchmark::TimePerCallNs(UPDATES, [](size_t i) { Benchmark::Consume(i); });
+    double increment = Benchmark::TimePerCallNs(UPDATES, [](size_t i) {
+        Metrics::TogglesTotal.Increment();
+        Benchmark::Consume(i);
+    });
+    double set = Benchmark::TimePerCallNs(UPDATES, [](size_t i) {
+        Metrics::TimersPending.Set(static_cast<int64_t>(i & 0xFF));
+        Benchmark::Consume(i);
+    });
+    double observe = Benchmark::TimePerCallNs(UPDATES, [](size_t i) {
+        Metrics::ToggleDuration.Observe(i % 2000000);
+        Benchmark::Consume(i);
+    });
+
+    Benchmark::Report("loop without an update", baseline, "ns");
+    Benchmark::Report("counter increment", increment - baseline, "ns");
+    Benchmark::Report("gauge set", set - baseline, "ns");
+    Benchmark::Report("histogram observe", observe - baseline, "ns");
+}
+
+TEST(Metrics, Contention) {
+    for (size_t threadCount : THREAD_COUNTS) {
+        double shared = UpdatesPerSecond(threadCount, [](size_t, size_t) { Metrics::TogglesTotal.Increment(); });
+        double own = UpdatesPerSecond(threadCount, [](size_t t, size_t) { OWN_COUNTERS[t]->Increment(); });
+        double histogram = UpdatesPerSecond(threadCount, [](size_t, size_t i) { Metrics::ClickHookDuration.Observe(i % 500); });
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu threads, one shared counter", threadCount);
+        Benchmark::Report(label, shared, "M/s");
+        std::snprintf(label, sizeof(label), "%zu threads, a counter each", threadCount);
+        Benchmark::Report(label, own, "M/s");
+        std::snprintf(label, sizeof(label), "%zu threads, one shared histogram", threadCount);
+        Benchmark::Report(label, histogram, "M/s");
+    }
+}
+
+TEST(Metrics, SnapshotCost) {
+    const wchar_t* const PATH = L"metrics-benchmark.prom";
+    const size_t SNAPSHOTS = 200;
+
+    std::vector<double> samples;
+    bool written = true;
+    for (size_t i = 0; i < SNAPSHOTS; i++) {
+        Metrics::TogglesTotal.Increment();
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        written = written && MetricsExporter::WriteSnapshot(PATH);
+        samples.push_back(Benchmark::ElapsedNs(start));
+    }
+    CHECK(written);
+    std::remove("metrics-benchmark.prom");
+
+    Benchmark::Report("snapshot written p50", Benchmark::Percentile(samples, 0.50) / 1000.0, "us");
+    Benchmark::Report("snapshot written p99", Benchmark::Percentile(samples, 0.99) / 1000.0, "us");
+}
@@ -0,0 +1,85 @@
+#include "Benchmark.h"
+#include "MonitorHider.h"
+#include <cwchar>
+#include <string>
+
+// Per-monitor hiding on a simulated desktop of four 4K monitors side by
+// side, through the fake listview. The first hide after a change reads the
+// whole desktop into the monitor index; later ones use the cached index.
+
+namespace {
+    using Win32Compat::FakeListView;
+
+    const size_t COUNTS[] = { 400, 4000, 10000 };
+
+    void SetUpMonitors() {
+        std::vector<RECT>& monitors = Win32Compat::FakeMonitors();
+        monitors.clear();
+        for (LONG i = 0; i < 4; i++) {
+            monitors.push_back({ i * 3840, 0, (i + 1) * 3840, 2160 });
+        }
+    }
+
+    // Scattered over the whole desktop, away from the monitor edges
+    void Fill(FakeListView& listView, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            wchar_t name[64];
+            std::swprintf(name, 64, L"Item %zu", i);
+            LONG x = static_cast<LONG>((i * 7919) % 15200);
+            LONG y = static_cast<LONG>((i * 104729) % 2000);
+            listView.Add(name, { x, y });
+        }
+    }
+
+    bool AllBack(const FakeListView& listView, const std::vector<POINT>& original) {
+        for (size_t i = 0; i < original.size(); i++) {
+            if (listView.positions[i].x != original[i].x || listView.positions[i].y != original[i].y) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST(MultiMonitor, HideShowLatency) {
+    SetUpMonitors();
+
+    for (size_t count : COUNTS) {
+        FakeListView listView;
+        Fill(listView, count);
+        std::vector<POINT> original = listView.positions;
+        MonitorHider hider;
+
+        const size_t ROUNDS = 20;
+        std::vector<double> coldHides, warmHides, shows;
+        bool ok = true;
+        for (size_t round = 0; round < ROUNDS; round++) {
+            // Showing invalidates the index, so the first hide rebuilds it
+            Benchmark::Clock::time_point start = Benchmark::Clock::now();
+            ok = ok && hider.Hide(listView.Handle(), L"\\\\.\\DISPLAY1");
+            coldHides.push_back(Benchmark::ElapsedNs(start));
+
+            start = Benchmark::Clock::now();
+            ok = ok && hider.Hide(listView.Handle(), L"\\\\.\\DISPLAY3");
+            warmHides.push_back(Benchmark::ElapsedNs(start));
+
+            start = Benchmark::Clock::now();
+            ok = ok && hider.Show(listView.Handle(), L"\\\\.\\DISPLAY3");
+            ok = ok && hider.Show(listView.Handle(), L"\\\\.\\DISPLAY1");
+            shows.push_back(Benchmark::ElapsedNs(start) / 2.0);
+        }
+
+        CHECK(ok);
+        CHECK(AllBack(listView, original));
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "hide one monitor, %zu icons, index built", count);
+        Benchmark::Report(label, Benchmark::Percentile(coldHides, 0.50) / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "hide one monitor, %zu icons, index cached", count);
+        Benchmark::Report(label, Benchmark::Percentile(warmHides, 0.50) / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "show one monitor, %zu icons", count);
+        Benchmark::Report(label, Benchmark::Percentile(shows, 0.50) / 1000.0, "us");
+    }
+
+    Win32Compat::FakeMonitors().clear();
+}
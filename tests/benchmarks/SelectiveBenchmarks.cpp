@@ -0,0 +1,110 @@
+#include "Benchmark.h"
+#include "PatternRules.h"
+#include "SelectiveHider.h"
+#include <string>
+
+// Selective hiding on simulated desktops of up to 10,000 icons: rule
+// matching on its own, then whole hides and restores through a fake
+// listview, which costs the batching but not Explorer's side of the messages.
+
+namespace {
+    using Win32Compat::FakeListView;
+
+    const wchar_t* const KINDS[] = { L"Document %zu.docx", L"Shortcut %zu.lnk", L"Photo_%zu.jpg", L"Project %zu" };
+
+    std::wstring IconName(size_t i) {
+        wchar_t name[64];
+        std::swprintf(name, 64, KINDS[i % 4], i);
+        return name;
+    }
+
+    void Fill(FakeListView& listView, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            listView.Add(IconName(i).c_str(), { static_cast<LONG>(i % 100) * 75, static_cast<LONG>(i / 100) * 100 });
+        }
+    }
+
+    // Typical keep lists: a few names and extensions, then one with a regex
+    const std::vector<std::wstring> KEEP_SIMPLE = { L"Recycle Bin", L"This PC", L"*.lnk", L"Project 1*" };
+    const std::vector<std::wstring> KEEP_GLOB = { L"Recycle Bin", L"*.lnk", L"Photo_?0*.jpg", L"Project *7" };
+    const std::vector<std::wstring> KEEP_REGEX = { L"Recycle Bin", L"*.lnk", L"re:document [0-9]*5\\.docx" };
+}
+
+TEST(Selective, MatchScaling) {
+    struct RuleSet {
+        const char* name;
+        const std::vector<std::wstring>* patterns;
+    } sets[] = {
+        { "literal, suffix, prefix", &KEEP_SIMPLE },
+        { "with globs", &KEEP_GLOB },
+        { "with a regex", &KEEP_REGEX },
+    };
+
+    const size_t COUNTS[] = { 100, 1000, 10000 };
+
+    for (const RuleSet& set : sets) {
+        PatternRules rules;
+        for (const std::wstring& pattern : *set.patterns) {
+            REQUIRE(rules.Add(pattern));
+        }
+
+        for (size_t count : COUNTS) {
+            std::vector<std::wstring> names;
+            for (size_t i = 0; i < count; i++) {
+                names.push_back(IconName(i));
+            }
+
+            size_t rounds = 100000 / count;
+            size_t matched = 0;
+            double ns = Benchmark::TimePerCallNs(rounds, [&](size_t) {
+                for (const std::wstring& name : names) {
+                    matched += rules.Matches(name.c_str()) ? 1 : 0;
+                }
+            });
+            Benchmark::Consume(matched);
+
+            char label[96];
+            std::snprintf(label, sizeof(label), "match %zu names, %s", count, set.name);
+            Benchmark::Report(label, ns / 1000.0, "us");
+        }
+    }
+}
+
+TEST(Selective, HideRestoreScaling) {
+    const size_t COUNTS[] = { 100, 1000, 10000 };
+
+    for (size_t count : COUNTS) {
+        FakeListView listView;
+        Fill(listView, count);
+        std::vector<POINT> original = listView.positions;
+
+        SelectiveHider hider;
+        REQUIRE(hider.SetKeepRules(KEEP_SIMPLE) == 0);
+
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        REQUIRE(hider.Hide(listView.Handle()));
+        double hideNs = Benchmark::ElapsedNs(start);
+
+        // Shortcuts and some projects are kept
+        size_t hidden = hider.GetHiddenCount();
+        CHECK(hidden > count / 2 && hidden <= count * 3 / 4);
+
+        start = Benchmark::Clock::now();
+        REQUIRE(hider.Restore(listView.Handle()));
+        double restoreNs = Benchmark::ElapsedNs(start);
+
+        bool back = true;
+        for (size_t i = 0; i < count; i++) {
+            back = back && listView.positions[i].x == original[i].x && listView.positions[i].y == original[i].y;
+        }
+        CHECK(back);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "hide, %zu icons (%zu moved)", count, hidden);
+        Benchmark::Report(label, hideNs / 1e6, "ms");
+        std::snprintf(label, sizeof(label), "restore, %zu icons", count);
+        Benchmark::Report(label, restoreNs / 1e6, "ms");
+        std::snprintf(label, sizeof(label), "hide + restore per icon, %zu icons", count);
+        Benchmark::Report(label, (hideNs + restoreNs) / static_cast<double>(count), "ns");
+    }
+}
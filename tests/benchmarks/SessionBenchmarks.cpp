@@ -0,0 +1,170 @@
+#include "Benchmark.h"
+#include "SharedAssets.h"
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+
+// Memory taken by the shared assets across many sessions on one host, each
+// session a forked process that maps the section as the application does.
+// With the privilege to create Global\ objects the first instance (this
+// process) publishes one section for everyone; without it every session
+// renders a copy of its own. Counted from each session's smaps: its private
+// pages, plus the shared pages once.
+
+namespace {
+    const size_t SESSION_COUNTS[] = { 1, 8, 32, 64 };
+
+    struct SectionPages {
+        size_t privateKb = 0;
+        size_t sharedKb = 0;
+    };
+
+    SectionPages ReadSectionPages() {
+        SectionPages pages;
+        std::ifstream smaps("/proc/self/smaps");
+        std::string line;
+        bool inSection = false;
+        while (std::getline(smaps, line)) {
+            // Mapping headers start with the address range, in lowercase hex
+            if (!line.empty() && (std::isdigit(static_cast<unsigned char>(line[0])) || (line[0] >= 'a' && line[0] <= 'f'))) {
+                inSection = line.find("DesktopIconTogglerAssets") != std::string::npos;
+                continue;
+            }
+            if (!inSection) {
+                continue;
+            }
+            size_t kb = 0;
+            if (std::sscanf(line.c_str(), "Private_Clean: %zu kB", &kb) == 1 ||
+                std::sscanf(line.c_str(), "Private_Dirty: %zu kB", &kb) == 1) {
+                pages.privateKb += kb;
+            } else if (std::sscanf(line.c_str(), "Shared_Clean: %zu kB", &kb) == 1 ||
+                       std::sscanf(line.c_str(), "Shared_Dirty: %zu kB", &kb) == 1) {
+                pages.sharedKb += kb;
+            }
+        }
+        return pages;
+    }
+
+    // Reads every icon pixel and key name, so every page is resident
+    size_t TouchAssets(const SharedAssetStore& store) {
+        size_t sum = 0;
+        for (int visible = 0; visible < 2; visible++) {
+            const uint32_t* pixels = store.GetIconPixels(visible != 0);
+            for (uint32_t i = 0; pixels && i < SharedAssets::ICON_PIXELS; i++) {
+                sum += pixels[i];
+            }
+        }
+        for (UINT vk = 0; vk < SharedAssets::KEY_COUNT; vk++) {
+            const wchar_t* name = store.GetKeyName(vk);
+            sum += name ? static_cast<size_t>(name[0]) : 0;
+        }
+        return sum;
+    }
+
+    // One session: maps the assets, reports once every session has, and
+    // exits when told to. Never returns.
+    [[noreturn]] void RunSession(int readyPipe, int goPipe, int resultPipe) {
+        SharedAssetStore store;
+        SectionPages pages;
+        bool initialized = store.Initialize();
+        Benchmark::Consume(initialized ? TouchAssets(store) : 0);
+
+        char ready = initialized ? 1 : 0;
+        ssize_t written = write(readyPipe, &ready, 1);
+        char go;
+        ssize_t read = ::read(goPipe, &go, 1);
+        Benchmark::Consume(static_cast<size_t>(written + read));
+
+        pages = ReadSectionPages();
+        written = write(resultPipe, &pages, sizeof(pages));
+        Benchmark::Consume(static_cast<size_t>(written));
+        _exit(0);
+    }
+
+    // Total KB of section pages over sessionCount live sessions; 0 if a
+    // session failed to map the assets
+    size_t MeasureSessions(size_t sessionCount) {
+        int ready[2], go[2], result[2];
+        if (pipe(ready) != 0 || pipe(go) != 0 || pipe(result) != 0) {
+            return 0;
+        }
+
+        std::vector<pid_t> sessions;
+        for (size_t s = 0; s < sessionCount; s++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(go[1]);
+                RunSession(ready[1], go[0], result[1]);
+            }
+            if (pid > 0) {
+                sessions.push_back(pid);
+            }
+        }
+
+        // Hold every session until all of them have mapped the section
+        bool allReady = sessions.size() == sessionCount;
+        for (size_t s = 0; s < sessions.size(); s++) {
+            char byte = 0;
+            allReady = allReady && ::read(ready[0], &byte, 1) == 1 && byte == 1;
+        }
+        close(go[1]);
+
+        size_t privateKb = 0;
+        size_t sharedKb = 0;
+        for (size_t s = 0; s < sessions.size(); s++) {
+            SectionPages pages;
+            if (::read(result[0], &pages, sizeof(pages)) == static_cast<ssize_t>(sizeof(pages))) {
+                privateKb += pages.privateKb;
+                sharedKb = pages.sharedKb > sharedKb ? pages.sharedKb : sharedKb;
+            }
+        }
+        for (pid_t pid : sessions) {
+            waitpid(pid, nullptr, 0);
+        }
+
+        close(ready[0]);
+        close(ready[1]);
+        close(go[0]);
+        close(result[0]);
+        close(result[1]);
+        return allReady ? privateKb + sharedKb : 0;
+    }
+}
+
+TEST(Sessions, AssetMemory) {
+    // First without the privilege: nobody may publish in Global\, and the
+    // sections the sessions create die with them
+    Win32Compat::GlobalObjectsAllowed() = false;
+    std::vector<size_t> perSession;
+    for (size_t sessionCount : SESSION_COUNTS) {
+        perSession.push_back(MeasureSessions(sessionCount));
+    }
+    Win32Compat::GlobalObjectsAllowed() = true;
+
+    // Then the first instance publishes for the machine and stays running
+    SharedAssetStore publisher;
+    REQUIRE(publisher.Initialize());
+    REQUIRE(publisher.IsMachineWide());
+    Benchmark::Consume(TouchAssets(publisher));
+
+    std::vector<size_t> machineWide;
+    for (size_t sessionCount : SESSION_COUNTS) {
+        machineWide.push_back(MeasureSessions(sessionCount));
+    }
+    publisher.Cleanup();
+
+    const size_t sectionKb = (sizeof(SharedAssets::Section) + 4095) / 4096 * 4;
+    Benchmark::Report("section size, rounded up to pages", static_cast<double>(sectionKb), "KB");
+    for (size_t i = 0; i < sizeof(SESSION_COUNTS) / sizeof(SESSION_COUNTS[0]); i++) {
+        CHECK_EQ(perSession[i], SESSION_COUNTS[i] * sectionKb);
+        CHECK_EQ(machineWide[i], sectionKb);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu sessions, a copy each, total", SESSION_COUNTS[i]);
+        Benchmark::Report(label, static_cast<double>(perSession[i]), "KB");
+        std::snprintf(label, sizeof(label), "%zu sessions, one machine-wide section, total", SESSION_COUNTS[i]);
+        Benchmark::Report(label, static_cast<double>(machineWide[i]), "KB");
+    }
+}
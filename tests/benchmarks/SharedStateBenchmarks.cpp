@@ -0,0 +1,164 @@
+#include "Benchmark.h"
+#include "SharedStatePage.h"
+#include "IpcProtocol.h"
+#include <atomic>
+#include <thread>
+
+// The shared state page from both sides: readers map the page by name as a
+// status bar would and copy snapshots in a loop, while the publisher writes
+// new states, flat out or about a thousand times a second. Every snapshot
+// is checked for a torn copy.
+
+namespace {
+    const size_t READS_PER_THREAD = 2000000;
+    const size_t THREAD_COUNTS[] = { 1, 2, 4, 8 };
+
+    // Publishes alternate between two states whose fields all differ, so a
+    // copy mixing the two shows up
+    HotkeyConfig HotkeyFor(IconState state) {
+        HotkeyConfig hotkey;
+        hotkey.shift = state == IconState::Hidden;
+        hotkey.vkCode = state == IconState::Hidden ? 'H' : 'V';
+        return hotkey;
+    }
+
+    bool Consistent(const SharedState::Snapshot& snapshot) {
+        if (snapshot.iconState == static_cast<uint32_t>(Ipc::WireState::Unknown)) {
+            return snapshot.changeCounter == 0;
+        }
+        IconState state = snapshot.iconState == static_cast<uint32_t>(Ipc::WireState::Hidden) ? IconState::Hidden : IconState::Visible;
+        HotkeyConfig hotkey = HotkeyFor(state);
+        return snapshot.hotkeyModifiers == hotkey.GetModifiers() && snapshot.hotkeyVirtualKey == hotkey.vkCode;
+    }
+
+    IconState StateFor(size_t change) {
+        return (change & 1) ? IconState::Hidden : IconState::Visible;
+    }
+
+    // A reader's own view of the page, opened by name
+    struct ReaderView {
+        HANDLE mapping = OpenFileMapping(FILE_MAP_READ, FALSE, SharedState::MAPPING_NAME);
+        const SharedState::Page* page = mapping ? static_cast<const SharedState::Page*>(
+            MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(SharedState::Page))) : nullptr;
+
+        ~ReaderView() {
+            if (page) UnmapViewOfFile(page);
+            if (mapping) CloseHandle(mapping);
+        }
+    };
+
+    struct Result {
+        double readsPerSecond = 0.0; // Millions, over every reader
+        double publishesPerSecond = 0.0;
+        size_t torn = 0;
+    };
+
+    // writerPauseUs 0 publishes as fast as possible
+    Result Run(SharedStatePublisher& publisher, size_t readerCount, DWORD writerPauseUs) {
+        std::atomic<size_t> ready(0);
+        std::atomic<size_t> running(readerCount);
+        std::atomic<bool> go(false);
+        std::atomic<size_t> torn(0);
+        bool mapped = true;
+
+        std::vector<ReaderView> views(readerCount);
+        for (const ReaderView& view : views) {
+            mapped = mapped && view.page != nullptr;
+        }
+        CHECK(mapped);
+        if (!mapped) {
+            return Result();
+        }
+
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < readerCount; r++) {
+            readers.emplace_back([&, r]() {
+                ready.fetch_add(1);
+                while (!go.load()) {}
+                size_t bad = 0;
+                for (size_t i = 0; i < READS_PER_THREAD; i++) {
+                    SharedState::Snapshot snapshot = SharedState::ReadSnapshot(*views[r].page);
+                    bad += Consistent(snapshot) ? 0 : 1;
+                }
+                torn.fetch_add(bad);
+                running.fetch_sub(1);
+            });
+        }
+        while (ready.load() != readerCount) {}
+
+        Result result;
+        size_t publishes = 0;
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        go.store(true);
+        while (running.load() != 0) {
+            publishes++;
+            IconState state = StateFor(publishes);
+            publisher.Publish(state, HotkeyFor(state));
+            if (writerPauseUs) {
+                usleep(writerPauseUs);
+            }
+        }
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        double elapsedNs = Benchmark::ElapsedNs(start);
+        result.readsPerSecond = static_cast<double>(readerCount * READS_PER_THREAD) * 1000.0 / elapsedNs;
+        result.publishesPerSecond = static_cast<double>(publishes) * 1e9 / elapsedNs;
+        result.torn = torn.load();
+        return result;
+    }
+}
+
+TEST(SharedState, ReadPublishCost) {
+    SharedStatePublisher publisher;
+    REQUIRE(publisher.Initialize());
+    ReaderView view;
+    REQUIRE(view.page != nullptr);
+
+    const size_t CALLS = 5000000;
+    size_t torn = 0;
+    double readNs = Benchmark::TimePerCallNs(CALLS, [&](size_t) {
+        SharedState::Snapshot snapshot = SharedState::ReadSnapshot(*view.page);
+        torn += Consistent(snapshot) ? 0 : 1;
+    });
+    CHECK_EQ(torn, 0u);
+
+    // Every call changes the state, so none is skipped
+    double publishNs = Benchmark::TimePerCallNs(CALLS, [&](size_t i) {
+        IconState state = StateFor(i);
+        publisher.Publish(state, HotkeyFor(state));
+    });
+    CHECK_EQ(SharedState::ReadSnapshot(*view.page).changeCounter, CALLS);
+
+    double unchangedNs = Benchmark::TimePerCallNs(CALLS, [&](size_t) {
+        publisher.Publish(IconState::Hidden, HotkeyFor(IconState::Hidden));
+    });
+
+    Benchmark::Report("read snapshot, no writer", readNs, "ns");
+    Benchmark::Report("publish, state changed", publishNs, "ns");
+    Benchmark::Report("publish, nothing changed", unchangedNs, "ns");
+
+    publisher.Cleanup();
+}
+
+TEST(SharedState, ReadersAgainstWriter) {
+    SharedStatePublisher publisher;
+    REQUIRE(publisher.Initialize());
+
+    for (size_t readerCount : THREAD_COUNTS) {
+        Result busy = Run(publisher, readerCount, 0);
+        Result paced = Run(publisher, readerCount, 1000);
+        CHECK_EQ(busy.torn, 0u);
+        CHECK_EQ(paced.torn, 0u);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu readers, writer flat out, reads", readerCount);
+        Benchmark::Report(label, busy.readsPerSecond, "M/s");
+        std::snprintf(label, sizeof(label), "%zu readers, writer flat out, publishes", readerCount);
+        Benchmark::Report(label, busy.publishesPerSecond, "/s");
+        std::snprintf(label, sizeof(label), "%zu readers, writer at ~1 kHz, reads", readerCount);
+        Benchmark::Report(label, paced.readsPerSecond, "M/s");
+    }
+
+    publisher.Cleanup();
+}
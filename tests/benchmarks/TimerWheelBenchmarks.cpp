@@ -0,0 +1,166 @@
+#include "Benchmark.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <map>
+#include <random>
+
+// The timing wheel behind TimerService: checked against a plain map of
+// deadlines over randomized rounds, then insert, cancel and expiry cost
+// with up to a million timers spread over a day. A std::multimap doing the
+// same work is timed alongside.
+
+namespace {
+    constexpr uint64_t DAY_MS = 24ull * 60 * 60 * 1000;
+    const size_t COUNTS[] = { 10000, 100000, 1000000 };
+
+    struct Costs {
+        double insertNs = 0.0;
+        double cancelNs = 0.0;
+        double expireNs = 0.0; // Per expired timer, advancing a second at a time
+    };
+
+    // Half the timers are cancelled, the rest expire
+    Costs MeasureWheel(const std::vector<uint64_t>& deadlines, uint64_t start, size_t& expired) {
+        TimerWheel wheel;
+        wheel.Reserve(deadlines.size());
+        std::vector<TimerWheel::Handle> handles(deadlines.size());
+        Costs costs;
+
+        costs.insertNs = Benchmark::TimePerCallNs(deadlines.size(), [&](size_t i) {
+            handles[i] = wheel.Insert(start, deadlines[i], i);
+        });
+        costs.cancelNs = Benchmark::TimePerCallNs(deadlines.size() / 2, [&](size_t i) {
+            Benchmark::Consume(wheel.Cancel(handles[i * 2]) ? 1 : 0);
+        });
+
+        expired = 0;
+        Benchmark::Clock::time_point begin = Benchmark::Clock::now();
+        for (uint64_t now = start; now <= start + DAY_MS + 1000; now += 1000) {
+            wheel.Advance(now);
+            uint64_t cookie;
+            while (wheel.PopExpired(cookie)) {
+                expired++;
+            }
+        }
+        costs.expireNs = Benchmark::ElapsedNs(begin) / static_cast<double>(expired ? expired : 1);
+        return costs;
+    }
+
+    Costs MeasureMultimap(const std::vector<uint64_t>& deadlines, uint64_t start, size_t& expired) {
+        std::multimap<uint64_t, uint64_t> timers;
+        std::vector<std::multimap<uint64_t, uint64_t>::iterator> handles(deadlines.size());
+        Costs costs;
+
+        costs.insertNs = Benchmark::TimePerCallNs(deadlines.size(), [&](size_t i) {
+            handles[i] = timers.emplace(deadlines[i], i);
+        });
+        costs.cancelNs = Benchmark::TimePerCallNs(deadlines.size() / 2, [&](size_t i) {
+            timers.erase(handles[i * 2]);
+        });
+
+        expired = 0;
+        Benchmark::Clock::time_point begin = Benchmark::Clock::now();
+        for (uint64_t now = start; now <= start + DAY_MS + 1000; now += 1000) {
+            while (!timers.empty() && timers.begin()->first <= now) {
+                Benchmark::Consume(timers.begin()->second);
+                timers.erase(timers.begin());
+                expired++;
+            }
+        }
+        costs.expireNs = Benchmark::ElapsedNs(begin) / static_cast<double>(expired ? expired : 1);
+        return costs;
+    }
+}
+
+// Every timer expires once, never early and at most a tick late, and the
+// next deadline never lies beyond the earliest pending one
+TEST(TimerWheel, ReferenceRounds) {
+    const int ROUNDS = 20;
+    size_t mismatches = 0;
+    size_t expired = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        std::mt19937_64 random(1000 + round);
+        TimerWheel wheel;
+        std::map<uint64_t, std::pair<uint64_t, TimerWheel::Handle>> pending; // Cookie -> deadline, handle
+        uint64_t now = random() % (1ull << 40);
+        uint64_t nextCookie = 0;
+
+        for (int step = 0; step < 50000; step++) {
+            int operation = static_cast<int>(random() % 10);
+            if (operation < 5) {
+                // Mostly near, some beyond the wheel's three days
+                uint64_t range = random() % 8 == 0 ? 5 * DAY_MS : (random() % 2 ? 100000 : 2000);
+                uint64_t deadline = now + random() % range;
+                pending[nextCookie] = { std::max(deadline, now), wheel.Insert(now, deadline, nextCookie) };
+                nextCookie++;
+            } else if (operation < 7 && !pending.empty()) {
+                auto it = pending.lower_bound(random() % nextCookie);
+                it = it == pending.end() ? pending.begin() : it;
+                mismatches += wheel.Cancel(it->second.second) ? 0 : 1;
+                pending.erase(it);
+            } else {
+                uint64_t next = 0;
+                bool hasNext = wheel.GetNextDeadline(next);
+                uint64_t earliest = UINT64_MAX;
+                for (const auto& entry : pending) {
+                    earliest = std::min(earliest, entry.second.first);
+                }
+                mismatches += hasNext != !pending.empty() || (hasNext && next > earliest + TimerWheel::TICK_MS) ? 1 : 0;
+
+                now += hasNext && random() % 3 == 0 ? (next > now ? next - now : 0) : random() % 5000;
+                wheel.Advance(now);
+
+                uint64_t cookie;
+                while (wheel.PopExpired(cookie)) {
+                    auto it = pending.find(cookie);
+                    mismatches += (it == pending.end() || it->second.first > now) ? 1 : 0;
+                    if (it != pending.end()) {
+                        pending.erase(it);
+                    }
+                    expired++;
+                }
+                for (const auto& entry : pending) {
+                    mismatches += entry.second.first + 2 * TimerWheel::TICK_MS <= now ? 1 : 0;
+                }
+            }
+            mismatches += wheel.GetCount() != pending.size() ? 1 : 0;
+        }
+    }
+
+    CHECK_EQ(mismatches, 0u);
+    Benchmark::Report("randomized rounds against the reference", static_cast<double>(ROUNDS), "");
+    Benchmark::Report("timers expired", static_cast<double>(expired), "");
+    Benchmark::Report("mismatches", static_cast<double>(mismatches), "");
+}
+
+TEST(TimerWheel, DayOfTimers) {
+    for (size_t count : COUNTS) {
+        std::mt19937_64 random(49);
+        uint64_t start = random() % (1ull << 40);
+        std::vector<uint64_t> deadlines(count);
+        for (uint64_t& deadline : deadlines) {
+            deadline = start + random() % DAY_MS;
+        }
+
+        size_t wheelExpired = 0, mapExpired = 0;
+        Costs wheel = MeasureWheel(deadlines, start, wheelExpired);
+        Costs map = MeasureMultimap(deadlines, start, mapExpired);
+        CHECK_EQ(wheelExpired, count - count / 2);
+        CHECK_EQ(mapExpired, wheelExpired);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "%zu timers, wheel insert", count);
+        Benchmark::Report(label, wheel.insertNs, "ns");
+        std::snprintf(label, sizeof(label), "%zu timers, wheel cancel", count);
+        Benchmark::Report(label, wheel.cancelNs, "ns");
+        std::snprintf(label, sizeof(label), "%zu timers, wheel expiry per timer", count);
+        Benchmark::Report(label, wheel.expireNs, "ns");
+        std::snprintf(label, sizeof(label), "%zu timers, multimap insert", count);
+        Benchmark::Report(label, map.insertNs, "ns");
+        std::snprintf(label, sizeof(label), "%zu timers, multimap cancel", count);
+        Benchmark::Report(label, map.cancelNs, "ns");
+        std::snprintf(label, sizeof(label), "%zu timers, multimap expiry per timer", count);
+        Benchmark::Report(label, map.expireNs, "ns");
+    }
+}
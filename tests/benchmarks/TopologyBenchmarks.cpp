@@ -0,0 +1,101 @@
+#include "Benchmark.h"
+#include "LayoutStore.h"
+#include <cstdio>
+#include <random>
+#include <string>
+
+// A simulated stream of display changes (docking, projectors, resolution
+// and scale changes) against the memory-mapped layout store, restoring each
+// setup's layout onto the fake listview as OnDisplayLayoutRestore does. More
+// setups come up than the store keeps, so some restores miss and evict.
+
+namespace {
+    using Win32Compat::FakeListView;
+
+    const wchar_t* const STORE_PATH = L"topology-benchmark.dat";
+    const size_t ICON_COUNT = 1000;
+    const size_t TOPOLOGY_COUNT = 24; // More than LayoutStoreFormat::MAX_LAYOUTS
+    const size_t EVENT_COUNT = 2000;
+
+    // Explorer's rearrangement under a setup: the same grid, shifted
+    void Arrange(FakeListView& listView, uint64_t topology) {
+        LONG shift = static_cast<LONG>(topology % 7) * 10;
+        for (size_t i = 0; i < listView.positions.size(); i++) {
+            listView.positions[i] = { static_cast<LONG>(i % 40) * 75 + shift, static_cast<LONG>(i / 40) * 100 };
+        }
+    }
+
+    void Report(const char* name, std::vector<double>& samples) {
+        char label[96];
+        std::snprintf(label, sizeof(label), "%s p50", name);
+        Benchmark::Report(label, Benchmark::Percentile(samples, 0.50) / 1000.0, "us");
+        std::snprintf(label, sizeof(label), "%s p99", name);
+        Benchmark::Report(label, Benchmark::Percentile(samples, 0.99) / 1000.0, "us");
+    }
+}
+
+TEST(Topology, DisplayChangeStream) {
+    std::remove("topology-benchmark.dat");
+
+    FakeListView listView;
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        std::wstring name = L"Item " + std::to_wstring(i);
+        listView.Add(name.c_str(), { 0, 0 });
+    }
+
+    LayoutStore store;
+    REQUIRE(store.Open(STORE_PATH));
+
+    // A laptop mostly moves between a few setups; the rest are rare
+    std::mt19937_64 random(43);
+    std::discrete_distribution<size_t> pick({ 40, 25, 15, 5, 5, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 });
+    REQUIRE(pick.max() + 1 == TOPOLOGY_COUNT);
+
+    std::vector<double> lookups, restores, stores;
+    IconLayout layout;
+    size_t hits = 0;
+    bool restoredRight = true;
+
+    for (size_t event = 0; event < EVENT_COUNT; event++) {
+        uint64_t topology = 0x9E3779B97F4A7C15ull * (pick(random) + 1);
+        Arrange(listView, topology);
+
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        bool found = store.Lookup(topology, layout);
+        lookups.push_back(Benchmark::ElapsedNs(start));
+
+        if (found) {
+            hits++;
+            start = Benchmark::Clock::now();
+            bool applied = layout.Apply(listView.Handle());
+            restores.push_back(Benchmark::ElapsedNs(start));
+
+            // What the user left under this setup last time
+            restoredRight = restoredRight && applied && listView.positions[event % ICON_COUNT].y == 5000 + static_cast<LONG>(topology % 13);
+        }
+
+        // The user tidies up a bit, and the layout is recorded again
+        for (POINT& position : listView.positions) {
+            position.y = 5000 + static_cast<LONG>(topology % 13);
+        }
+
+        start = Benchmark::Clock::now();
+        bool stored = layout.Capture(listView.Handle()) && store.Store(topology, layout);
+        stores.push_back(Benchmark::ElapsedNs(start));
+        CHECK(stored);
+    }
+
+    CHECK(restoredRight);
+    CHECK(store.GetCount() == LayoutStoreFormat::MAX_LAYOUTS);
+
+    char label[96];
+    std::snprintf(label, sizeof(label), "%zu display changes, %zu icons, hit rate", EVENT_COUNT, ICON_COUNT);
+    Benchmark::Report(label, 100.0 * static_cast<double>(hits) / static_cast<double>(EVENT_COUNT), "%");
+    Report("lookup", lookups);
+    Report("restore after a hit", restores);
+    Report("capture + store", stores);
+    Benchmark::Report("store file size", static_cast<double>(store.GetMappedBytes()) / 1024.0, "KB");
+
+    store.Close();
+    std::remove("topology-benchmark.dat");
+}
@@ -0,0 +1,78 @@
+#include "Benchmark.h"
+#include "Tracer.h"
+#include <cstdio>
+#include <thread>
+
+// What a TRACE_SPAN costs with tracing on and off, from one thread and from
+// several at once, and what writing out every ring costs.
+
+namespace {
+    const size_t SPANS = 10000000;
+
+    // The same loop with no span, so the span's own cost can be told apart
+    double BaselineNs() {
+        return Benchmark::TimePerCallNs(SPANS, [](size_t i) { Benchmark::Consume(i); });
+    }
+
+    double SpanNs() {
+        return Benchmark::TimePerCallNs(SPANS, [](size_t i) {
+            TRACE_SPAN("bench", "Span");
+            Benchmark::Consume(i);
+        });
+    }
+}
+
+TEST(Tracer, SpanOverhead) {
+    Tracer::Initialize(L"crash-trace-benchmark.json");
+
+    double baseline = BaselineNs();
+
+    Tracer::SetEnabled(false);
+    double off = SpanNs();
+    Tracer::SetEnabled(true);
+    double on = SpanNs();
+
+    Benchmark::Report("loop without a span", baseline, "ns");
+    Benchmark::Report("span, tracing off", off - baseline, "ns");
+    Benchmark::Report("span, tracing on", on - baseline, "ns");
+}
+
+TEST(Tracer, ThreadScaling) {
+    Tracer::Initialize(L"crash-trace-benchmark.json");
+    Tracer::SetEnabled(true);
+
+    // Each thread records into its own ring; wall time over all spans
+    const size_t THREAD_COUNTS[] = { 1, 2, 4, 8 };
+    const size_t SPANS_PER_THREAD = 2000000;
+    for (size_t threadCount : THREAD_COUNTS) {
+        Benchmark::Clock::time_point start = Benchmark::Clock::now();
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; t++) {
+            threads.emplace_back([]() {
+                for (size_t i = 0; i < SPANS_PER_THREAD; i++) {
+                    TRACE_SPAN("bench", "ThreadSpan");
+                    Benchmark::Consume(i);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double ns = Benchmark::ElapsedNs(start) / static_cast<double>(threadCount * SPANS_PER_THREAD);
+
+        char label[96];
+        std::snprintf(label, sizeof(label), "span, tracing on, %zu threads, wall time per span", threadCount);
+        Benchmark::Report(label, ns, "ns");
+    }
+
+    // Every ring recorded so far is full by now
+    Benchmark::Clock::time_point start = Benchmark::Clock::now();
+    bool dumped = Tracer::DumpChromeTrace(L"trace-benchmark.json");
+    double dumpNs = Benchmark::ElapsedNs(start);
+    CHECK(dumped);
+    std::remove("trace-benchmark.json");
+
+    char label[96];
+    std::snprintf(label, sizeof(label), "dump, %zu bytes of rings", Tracer::GetMemoryUsage());
+    Benchmark::Report(label, dumpNs / 1e6, "ms");
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+
+// List-view messages, for RemoteListView (see windows.h)
+enum : UINT {
+    LVM_FIRST = 0x1000,
+    LVM_GETITEMCOUNT = LVM_FIRST + 4,
+    LVM_GETITEMRECT = LVM_FIRST + 14,
+    LVM_SETITEMPOSITION = LVM_FIRST + 15,
+    LVM_GETITEMPOSITION = LVM_FIRST + 16,
+    LVM_SETITEMPOSITION32 = LVM_FIRST + 49,
+    LVM_GETITEMSPACING = LVM_FIRST + 51,
+    LVM_GETITEMTEXTW = LVM_FIRST + 115
+};
+#define LVM_GETITEMTEXT LVM_GETITEMTEXTW
+
+enum : UINT { LVIF_TEXT = 0x1, LVIR_BOUNDS = 0, LVIR_ICON = 1 };
+enum : LONG { LVS_AUTOARRANGE = 0x0100 };
+
+struct LVITEM {
+    UINT mask;
+    int iItem;
+    int iSubItem;
+    UINT state;
+    UINT stateMask;
+    LPWSTR pszText;
+    int cchTextMax;
+    int iImage;
+    LPARAM lParam;
+    int iIndent;
+    int iGroupId;
+    UINT cColumns;
+    UINT* puColumns;
+    int* piColFmt;
+    int iGroup;
+};
+
+namespace Win32Compat {
+    // A listview in another process, as far as RemoteListView can tell
+    struct FakeListView : FakeWindow {
+        std::vector<std::wstring> names;
+        std::vector<POINT> positions;
+        size_t moves = 0;
+
+        void Add(const wchar_t* name, POINT position) {
+            names.push_back(name);
+            positions.push_back(position);
+        }
+
+        LRESULT OnMessage(UINT message, WPARAM wParam, LPARAM lParam) override {
+            size_t index = static_cast<size_t>(wParam);
+            switch (message) {
+                case LVM_GETITEMCOUNT:
+                    return static_cast<LRESULT>(names.size());
+
+                case LVM_GETITEMSPACING:
+                    return MAKELONG(75, 100);
+
+                case LVM_GETITEMTEXT: {
+                    if (index >= names.size()) return 0;
+                    LVITEM* item = reinterpret_cast<LVITEM*>(lParam);
+                    size_t length = std::min(names[index].size(), static_cast<size_t>(item->cchTextMax - 1));
+                    std::wmemcpy(item->pszText, names[index].c_str(), length);
+                    item->pszText[length] = L'\0';
+                    return static_cast<LRESULT>(length);
+                }
+
+                case LVM_GETITEMPOSITION:
+                    if (index >= positions.size()) return FALSE;
+                    *reinterpret_cast<POINT*>(lParam) = positions[index];
+                    return TRUE;
+
+                case LVM_SETITEMPOSITION32:
+                    if (index >= positions.size()) return FALSE;
+                    positions[index] = *reinterpret_cast<const POINT*>(lParam);
+                    moves++;
+                    return TRUE;
+
+                default:
+                    return 0;
+            }
+        }
+    };
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "windows.h"
+
+// Security descriptors do not exist here; every string converts to none
+enum : DWORD { SDDL_REVISION_1 = 1 };
+
+inline BOOL ConvertStringSecurityDescriptorToSecurityDescriptor(LPCWSTR, DWORD, PSECURITY_DESCRIPTOR* descriptor, ULONG* size) {
+    *descriptor = nullptr;
+    if (size) *size = 0;
+    return TRUE;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// Nothing from this header is used by the units under test (see windows.h)
@@ -0,0 +1,866 @@
+#pragma once
+
+// The slice of the Windows API used by the units under test, for building
+// the tests on other hosts. Files and clocks are real (POSIX underneath);
+// windows, messages and other processes do not exist, so those calls fail
+// or do nothing. Only used when the tests are not built on Windows.
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <ctime>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WINAPI
+#define CALLBACK
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED 0xFFFFFFFF
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef unsigned int UINT;
+typedef int INT;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef intptr_t LONG_PTR;
+typedef uintptr_t UINT_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t DWORD_PTR;
+typedef ULONG_PTR SIZE_T;
+typedef UINT_PTR WPARAM;
+typedef LONG_PTR LPARAM;
+typedef LONG_PTR LRESULT;
+typedef wchar_t WCHAR;
+typedef WCHAR* LPWSTR;
+typedef const WCHAR* LPCWSTR;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef DWORD* LPDWORD;
+typedef void* HANDLE;
+typedef HANDLE HWND;
+typedef HANDLE HLOCAL;
+typedef HANDLE HMODULE;
+typedef HANDLE HMONITOR;
+typedef HANDLE HDC;
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+
+#define LOWORD(l) ((WORD)(((DWORD_PTR)(l)) & 0xffff))
+#define HIWORD(l) ((WORD)((((DWORD_PTR)(l)) >> 16) & 0xffff))
+#define MAKELONG(a, b) ((LONG)(((WORD)(a)) | ((DWORD)((WORD)(b))) << 16))
+#define MAKELPARAM(l, h) ((LPARAM)(DWORD)MAKELONG(l, h))
+#define MAKELANGID(p, s) ((((WORD)(s)) << 10) | (WORD)(p))
+#define LANG_NEUTRAL 0
+#define SUBLANG_DEFAULT 1
+
+struct POINT { LONG x; LONG y; };
+struct RECT { LONG left; LONG top; LONG right; LONG bottom; };
+typedef RECT* LPRECT;
+struct SIZE { LONG cx; LONG cy; };
+struct FILETIME { DWORD dwLowDateTime; DWORD dwHighDateTime; };
+struct SYSTEMTIME { WORD wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds; };
+struct GUID { uint32_t Data1; uint16_t Data2; uint16_t Data3; uint8_t Data4[8]; };
+union LARGE_INTEGER { struct { DWORD LowPart; LONG HighPart; }; LONGLONG QuadPart; };
+typedef void* PSECURITY_DESCRIPTOR;
+struct SECURITY_ATTRIBUTES { DWORD nLength; LPVOID lpSecurityDescriptor; BOOL bInheritHandle; };
+typedef SECURITY_ATTRIBUTES* LPSECURITY_ATTRIBUTES;
+struct OVERLAPPED; typedef OVERLAPPED* LPOVERLAPPED;
+struct RAWINPUTDEVICE { WORD usUsagePage; WORD usUsage; DWORD dwFlags; HWND hwndTarget; };
+struct EXCEPTION_POINTERS;
+typedef LONG (WINAPI* LPTOP_LEVEL_EXCEPTION_FILTER)(EXCEPTION_POINTERS*);
+#define EXCEPTION_CONTINUE_SEARCH 0
+
+enum : LONG { GWL_STYLE = -16 };
+enum : UINT { WM_SETREDRAW = 0x000B, WM_USER = 0x0400, WM_APP = 0x8000 };
+enum : UINT { MOD_ALT = 1, MOD_CONTROL = 2, MOD_SHIFT = 4, MOD_WIN = 8, MOD_NOREPEAT = 0x4000 };
+enum : UINT { MAPVK_VK_TO_VSC = 0 };
+enum : UINT {
+    VK_BACK = 0x08, VK_TAB = 0x09, VK_RETURN = 0x0D, VK_PAUSE = 0x13, VK_ESCAPE = 0x1B, VK_SPACE = 0x20,
+    VK_PRIOR = 0x21, VK_NEXT = 0x22, VK_END = 0x23, VK_HOME = 0x24, VK_LEFT = 0x25, VK_UP = 0x26,
+    VK_RIGHT = 0x27, VK_DOWN = 0x28, VK_SNAPSHOT = 0x2C, VK_INSERT = 0x2D, VK_DELETE = 0x2E,
+    VK_NUMPAD0 = 0x60, VK_MULTIPLY = 0x6A, VK_ADD = 0x6B, VK_SUBTRACT = 0x6D, VK_DECIMAL = 0x6E,
+    VK_DIVIDE = 0x6F, VK_F1 = 0x70
+};
+enum : UINT { MB_OK = 0, MB_ICONERROR = 0x10, MB_ICONINFORMATION = 0x40 };
+enum : DWORD { FORMAT_MESSAGE_ALLOCATE_BUFFER = 0x100, FORMAT_MESSAGE_IGNORE_INSERTS = 0x200, FORMAT_MESSAGE_FROM_SYSTEM = 0x1000 };
+enum : DWORD { RIDEV_REMOVE = 0x1, RIDEV_INPUTSINK = 0x100 };
+enum : DWORD { GENERIC_READ = 0x80000000, GENERIC_WRITE = 0x40000000, FILE_SHARE_READ = 1, FILE_SHARE_WRITE = 2 };
+enum : DWORD { CREATE_NEW = 1, CREATE_ALWAYS = 2, OPEN_EXISTING = 3, OPEN_ALWAYS = 4, FILE_ATTRIBUTE_NORMAL = 0x80 };
+enum : DWORD { FILE_BEGIN = 0, FILE_CURRENT = 1, FILE_END = 2 };
+enum : DWORD { MOVEFILE_REPLACE_EXISTING = 1, MOVEFILE_WRITE_THROUGH = 8 };
+enum : DWORD { MEM_COMMIT = 0x1000, MEM_RESERVE = 0x2000, MEM_RELEASE = 0x8000, PAGE_READWRITE = 4 };
+enum : DWORD { FILE_MAP_WRITE = 2, FILE_MAP_READ = 4, FILE_MAP_ALL_ACCESS = 0xF001F };
+enum : DWORD { ERROR_FILE_NOT_FOUND = 2, ERROR_ACCESS_DENIED = 5, ERROR_ALREADY_EXISTS = 183 };
+enum : DWORD { PROCESS_VM_OPERATION = 0x8, PROCESS_VM_READ = 0x10, PROCESS_VM_WRITE = 0x20 };
+
+namespace Win32Compat {
+    // Owner of the fake window (see FakeWindow below)
+    const HANDLE FAKE_PROCESS = reinterpret_cast<HANDLE>(static_cast<intptr_t>(-2));
+    constexpr DWORD FAKE_PROCESS_ID = 2;
+
+    inline DWORD& LastError() {
+        static thread_local DWORD error = 0;
+        return error;
+    }
+
+    inline std::string Narrow(LPCWSTR text) {
+        std::string result;
+        for (; *text; text++) {
+            result += *text < 0x80 ? static_cast<char>(*text) : '?';
+        }
+        return result;
+    }
+
+    inline int ToFd(HANDLE handle) {
+        return static_cast<int>(reinterpret_cast<intptr_t>(handle)) - 1;
+    }
+
+    inline HANDLE FromFd(int fd) {
+        return reinterpret_cast<HANDLE>(static_cast<intptr_t>(fd) + 1);
+    }
+
+    // 100 ns units since 1601-01-01
+    inline ULONGLONG Now() {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return (static_cast<ULONGLONG>(now.tv_sec) + 11644473600ull) * 10000000ull + now.tv_nsec / 100;
+    }
+}
+
+// Errors, strings and messages
+
+inline DWORD GetLastError() { return Win32Compat::LastError(); }
+inline void SetLastError(DWORD error) { Win32Compat::LastError() = error; }
+inline DWORD FormatMessage(DWORD, LPCVOID, DWORD, DWORD, LPWSTR, DWORD, void*) { return 0; }
+inline HLOCAL LocalFree(HLOCAL) { return nullptr; }
+inline int MessageBox(HWND, LPCWSTR, LPCWSTR, UINT) { return 0; }
+inline void OutputDebugString(LPCWSTR) {}
+inline void OutputDebugStringA(const char*) {}
+inline UINT MapVirtualKey(UINT, UINT) { return 0; }
+inline int GetKeyNameText(LONG, LPWSTR, int) { return 0; }
+inline DWORD GetModuleFileName(HMODULE, LPWSTR buffer, DWORD size) {
+    if (size > 0) buffer[0] = L'\0';
+    return 0;
+}
+
+template<size_t N>
+inline int wcscpy_s(wchar_t (&destination)[N], const wchar_t* source) {
+    std::wcsncpy(destination, source, N - 1);
+    destination[N - 1] = L'\0';
+    return 0;
+}
+
+inline int wcscpy_s(wchar_t* destination, size_t size, const wchar_t* source) {
+    std::wcsncpy(destination, source, size - 1);
+    destination[size - 1] = L'\0';
+    return 0;
+}
+
+template<size_t N, typename... Args>
+inline int sprintf_s(char (&buffer)[N], const char* format, Args... args) {
+    return std::snprintf(buffer, N, format, args...);
+}
+
+// Numbers only: MSVC reads %s as a wide string here, glibc does not
+template<size_t N, typename... Args>
+inline int swprintf_s(wchar_t (&buffer)[N], const wchar_t* format, Args... args) {
+    return std::swprintf(buffer, N, format, args...);
+}
+
+template<typename... Args>
+inline int swprintf_s(wchar_t* buffer, size_t size, const wchar_t* format, Args... args) {
+    return std::swprintf(buffer, size, format, args...);
+}
+
+template<typename... Args>
+inline int swscanf_s(const wchar_t* text, const wchar_t* format, Args... args) {
+    return std::swscanf(text, format, args...);
+}
+
+template<size_t N>
+inline int _itow_s(int value, wchar_t (&buffer)[N], int) {
+    return std::swprintf(buffer, N, L"%d", value) < 0 ? EINVAL : 0;
+}
+
+inline int _wtoi(const wchar_t* text) { return static_cast<int>(std::wcstol(text, nullptr, 10)); }
+inline ULONGLONG _wcstoui64(const wchar_t* text, wchar_t** end, int base) { return std::wcstoull(text, end, base); }
+
+inline int _wcsicmp(const wchar_t* a, const wchar_t* b) {
+    for (; *a && std::towlower(*a) == std::towlower(*b); a++, b++) {}
+    return static_cast<int>(std::towlower(*a)) - static_cast<int>(std::towlower(*b));
+}
+
+inline int _wcsnicmp(const wchar_t* a, const wchar_t* b, size_t count) {
+    for (; count > 1 && *a && std::towlower(*a) == std::towlower(*b); a++, b++, count--) {}
+    return count == 0 ? 0 : static_cast<int>(std::towlower(*a)) - static_cast<int>(std::towlower(*b));
+}
+
+// Settings files are not emulated: reads give the defaults, writes fail
+
+inline DWORD GetPrivateProfileString(LPCWSTR, LPCWSTR, LPCWSTR defaultValue, LPWSTR buffer, DWORD size, LPCWSTR) {
+    if (size == 0) return 0;
+    std::wcsncpy(buffer, defaultValue ? defaultValue : L"", size - 1);
+    buffer[size - 1] = L'\0';
+    return static_cast<DWORD>(std::wcslen(buffer));
+}
+
+inline UINT GetPrivateProfileInt(LPCWSTR, LPCWSTR, INT defaultValue, LPCWSTR) { return static_cast<UINT>(defaultValue); }
+inline DWORD GetPrivateProfileSection(LPCWSTR, LPWSTR buffer, DWORD size, LPCWSTR) {
+    if (size >= 2) buffer[0] = buffer[1] = L'\0';
+    return 0;
+}
+inline BOOL WritePrivateProfileString(LPCWSTR, LPCWSTR, LPCWSTR, LPCWSTR) { return FALSE; }
+inline BOOL WritePrivateProfileSection(LPCWSTR, LPCWSTR, LPCWSTR) { return FALSE; }
+
+// Clocks and threads
+
+inline DWORD GetTickCount() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<DWORD>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* counter) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    counter->QuadPart = static_cast<LONGLONG>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    return TRUE;
+}
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency) {
+    frequency->QuadPart = 1000000000;
+    return TRUE;
+}
+
+inline void GetSystemTimeAsFileTime(FILETIME* time) {
+    ULONGLONG now = Win32Compat::Now();
+    time->dwLowDateTime = static_cast<DWORD>(now);
+    time->dwHighDateTime = static_cast<DWORD>(now >> 32);
+}
+
+// Multiples of four, as on Windows
+inline DWORD GetCurrentThreadId() {
+    static std::atomic<DWORD> next(1);
+    static thread_local DWORD id = next.fetch_add(1) * 4;
+    return id;
+}
+inline DWORD GetCurrentProcessId() { return static_cast<DWORD>(getpid()); }
+inline BOOL ProcessIdToSessionId(DWORD, DWORD* sessionId) {
+    *sessionId = 0;
+    return TRUE;
+}
+
+inline LPTOP_LEVEL_EXCEPTION_FILTER SetUnhandledExceptionFilter(LPTOP_LEVEL_EXCEPTION_FILTER) { return nullptr; }
+
+// Events. One lock and condition variable serve all of them, which is
+// plenty for tests.
+
+namespace Win32Compat {
+    struct Event {
+        bool manualReset;
+        bool signaled;
+    };
+
+    struct EventTable {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::set<HANDLE> events;
+    };
+
+    inline EventTable& Events() {
+        static EventTable table;
+        return table;
+    }
+
+    // Index of the first signaled handle, consuming an auto-reset signal,
+    // or -1. Called with the table locked.
+    inline int TakeSignaled(const HANDLE* handles, DWORD count) {
+        for (DWORD i = 0; i < count; i++) {
+            Event* event = static_cast<Event*>(handles[i]);
+            if (event->signaled) {
+                if (!event->manualReset) event->signaled = false;
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+}
+
+inline HANDLE CreateEvent(LPSECURITY_ATTRIBUTES, BOOL manualReset, BOOL initialState, LPCWSTR) {
+    Win32Compat::EventTable& table = Win32Compat::Events();
+    HANDLE event = new Win32Compat::Event{ manualReset != FALSE, initialState != FALSE };
+    std::lock_guard<std::mutex> lock(table.mutex);
+    table.events.insert(event);
+    return event;
+}
+
+inline BOOL SetEvent(HANDLE event) {
+    Win32Compat::EventTable& table = Win32Compat::Events();
+    {
+        std::lock_guard<std::mutex> lock(table.mutex);
+        static_cast<Win32Compat::Event*>(event)->signaled = true;
+    }
+    table.changed.notify_all();
+    return TRUE;
+}
+
+inline BOOL ResetEvent(HANDLE event) {
+    std::lock_guard<std::mutex> lock(Win32Compat::Events().mutex);
+    static_cast<Win32Compat::Event*>(event)->signaled = false;
+    return TRUE;
+}
+
+inline DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL, DWORD timeoutMs) {
+    Win32Compat::EventTable& table = Win32Compat::Events();
+    std::unique_lock<std::mutex> lock(table.mutex);
+    int signaled = -1;
+    auto ready = [&]() { return (signaled = Win32Compat::TakeSignaled(handles, count)) >= 0; };
+    if (timeoutMs == INFINITE) {
+        table.changed.wait(lock, ready);
+    } else if (!table.changed.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready)) {
+        return WAIT_TIMEOUT;
+    }
+    return WAIT_OBJECT_0 + static_cast<DWORD>(signaled);
+}
+
+inline DWORD WaitForSingleObject(HANDLE handle, DWORD timeoutMs) {
+    return WaitForMultipleObjects(1, &handle, FALSE, timeoutMs);
+}
+
+inline void Sleep(DWORD milliseconds) {
+    usleep(static_cast<useconds_t>(milliseconds) * 1000);
+}
+
+inline void YieldProcessor() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Files
+
+inline HANDLE CreateFile(LPCWSTR path, DWORD access, DWORD, LPSECURITY_ATTRIBUTES, DWORD disposition, DWORD, HANDLE) {
+    int flags = (access & GENERIC_READ) && (access & GENERIC_WRITE) ? O_RDWR : (access & GENERIC_WRITE) ? O_WRONLY : O_RDONLY;
+    switch (disposition) {
+        case CREATE_NEW: flags |= O_CREAT | O_EXCL; break;
+        case CREATE_ALWAYS: flags |= O_CREAT | O_TRUNC; break;
+        case OPEN_ALWAYS: flags |= O_CREAT; break;
+        default: break;
+    }
+
+    int fd = open(Win32Compat::Narrow(path).c_str(), flags, 0644);
+    if (fd < 0) {
+        SetLastError(static_cast<DWORD>(errno));
+        return INVALID_HANDLE_VALUE;
+    }
+    return Win32Compat::FromFd(fd);
+}
+
+inline BOOL CloseHandle(HANDLE handle) {
+    if (handle == Win32Compat::FAKE_PROCESS) return TRUE;
+    {
+        Win32Compat::EventTable& table = Win32Compat::Events();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        if (table.events.erase(handle)) {
+            delete static_cast<Win32Compat::Event*>(handle);
+            return TRUE;
+        }
+    }
+    return close(Win32Compat::ToFd(handle)) == 0;
+}
+
+inline BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, LPOVERLAPPED) {
+    ssize_t count = ::read(Win32Compat::ToFd(file), buffer, size);
+    if (read) *read = count > 0 ? static_cast<DWORD>(count) : 0;
+    return count >= 0;
+}
+
+inline BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, LPOVERLAPPED) {
+    ssize_t count = ::write(Win32Compat::ToFd(file), buffer, size);
+    if (written) *written = count > 0 ? static_cast<DWORD>(count) : 0;
+    return count >= 0;
+}
+
+inline BOOL FlushFileBuffers(HANDLE file) {
+    return fsync(Win32Compat::ToFd(file)) == 0;
+}
+
+inline BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size) {
+    struct stat info;
+    if (fstat(Win32Compat::ToFd(file), &info) != 0) return FALSE;
+    size->QuadPart = info.st_size;
+    return TRUE;
+}
+
+inline BOOL SetFilePointerEx(HANDLE file, LARGE_INTEGER distance, LARGE_INTEGER* position, DWORD method) {
+    int whence = method == FILE_BEGIN ? SEEK_SET : method == FILE_CURRENT ? SEEK_CUR : SEEK_END;
+    off_t offset = lseek(Win32Compat::ToFd(file), static_cast<off_t>(distance.QuadPart), whence);
+    if (offset < 0) return FALSE;
+    if (position) position->QuadPart = offset;
+    return TRUE;
+}
+
+inline BOOL SetEndOfFile(HANDLE file) {
+    int fd = Win32Compat::ToFd(file);
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    return offset >= 0 && ftruncate(fd, offset) == 0;
+}
+
+inline BOOL MoveFileEx(LPCWSTR from, LPCWSTR to, DWORD) {
+    return rename(Win32Compat::Narrow(from).c_str(), Win32Compat::Narrow(to).c_str()) == 0;
+}
+
+inline BOOL DeleteFile(LPCWSTR path) {
+    return unlink(Win32Compat::Narrow(path).c_str()) == 0;
+}
+
+// A mapping is a duplicate of the file's descriptor; views are shared mmaps.
+// Sections backed by the page file are unnamed shared memory files. Named
+// ones stay in a table by name until the process exits rather than until
+// the last handle closes, so a publisher that restarts finds its old page
+// as readers would keep it alive on Windows. A forked child inherits the
+// table, which is how tests stand in for other sessions opening a section
+// in the Global\ namespace. Creating one there fails unless
+// GlobalObjectsAllowed(), like a session without SeCreateGlobalPrivilege.
+
+namespace Win32Compat {
+    struct ViewTable {
+        std::mutex mutex;
+        std::map<void*, size_t> sizes;
+    };
+
+    inline ViewTable& Views() {
+        static ViewTable table;
+        return table;
+    }
+
+    struct SectionTable {
+        std::mutex mutex;
+        std::map<std::wstring, int> named;
+    };
+
+    inline SectionTable& Sections() {
+        static SectionTable table;
+        return table;
+    }
+
+    // An unnamed file the size of the section; the label shows in smaps
+    inline int CreateSectionFile(const char* label, off_t size) {
+#ifdef __linux__
+        int fd = memfd_create(label, 0);
+#else
+        static std::atomic<unsigned> counter{ 0 };
+        std::string path = "/dit-" + std::to_string(getpid()) + "-" + std::to_string(counter.fetch_add(1)) + "-" + label;
+        int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) shm_unlink(path.c_str());
+#endif
+        if (fd >= 0 && ftruncate(fd, size) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    inline bool& GlobalObjectsAllowed() {
+        static bool allowed = true;
+        return allowed;
+    }
+}
+
+inline HANDLE CreateFileMapping(HANDLE file, LPSECURITY_ATTRIBUTES, DWORD, DWORD sizeHigh, DWORD sizeLow, LPCWSTR name) {
+    off_t size = static_cast<off_t>((static_cast<uint64_t>(sizeHigh) << 32) | sizeLow);
+    if (file == INVALID_HANDLE_VALUE) {
+        Win32Compat::SectionTable& table = Win32Compat::Sections();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto found = name ? table.named.find(name) : table.named.end();
+        if (found != table.named.end()) {
+            int mapping = dup(found->second);
+            SetLastError(ERROR_ALREADY_EXISTS);
+            return mapping < 0 ? nullptr : Win32Compat::FromFd(mapping);
+        }
+        if (name && std::wcsncmp(name, L"Global\\", 7) == 0 && !Win32Compat::GlobalObjectsAllowed()) {
+            SetLastError(ERROR_ACCESS_DENIED);
+            return nullptr;
+        }
+        SetLastError(0);
+        int section = Win32Compat::CreateSectionFile(name ? Win32Compat::Narrow(name).c_str() : "section", size);
+        if (section < 0) {
+            return nullptr;
+        }
+        if (!name) {
+            return Win32Compat::FromFd(section);
+        }
+        table.named[name] = section;
+        int mapping = dup(section);
+        return mapping < 0 ? nullptr : Win32Compat::FromFd(mapping);
+    }
+
+    int fd = Win32Compat::ToFd(file);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size > info.st_size && ftruncate(fd, size) != 0)) {
+        return nullptr;
+    }
+    int mapping = dup(fd);
+    return mapping < 0 ? nullptr : Win32Compat::FromFd(mapping);
+}
+
+inline HANDLE OpenFileMapping(DWORD, BOOL, LPCWSTR name) {
+    Win32Compat::SectionTable& table = Win32Compat::Sections();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto found = table.named.find(name);
+    if (found == table.named.end()) {
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return nullptr;
+    }
+    int mapping = dup(found->second);
+    return mapping < 0 ? nullptr : Win32Compat::FromFd(mapping);
+}
+
+inline LPVOID MapViewOfFile(HANDLE mapping, DWORD, DWORD offsetHigh, DWORD offsetLow, SIZE_T size) {
+    int fd = Win32Compat::ToFd(mapping);
+    off_t offset = static_cast<off_t>((static_cast<uint64_t>(offsetHigh) << 32) | offsetLow);
+    struct stat info;
+    if (size == 0) {
+        if (fstat(fd, &info) != 0) return nullptr;
+        size = static_cast<SIZE_T>(info.st_size - offset);
+    }
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    if (view == MAP_FAILED) return nullptr;
+    Win32Compat::ViewTable& table = Win32Compat::Views();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    table.sizes[view] = size;
+    return view;
+}
+
+inline BOOL UnmapViewOfFile(LPCVOID view) {
+    Win32Compat::ViewTable& table = Win32Compat::Views();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto found = table.sizes.find(const_cast<void*>(view));
+    if (found == table.sizes.end()) return FALSE;
+    munmap(found->first, found->second);
+    table.sizes.erase(found);
+    return TRUE;
+}
+
+// Windows, input and other processes do not exist here, except for one
+// fake window at a time that a test installs (see FakeListView in
+// commctrl.h). Its owner "process" shares our address space.
+
+namespace Win32Compat {
+    struct FakeWindow {
+        LONG style = 0;
+        int transfersLeft = -1; // Read/WriteProcessMemory calls that succeed; -1 = all
+        std::atomic<size_t> posted{ 0 }; // PostMessage calls; nothing delivers them
+        RECT client = { 0, 0, 1920, 1080 };
+
+        FakeWindow() { Current() = this; }
+        virtual ~FakeWindow() { Current() = nullptr; }
+        FakeWindow(const FakeWindow&) = delete;
+        FakeWindow& operator=(const FakeWindow&) = delete;
+
+        HWND Handle() { return this; }
+        virtual LRESULT OnMessage(UINT message, WPARAM wParam, LPARAM lParam) = 0;
+
+        bool Transfer() {
+            if (transfersLeft == 0) return false;
+            if (transfersLeft > 0) transfersLeft--;
+            return true;
+        }
+
+        static FakeWindow*& Current() {
+            static FakeWindow* window = nullptr;
+            return window;
+        }
+
+        static FakeWindow* Find(HWND window) {
+            return window && window == static_cast<HWND>(Current()) ? Current() : nullptr;
+        }
+    };
+}
+
+inline BOOL IsWindow(HWND window) { return Win32Compat::FakeWindow::Find(window) != nullptr; }
+inline LONG GetWindowLong(HWND window, int index) {
+    Win32Compat::FakeWindow* fake = Win32Compat::FakeWindow::Find(window);
+    return fake && index == GWL_STYLE ? fake->style : 0;
+}
+inline LRESULT SendMessage(HWND window, UINT message, WPARAM wParam, LPARAM lParam) {
+    Win32Compat::FakeWindow* fake = Win32Compat::FakeWindow::Find(window);
+    return fake ? fake->OnMessage(message, wParam, lParam) : 0;
+}
+inline BOOL PostMessage(HWND window, UINT, WPARAM, LPARAM) {
+    Win32Compat::FakeWindow* fake = Win32Compat::FakeWindow::Find(window);
+    if (fake) fake->posted.fetch_add(1);
+    return fake != nullptr;
+}
+inline BOOL InvalidateRect(HWND window, const RECT*, BOOL) { return IsWindow(window); }
+inline DWORD GetWindowThreadProcessId(HWND window, LPDWORD processId) {
+    DWORD id = IsWindow(window) ? Win32Compat::FAKE_PROCESS_ID : 0;
+    if (processId) *processId = id;
+    return id;
+}
+inline BOOL ClientToScreen(HWND window, POINT*) { return IsWindow(window); }
+inline BOOL GetClientRect(HWND window, RECT* rect) {
+    Win32Compat::FakeWindow* fake = Win32Compat::FakeWindow::Find(window);
+    if (fake) *rect = fake->client;
+    return fake != nullptr;
+}
+inline BOOL EqualRect(const RECT* a, const RECT* b) {
+    return a->left == b->left && a->top == b->top && a->right == b->right && a->bottom == b->bottom;
+}
+
+enum : int { SM_CXDOUBLECLK = 36, SM_CYDOUBLECLK = 37 };
+inline int GetSystemMetrics(int index) {
+    return index == SM_CXDOUBLECLK || index == SM_CYDOUBLECLK ? 4 : 0;
+}
+inline UINT GetDoubleClickTime() { return 500; }
+
+// Thread messages queue up per thread until taken. A low-level mouse hook
+// is only recorded; SendMouseInput() runs it on the caller's thread, where
+// Windows would run it inside the hook thread's GetMessage().
+
+enum : UINT { WM_QUIT = 0x0012, WM_LBUTTONDOWN = 0x0201 };
+enum : UINT { PM_NOREMOVE = 0, PM_REMOVE = 1 };
+enum : int { WH_MOUSE_LL = 14, HC_ACTION = 0, THREAD_PRIORITY_HIGHEST = 2 };
+struct MSG { HWND hwnd; UINT message; WPARAM wParam; LPARAM lParam; DWORD time; POINT pt; };
+struct MSLLHOOKSTRUCT { POINT pt; DWORD mouseData; DWORD flags; DWORD time; ULONG_PTR dwExtraInfo; };
+typedef HANDLE HHOOK;
+typedef LRESULT (CALLBACK* HOOKPROC)(int, WPARAM, LPARAM);
+
+namespace Win32Compat {
+    struct ThreadQueues {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::map<DWORD, std::deque<MSG>> queues;
+    };
+
+    inline ThreadQueues& Queues() {
+        static ThreadQueues queues;
+        return queues;
+    }
+
+    inline HOOKPROC& MouseHook() {
+        static HOOKPROC hook = nullptr;
+        return hook;
+    }
+
+    inline LRESULT SendMouseInput(UINT message, MSLLHOOKSTRUCT& event) {
+        HOOKPROC hook = MouseHook();
+        return hook ? hook(HC_ACTION, message, reinterpret_cast<LPARAM>(&event)) : 0;
+    }
+}
+
+inline BOOL PeekMessage(MSG* message, HWND, UINT, UINT, UINT flags) {
+    Win32Compat::ThreadQueues& table = Win32Compat::Queues();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    std::deque<MSG>& queue = table.queues[GetCurrentThreadId()];
+    if (queue.empty()) return FALSE;
+    *message = queue.front();
+    if (flags & PM_REMOVE) queue.pop_front();
+    return TRUE;
+}
+inline BOOL GetMessage(MSG* message, HWND, UINT, UINT) {
+    Win32Compat::ThreadQueues& table = Win32Compat::Queues();
+    std::unique_lock<std::mutex> lock(table.mutex);
+    std::deque<MSG>& queue = table.queues[GetCurrentThreadId()];
+    table.changed.wait(lock, [&]() { return !queue.empty(); });
+    *message = queue.front();
+    queue.pop_front();
+    return message->message != WM_QUIT;
+}
+inline BOOL PostThreadMessage(DWORD threadId, UINT message, WPARAM wParam, LPARAM lParam) {
+    Win32Compat::ThreadQueues& table = Win32Compat::Queues();
+    {
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto found = table.queues.find(threadId);
+        if (found == table.queues.end()) return FALSE;
+        found->second.push_back(MSG{ nullptr, message, wParam, lParam, 0, {} });
+    }
+    table.changed.notify_all();
+    return TRUE;
+}
+
+inline HMODULE GetModuleHandle(LPCWSTR) { return nullptr; }
+inline HANDLE GetCurrentThread() { return reinterpret_cast<HANDLE>(static_cast<intptr_t>(-3)); }
+inline BOOL SetThreadPriority(HANDLE, int) { return TRUE; }
+inline HHOOK SetWindowsHookEx(int type, HOOKPROC proc, HMODULE, DWORD) {
+    if (type != WH_MOUSE_LL || Win32Compat::MouseHook()) return nullptr;
+    Win32Compat::MouseHook() = proc;
+    return reinterpret_cast<HHOOK>(&Win32Compat::MouseHook());
+}
+inline BOOL UnhookWindowsHookEx(HHOOK hook) {
+    if (hook != reinterpret_cast<HHOOK>(&Win32Compat::MouseHook())) return FALSE;
+    Win32Compat::MouseHook() = nullptr;
+    return TRUE;
+}
+inline LRESULT CallNextHookEx(HHOOK, int, WPARAM, LPARAM) { return 0; }
+
+// Monitors are the rectangles a test puts in FakeMonitors(), named
+// \\.\DISPLAY1 and up in that order; the window's client origin is the
+// virtual screen's
+
+enum : DWORD { MONITOR_DEFAULTTONULL = 0 };
+struct MONITORINFOEX { DWORD cbSize; RECT rcMonitor; RECT rcWork; DWORD dwFlags; WCHAR szDevice[32]; };
+typedef BOOL (CALLBACK* MONITORENUMPROC)(HMONITOR, HDC, LPRECT, LPARAM);
+
+namespace Win32Compat {
+    inline std::vector<RECT>& FakeMonitors() {
+        static std::vector<RECT> monitors;
+        return monitors;
+    }
+}
+
+inline BOOL PtInRect(const RECT* rect, POINT point) {
+    return point.x >= rect->left && point.x < rect->right && point.y >= rect->top && point.y < rect->bottom;
+}
+inline BOOL OffsetRect(RECT* rect, int dx, int dy) {
+    rect->left += dx;
+    rect->right += dx;
+    rect->top += dy;
+    rect->bottom += dy;
+    return TRUE;
+}
+inline BOOL EnumDisplayMonitors(HDC, const RECT*, MONITORENUMPROC callback, LPARAM context) {
+    std::vector<RECT>& monitors = Win32Compat::FakeMonitors();
+    for (size_t i = 0; i < monitors.size(); i++) {
+        if (!callback(reinterpret_cast<HMONITOR>(i + 1), nullptr, &monitors[i], context)) break;
+    }
+    return TRUE;
+}
+inline BOOL GetMonitorInfo(HMONITOR monitor, MONITORINFOEX* info) {
+    size_t index = reinterpret_cast<size_t>(monitor) - 1;
+    if (index >= Win32Compat::FakeMonitors().size()) return FALSE;
+    info->rcMonitor = info->rcWork = Win32Compat::FakeMonitors()[index];
+    info->dwFlags = index == 0 ? 1 : 0;
+    std::swprintf(info->szDevice, 32, L"\\\\.\\DISPLAY%zu", index + 1);
+    return TRUE;
+}
+inline HMONITOR MonitorFromPoint(POINT point, DWORD) {
+    std::vector<RECT>& monitors = Win32Compat::FakeMonitors();
+    for (size_t i = 0; i < monitors.size(); i++) {
+        if (PtInRect(&monitors[i], point)) return reinterpret_cast<HMONITOR>(i + 1);
+    }
+    return nullptr;
+}
+inline BOOL RegisterRawInputDevices(const RAWINPUTDEVICE*, UINT, UINT) { return FALSE; }
+inline HANDLE GetCurrentProcess() { return reinterpret_cast<HANDLE>(static_cast<intptr_t>(-1)); }
+inline BOOL IsWow64Process(HANDLE, BOOL* wow64) {
+    *wow64 = FALSE;
+    return TRUE;
+}
+inline HANDLE OpenProcess(DWORD, BOOL, DWORD processId) {
+    return processId == Win32Compat::FAKE_PROCESS_ID && Win32Compat::FakeWindow::Current() ? Win32Compat::FAKE_PROCESS : nullptr;
+}
+inline LPVOID VirtualAllocEx(HANDLE process, LPVOID, SIZE_T size, DWORD, DWORD) {
+    return process == Win32Compat::FAKE_PROCESS ? std::calloc(1, size) : nullptr;
+}
+inline BOOL VirtualFreeEx(HANDLE process, LPVOID address, SIZE_T, DWORD) {
+    if (process != Win32Compat::FAKE_PROCESS) return FALSE;
+    std::free(address);
+    return TRUE;
+}
+inline BOOL ReadProcessMemory(HANDLE process, LPCVOID address, LPVOID buffer, SIZE_T size, SIZE_T* read) {
+    Win32Compat::FakeWindow* fake = Win32Compat::FakeWindow::Current();
+    if (process != Win32Compat::FAKE_PROCESS || !fake || !fake->Transfer()) return FALSE;
+    std::memcpy(buffer, address, size);
+    if (read) *read = size;
+    return TRUE;
+}
+inline BOOL WriteProcessMemory(HANDLE process, LPVOID address, LPCVOID buffer, SIZE_T size, SIZE_T* written) {
+    Win32Compat::FakeWindow* fake = Win32Compat::FakeWindow::Current();
+    if (process != Win32Compat::FAKE_PROCESS || !fake || !fake->Transfer()) return FALSE;
+    std::memcpy(address, buffer, size);
+    if (written) *written = size;
+    return TRUE;
+}
+
+// GDI draws nothing; a DIB section is zeroed memory that stays as it is
+
+enum : DWORD { BI_RGB = 0 };
+enum : UINT { DIB_RGB_COLORS = 0 };
+enum : int { PS_SOLID = 0, WHITE_BRUSH = 0 };
+typedef DWORD COLORREF;
+typedef HANDLE HGDIOBJ;
+typedef HANDLE HBITMAP;
+typedef HANDLE HBRUSH;
+typedef HANDLE HPEN;
+#define RGB(r, g, b) ((COLORREF)(((BYTE)(r)) | ((WORD)((BYTE)(g)) << 8) | (((DWORD)(BYTE)(b)) << 16)))
+
+struct BITMAPINFOHEADER {
+    DWORD biSize;
+    LONG biWidth;
+    LONG biHeight;
+    WORD biPlanes;
+    WORD biBitCount;
+    DWORD biCompression;
+    DWORD biSizeImage;
+    LONG biXPelsPerMeter;
+    LONG biYPelsPerMeter;
+    DWORD biClrUsed;
+    DWORD biClrImportant;
+};
+struct RGBQUAD { BYTE rgbBlue, rgbGreen, rgbRed, rgbReserved; };
+struct BITMAPINFO { BITMAPINFOHEADER bmiHeader; RGBQUAD bmiColors[1]; };
+
+namespace Win32Compat {
+    struct GdiObject {
+        std::vector<uint32_t> bits;
+    };
+
+    inline GdiObject& StockObject() {
+        static GdiObject stock;
+        return stock;
+    }
+}
+
+inline HDC GetDC(HWND) { return &Win32Compat::StockObject(); }
+inline int ReleaseDC(HWND, HDC) { return 1; }
+inline HDC CreateCompatibleDC(HDC) { return new Win32Compat::GdiObject(); }
+inline BOOL DeleteDC(HDC dc) {
+    delete static_cast<Win32Compat::GdiObject*>(dc);
+    return TRUE;
+}
+inline HBITMAP CreateDIBSection(HDC, const BITMAPINFO* info, UINT, void** bits, HANDLE, DWORD) {
+    LONG height = info->bmiHeader.biHeight < 0 ? -info->bmiHeader.biHeight : info->bmiHeader.biHeight;
+    auto* bitmap = new Win32Compat::GdiObject();
+    bitmap->bits.resize(static_cast<size_t>(info->bmiHeader.biWidth) * static_cast<size_t>(height));
+    *bits = bitmap->bits.data();
+    return bitmap;
+}
+inline HPEN CreatePen(int, int, COLORREF) { return new Win32Compat::GdiObject(); }
+inline HGDIOBJ GetStockObject(int) { return &Win32Compat::StockObject(); }
+inline HGDIOBJ SelectObject(HDC, HGDIOBJ) { return &Win32Compat::StockObject(); }
+inline BOOL DeleteObject(HGDIOBJ object) {
+    if (object != &Win32Compat::StockObject()) delete static_cast<Win32Compat::GdiObject*>(object);
+    return TRUE;
+}
+inline int FillRect(HDC, const RECT*, HBRUSH) { return 1; }
+inline BOOL Rectangle(HDC, int, int, int, int) { return TRUE; }
+inline BOOL MoveToEx(HDC, int, int, POINT*) { return TRUE; }
+inline BOOL LineTo(HDC, int, int) { return TRUE; }
+inline BOOL GdiFlush() { return TRUE; }